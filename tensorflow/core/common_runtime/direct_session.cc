@@ -73,6 +73,7 @@ limitations under the License.
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/profiler/lib/connected_traceme.h"
@@ -144,6 +145,39 @@ thread::ThreadPool* GlobalThreadPool(const SessionOptions& options) {
   return thread_pool;
 }
 
+// Returns the process-wide inter op thread pools of the NUMA nodes, indexed by
+// node. They are sized for the devices of the first session that uses them:
+// each node's pool gets the share of the inter op threads that the node's
+// devices make up. Devices without a NUMA node count towards node 0, whose
+// pool also stands in for the global one. Nodes without devices get no pool.
+const std::vector<thread::ThreadPool*>& GlobalNumaThreadPools(
+    const SessionOptions& options, const DeviceMgr* device_mgr) {
+  static const std::vector<thread::ThreadPool*>* const thread_pools = [&] {
+    const int num_nodes = port::NUMANumNodes();
+    const std::vector<Device*> devices = device_mgr->ListDevices();
+    std::vector<int> num_node_devices(num_nodes, 0);
+    for (const Device* device : devices) {
+      const int numa_node = device->attributes().locality().numa_node();
+      if (numa_node >= 0 && numa_node < num_nodes) {
+        ++num_node_devices[numa_node];
+      } else {
+        ++num_node_devices[0];
+      }
+    }
+    // Node 0 always gets a pool, even without devices.
+    num_node_devices[0] = std::max(num_node_devices[0], 1);
+    const int num_devices = std::max<int>(devices.size(), 1);
+    auto* thread_pools = new std::vector<thread::ThreadPool*>(num_nodes);
+    for (int node = 0; node < num_nodes; ++node) {
+      if (num_node_devices[node] == 0) continue;
+      (*thread_pools)[node] = NewNumaThreadPoolFromSessionOptions(
+          options, node, num_node_devices[node], num_devices);
+    }
+    return thread_pools;
+  }();
+  return *thread_pools;
+}
+
 // TODO(vrv): Figure out how to unify the many different functions
 // that generate RendezvousKey, since many of them have to be
 // consistent with each other.
@@ -338,7 +372,15 @@ DirectSession::DirectSession(const SessionOptions& options,
     thread_pools_.emplace_back(NewThreadPoolFromSessionOptions(options_),
                                true /* owned */);
   } else {
-    thread_pools_.emplace_back(GlobalThreadPool(options), false /* owned */);
+    if (options_.config.experimental().use_numa_affinity() &&
+        port::NUMAEnabled()) {
+      // The pool of node 0 stands in for the global one, which is not created,
+      // e.g. for the partitions of devices without a NUMA node.
+      numa_thread_pools_ = GlobalNumaThreadPools(options, device_mgr_.get());
+      thread_pools_.emplace_back(numa_thread_pools_[0], false /* owned */);
+    } else {
+      thread_pools_.emplace_back(GlobalThreadPool(options), false /* owned */);
+    }
     // Run locally if environment value of TF_NUM_INTEROP_THREADS is negative
     // and config.inter_op_parallelism_threads is unspecified or negative.
     static const int env_num_threads = NumInterOpThreadsFromEnvironment();
@@ -706,9 +748,15 @@ Status DirectSession::RunInternal(
 
   Status run_status;
 
+  // With NUMA affinity, the partitions of the step run on the inter op thread
+  // pool of their device's NUMA node rather than the global one.
+  const bool use_numa_thread_pools = !numa_thread_pools_.empty() &&
+                                     pool == thread_pools_[0].first &&
+                                     handler_ptr == nullptr;
+
   auto set_threadpool_args_for_item =
-      [&default_runner, &handler](const PerPartitionExecutorsAndLib& item,
-                                  Executor::Args* args) {
+      [this, &default_runner, &handler, use_numa_thread_pools](
+          const PerPartitionExecutorsAndLib& item, Executor::Args* args) {
         // TODO(azaks): support partial run.
         // TODO(azaks): if the device picks its own threadpool, we need to
         // assign
@@ -717,7 +765,15 @@ Status DirectSession::RunInternal(
             item.device->tensorflow_device_thread_pool();
         // TODO(crk): Investigate usage of RunHandlerPool when using device
         // specific thread pool(s).
-        if (!device_thread_pool) {
+        const int numa_node = item.device->attributes().locality().numa_node();
+        if (!device_thread_pool && use_numa_thread_pools && numa_node >= 0 &&
+            numa_node < numa_thread_pools_.size() &&
+            numa_thread_pools_[numa_node] != nullptr) {
+          thread::ThreadPool* numa_thread_pool = numa_thread_pools_[numa_node];
+          args->runner = [numa_thread_pool](Executor::Args::Closure c) {
+            numa_thread_pool->Schedule(std::move(c));
+          };
+        } else if (!device_thread_pool) {
           args->runner = default_runner;
         } else {
           args->runner = [device_thread_pool](Executor::Args::Closure c) {
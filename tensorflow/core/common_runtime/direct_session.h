@@ -350,6 +350,12 @@ class DirectSession : public Session {
   // is owned.
   std::vector<std::pair<thread::ThreadPool*, bool>> thread_pools_;
 
+  // With NUMA affinity and the process-wide inter op thread pools, the inter
+  // op thread pools of the NUMA nodes, indexed by node. They replace the
+  // global pool, and thread_pools_[0] is the one of node 0. Nodes without
+  // devices have no pool (nullptr). Not owned.
+  std::vector<thread::ThreadPool*> numa_thread_pools_;
+
   Status init_error_;  // Set to an error if construction failed.
 
   // If true, blocks until device has finished all queued operations in a step.
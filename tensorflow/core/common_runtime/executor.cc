@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -48,6 +49,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/edgeset.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_node_util.h"
@@ -77,6 +79,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/determinism.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/managed_stack_trace.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
 
@@ -87,6 +90,46 @@ namespace {
 // 1-D, 0 element tensor.
 static const Tensor* const kEmptyTensor = new Tensor;
 
+// The `ExecutorState` whose work-stealing worker is running on this thread,
+// and the index of that worker. Used to push newly ready nodes onto the deque
+// of the worker that produced them.
+thread_local const void* current_worker_state = nullptr;
+thread_local int current_worker_id = -1;
+
+// Returns the number of work-stealing workers to use when
+// `Executor::Args::work_stealing_num_workers` is not set. Zero disables work
+// stealing.
+int DefaultWorkStealingNumWorkers() {
+  static const int num_workers = []() {
+    int64_t value = 0;
+    Status s =
+        ReadInt64FromEnvVar("TF_EXECUTOR_WORK_STEALING_WORKERS", 0, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to read TF_EXECUTOR_WORK_STEALING_WORKERS: " << s;
+      return 0;
+    }
+    return static_cast<int>(std::max<int64_t>(value, 0));
+  }();
+  return num_workers;
+}
+
+// Returns true if critical-path scheduling is enabled for all executors by the
+// TF_EXECUTOR_CRITICAL_PATH_SCHEDULING environment variable.
+bool CriticalPathSchedulingFromEnv() {
+  static const bool enabled = []() {
+    bool value = false;
+    Status s = ReadBoolFromEnvVar("TF_EXECUTOR_CRITICAL_PATH_SCHEDULING",
+                                  false, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to read TF_EXECUTOR_CRITICAL_PATH_SCHEDULING: "
+                 << s;
+      return false;
+    }
+    return value;
+  }();
+  return enabled;
+}
+
 // Helper routines for collecting step stats.
 namespace nodestats {
 inline int64_t NowInNsec() { return EnvTime::NowNanos(); }
@@ -149,6 +192,10 @@ class ExecutorImpl : public Executor {
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
     kernel_stats_.Initialize(immutable_state_.graph_view());
+    const LocalExecutorParams& params = immutable_state_.params();
+    if (params.critical_path_scheduling || CriticalPathSchedulingFromEnv()) {
+      kernel_stats_.InitializePriorities(immutable_state_.graph_view(), graph);
+    }
     return OkStatus();
   }
 
@@ -207,17 +254,107 @@ class ExecutorImpl : public Executor {
       cost_estimate.store(new_estimate, std::memory_order_relaxed);
     }
 
+    // Enables critical-path scheduling by computing the priority of every
+    // node: the estimated cost, in cycles, of the most expensive path from the
+    // node to a sink.
+    void InitializePriorities(const GraphView& gview, const Graph& graph) {
+      const int32_t num_nodes = gview.num_nodes();
+      std::vector<Node*> order;
+      GetReversePostOrder(graph, &order);
+      topo_order_.clear();
+      topo_order_.reserve(order.size());
+      topo_position_.assign(num_nodes, 0);
+      for (Node* n : order) {
+        topo_position_[n->id()] = topo_order_.size();
+        topo_order_.push_back(n->id());
+      }
+      priorities_ = std::make_unique<std::atomic_uint_fast64_t[]>(num_nodes);
+      mutex_lock l(priorities_mu_);
+      UpdatePriorities(gview);
+    }
+
+    // Returns true if critical-path scheduling is enabled.
+    bool HasPriorities() const { return priorities_ != nullptr; }
+
+    // Returns the priority of the given node. Nodes with a higher priority
+    // should be started first.
+    uint64 Priority(const NodeItem& node) const {
+      return priorities_[node.node_id].load(std::memory_order_relaxed);
+    }
+
+    // Recomputes the priorities from the latest cost estimates once every
+    // `kPriorityUpdateInterval` calls. Called once per step.
+    void MaybeUpdatePriorities(const GraphView& gview) {
+      if (priorities_ == nullptr ||
+          num_priority_update_calls_.fetch_add(1, std::memory_order_relaxed) %
+                  kPriorityUpdateInterval !=
+              kPriorityUpdateInterval - 1) {
+        return;
+      }
+      mutex_lock l(priorities_mu_);
+      UpdatePriorities(gview);
+    }
+
    private:
+    // Returns the cost used to compute priorities for the given node.
+    uint64 PriorityCost(const NodeItem& node) const {
+      const int32_t id = node.node_id;
+      if (is_expensive_[id]) {
+        const uint64 estimate =
+            cost_estimates_[id].load(std::memory_order_relaxed);
+        if (estimate != kInitialCostEstimateCycles) return estimate;
+      }
+      return is_expensive_[id] ? kOpIsExpensiveThresholdCycles : 1;
+    }
+
+    // Computes the priorities in reverse topological order, so that the
+    // priorities of a node's successors are final before the node's own. Back
+    // edges, which only exist in loops, are ignored.
+    void UpdatePriorities(const GraphView& gview)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(priorities_mu_) {
+      for (auto it = topo_order_.rbegin(); it != topo_order_.rend(); ++it) {
+        const int32_t id = *it;
+        const NodeItem* item = gview.node(id);
+        if (item == nullptr) continue;
+        uint64 max_successor_priority = 0;
+        auto visit_successor = [&](int32_t dst_id) {
+          if (topo_position_[dst_id] > topo_position_[id]) {
+            max_successor_priority = std::max<uint64>(
+                max_successor_priority,
+                priorities_[dst_id].load(std::memory_order_relaxed));
+          }
+        };
+        for (const EdgeInfo& e : item->output_edges()) {
+          visit_successor(e.dst_id);
+        }
+        for (const ControlEdgeInfo& e : item->output_control_edges()) {
+          visit_successor(e.dst_id);
+        }
+        priorities_[id].store(PriorityCost(*item) + max_successor_priority,
+                              std::memory_order_relaxed);
+      }
+    }
+
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
     // Operations start out "expensive".
     static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
     static constexpr uint64 kOpIsExpensiveThresholdCycles = 8000;
     static constexpr uint64 kCostDecay = 10;
+    // Number of steps between two recomputations of the priorities.
+    static constexpr uint64 kPriorityUpdateInterval = 100;
 
     std::vector<bool> is_expensive_;
     // std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+
+    // Critical-path scheduling state. `priorities_` is null if critical-path
+    // scheduling is disabled.
+    std::vector<int32> topo_order_;
+    std::vector<int32> topo_position_;
+    std::unique_ptr<std::atomic_uint_fast64_t[]> priorities_;
+    std::atomic<uint64> num_priority_update_calls_{0};
+    mutex priorities_mu_;
   };
 
   ImmutableExecutorState immutable_state_;
@@ -342,6 +479,30 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c, int sample_rate = 0);
 
+  // Work stealing. When `num_workers_ > 0`, expensive ready nodes are pushed
+  // onto per-worker deques instead of being passed to `RunTask()` one by one.
+  // A worker pops from the back of its own deque, which favors the nodes it
+  // made ready most recently and whose inputs are still in its cache, and
+  // steals from the front of its peers' deques when its own is empty.
+
+  // Pushes `nodes` onto the deque of the calling worker, or spreads them over
+  // all deques if the caller is not a worker of this step, and starts idle
+  // workers to run them.
+  void EnqueueForWorkers(const TaggedNodeSeq& nodes);
+
+  // Starts worker `id` unless it is already running. Returns true if the
+  // worker was started.
+  bool MaybeStartWorker(int id);
+
+  // Runs nodes until no deque has any left.
+  void RunWorker(int id);
+
+  // Pops a node from the deque of worker `id`, or steals one from a peer.
+  absl::optional<TaggedNode> PopOrSteal(int id);
+
+  // Reports the work-stealing statistics of this step.
+  void RecordWorkStealingStats();
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -392,6 +553,25 @@ class ExecutorState {
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
+  // If true, nodes that become ready together are started in decreasing order
+  // of `KernelStats::Priority()`.
+  const bool critical_path_scheduling_;
+
+  // A deque of ready nodes owned by one work-stealing worker.
+  struct alignas(64) WorkerQueue {
+    mutex mu;
+    std::deque<TaggedNode> nodes TF_GUARDED_BY(mu);
+    // Per-step statistics.
+    int64_t num_local_runs TF_GUARDED_BY(mu) = 0;
+    int64_t num_stolen TF_GUARDED_BY(mu) = 0;
+    int64_t max_depth TF_GUARDED_BY(mu) = 0;
+    // True while a closure running `RunWorker()` for this deque is scheduled.
+    std::atomic<bool> active{false};
+  };
+  const int num_workers_;
+  std::unique_ptr<WorkerQueue[]> worker_queues_;
+  std::atomic<uint64> next_worker_queue_{0};
+  std::atomic<int64_t> num_inline_runs_{0};
 
   PropagatorStateType propagator_;
 
@@ -440,6 +620,11 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
+      critical_path_scheduling_(kernel_stats->HasPriorities()),
+      num_workers_(args.run_all_kernels_inline ? 0
+                   : args.work_stealing_num_workers > 0
+                       ? args.work_stealing_num_workers
+                       : DefaultWorkStealingNumWorkers()),
       propagator_(immutable_state, step_id_, vlog_),
       num_outstanding_ops_(0) {
   if (args.user_intra_op_threadpool != nullptr) {
@@ -447,6 +632,9 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (num_workers_ > 0) {
+    worker_queues_.reset(new WorkerQueue[num_workers_]);
+  }
 }
 
 template <class PropagatorStateType>
@@ -481,6 +669,138 @@ void ExecutorState<PropagatorStateType>::RunTask(Closure&& c, int sample_rate) {
   });
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::EnqueueForWorkers(
+    const TaggedNodeSeq& nodes) {
+  const int num_nodes = nodes.size();
+  if (current_worker_state == this) {
+    // Keep the nodes on this worker's deque, and wake up idle peers to steal
+    // them while this worker is busy with the nodes it runs inline. Owners pop
+    // from the back, so push the nodes in reverse to run them in order.
+    const int id = current_worker_id;
+    {
+      WorkerQueue& queue = worker_queues_[id];
+      mutex_lock l(queue.mu);
+      queue.nodes.insert(queue.nodes.end(), nodes.rbegin(), nodes.rend());
+      queue.max_depth =
+          std::max<int64_t>(queue.max_depth, queue.nodes.size());
+    }
+    int num_started = 0;
+    for (int i = 1; i < num_workers_ && num_started < num_nodes; ++i) {
+      if (MaybeStartWorker((id + i) % num_workers_)) ++num_started;
+    }
+  } else {
+    const int first_id =
+        next_worker_queue_.fetch_add(num_nodes, std::memory_order_relaxed) %
+        num_workers_;
+    const int num_queues = std::min(num_nodes, num_workers_);
+    for (int i = 0; i < num_queues; ++i) {
+      const int id = (first_id + i) % num_workers_;
+      {
+        WorkerQueue& queue = worker_queues_[id];
+        mutex_lock l(queue.mu);
+        const int last = i + (num_nodes - 1 - i) / num_queues * num_queues;
+        for (int j = last; j >= i; j -= num_queues) {
+          queue.nodes.push_back(nodes[j]);
+        }
+        queue.max_depth =
+            std::max<int64_t>(queue.max_depth, queue.nodes.size());
+      }
+      MaybeStartWorker(id);
+    }
+  }
+}
+
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::MaybeStartWorker(int id) {
+  if (worker_queues_[id].active.exchange(true)) return false;
+  // A running worker counts as an outstanding op, so that this state is not
+  // deleted while the worker is still looking for nodes to run.
+  num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+  RunTask([this, id]() { RunWorker(id); });
+  return true;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RunWorker(int id) {
+  profiler::TraceMe traceme("ExecutorState::RunWorker",
+                            profiler::TraceMeLevel::kVerbose);
+  const void* const prev_worker_state = current_worker_state;
+  const int prev_worker_id = current_worker_id;
+  current_worker_state = this;
+  current_worker_id = id;
+
+  WorkerQueue& queue = worker_queues_[id];
+  while (true) {
+    absl::optional<TaggedNode> tagged_node = PopOrSteal(id);
+    if (tagged_node.has_value()) {
+      Process(*tagged_node, stats_collector_ ? nodestats::NowInNsec() : 0);
+      continue;
+    }
+    queue.active.store(false);
+    // A producer that pushed onto this deque after `PopOrSteal()` found it
+    // empty, but before `active` was cleared, did not start a new worker, so
+    // check again before leaving.
+    bool empty;
+    {
+      mutex_lock l(queue.mu);
+      empty = queue.nodes.empty();
+    }
+    if (empty || queue.active.exchange(true)) break;
+  }
+
+  current_worker_state = prev_worker_state;
+  current_worker_id = prev_worker_id;
+  if (num_outstanding_ops_.fetch_sub(1) == 1) ScheduleFinish();
+}
+
+template <class PropagatorStateType>
+absl::optional<typename PropagatorStateType::TaggedNode>
+ExecutorState<PropagatorStateType>::PopOrSteal(int id) {
+  {
+    WorkerQueue& queue = worker_queues_[id];
+    mutex_lock l(queue.mu);
+    if (!queue.nodes.empty()) {
+      TaggedNode tagged_node = queue.nodes.back();
+      queue.nodes.pop_back();
+      ++queue.num_local_runs;
+      return tagged_node;
+    }
+  }
+  for (int i = 1; i < num_workers_; ++i) {
+    WorkerQueue& victim = worker_queues_[(id + i) % num_workers_];
+    mutex_lock l(victim.mu);
+    if (!victim.nodes.empty()) {
+      TaggedNode tagged_node = victim.nodes.front();
+      victim.nodes.pop_front();
+      ++victim.num_stolen;
+      return tagged_node;
+    }
+  }
+  return absl::nullopt;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::RecordWorkStealingStats() {
+  int64_t num_local_runs = 0;
+  int64_t num_steals = 0;
+  int64_t max_queue_depth = 0;
+  for (int i = 0; i < num_workers_; ++i) {
+    WorkerQueue& queue = worker_queues_[i];
+    mutex_lock l(queue.mu);
+    num_local_runs += queue.num_local_runs;
+    num_steals += queue.num_stolen;
+    max_queue_depth = std::max(max_queue_depth, queue.max_depth);
+  }
+  const int64_t num_inline_runs = num_inline_runs_.load();
+  metrics::RecordGraphWorkStealingStep(num_local_runs, num_steals,
+                                       num_inline_runs, max_queue_depth);
+  VLOG(1) << "Step " << step_id_ << " work stealing: " << num_workers_
+          << " workers, " << num_local_runs << " local runs, " << num_steals
+          << " steals, " << num_inline_runs << " inline runs, max queue depth "
+          << max_queue_depth;
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
   TaggedNodeSeq ready;
@@ -1236,6 +1556,25 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     scheduled_nsec = nodestats::NowInNsec();
   }
 
+  if (critical_path_scheduling_ && ready->size() > 1) {
+    // Start the nodes on the longest remaining paths first. The priorities are
+    // read once, since they may be updated concurrently.
+    std::vector<std::pair<uint64, TaggedNode>> by_priority;
+    by_priority.reserve(ready->size());
+    for (const TaggedNode& tagged_node : *ready) {
+      by_priority.emplace_back(
+          kernel_stats_->Priority(tagged_node.get_node_item()), tagged_node);
+    }
+    std::stable_sort(by_priority.begin(), by_priority.end(),
+                     [](const std::pair<uint64, TaggedNode>& a,
+                        const std::pair<uint64, TaggedNode>& b) {
+                       return a.first > b.first;
+                     });
+    for (size_t i = 0; i < by_priority.size(); ++i) {
+      (*ready)[i] = by_priority[i].second;
+    }
+  }
+
   if (run_all_kernels_inline_) {
     if (inline_ready == nullptr) {
       // Schedule all ready kernels from a single closure. This ensure that,
@@ -1256,6 +1595,11 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
     if (inline_ready == nullptr) {
+      if (num_workers_ > 0) {
+        EnqueueForWorkers(*ready);
+        ready->clear();
+        return;
+      }
       // Schedule to run all the ready ops in thread pool.
       for (auto& tagged_node : *ready) {
         RunTask([=]() { Process(tagged_node, scheduled_nsec); },
@@ -1267,10 +1611,13 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
           // Inline this inexpensive node.
           inline_ready->push_back(tagged_node);
+        } else if (curr_expensive_node == nullptr) {
+          curr_expensive_node = &tagged_node;
+        } else if (critical_path_scheduling_) {
+          // Keep the first expensive node, which has the highest priority.
+          expensive_nodes.push_back(tagged_node);
         } else {
-          if (curr_expensive_node) {
-            expensive_nodes.push_back(*curr_expensive_node);
-          }
+          expensive_nodes.push_back(*curr_expensive_node);
           curr_expensive_node = &tagged_node;
         }
       }
@@ -1281,10 +1628,18 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       } else {
         // There are inline nodes to run already. We dispatch this expensive
         // node to other thread.
-        expensive_nodes.push_back(*curr_expensive_node);
+        if (critical_path_scheduling_) {
+          expensive_nodes.insert(expensive_nodes.begin(), *curr_expensive_node);
+        } else {
+          expensive_nodes.push_back(*curr_expensive_node);
+        }
       }
     }
-    if (!expensive_nodes.empty()) {
+    if (num_workers_ > 0) {
+      num_inline_runs_.fetch_add(ready->size() - expensive_nodes.size(),
+                                 std::memory_order_relaxed);
+      if (!expensive_nodes.empty()) EnqueueForWorkers(expensive_nodes);
+    } else if (!expensive_nodes.empty()) {
       if (expensive_nodes.size() < kInlineScheduleReadyThreshold) {
         for (auto& tagged_node : expensive_nodes) {
           RunTask(std::bind(&ExecutorState::Process, this, tagged_node,
@@ -1358,6 +1713,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
   mu_.unlock();
   int64_t step_id = step_id_;
   CHECK(done_cb != nullptr);
+  if (num_workers_ > 0) RecordWorkStealingStats();
   Device* device = immutable_state_.params().device;
 
   if (vlog_ && !status.ok() && VLOG_IS_ON(1)) {
@@ -1465,6 +1821,7 @@ void ExecutorState<PropagatorStateType>::Finish() {
 }
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  kernel_stats_.MaybeUpdatePriorities(immutable_state_.graph_view());
   if (OpOrderDeterminismRequired()) {
     (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
                                                &kernel_stats_))
@@ -118,6 +118,14 @@ class Executor {
     // If true, all kernels will be treated as "inexpensive", and hence executed
     // on the scheduling thread.
     bool run_all_kernels_inline = false;
+
+    // If positive, expensive ready nodes are queued on this many per-step
+    // worker deques instead of being dispatched to "runner" one at a time.
+    // Each worker drains its own deque and steals from its peers when idle,
+    // so "runner" is invoked at most once per idle worker. If zero, the value
+    // of the TF_EXECUTOR_WORK_STEALING_WORKERS environment variable is used.
+    // Ignored if `run_all_kernels_inline` is true.
+    int work_stealing_num_workers = 0;
   };
   typedef std::function<void(const Status&)> DoneCallback;
   virtual void RunAsync(const Args& args, DoneCallback done) = 0;
@@ -39,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
@@ -73,10 +74,12 @@ class ExecutorTest : public ::testing::Test {
   }
 
   // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
+  void Create(std::unique_ptr<const Graph> graph,
+              bool critical_path_scheduling = false) {
     const int version = graph->versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
+    params.critical_path_scheduling = critical_path_scheduling;
     params.create_kernel =
         [this, version](const std::shared_ptr<const NodeProperties>& props,
                         OpKernel** kernel) {
@@ -92,11 +95,12 @@ class ExecutorTest : public ::testing::Test {
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
-  Status Run(Rendezvous* rendez) {
+  Status Run(Rendezvous* rendez, int work_stealing_num_workers = 0) {
     Executor::Args args;
     args.rendezvous = rendez;
     args.stats_collector = &step_stats_collector_;
     args.runner = runner_;
+    args.work_stealing_num_workers = work_stealing_num_workers;
     return exec_->Run(args);
   }
 
@@ -261,6 +265,63 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  monitoring::testing::CellReader<int64_t> nodes_reader(
+      "/tensorflow/core/graph_work_stealing_nodes");
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_, /*work_stealing_num_workers=*/4));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+  // The "Add" nodes start out expensive, so they are run by the workers.
+  EXPECT_GT(nodes_reader.Delta("local") + nodes_reader.Delta("stolen"), 0);
+}
+
+TEST_F(ExecutorTest, CriticalPathSchedulingStartsLongestChainFirst) {
+  // "short_add" and "long_add" become ready together. "short_add" comes first
+  // in FIFO order, but "long_add" heads a chain of five adds.
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* in = test::graph::Constant(g.get(), V(1.0));
+  Node* short_add = test::graph::Add(g.get(), in, in);
+  Node* long_add = test::graph::Add(g.get(), in, in);
+  Node* v = long_add;
+  for (int i = 0; i < 4; ++i) {
+    v = test::graph::Add(g.get(), v, v);
+  }
+  FixupSourceAndSinkEdges(g.get());
+  const string short_name = short_add->name();
+  const string long_name = long_add->name();
+  Create(std::move(g), /*critical_path_scheduling=*/true);
+
+  // Run all kernels on one thread, so that the stats record the order in
+  // which the nodes were started.
+  Executor::Args args;
+  args.stats_collector = &step_stats_collector_;
+  args.runner = runner_;
+  args.run_all_kernels_inline = true;
+  TF_ASSERT_OK(exec_->Run(args));
+  step_stats_collector_.Finalize();
+
+  std::vector<string> order;
+  for (const auto& dev_stats : step_stats_.dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      order.push_back(node_stats.node_name());
+    }
+  }
+  auto long_it = std::find(order.begin(), order.end(), long_name);
+  auto short_it = std::find(order.begin(), order.end(), short_name);
+  ASSERT_NE(long_it, order.end());
+  ASSERT_NE(short_it, order.end());
+  EXPECT_LT(long_it, short_it);
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -296,6 +357,23 @@ TEST_F(ExecutorTest, ConcurrentAddAssign) {
     rendez->Unref();
   }
 }
+
+TEST_F(ExecutorTest, ConcurrentAddAssignWorkStealing) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildConcurrentAddAssign(g.get());
+  Create(std::move(g));
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(Run(rendez, /*work_stealing_num_workers=*/8));
+    Rendezvous::Args args;
+    Tensor out;
+    bool is_dead;
+    TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"), args, &out,
+                              &is_dead));
+    EXPECT_LE(V(out), 1025.0);
+    rendez->Unref();
+  }
+}
 #endif
 
 TEST_F(ExecutorTest, SimpleSwitchLive) {
@@ -489,6 +567,68 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+// Create a graph with 'width' independent chains of four element-wise adds
+// over a tensor large enough for each add to be scheduled as an expensive op,
+// and run it with 'num_workers' work-stealing workers (0 for the default
+// scheduling).
+static void BM_WorkStealing(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int num_workers = state.range(1);
+  constexpr int kDepth = 4;
+
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Tensor t(DT_FLOAT, TensorShape({1 << 16}));
+  t.flat<float>().setConstant(1.0);
+  Node* in = test::graph::Constant(g.get(), t);
+  for (int i = 0; i < width; ++i) {
+    Node* n = in;
+    for (int j = 0; j < kDepth; ++j) {
+      n = test::graph::Add(g.get(), n, in);
+    }
+  }
+  FixupSourceAndSinkEdges(g.get());
+
+  std::unique_ptr<Device> device =
+      DeviceFactory::NewDevice("CPU", {}, "/job:localhost/replica:0/task:0");
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  Executor* exec = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *g, &exec));
+  std::unique_ptr<Executor> exec_owner(exec);
+
+  thread::ThreadPool* pool = ComputePool(SessionOptions());
+  Executor::Args args;
+  args.runner = [pool](std::function<void()> fn) { pool->Schedule(fn); };
+  args.work_stealing_num_workers = num_workers;
+  for (auto s : state) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+
+  const int64_t num_nodes = 1 + width * kDepth;
+  state.SetLabel(strings::StrCat("Nodes = ", num_nodes));
+  state.SetItemsProcessed(num_nodes * static_cast<int64_t>(state.iterations()));
+}
+
+// Compare the default scheduling with work stealing on wide graphs.
+BENCHMARK(BM_WorkStealing)
+    ->UseRealTime()
+    ->ArgPair(256, 0)
+    ->ArgPair(256, 4)
+    ->ArgPair(256, 16)
+    ->ArgPair(4096, 0)
+    ->ArgPair(4096, 4)
+    ->ArgPair(4096, 16);
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
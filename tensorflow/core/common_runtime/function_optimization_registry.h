@@ -65,6 +65,9 @@ class FunctionOptimizationPassRegistry {
              std::vector<std::string>* control_ret_node_names,
              bool* control_rets_updated);
 
+  // Returns whether the registry contains a pass.
+  bool HasPass() const { return pass_ != nullptr; }
+
   // Returns the global registry of function graph passes.
   static FunctionOptimizationPassRegistry& Global();
 
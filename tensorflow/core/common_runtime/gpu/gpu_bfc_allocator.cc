@@ -21,6 +21,7 @@ limitations under the License.
 #include <string>
 #include <utility>
 
+#include "absl/strings/numbers.h"
 #include "tensorflow/tsl/framework/bfc_allocator.h"
 #include "tensorflow/tsl/platform/logging.h"
 
@@ -80,6 +81,45 @@ bool GetGarbageCollectionValue() {
       << " Using the default value \"true\".";
   return true;
 }
+
+bool GetSmallAllocationCacheValue() {
+  const char* small_allocation_cache =
+      std::getenv("TF_GPU_BFC_SMALL_ALLOCATION_CACHE");
+  if (small_allocation_cache == nullptr) {
+    return false;
+  }
+  if (strcmp("false", small_allocation_cache) == 0) {
+    return false;
+  } else if (strcmp("true", small_allocation_cache) == 0) {
+    return true;
+  }
+
+  LOG(ERROR)
+      << "The TF_GPU_BFC_SMALL_ALLOCATION_CACHE environment variable is set"
+      << " but could not be parsed: \"" << small_allocation_cache << "\"."
+      << " Valid values are \"true\" or \"false\"."
+      << " Using the default value \"false\".";
+  return false;
+}
+
+int64_t GetAllocationTraceSizeValue() {
+  const char* allocation_trace_size =
+      std::getenv("TF_GPU_BFC_ALLOCATION_TRACE_SIZE");
+  if (allocation_trace_size == nullptr) {
+    return 0;
+  }
+  int64_t value;
+  if (absl::SimpleAtoi(allocation_trace_size, &value) && value >= 0) {
+    return value;
+  }
+
+  LOG(ERROR)
+      << "The TF_GPU_BFC_ALLOCATION_TRACE_SIZE environment variable is set"
+      << " but could not be parsed: \"" << allocation_trace_size << "\"."
+      << " Valid values are non-negative integers."
+      << " Using the default value 0.";
+  return 0;
+}
 }  // anonymous namespace
 
 GPUBFCAllocator::GPUBFCAllocator(
@@ -95,6 +135,16 @@ GPUBFCAllocator::GPUBFCAllocator(
           o.garbage_collection = GetGarbageCollectionValue();
         }
         o.fragmentation_fraction = opts.fragmentation_fraction;
+        if (opts.small_allocation_cache.has_value()) {
+          o.small_allocation_cache = *opts.small_allocation_cache;
+        } else {
+          o.small_allocation_cache = GetSmallAllocationCacheValue();
+        }
+        if (opts.allocation_trace_size.has_value()) {
+          o.allocation_trace_size = *opts.allocation_trace_size;
+        } else {
+          o.allocation_trace_size = GetAllocationTraceSizeValue();
+        }
         return o;
       }()) {}
 
@@ -46,6 +46,14 @@ class GPUBFCAllocator : public tsl::BFCAllocator {
 
     double fragmentation_fraction = 0;
     bool allow_retry_on_failure = true;
+
+    // If nullopt, defaults to TF_GPU_BFC_SMALL_ALLOCATION_CACHE, or false if
+    // that envvar is not present.
+    std::optional<bool> small_allocation_cache;
+
+    // If nullopt, defaults to TF_GPU_BFC_ALLOCATION_TRACE_SIZE, or 0 (no
+    // trace) if that envvar is not present.
+    std::optional<int64_t> allocation_trace_size;
   };
 
   GPUBFCAllocator(std::unique_ptr<tsl::SubAllocator> sub_allocator,
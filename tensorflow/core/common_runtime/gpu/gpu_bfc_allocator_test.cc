@@ -22,6 +22,7 @@ limitations under the License.
 #include <optional>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/compiler/xla/stream_executor/device_id_utils.h"
 #include "tensorflow/compiler/xla/stream_executor/gpu/gpu_driver.h"
 #include "tensorflow/compiler/xla/stream_executor/gpu/gpu_init.h"
@@ -32,8 +33,10 @@ limitations under the License.
 #include "tensorflow/core/protobuf/bfc_memory_map.pb.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/tsl/framework/device_id.h"
+#include "tensorflow/tsl/lib/core/bits.h"
 #include "tensorflow/tsl/lib/gtl/inlined_vector.h"
 #include "tensorflow/tsl/lib/random/simple_philox.h"
+#include "tensorflow/tsl/platform/blocking_counter.h"
 #include "tensorflow/tsl/platform/logging.h"
 #include "tensorflow/tsl/platform/strcat.h"
 #include "tensorflow/tsl/platform/test.h"
@@ -251,6 +254,65 @@ TEST_P(GPUBFCAllocatorTest, AllocatedVsRequested) {
   a.DeallocateRaw(t1);
 }
 
+TEST_P(GPUBFCAllocatorTest, SmallAllocationCache) {
+  GPUBFCAllocator::Options opts;
+  opts.small_allocation_cache = true;
+  GPUBFCAllocator a(GetParam()(1ull << 32), 1 << 30, "GPU_0_bfc", opts);
+
+  std::vector<void*> ptrs;
+  absl::flat_hash_set<int64_t> ids;
+  for (int s = 1; s <= 4096; s += 13) {
+    void* raw = a.AllocateRaw(1, s);
+    ASSERT_NE(raw, nullptr);
+    EXPECT_EQ(s, a.RequestedSize(raw));
+    EXPECT_EQ(std::max<size_t>(256, NextPowerOfTwo64(s)),
+              a.AllocatedSize(raw));
+    EXPECT_TRUE(ids.insert(a.AllocationId(raw)).second);
+    ptrs.push_back(raw);
+  }
+  // Larger allocations bypass the cache.
+  void* large = a.AllocateRaw(1, 4097);
+  EXPECT_EQ(4352, a.AllocatedSize(large));
+
+  std::optional<AllocatorStats> stats = a.GetStats();
+  EXPECT_EQ(ptrs.size(), stats->num_slab_allocs);
+  EXPECT_GT(stats->slab_bytes_in_use, 0);
+  EXPECT_GT(stats->slab_bytes_reserved, 0);
+  // The slabs are regular allocations.
+  EXPECT_EQ(stats->slab_bytes_reserved + 4352, stats->bytes_in_use);
+
+  for (void* raw : ptrs) {
+    a.DeallocateRaw(raw);
+  }
+  a.DeallocateRaw(large);
+  stats = a.GetStats();
+  EXPECT_EQ(0, stats->slab_bytes_in_use);
+  a.ClearStats();
+  EXPECT_EQ(0, a.GetStats()->num_slab_allocs);
+}
+
+TEST_P(GPUBFCAllocatorTest, SmallAllocationCacheReleasesSlabs) {
+  GPUBFCAllocator::Options opts;
+  opts.small_allocation_cache = true;
+  GPUBFCAllocator a(GetParam()(1ull << 32), 2 << 20, "GPU_0_bfc", opts);
+
+  // Fill the memory with slabs, then free their objects.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < (2 << 20) / 4096; ++i) {
+    ptrs.push_back(a.AllocateRaw(1, 4096));
+  }
+  for (void* raw : ptrs) {
+    a.DeallocateRaw(raw);
+  }
+  EXPECT_GT(a.GetStats()->slab_bytes_reserved, 0);
+
+  // The empty slabs are returned to make room for a large allocation.
+  void* large = a.AllocateRaw(1, 1 << 20);
+  EXPECT_NE(nullptr, large);
+  EXPECT_EQ(0, a.GetStats()->slab_bytes_reserved);
+  a.DeallocateRaw(large);
+}
+
 TEST_P(GPUBFCAllocatorTest, TestCustomMemoryLimit) {
   // Configure a 2MiB byte limit
   GPUBFCAllocator a(GetParam()(1ull << 32), 2 << 20, "GPU_0_bfc", {});
@@ -401,6 +463,44 @@ static void BM_AllocationThreaded(::testing::benchmark::State& state) {
 
 BENCHMARK(BM_AllocationThreaded)->Arg(1)->Arg(4)->Arg(16);
 
+static void BM_SmallAllocationThreaded(::testing::benchmark::State& state) {
+  const bool small_allocation_cache = state.range(0);
+  const int num_threads = state.range(1);
+  constexpr int kSubIters = 1000;
+  GPUBFCAllocator::Options opts;
+  opts.small_allocation_cache = small_allocation_cache;
+  GPUBFCAllocator a(CreateSubAllocator(1ul << 36), 1uLL << 33, "GPU_0_bfc",
+                    opts);
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; t++) {
+      pool.Schedule([&a, &counter]() {
+        // Small allocations, a few of them live at a time.
+        std::vector<int> sizes = {64, 256, 512, 1024, 4096, 100, 2000, 3000};
+        std::vector<void*> ptrs(sizes.size());
+        for (int i = 0; i < kSubIters; i++) {
+          for (int j = 0; j < sizes.size(); j++) {
+            ptrs[j] = a.AllocateRaw(1, sizes[j]);
+          }
+          for (void* p : ptrs) {
+            a.DeallocateRaw(p);
+          }
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+}
+
+BENCHMARK(BM_SmallAllocationThreaded)
+    ->ArgPair(0, 1)
+    ->ArgPair(1, 1)
+    ->ArgPair(0, 16)
+    ->ArgPair(1, 16);
+
 // A more complex benchmark that defers deallocation of an object for
 // "delay" allocations.
 static void BM_AllocationDelayed(::testing::benchmark::State& state) {
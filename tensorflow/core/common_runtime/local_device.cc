@@ -149,9 +149,16 @@ LocalDevice::LocalDevice(const SessionOptions& options,
   } else {
     // Each LocalDevice owns a separate ThreadPoolDevice for numerical
     // computations.
-    // TODO(tucker): NUMA for these too?
-    owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(
-        options, port::kNUMANoAffinity, nullptr));
+    if (options.config.experimental().use_numa_affinity()) {
+      int numa_node = attributes.locality().numa_node();
+      DCHECK_LT(numa_node, port::NUMANumNodes());
+      owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(
+          options, numa_node,
+          ProcessState::singleton()->GetCPUAllocator(numa_node)));
+    } else {
+      owned_tp_info_.reset(new LocalDevice::EigenThreadPoolInfo(
+          options, port::kNUMANoAffinity, nullptr));
+    }
     tp_info = owned_tp_info_.get();
   }
   set_tensorflow_cpu_worker_threads(&tp_info->eigen_worker_threads_);
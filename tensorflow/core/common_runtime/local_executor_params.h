@@ -52,6 +52,13 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // If true, nodes that become ready at the same time are started in
+  // decreasing order of the estimated cost of the longest path from each node
+  // to the end of the graph, so that long chains start first. Can also be
+  // enabled for all executors by setting the
+  // TF_EXECUTOR_CRITICAL_PATH_SCHEDULING environment variable.
+  bool critical_path_scheduling = false;
 };
 
 }  // end namespace tensorflow
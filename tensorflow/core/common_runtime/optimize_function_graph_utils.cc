@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/optimize_function_graph_utils.h"
 
+#include <stdlib.h>
+
 #include <algorithm>
 #include <iterator>
 #include <memory>
@@ -30,10 +32,19 @@ limitations under the License.
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_node_util.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/str_util.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/core/util/dump_graph.h"
 
 namespace tensorflow {
 namespace {
+// Environment variables configuring the graph optimization passes.
+constexpr const char* kFunctionGraphCacheKeyEnvVars[] = {
+    "TF_XLA_FLAGS", "TF_ENABLE_ONEDNN_OPTS"};
+
 Status ValidateNoListArguments(
     const protobuf::RepeatedPtrField<OpDef::ArgDef>& args, const char* arg_type,
     const string& function_name) {
@@ -334,12 +345,16 @@ Status PinArgsAndRets(const std::vector<string>& input_devices,
   return OkStatus();
 }
 
-StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraph(
+namespace {
+
+// Like OptimizeFunctionGraph(), and sets `optimize_graph_fn_status` to the
+// status of `options.optimize_graph_fn`, whose failures are otherwise ignored.
+StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraphInternal(
     const string& function_name, AttrSlice attrs,
     const FunctionLibraryRuntime::InstantiateOptions& options,
     const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
     const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
-    Device* default_device, Env* env) {
+    Device* default_device, Env* env, Status* optimize_graph_fn_status) {
   const FunctionLibraryDefinition* lib_def =
       options.lib_def == nullptr ? input_lib_def : options.lib_def;
 
@@ -468,9 +483,21 @@ StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraph(
 
   if (options.optimize_graph_fn) {
     DumpGraph("Before running graph optimization fn", graph.get());
+    const uint64 start_us = env->NowMicros();
     Status status = options.optimize_graph_fn(
         std::move(ret_node_names), std::move(control_ret_node_names),
         &reachable_lib_def, dev_set, cpu_device, &graph);
+    // Grappler only logs the optimizers that outlast its deadline, and returns
+    // the graph as they left it.
+    const int64_t timeout_ms = options.config_proto.graph_options()
+                                   .rewrite_options()
+                                   .meta_optimizer_timeout_ms();
+    if (status.ok() && timeout_ms > 0 &&
+        env->NowMicros() - start_us > timeout_ms * 1000) {
+      status = errors::DeadlineExceeded(
+          "Graph optimization exceeded its deadline of ", timeout_ms, " ms");
+    }
+    *optimize_graph_fn_status = status;
     if (!status.ok()) {
       LOG(WARNING) << "Ignoring multi-device function optimization failure: "
                    << status.ToString();
@@ -494,4 +521,224 @@ StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraph(
                                     ret_nodes.size()};
 }
 
+}  // namespace
+
+StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraph(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
+    Device* default_device, Env* env) {
+  Status optimize_graph_fn_status;
+  return OptimizeFunctionGraphInternal(
+      function_name, attrs, options, dev_set, input_lib_def, composite_devices,
+      cpu_device, default_device, env, &optimize_graph_fn_status);
+}
+
+StatusOr<uint64> GetFunctionGraphCacheKey(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    Device* default_device) {
+  const FunctionLibraryDefinition* lib_def =
+      options.lib_def == nullptr ? input_lib_def : options.lib_def;
+  const FunctionDef* fdef = lib_def->Find(function_name);
+  if (fdef == nullptr) {
+    return errors::InvalidArgument("Failed to find function \"", function_name,
+                                   "\" in function library: ", lib_def);
+  }
+
+  // The library and the state handle only identify objects of this process.
+  FunctionLibraryRuntime::InstantiateOptions key_options = options;
+  key_options.lib_def = nullptr;
+  key_options.state_handle.clear();
+  uint64 key = Fingerprint64(Canonicalize(function_name, attrs, key_options));
+  key = FingerprintCat64(
+      key, Fingerprint64(strings::StrCat(
+               options.is_component_function, ",",
+               options.shape_inference_on_tfe_dialect_import, ",",
+               options.optimize_graph_fn != nullptr, ",",
+               options.xla_compile_device_type, ",",
+               default_device == nullptr ? "" : default_device->name())));
+
+  key = FingerprintCat64(key, FunctionDefHash(*fdef));
+  const FunctionLibraryDefinition reachable_lib_def =
+      lib_def->ReachableDefinitions(*fdef);
+  std::vector<string> function_names = reachable_lib_def.ListFunctionNames();
+  std::sort(function_names.begin(), function_names.end());
+  for (const string& name : function_names) {
+    key = FingerprintCat64(key, Fingerprint64(name));
+    key = FingerprintCat64(key, FunctionDefHash(*reachable_lib_def.Find(name)));
+  }
+
+  std::vector<string> devices;
+  for (const Device* device : dev_set.devices()) {
+    devices.push_back(
+        strings::StrCat(device->name(), ":", device->device_type()));
+  }
+  std::sort(devices.begin(), devices.end());
+  for (const string& device : devices) {
+    key = FingerprintCat64(key, Fingerprint64(device));
+  }
+
+  // The passes registered in this process and their configuration. Passes of
+  // the same phase are registered in an unspecified order.
+  std::vector<string> passes;
+  if (FunctionOptimizationPassRegistry::Global().HasPass()) {
+    passes.push_back("FunctionOptimizationPass");
+  }
+  for (const auto& group : OptimizationPassRegistry::Global()->groups()) {
+    for (const auto& phase : group.second) {
+      for (const auto& pass : phase.second) {
+        passes.push_back(
+            strings::StrCat(group.first, ":", phase.first, ":", pass->name()));
+      }
+    }
+  }
+  std::sort(passes.begin(), passes.end());
+  for (const string& pass : passes) {
+    key = FingerprintCat64(key, Fingerprint64(pass));
+  }
+  for (const char* env_var : kFunctionGraphCacheKeyEnvVars) {
+    const char* value = getenv(env_var);
+    key = FingerprintCat64(
+        key, Fingerprint64(strings::StrCat(env_var, "=",
+                                           value == nullptr ? "" : value)));
+  }
+
+  return FingerprintCat64(
+      key, Fingerprint64(
+               strings::StrCat(TF_VERSION_STRING, TF_GRAPH_DEF_VERSION)));
+}
+
+string GetFunctionGraphCacheFileName(const string& cache_dir,
+                                     const string& function_name, uint64 key) {
+  string file_name = strings::StrCat(function_name, "_", strings::Hex(key),
+                                     ".pb");
+  // Function names may hold characters that aren't allowed in file names.
+  for (char& c : file_name) {
+    if (!isalnum(c) && c != '_' && c != '.' && c != '-') c = '_';
+  }
+  return io::JoinPath(cache_dir, file_name);
+}
+
+void TrimFunctionGraphCache(Env* env, const string& cache_dir,
+                            int64_t max_bytes) {
+  std::vector<string> children;
+  Status status = env->GetChildren(cache_dir, &children);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to list the function graph cache " << cache_dir
+                 << ": " << status;
+    return;
+  }
+  struct Entry {
+    int64_t mtime_nsec;
+    int64_t length;
+    string file_name;
+  };
+  std::vector<Entry> entries;
+  int64_t total_bytes = 0;
+  for (const string& child : children) {
+    // Leaves the temporary files alone, other processes may be writing them.
+    if (!str_util::EndsWith(child, ".pb")) continue;
+    const string file_name = io::JoinPath(cache_dir, child);
+    FileStatistics stat;
+    if (!env->Stat(file_name, &stat).ok()) continue;
+    entries.push_back({stat.mtime_nsec, stat.length, file_name});
+    total_bytes += stat.length;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+              return a.mtime_nsec < b.mtime_nsec;
+            });
+  for (const Entry& entry : entries) {
+    if (total_bytes <= max_bytes) break;
+    // Another process may have removed it already.
+    env->DeleteFile(entry.file_name).IgnoreError();
+    total_bytes -= entry.length;
+    VLOG(1) << "Evicted " << entry.file_name
+            << " from the function graph cache";
+  }
+}
+
+StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraphOrReadFromFileCache(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
+    Device* default_device, Env* env, const string& cache_dir,
+    int64_t cache_max_bytes) {
+  // Graphs with composite devices depend on the resources of this process, and
+  // graphs being collected for debugging must be optimized afresh.
+  if (cache_dir.empty() || !composite_devices.empty() ||
+      options.graph_collector != nullptr) {
+    return OptimizeFunctionGraph(function_name, attrs, options, dev_set,
+                                 input_lib_def, composite_devices, cpu_device,
+                                 default_device, env);
+  }
+
+  TF_ASSIGN_OR_RETURN(const uint64 key,
+                      GetFunctionGraphCacheKey(function_name, attrs, options,
+                                               dev_set, input_lib_def,
+                                               default_device));
+  const string file_name =
+      GetFunctionGraphCacheFileName(cache_dir, function_name, key);
+  if (env->FileExists(file_name).ok()) {
+    OptimizedFunctionGraph proto;
+    Status status = ReadBinaryProto(env, file_name, &proto);
+    if (status.ok()) {
+      StatusOr<OptimizedFunctionGraphInfo> info =
+          OptimizedFunctionGraphInfo::FromProto(proto);
+      if (info.ok()) {
+        VLOG(1) << "Read the optimized graph of function " << function_name
+                << " from " << file_name;
+        return info;
+      }
+      status = info.status();
+    }
+    LOG(WARNING) << "Failed to read the optimized graph of function "
+                 << function_name << " from " << file_name
+                 << ", optimizing it again: " << status;
+  }
+
+  Status optimize_graph_fn_status;
+  TF_ASSIGN_OR_RETURN(
+      OptimizedFunctionGraphInfo info,
+      OptimizeFunctionGraphInternal(function_name, attrs, options, dev_set,
+                                    input_lib_def, composite_devices,
+                                    cpu_device, default_device, env,
+                                    &optimize_graph_fn_status));
+  if (!optimize_graph_fn_status.ok()) {
+    // The graph is not fully optimized, so it is only used by this process.
+    VLOG(1) << "Not writing the graph of function " << function_name
+            << " to the cache, since its optimization failed: "
+            << optimize_graph_fn_status;
+    return info;
+  }
+
+  // Writes to a temporary file first, so that concurrent processes never read
+  // a partially written graph.
+  string temp_file_name = file_name;
+  Status status = env->RecursivelyCreateDir(cache_dir);
+  if (status.ok() && env->CreateUniqueFileName(&temp_file_name, ".tmp")) {
+    status = WriteBinaryProto(env, temp_file_name,
+                              OptimizedFunctionGraphInfo::ToProto(info));
+    if (status.ok()) {
+      status = env->RenameFile(temp_file_name, file_name);
+    }
+    if (!status.ok()) {
+      env->DeleteFile(temp_file_name).IgnoreError();
+    }
+  }
+  if (status.ok()) {
+    VLOG(1) << "Wrote the optimized graph of function " << function_name
+            << " to " << file_name;
+    TrimFunctionGraphCache(env, cache_dir, cache_max_bytes);
+  } else {
+    LOG(WARNING) << "Failed to write the optimized graph of function "
+                 << function_name << " to " << file_name << ": " << status;
+  }
+  return info;
+}
+
 }  // namespace tensorflow
@@ -60,6 +60,44 @@ StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraph(
     const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
     Device* default_device, Env* env);
 
+// Returns a fingerprint of everything that the optimized graph of
+// `function_name` depends on: the function and the functions reachable from
+// it, its attributes and instantiation options (including whether an
+// `optimize_graph_fn` is set), the devices, the registered graph optimization
+// passes, the environment variables configuring them (e.g. TF_XLA_FLAGS) and
+// the TensorFlow version. The fingerprint is stable across processes.
+StatusOr<uint64> GetFunctionGraphCacheKey(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    Device* default_device);
+
+// Returns the name of the file in `cache_dir` holding the optimized graph of
+// `function_name` with the cache key `key`.
+string GetFunctionGraphCacheFileName(const string& cache_dir,
+                                     const string& function_name, uint64 key);
+
+// Deletes the oldest optimized graphs of the file cache in `cache_dir` until
+// the remaining ones take at most `max_bytes`.
+void TrimFunctionGraphCache(Env* env, const string& cache_dir,
+                            int64_t max_bytes);
+
+// Like OptimizeFunctionGraph(), but if `cache_dir` is non-empty, first looks
+// for the optimized graph in a file of `cache_dir` written by a previous
+// instantiation with the same GetFunctionGraphCacheKey(), which skips placement
+// and the graph optimization passes. On a cache miss, the optimized graph is
+// written to `cache_dir` for the next process, and the cache is trimmed to
+// `cache_max_bytes` with TrimFunctionGraphCache(), unless
+// `options.optimize_graph_fn` failed or exceeded the Grappler deadline.
+// Failures to read or write the cache are logged and otherwise ignored.
+StatusOr<OptimizedFunctionGraphInfo> OptimizeFunctionGraphOrReadFromFileCache(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const DeviceSet& dev_set, const FunctionLibraryDefinition* input_lib_def,
+    const std::vector<CompositeDevice*>& composite_devices, Device* cpu_device,
+    Device* default_device, Env* env, const string& cache_dir,
+    int64_t cache_max_bytes);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZE_FUNCTION_GRAPH_UTILS_H_
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/optimize_function_graph_utils.h"
 
+#include <stdlib.h>
+
 #include <memory>
 #include <vector>
 
@@ -24,6 +26,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/device_set.h"
 #include "tensorflow/core/common_runtime/function_testlib.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/tsl/lib/core/status_test_util.h"
@@ -103,5 +108,183 @@ TEST(OptimizeFunctionGraphTest, OptimizeFunctionGraphReturnsCorrectResult) {
   EXPECT_THAT(aot_result->ret_types, ElementsAre(DT_STRING));
 }
 
+TEST(OptimizeFunctionGraphTest, FunctionGraphCacheKey) {
+  FunctionLibraryRuntime::InstantiateOptions opts;
+  opts.is_multi_device_function = true;
+  FunctionDefLibrary proto;
+  *(proto.add_function()) = test::function::FindDevice();
+  auto lib_def =
+      std::make_unique<FunctionLibraryDefinition>(OpRegistry::Global(), proto);
+
+  std::vector<std::unique_ptr<Device>> devices;
+  CreateCpuDeviceList(kDevicePrefix, 2, devices);
+  DeviceSet device_set;
+  device_set.AddDevice(devices[0].get());
+
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 same_key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  EXPECT_EQ(key, same_key);
+
+  // The key changes with the config.
+  opts.config_proto.set_allow_soft_placement(true);
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 config_key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  EXPECT_NE(key, config_key);
+
+  // The key changes with the devices.
+  device_set.AddDevice(devices[1].get());
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 devices_key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  EXPECT_NE(config_key, devices_key);
+
+  // The key changes with the flags of the optimization passes.
+  setenv("TF_XLA_FLAGS", "--tf_xla_auto_jit=2", 1);
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 flags_key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  unsetenv("TF_XLA_FLAGS");
+  EXPECT_NE(devices_key, flags_key);
+
+  // The key changes with whether Grappler runs.
+  opts.optimize_graph_fn = [](std::vector<string>, std::vector<string>,
+                              FunctionLibraryDefinition*, const DeviceSet&,
+                              Device*, std::unique_ptr<Graph>*) {
+    return OkStatus();
+  };
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 optimize_graph_fn_key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  EXPECT_NE(devices_key, optimize_graph_fn_key);
+}
+
+TEST(OptimizeFunctionGraphTest, OptimizeFunctionGraphWithFileCache) {
+  FunctionLibraryRuntime::InstantiateOptions opts;
+  opts.is_multi_device_function = true;
+  FunctionDefLibrary proto;
+  *(proto.add_function()) = test::function::FindDevice();
+  auto lib_def =
+      std::make_unique<FunctionLibraryDefinition>(OpRegistry::Global(), proto);
+
+  std::vector<std::unique_ptr<Device>> devices;
+  CreateCpuDeviceList(kDevicePrefix, 1, devices);
+  DeviceSet device_set;
+  device_set.AddDevice(devices[0].get());
+
+  Env* env = Env::Default();
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "function_graph_cache");
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+  const string file_name =
+      GetFunctionGraphCacheFileName(cache_dir, "FindDevice", key);
+
+  // The optimized graph is written to the cache.
+  TF_ASSERT_OK_AND_ASSIGN(
+      OptimizedFunctionGraphInfo info,
+      OptimizeFunctionGraphOrReadFromFileCache(
+          "FindDevice", {}, opts, device_set, lib_def.get(),
+          /*composite_devices=*/{}, devices[0].get(), devices[0].get(), env,
+          cache_dir, /*cache_max_bytes=*/int64_t{1} << 30));
+  EXPECT_EQ(info.name, "FindDevice");
+  TF_ASSERT_OK(env->FileExists(file_name));
+
+  // And read back from it instead of being optimized again.
+  OptimizedFunctionGraph cached = OptimizedFunctionGraphInfo::ToProto(info);
+  cached.set_name("FindDeviceFromCache");
+  TF_ASSERT_OK(WriteBinaryProto(env, file_name, cached));
+  TF_ASSERT_OK_AND_ASSIGN(
+      OptimizedFunctionGraphInfo cached_info,
+      OptimizeFunctionGraphOrReadFromFileCache(
+          "FindDevice", {}, opts, device_set, lib_def.get(),
+          /*composite_devices=*/{}, devices[0].get(), devices[0].get(), env,
+          cache_dir, /*cache_max_bytes=*/int64_t{1} << 30));
+  EXPECT_EQ(cached_info.name, "FindDeviceFromCache");
+  EXPECT_EQ(cached_info.num_return_nodes, 1);
+  EXPECT_THAT(cached_info.ret_types, ElementsAre(DT_STRING));
+
+  // A corrupted cache file is ignored.
+  TF_ASSERT_OK(WriteStringToFile(env, file_name, "not a graph"));
+  TF_ASSERT_OK_AND_ASSIGN(
+      OptimizedFunctionGraphInfo reoptimized_info,
+      OptimizeFunctionGraphOrReadFromFileCache(
+          "FindDevice", {}, opts, device_set, lib_def.get(),
+          /*composite_devices=*/{}, devices[0].get(), devices[0].get(), env,
+          cache_dir, /*cache_max_bytes=*/int64_t{1} << 30));
+  EXPECT_EQ(reoptimized_info.name, "FindDevice");
+}
+
+TEST(OptimizeFunctionGraphTest, FailedOptimizationIsNotCached) {
+  FunctionLibraryRuntime::InstantiateOptions opts;
+  opts.is_multi_device_function = true;
+  opts.optimize_graph_fn = [](std::vector<string>, std::vector<string>,
+                              FunctionLibraryDefinition*, const DeviceSet&,
+                              Device*, std::unique_ptr<Graph>*) {
+    return errors::Internal("Optimization failed");
+  };
+  FunctionDefLibrary proto;
+  *(proto.add_function()) = test::function::FindDevice();
+  auto lib_def =
+      std::make_unique<FunctionLibraryDefinition>(OpRegistry::Global(), proto);
+
+  std::vector<std::unique_ptr<Device>> devices;
+  CreateCpuDeviceList(kDevicePrefix, 1, devices);
+  DeviceSet device_set;
+  device_set.AddDevice(devices[0].get());
+
+  Env* env = Env::Default();
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "failed_function_graph_cache");
+  TF_ASSERT_OK_AND_ASSIGN(
+      const uint64 key,
+      GetFunctionGraphCacheKey("FindDevice", {}, opts, device_set,
+                               lib_def.get(), devices[0].get()));
+
+  // The unoptimized graph is used, but not written to the cache.
+  TF_ASSERT_OK_AND_ASSIGN(
+      OptimizedFunctionGraphInfo info,
+      OptimizeFunctionGraphOrReadFromFileCache(
+          "FindDevice", {}, opts, device_set, lib_def.get(),
+          /*composite_devices=*/{}, devices[0].get(), devices[0].get(), env,
+          cache_dir, /*cache_max_bytes=*/int64_t{1} << 30));
+  EXPECT_EQ(info.name, "FindDevice");
+  EXPECT_TRUE(errors::IsNotFound(env->FileExists(
+      GetFunctionGraphCacheFileName(cache_dir, "FindDevice", key))));
+}
+
+TEST(OptimizeFunctionGraphTest, TrimFunctionGraphCache) {
+  Env* env = Env::Default();
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "trimmed_function_graph_cache");
+  TF_ASSERT_OK(env->RecursivelyCreateDir(cache_dir));
+  for (const string& name : {"a.pb", "b.pb", "c.pb", "d.pb.tmp"}) {
+    TF_ASSERT_OK(WriteStringToFile(env, io::JoinPath(cache_dir, name),
+                                   string(100, 'x')));
+    // Gives the files distinct modification times.
+    env->SleepForMicroseconds(20000);
+  }
+
+  // The oldest entries are evicted first, and temporary files are kept.
+  TrimFunctionGraphCache(env, cache_dir, /*max_bytes=*/250);
+  EXPECT_TRUE(errors::IsNotFound(
+      env->FileExists(io::JoinPath(cache_dir, "a.pb"))));
+  TF_EXPECT_OK(env->FileExists(io::JoinPath(cache_dir, "b.pb")));
+  TF_EXPECT_OK(env->FileExists(io::JoinPath(cache_dir, "c.pb")));
+  TF_EXPECT_OK(env->FileExists(io::JoinPath(cache_dir, "d.pb.tmp")));
+}
+
 }  // namespace
 }  // namespace tensorflow
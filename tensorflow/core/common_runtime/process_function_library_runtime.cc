@@ -56,6 +56,7 @@ limitations under the License.
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/util/device_name_utils.h"
 #include "tensorflow/core/util/dump_graph.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/reffed_status_callback.h"
 #include "tensorflow/tsl/platform/statusor.h"
 #if !defined(IS_MOBILE_PLATFORM)
@@ -412,6 +413,39 @@ Status FunctionRetsToTensors(const std::vector<FunctionRet>* function_rets,
   }
   return OkStatus();
 }
+
+// Returns the directory of the file cache of optimized function graphs, set
+// with TF_FUNCTION_GRAPH_CACHE_DIR, or an empty string if it is disabled.
+const string& FunctionGraphCacheDir() {
+  static const string* const cache_dir = [] {
+    string dir;
+    Status status =
+        ReadStringFromEnvVar("TF_FUNCTION_GRAPH_CACHE_DIR", "", &dir);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to read TF_FUNCTION_GRAPH_CACHE_DIR: " << status;
+      dir.clear();
+    }
+    return new string(dir);
+  }();
+  return *cache_dir;
+}
+
+// Returns the size bound of the file cache of optimized function graphs, set
+// with TF_FUNCTION_GRAPH_CACHE_MAX_BYTES.
+int64_t FunctionGraphCacheMaxBytes() {
+  static const int64_t max_bytes = [] {
+    int64_t bytes;
+    Status status = ReadInt64FromEnvVar("TF_FUNCTION_GRAPH_CACHE_MAX_BYTES",
+                                        int64_t{1} << 30, &bytes);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to read TF_FUNCTION_GRAPH_CACHE_MAX_BYTES: "
+                 << status;
+      bytes = int64_t{1} << 30;
+    }
+    return bytes;
+  }();
+  return max_bytes;
+}
 }  // namespace
 
 ProcessFunctionLibraryRuntime::AsyncAttributes::Summary
@@ -557,10 +591,12 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
   TF_RETURN_IF_ERROR(device_mgr_->LookupDevice("CPU:0", &cpu_device));
 
   const uint64 optimization_start_time_usecs = Env::Default()->NowMicros();
-  TF_ASSIGN_OR_RETURN(auto optimized_graph_info,
-                      OptimizeFunctionGraph(
-                          function_name, attrs, options, *dev_set, lib_def_,
-                          composite_devices, cpu_device, default_device, env_));
+  TF_ASSIGN_OR_RETURN(
+      auto optimized_graph_info,
+      OptimizeFunctionGraphOrReadFromFileCache(
+          function_name, attrs, options, *dev_set, lib_def_, composite_devices,
+          cpu_device, default_device, env_, FunctionGraphCacheDir(),
+          FunctionGraphCacheMaxBytes()));
 
   auto& graph = optimized_graph_info.function_graph;
   graph->mutable_flib_def()->set_default_registry(
@@ -22,10 +22,13 @@ limitations under the License.
 #endif  // defined(ENABLE_MKL) && defined(ENABLE_ONEDNN_OPENMP)
 #include <string.h>
 
+#include <algorithm>
+
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/util.h"
@@ -163,6 +166,25 @@ thread::ThreadPool* NewThreadPoolFromSessionOptions(
       /*allocator=*/nullptr);
 }
 
+thread::ThreadPool* NewNumaThreadPoolFromSessionOptions(
+    const SessionOptions& options, int numa_node, int num_node_devices,
+    int num_devices) {
+  const int64_t num_inter_op_threads =
+      NumInterOpThreadsFromSessionOptions(options);
+  const int32_t num_threads = static_cast<int32_t>(
+      std::max<int64_t>(num_inter_op_threads * num_node_devices /
+                            std::max(num_devices, 1),
+                        1));
+  VLOG(1) << "Session inter op parallelism threads on NUMA node " << numa_node
+          << ": " << num_threads;
+  ThreadOptions thread_opts;
+  thread_opts.numa_node = numa_node;
+  return new thread::ThreadPool(
+      options.env, thread_opts, strings::StrCat("numa_", numa_node, "_Compute"),
+      num_threads, !options.config.experimental().disable_thread_spinning(),
+      /*allocator=*/nullptr);
+}
+
 void SchedClosure(std::function<void()> closure) {
   if (!tracing::EventCollector::IsEnabled()) {
     return Env::Default()->SchedClosure(std::move(closure));
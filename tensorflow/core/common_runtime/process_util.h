@@ -48,6 +48,15 @@ int32 NumInterOpThreadsFromSessionOptions(const SessionOptions& options);
 thread::ThreadPool* NewThreadPoolFromSessionOptions(
     const SessionOptions& options);
 
+// Creates a thread pool for the inter op work placed on NUMA node
+// `numa_node`, whose threads have affinity to that node. The pool gets the
+// share of the inter op threads of `options` that the node's
+// `num_node_devices` out of `num_devices` devices make up, and at least one
+// thread.
+thread::ThreadPool* NewNumaThreadPoolFromSessionOptions(
+    const SessionOptions& options, int numa_node, int num_node_devices,
+    int num_devices);
+
 // Schedule "closure" in the default thread queue.
 void SchedClosure(std::function<void()> closure);
 
@@ -34,5 +34,27 @@ TEST(ProcessUtilTest, ThreadPool) {
   delete pool;
 }
 
+TEST(ProcessUtilTest, NumaThreadPool) {
+  SessionOptions opts;
+  opts.config.set_inter_op_parallelism_threads(10);
+
+  // A node that hosts all devices gets all inter op threads.
+  thread::ThreadPool* pool = NewNumaThreadPoolFromSessionOptions(
+      opts, /*numa_node=*/0, /*num_node_devices=*/1, /*num_devices=*/1);
+  EXPECT_EQ(10, pool->NumThreads());
+  delete pool;
+
+  pool = NewNumaThreadPoolFromSessionOptions(
+      opts, /*numa_node=*/0, /*num_node_devices=*/2, /*num_devices=*/5);
+  EXPECT_EQ(4, pool->NumThreads());
+  delete pool;
+
+  // Every pool gets at least one thread.
+  pool = NewNumaThreadPoolFromSessionOptions(
+      opts, /*numa_node=*/0, /*num_node_devices=*/1, /*num_devices=*/20);
+  EXPECT_EQ(1, pool->NumThreads());
+  delete pool;
+}
+
 }  // anonymous namespace
 }  // namespace tensorflow
@@ -13,15 +13,20 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <atomic>
 #include <vector>
 
 // Register a factory that provides CPU devices.
 #include "absl/memory/memory.h"
+#include "absl/strings/str_join.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/process_state.h"
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -66,9 +71,38 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
       }
       devices->push_back(std::move(tpd));
     }
+    if (options.config.experimental().use_numa_affinity()) {
+      LogNumaTopology(*devices);
+    }
 
     return OkStatus();
   }
+
+ private:
+  // Reports the NUMA topology and the placement of the CPU devices on it, once
+  // per process.
+  static void LogNumaTopology(
+      const std::vector<std::unique_ptr<Device>>& devices) {
+    static std::atomic<bool> logged(false);
+    if (logged.exchange(true)) return;
+    if (!port::NUMAEnabled()) {
+      LOG(INFO) << "NUMA affinity requested, but only "
+                << port::NUMANumNodes()
+                << " NUMA node is visible; thread pools and allocators are "
+                   "not bound to NUMA nodes.";
+      return;
+    }
+    std::vector<string> placements;
+    for (const auto& device : devices) {
+      placements.push_back(strings::StrCat(
+          device->name(), " on node ",
+          device->attributes().locality().numa_node()));
+    }
+    LOG(INFO) << "NUMA affinity enabled on " << port::NUMANumNodes()
+              << " NUMA nodes with " << port::MaxParallelism(0)
+              << " schedulable CPUs each: "
+              << absl::StrJoin(placements, ", ");
+  }
 };
 
 REGISTER_LOCAL_DEVICE_FACTORY("CPU", ThreadPoolDeviceFactory, 60);
@@ -0,0 +1,111 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/element_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+
+ElementArena::ElementArena(Allocator* allocator, int64_t max_cached_bytes)
+    : allocator_(allocator), max_cached_bytes_(max_cached_bytes) {}
+
+ElementArena::~ElementArena() {
+  mutex_lock l(mu_);
+  DCHECK(in_use_.empty());
+  for (auto& free_list : free_lists_) {
+    for (void* ptr : free_list.second) {
+      allocator_->DeallocateRaw(ptr);
+    }
+  }
+}
+
+void* ElementArena::AllocateRaw(size_t alignment, size_t num_bytes) {
+  void* ptr = nullptr;
+  {
+    mutex_lock l(mu_);
+    // Every buffer on the free lists is aligned to at least
+    // `kAllocatorAlignment`, so it can serve any request with an alignment no
+    // larger than that.
+    if (alignment <= Allocator::kAllocatorAlignment) {
+      auto it = free_lists_.find(num_bytes);
+      if (it != free_lists_.end() && !it->second.empty()) {
+        ptr = it->second.back();
+        it->second.pop_back();
+        cached_bytes_ -= num_bytes;
+        bytes_recycled_ += num_bytes;
+        ++allocations_avoided_;
+        in_use_[ptr] = num_bytes;
+      }
+    }
+  }
+  if (ptr == nullptr) {
+    ptr = allocator_->AllocateRaw(
+        std::max(alignment, Allocator::kAllocatorAlignment), num_bytes);
+    if (ptr == nullptr) {
+      return nullptr;
+    }
+    mutex_lock l(mu_);
+    in_use_[ptr] = num_bytes;
+  }
+  // Each outstanding allocation keeps the arena alive.
+  Ref();
+  return ptr;
+}
+
+void ElementArena::DeallocateRaw(void* ptr) {
+  {
+    mutex_lock l(mu_);
+    auto it = in_use_.find(ptr);
+    DCHECK(it != in_use_.end());
+    const size_t num_bytes = it->second;
+    in_use_.erase(it);
+    if (cached_bytes_ + static_cast<int64_t>(num_bytes) <= max_cached_bytes_) {
+      free_lists_[num_bytes].push_back(ptr);
+      cached_bytes_ += num_bytes;
+      ptr = nullptr;
+    }
+  }
+  if (ptr != nullptr) {
+    allocator_->DeallocateRaw(ptr);
+  }
+  // May delete `this`, so this must be the last access to the arena.
+  Unref();
+}
+
+int64_t ElementArena::bytes_recycled() const {
+  mutex_lock l(mu_);
+  return bytes_recycled_;
+}
+
+int64_t ElementArena::allocations_avoided() const {
+  mutex_lock l(mu_);
+  return allocations_avoided_;
+}
+
+int64_t ElementArena::cached_bytes() const {
+  mutex_lock l(mu_);
+  return cached_bytes_;
+}
+
+}  // namespace data
+}  // namespace tensorflow
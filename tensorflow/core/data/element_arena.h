@@ -0,0 +1,92 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_ELEMENT_ARENA_H_
+#define TENSORFLOW_CORE_DATA_ELEMENT_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// An allocator that recycles the buffers of tf.data elements across steps.
+//
+// Input pipelines tend to produce elements (and batches of elements) of the
+// same shape on every step, so buffers freed by one step are usually exactly
+// the size that the next step asks for. `ElementArena` wraps an underlying
+// allocator and keeps freed buffers on per-size free lists, handing them back
+// out for allocations of the same size instead of going through the
+// underlying allocator. At most `max_cached_bytes` bytes are kept on the free
+// lists; buffers beyond that are returned to the underlying allocator.
+//
+// Tensors allocated by the arena can outlive the iterator that produced them,
+// so the arena is reference counted: each outstanding allocation holds a
+// reference, and the arena deletes itself (returning all cached buffers to the
+// underlying allocator) once the owner and all outstanding allocations have
+// released theirs.
+//
+// This class is thread-safe.
+class ElementArena : public Allocator, public core::RefCounted {
+ public:
+  // `allocator` is not owned and must outlive the arena.
+  ElementArena(Allocator* allocator, int64_t max_cached_bytes);
+
+  std::string Name() override { return "element_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+  AllocatorMemoryType GetMemoryType() const override {
+    return allocator_->GetMemoryType();
+  }
+
+  // Returns the total number of bytes served from the free lists.
+  int64_t bytes_recycled() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of allocations served from the free lists, i.e. the
+  // number of calls to the underlying allocator that were avoided.
+  int64_t allocations_avoided() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of bytes currently kept on the free lists.
+  int64_t cached_bytes() const TF_LOCKS_EXCLUDED(mu_);
+
+ protected:
+  ~ElementArena() override;
+
+ private:
+  Allocator* const allocator_;  // not owned
+  const int64_t max_cached_bytes_;
+
+  mutable mutex mu_;
+  // Maps the outstanding allocations to their sizes.
+  absl::flat_hash_map<void*, size_t> in_use_ TF_GUARDED_BY(mu_);
+  // Maps allocation sizes to buffers of that size that are free for reuse.
+  absl::flat_hash_map<size_t, std::vector<void*>> free_lists_
+      TF_GUARDED_BY(mu_);
+  int64_t cached_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t bytes_recycled_ TF_GUARDED_BY(mu_) = 0;
+  int64_t allocations_avoided_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_ELEMENT_ARENA_H_
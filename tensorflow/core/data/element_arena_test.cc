@@ -0,0 +1,80 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/element_arena.h"
+
+#include <cstdint>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(ElementArenaTest, RecyclesBuffersOfTheSameSize) {
+  core::RefCountPtr<ElementArena> arena(
+      new ElementArena(cpu_allocator(), /*max_cached_bytes=*/1024));
+  const void* first_buffer;
+  {
+    Tensor t(arena.get(), DT_INT64, TensorShape({16}));
+    first_buffer = t.tensor_data().data();
+  }
+  EXPECT_EQ(arena->cached_bytes(), 16 * sizeof(int64_t));
+
+  Tensor t(arena.get(), DT_INT64, TensorShape({16}));
+  EXPECT_EQ(t.tensor_data().data(), first_buffer);
+  EXPECT_EQ(arena->allocations_avoided(), 1);
+  EXPECT_EQ(arena->bytes_recycled(), 16 * sizeof(int64_t));
+  EXPECT_EQ(arena->cached_bytes(), 0);
+}
+
+TEST(ElementArenaTest, DoesNotRecycleBuffersOfADifferentSize) {
+  core::RefCountPtr<ElementArena> arena(
+      new ElementArena(cpu_allocator(), /*max_cached_bytes=*/1024));
+  { Tensor t(arena.get(), DT_INT64, TensorShape({16})); }
+  Tensor t(arena.get(), DT_INT64, TensorShape({8}));
+  EXPECT_EQ(arena->allocations_avoided(), 0);
+  EXPECT_EQ(arena->bytes_recycled(), 0);
+  EXPECT_EQ(arena->cached_bytes(), 16 * sizeof(int64_t));
+}
+
+TEST(ElementArenaTest, RespectsMaxCachedBytes) {
+  core::RefCountPtr<ElementArena> arena(
+      new ElementArena(cpu_allocator(), /*max_cached_bytes=*/128));
+  {
+    Tensor t1(arena.get(), DT_INT64, TensorShape({16}));
+    Tensor t2(arena.get(), DT_INT64, TensorShape({16}));
+    Tensor t3(arena.get(), DT_INT64, TensorShape({16}));
+  }
+  EXPECT_EQ(arena->cached_bytes(), 128);
+}
+
+TEST(ElementArenaTest, TensorsOutliveOwnerReference) {
+  auto* arena = new ElementArena(cpu_allocator(), /*max_cached_bytes=*/1024);
+  Tensor t(arena, DT_INT64, TensorShape({16}));
+  // The outstanding allocation keeps the arena alive after the owner releases
+  // its reference.
+  arena->Unref();
+  t.flat<int64_t>().setConstant(42);
+  EXPECT_EQ(t.flat<int64_t>()(15), 42);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -89,6 +89,15 @@ void IteratorMetricsCollector::RecordStop(absl::Time start_time,
   }
 }
 
+void IteratorMetricsCollector::RecordElementArenaStats(
+    int64_t bytes_recycled, int64_t allocations_avoided) {
+  if (!ShouldCollectMetrics()) {
+    return;
+  }
+  tf_dataz_metrics_collector_.RecordElementArenaStats(bytes_recycled,
+                                                      allocations_avoided);
+}
+
 bool IteratorMetricsCollector::ShouldCollectMetrics() const {
   return device_type_ == DEVICE_CPU;
 }
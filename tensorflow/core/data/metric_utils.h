@@ -58,6 +58,11 @@ class IteratorMetricsCollector {
   // returned by `RecordStart`. `output` is the output of the `GetNext` call.
   void RecordStop(absl::Time start_time, const std::vector<Tensor>& output);
 
+  // Records the cumulative statistics of the iterator's `ElementArena`, to be
+  // exported to /tfdataz.
+  void RecordElementArenaStats(int64_t bytes_recycled,
+                               int64_t allocations_avoided);
+
  private:
   // We only collect metrics for CPU devices.
   bool ShouldCollectMetrics() const;
@@ -113,5 +113,21 @@ double TfDatazMetricsCollector::GetAverageLatencyForLastSixtyMinutes() {
       ApproximateLatencyEstimator::Duration::kSixtyMinutes);
 }
 
+void TfDatazMetricsCollector::RecordElementArenaStats(
+    int64_t bytes_recycled, int64_t allocations_avoided) {
+  element_arena_bytes_recycled_.store(bytes_recycled,
+                                      std::memory_order_relaxed);
+  element_arena_allocations_avoided_.store(allocations_avoided,
+                                           std::memory_order_relaxed);
+}
+
+int64_t TfDatazMetricsCollector::GetElementArenaBytesRecycled() {
+  return element_arena_bytes_recycled_.load(std::memory_order_relaxed);
+}
+
+int64_t TfDatazMetricsCollector::GetElementArenaAllocationsAvoided() {
+  return element_arena_allocations_avoided_.load(std::memory_order_relaxed);
+}
+
 }  // namespace data
 }  // namespace tensorflow
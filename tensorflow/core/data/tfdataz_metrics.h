@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_TFDATAZ_METRICS_H_
 #define TENSORFLOW_CORE_DATA_TFDATAZ_METRICS_H_
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <string>
@@ -107,11 +108,25 @@ class TfDatazMetricsCollector {
   // Returns the average `GetNext` latency for past 60 minutes.
   double GetAverageLatencyForLastSixtyMinutes();
 
+  // Records the cumulative statistics of the iterator's `ElementArena`:
+  // the number of bytes served from recycled buffers and the number of
+  // allocations that did not have to go through the underlying allocator.
+  void RecordElementArenaStats(int64_t bytes_recycled,
+                               int64_t allocations_avoided);
+
+  // Returns the number of bytes served from recycled buffers.
+  int64_t GetElementArenaBytesRecycled();
+
+  // Returns the number of allocations avoided by recycling buffers.
+  int64_t GetElementArenaAllocationsAvoided();
+
  private:
   // One of the devices defined in `types.h`
   // (DEVICE_CPU, DEVICE_GPU, DEVICE_TPU, etc).
   const std::string device_type_;
   ApproximateLatencyEstimator latency_estimator_;
+  std::atomic<int64_t> element_arena_bytes_recycled_{0};
+  std::atomic<int64_t> element_arena_allocations_avoided_{0};
 };
 
 }  // namespace data
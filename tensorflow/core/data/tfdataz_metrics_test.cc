@@ -141,6 +141,21 @@ TEST_F(TfDatazMetricsTest, GetMultipleAverageLatencies) {
                   5.0);
 }
 
+TEST_F(TfDatazMetricsTest, RecordElementArenaStats) {
+  EXPECT_EQ(tfdataz_metrics_->GetElementArenaBytesRecycled(), 0);
+  EXPECT_EQ(tfdataz_metrics_->GetElementArenaAllocationsAvoided(), 0);
+
+  tfdataz_metrics_->RecordElementArenaStats(/*bytes_recycled=*/1024,
+                                            /*allocations_avoided=*/4);
+  EXPECT_EQ(tfdataz_metrics_->GetElementArenaBytesRecycled(), 1024);
+  EXPECT_EQ(tfdataz_metrics_->GetElementArenaAllocationsAvoided(), 4);
+
+  tfdataz_metrics_->RecordElementArenaStats(/*bytes_recycled=*/4096,
+                                            /*allocations_avoided=*/16);
+  EXPECT_EQ(tfdataz_metrics_->GetElementArenaBytesRecycled(), 4096);
+  EXPECT_EQ(tfdataz_metrics_->GetElementArenaAllocationsAvoided(), 16);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -49,6 +49,24 @@ auto* graph_pending_queue_length_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count 30 (> 191k)
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
 
+auto* graph_work_stealing_nodes = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/graph_work_stealing_nodes",
+    "The number of nodes run by the work-stealing graph executor, by how they "
+    "were dispatched.",
+    "dispatch");
+
+auto* graph_work_stealing_steals_per_step = tsl::monitoring::Sampler<0>::New(
+    {"/tensorflow/core/graph_work_stealing_steals_per_step",
+     "The number of nodes stolen from a peer worker queue in one step."},
+    // Power of 2 with bucket count 20 (> 500k)
+    {tsl::monitoring::Buckets::Exponential(1, 2, 20)});
+
+auto* graph_work_stealing_max_queue_depth = tsl::monitoring::Sampler<0>::New(
+    {"/tensorflow/core/graph_work_stealing_max_queue_depth",
+     "The largest depth reached by a worker ready queue in one step."},
+    // Power of 1.5 with bucket count 30 (> 191k)
+    {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
+
 auto* graph_run_input_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     {"/tensorflow/core/graph_run_input_tensor_bytes",
      "The size of input tensors in bytes."},
@@ -86,6 +104,12 @@ auto* tf_data_bytes_read_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/bytes_read",
     "The number of bytes read by tf.data Dataset sources.", "name");
 
+auto* tf_data_read_ahead_stall_counter = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/data/read_ahead_stall_usecs",
+    "The time (in microseconds) tf.data Dataset sources spent waiting for data "
+    "read ahead from the filesystem.",
+    "name");
+
 auto* tf_data_bytes_fetched_counter = tsl::monitoring::Counter<0>::New(
     "/tensorflow/data/bytes_fetched",
     "The number of bytes fetched from tf.data Dataset iterator.");
@@ -177,6 +201,25 @@ auto* tf_data_filename_counter = tsl::monitoring::Counter<2>::New(
     "/tensorflow/data/filename", "The file name read by a tf.data Dataset.",
     "name", "filename");
 
+auto* tf_data_cache_lookups_counter = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/data/cache/lookups",
+    "The number of elements served by the tf.data memory cache, by the tier "
+    "(memory or disk) that held the element.",
+    "tier");
+
+auto* tf_data_cache_spill_bytes_counter = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/data/cache/spill_bytes",
+    "The number of bytes written to or read from the spill files of the "
+    "tf.data memory cache.",
+    "direction");
+
+auto* tf_data_cache_spill_time_usecs_counter =
+    tsl::monitoring::Counter<1>::New(
+        "/tensorflow/data/cache/spill_time_usecs",
+        "The time (in microseconds) spent writing to or reading from the spill "
+        "files of the tf.data memory cache.",
+        "direction");
+
 auto* tf_data_model_gauge =
     tsl::monitoring::Gauge<std::function<std::string()>, 1>::New(
         "/tensorflow/data/model", "tf.data autotuning model proto.", "id");
@@ -310,6 +353,11 @@ tsl::monitoring::CounterCell* GetTFDataBytesReadCounter(const string& name) {
   return tf_data_bytes_read_counter->GetCell(name);
 }
 
+tsl::monitoring::CounterCell* GetTFDataReadAheadStallCounter(
+    const string& name) {
+  return tf_data_read_ahead_stall_counter->GetCell(name);
+}
+
 tsl::monitoring::CounterCell* GetTFDataElementsCounter(const string& name) {
   return tf_data_elements_counter->GetCell(name);
 }
@@ -420,6 +468,18 @@ void RecordTFDataFilename(const string& name, const string& filename) {
   tf_data_filename_counter->GetCell(name, filename)->IncrementBy(1);
 }
 
+void RecordTFDataCacheLookup(const string& tier) {
+  tf_data_cache_lookups_counter->GetCell(tier)->IncrementBy(1);
+}
+
+void RecordTFDataCacheSpill(const string& direction, int64_t num_bytes,
+                            uint64 duration_us) {
+  tf_data_cache_spill_bytes_counter->GetCell(direction)->IncrementBy(
+      num_bytes);
+  tf_data_cache_spill_time_usecs_counter->GetCell(direction)->IncrementBy(
+      duration_us);
+}
+
 void RecordTFDataAutoShard(const string& id,
                            data::AutoShardPolicy policy,
                            int64 num_workers, int64 num_replicas) {
@@ -496,6 +556,23 @@ void UpdateGraphPendingQueueLength(uint64 len) {
   graph_pending_queue_length_cell->Add(len);
 }
 
+void RecordGraphWorkStealingStep(int64_t num_local_runs, int64_t num_steals,
+                                 int64_t num_inline_runs,
+                                 int64_t max_queue_depth) {
+  static auto* local_cell = graph_work_stealing_nodes->GetCell("local");
+  static auto* stolen_cell = graph_work_stealing_nodes->GetCell("stolen");
+  static auto* inline_cell = graph_work_stealing_nodes->GetCell("inline");
+  static auto* steals_per_step_cell =
+      graph_work_stealing_steals_per_step->GetCell();
+  static auto* max_queue_depth_cell =
+      graph_work_stealing_max_queue_depth->GetCell();
+  local_cell->IncrementBy(num_local_runs);
+  stolen_cell->IncrementBy(num_steals);
+  inline_cell->IncrementBy(num_inline_runs);
+  steals_per_step_cell->Add(num_steals);
+  max_queue_depth_cell->Add(max_queue_depth);
+}
+
 void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* build_graph_calls_cell = build_graph_calls->GetCell();
@@ -57,6 +57,13 @@ monitoring::CounterCell* GetTFDataBytesProducedCounter(const string& name);
 // TODO(jsimsa): Remove this now that we have GetTFDataBytesConsumedCounter?
 monitoring::CounterCell* GetTFDataBytesReadCounter(const string& name);
 
+// Returns a counter that can be used to record the time, in microseconds, a
+// tf.data.Dataset source spent waiting for data read ahead from the
+// filesystem.
+//
+// The `name` argument identifies the Dataset type (e.g. "TFRecordDataset").
+monitoring::CounterCell* GetTFDataReadAheadStallCounter(const string& name);
+
 // Returns a counter than can be used to record the number of elements produced
 // by a tf.data.Dataset.
 //
@@ -136,6 +143,17 @@ void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes);
 // The `name` argument identifies the Dataset type (e.g. "TFRecordDataset").
 void RecordTFDataFilename(const string& name, const string& filename);
 
+// Records a lookup into the tf.data memory cache. The `tier` argument is
+// "memory" if the element was served from memory and "disk" if it was read
+// back from the spill file of the cache.
+void RecordTFDataCacheLookup(const string& tier);
+
+// Records `num_bytes` transferred between the tf.data memory cache and its
+// spill file in `duration_us` microseconds. The `direction` argument is either
+// "write" (spilling) or "read" (reading spilled elements back).
+void RecordTFDataCacheSpill(const string& direction, int64_t num_bytes,
+                            uint64 duration_us);
+
 // Records statistics of tf.data auto sharding.
 //
 // The `id` is a unique identifier of the input pipeline. The `policy`
@@ -176,6 +194,14 @@ void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Records the scheduling statistics of one graph execution step that used
+// work-stealing ready queues: the number of nodes a worker popped from its own
+// queue, stole from a peer, or ran inline on the scheduling thread, and the
+// largest depth reached by any worker queue.
+void RecordGraphWorkStealingStep(int64_t num_local_runs, int64_t num_steals,
+                                 int64_t num_inline_runs,
+                                 int64_t max_queue_depth);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/batch_resource_base.h"
 #include "tensorflow/core/kernels/batching_util/bounded_executor.h"
 #include "tensorflow/core/kernels/batching_util/concat_split_util.h"
+#include "tensorflow/core/kernels/batching_util/length_bucketing.h"
 #include "tensorflow/core/kernels/batching_util/periodic_function.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
@@ -257,6 +258,16 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
     has_attribute_enable_large_batch_splitting_ = false;
   }
 
+  if (c->HasAttr("length_bucketing_input")) {
+    OP_REQUIRES_OK(
+        c, c->GetAttr("length_bucketing_input", &length_bucketing_input_));
+    OP_REQUIRES_OK(c, c->GetAttr("length_bucket_boundaries",
+                                 &length_bucket_boundaries_));
+  }
+  DataTypeVector input_types;
+  OP_REQUIRES_OK(c, c->GetAttr("Tin", &input_types));
+  OP_REQUIRES_OK(c, ValidateLengthBucketing(input_types.size()));
+
   // Helper function `SetAdaptiveBatchSchedulerOptions` calls
   // `OP_REQUIRES_OK`, which exits the current function upon error.
   // So validate status of `op-kernel-construction`.
@@ -348,13 +359,16 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
     };
   }
 
+  string batcher_queue;
+  OP_REQUIRES_OK_ASYNC(c, GetBatcherQueueName(c, &batcher_queue), done);
+
   BatchResource* br;
   OP_REQUIRES_OK_ASYNC(c,
                        c->resource_manager()->LookupOrCreate(
                            container_, shared_name_, &br, creator),
                        done);
   const Status status =
-      br->RegisterInput(random::New64(), c, batcher_queue_, done);
+      br->RegisterInput(random::New64(), c, batcher_queue, done);
   br->Unref();
   OP_REQUIRES_OK_ASYNC(c, status, done);
   // Assume br calls done, so nothing to do here.
@@ -460,6 +474,42 @@ Status BatchFunctionKernel::ValidateAllowedBatchSizes() const {
   return OkStatus();
 }
 
+Status BatchFunctionKernel::ValidateLengthBucketing(int num_inputs) const {
+  if (length_bucketing_input_ < 0) {
+    return OkStatus();
+  }
+  if (length_bucketing_input_ >= num_inputs) {
+    return errors::InvalidArgument("length_bucketing_input ",
+                                   length_bucketing_input_,
+                                   " is out of range for ", num_inputs,
+                                   " batched inputs");
+  }
+  for (size_t i = 1; i < length_bucket_boundaries_.size(); ++i) {
+    if (length_bucket_boundaries_[i] <= length_bucket_boundaries_[i - 1]) {
+      return errors::InvalidArgument(
+          "length_bucket_boundaries entries must be monotonically increasing");
+    }
+  }
+  return OkStatus();
+}
+
+Status BatchFunctionKernel::GetBatcherQueueName(OpKernelContext* c,
+                                                string* queue_name) const {
+  *queue_name = batcher_queue_;
+  if (length_bucketing_input_ < 0) {
+    return OkStatus();
+  }
+  OpInputList tensors;
+  TF_RETURN_IF_ERROR(c->input_list("in_tensors", &tensors));
+  int64_t length;
+  TF_RETURN_IF_ERROR(
+      serving::GetSequenceLength(tensors[length_bucketing_input_], &length));
+  absl::StrAppend(
+      queue_name, "/length_bucket_",
+      serving::GetLengthBucket(length, length_bucket_boundaries_));
+  return OkStatus();
+}
+
 // Initialize vars by reading from op-kernel-construction.
 // Vars
 // - enable_adaptive_batch_threads_
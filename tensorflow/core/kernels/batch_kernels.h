@@ -63,6 +63,16 @@ class BatchFunctionKernel : public AsyncOpKernel {
   // to `max_batch_size_`.
   Status ValidateAllowedBatchSizes() const;
 
+  // Validates the length bucketing attributes: 'length_bucketing_input_' must
+  // be negative (disabled) or the index of one of the 'num_inputs' batched
+  // inputs, and 'length_bucket_boundaries_' must increase monotonically.
+  Status ValidateLengthBucketing(int num_inputs) const;
+
+  // Returns the name of the batcher queue for the inputs of 'c'. With length
+  // bucketing, the inputs of each length bucket are batched in a queue of
+  // their own.
+  Status GetBatcherQueueName(OpKernelContext* c, string* queue_name) const;
+
   // Creates the function handle if it isn't initialized yet; and re-use it
   // afterwards.
   Status GetOrCreateFunctionHandle(OpKernelContext* c,
@@ -95,6 +105,8 @@ class BatchFunctionKernel : public AsyncOpKernel {
   bool enable_large_batch_splitting_;
   bool has_attribute_enable_large_batch_splitting_;
   bool enable_adaptive_batch_threads_ = false;
+  int32 length_bucketing_input_ = -1;
+  std::vector<int32> length_bucket_boundaries_;
 
   mutex mu_;
 
@@ -33,4 +33,46 @@ TEST_P(BatchFunctionKernelTest, EnableAdaptiveScheduler) {
 
 INSTANTIATE_TEST_SUITE_P(Params, BatchFunctionKernelTest, ::testing::Bool());
 
+class BatchFunctionKernelLengthBucketingTest : public OpsTestBase {
+ protected:
+  Status Init(int length_bucketing_input,
+              const std::vector<int32>& length_bucket_boundaries) {
+    NameAttrList f;
+    f.set_name("func_to_batch");
+    TF_CHECK_OK(NodeDefBuilder("BatchTPUInput", "BatchFunction")
+                    .Attr("max_batch_size", 8)
+                    .Attr("num_batch_threads", 8)
+                    .Attr("batch_timeout_micros", 1000)
+                    .Attr("length_bucketing_input", length_bucketing_input)
+                    .Attr("length_bucket_boundaries", length_bucket_boundaries)
+                    .Attr("Tin", std::vector<DataType>{DT_STRING})
+                    .Input(std::vector<NodeDefBuilder::NodeOut>{
+                        NodeDefBuilder::NodeOut({"n1", 0, DT_STRING})})
+                    .Attr("Tcaptured", std::vector<DataType>{})
+                    .Input(std::vector<NodeDefBuilder::NodeOut>{})
+                    .Attr("Tout", std::vector<DataType>{DT_STRING})
+                    .Attr("f", f)
+                    .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(BatchFunctionKernelLengthBucketingTest, Disabled) {
+  TF_EXPECT_OK(Init(/*length_bucketing_input=*/-1, {}));
+}
+
+TEST_F(BatchFunctionKernelLengthBucketingTest, Enabled) {
+  TF_EXPECT_OK(Init(/*length_bucketing_input=*/0, {16, 64}));
+}
+
+TEST_F(BatchFunctionKernelLengthBucketingTest, InputOutOfRange) {
+  EXPECT_EQ(Init(/*length_bucketing_input=*/1, {16, 64}).code(),
+            error::INVALID_ARGUMENT);
+}
+
+TEST_F(BatchFunctionKernelLengthBucketingTest, BoundariesNotIncreasing) {
+  EXPECT_EQ(Init(/*length_bucketing_input=*/0, {64, 16}).code(),
+            error::INVALID_ARGUMENT);
+}
+
 }  // namespace tensorflow
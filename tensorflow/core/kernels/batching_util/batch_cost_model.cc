@@ -0,0 +1,153 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_cost_model.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+
+BatchCostModel::BatchCostModel(std::vector<int32> allowed_batch_sizes)
+    : allowed_batch_sizes_(std::move(allowed_batch_sizes)),
+      costs_(allowed_batch_sizes_.size(), 0) {
+  DCHECK(!allowed_batch_sizes_.empty());
+  DCHECK(std::is_sorted(allowed_batch_sizes_.begin(),
+                        allowed_batch_sizes_.end()));
+}
+
+void BatchCostModel::RecordBatchCost(int32 padded_batch_size,
+                                     double cost_micros) {
+  auto it = std::lower_bound(allowed_batch_sizes_.begin(),
+                             allowed_batch_sizes_.end(), padded_batch_size);
+  if (it == allowed_batch_sizes_.end() || *it != padded_batch_size ||
+      cost_micros <= 0) {
+    return;
+  }
+  mutex_lock l(mu_);
+  double& cost = costs_[it - allowed_batch_sizes_.begin()];
+  if (cost == 0) {
+    cost = cost_micros;
+  } else {
+    cost += kCostUpdateWeight * (cost_micros - cost);
+  }
+}
+
+double BatchCostModel::EstimatedCost(int32 padded_batch_size) const {
+  std::vector<double> costs;
+  {
+    mutex_lock l(mu_);
+    costs = costs_;
+  }
+  return EstimateCost(costs, padded_batch_size);
+}
+
+int64_t BatchCostModel::PaddedBatchSize(int64_t batch_size) const {
+  auto it = std::lower_bound(allowed_batch_sizes_.begin(),
+                             allowed_batch_sizes_.end(), batch_size);
+  return it == allowed_batch_sizes_.end() ? batch_size : *it;
+}
+
+double BatchCostModel::EstimateCost(const std::vector<double>& costs,
+                                    int64_t padded_batch_size) const {
+  // The closest measured sizes below and above `padded_batch_size`.
+  int lower = -1;
+  int upper = -1;
+  for (int i = 0; i < allowed_batch_sizes_.size(); ++i) {
+    if (costs[i] == 0) continue;
+    if (allowed_batch_sizes_[i] == padded_batch_size) return costs[i];
+    if (allowed_batch_sizes_[i] < padded_batch_size) {
+      lower = i;
+    } else if (upper == -1) {
+      upper = i;
+    }
+  }
+  if (lower != -1 && upper != -1) {
+    const double fraction =
+        static_cast<double>(padded_batch_size - allowed_batch_sizes_[lower]) /
+        (allowed_batch_sizes_[upper] - allowed_batch_sizes_[lower]);
+    return costs[lower] + fraction * (costs[upper] - costs[lower]);
+  }
+  if (upper != -1) {
+    // Smaller batches are assumed to cost as much as the smallest measured
+    // one, which errs on the side of not splitting.
+    return costs[upper];
+  }
+  if (lower != -1) {
+    return costs[lower] * padded_batch_size / allowed_batch_sizes_[lower];
+  }
+  return 0;
+}
+
+std::vector<int> BatchCostModel::PlanBatches(
+    absl::Span<const int64_t> task_sizes) const {
+  std::vector<int> plan;
+  if (task_sizes.empty()) {
+    return plan;
+  }
+  std::vector<double> costs;
+  {
+    mutex_lock l(mu_);
+    costs = costs_;
+  }
+  if (std::all_of(costs.begin(), costs.end(),
+                  [](double cost) { return cost == 0; })) {
+    plan.push_back(task_sizes.size());
+    return plan;
+  }
+
+  // Greedily splits off the prefix of the remaining tasks that saves the most,
+  // until processing the remaining tasks as one batch is the cheapest.
+  int begin = 0;
+  while (begin < task_sizes.size()) {
+    int64_t remaining_size = 0;
+    for (int i = begin; i < task_sizes.size(); ++i) {
+      remaining_size += task_sizes[i];
+    }
+    const int64_t padded_size = PaddedBatchSize(remaining_size);
+    const double unsplit_cost = EstimateCost(costs, padded_size);
+    double best_cost = unsplit_cost * (1 - kMinSavingsFraction);
+    int best_end = task_sizes.size();
+
+    // For each smaller allowed size, tries the longest prefix that fits it.
+    // Ties go to the longer prefix, so that the oldest tasks are done sooner.
+    int end = begin;
+    int64_t prefix_size = 0;
+    for (int32 allowed_size : allowed_batch_sizes_) {
+      if (allowed_size >= padded_size) break;
+      while (end < task_sizes.size() &&
+             prefix_size + task_sizes[end] <= allowed_size) {
+        prefix_size += task_sizes[end++];
+      }
+      if (end == begin || end == task_sizes.size()) continue;
+      const double cost =
+          EstimateCost(costs, PaddedBatchSize(prefix_size)) +
+          EstimateCost(costs, PaddedBatchSize(remaining_size - prefix_size));
+      if (cost <= best_cost) {
+        best_cost = cost;
+        best_end = end;
+      }
+    }
+    plan.push_back(best_end - begin);
+    begin = best_end;
+  }
+  return plan;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
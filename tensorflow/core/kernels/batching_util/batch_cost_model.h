@@ -0,0 +1,92 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_COST_MODEL_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_COST_MODEL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Learns the cost of processing a batch padded to each of the allowed batch
+// sizes from measured batch latencies, and uses it to decide whether a batch
+// is cheaper to process as a few smaller batches with less padding.
+//
+// For instance, with allowed batch sizes {32, 64}, a batch of 33 examples is
+// padded to 64; processing it as batches of 32 and 1 (padded to 32) may be
+// cheaper if the cost of a batch grows faster with its size than the fixed
+// per-batch overhead.
+//
+// This class is thread-safe.
+class BatchCostModel {
+ public:
+  // `allowed_batch_sizes` must be non-empty and in increasing order.
+  explicit BatchCostModel(std::vector<int32> allowed_batch_sizes);
+
+  BatchCostModel(const BatchCostModel&) = delete;
+  BatchCostModel& operator=(const BatchCostModel&) = delete;
+
+  // Records that processing a batch padded to `padded_batch_size` took
+  // `cost_micros`. Measurements of sizes that are not allowed are ignored.
+  void RecordBatchCost(int32 padded_batch_size, double cost_micros);
+
+  // Returns the estimated cost of processing a batch padded to
+  // `padded_batch_size`. Costs of sizes that have not been measured yet are
+  // interpolated from their neighbours. Returns 0 if no size has been
+  // measured yet.
+  double EstimatedCost(int32 padded_batch_size) const;
+
+  // Returns how to process a batch of tasks of `task_sizes`, in order, at the
+  // lowest estimated cost: the number of consecutive tasks in each of the
+  // batches to process them in. Tasks are never split, and the tasks are
+  // processed as a single batch unless splitting them saves at least
+  // `kMinSavingsFraction` of the cost.
+  std::vector<int> PlanBatches(absl::Span<const int64_t> task_sizes) const;
+
+  // The weight of a new measurement in the moving average of the cost.
+  static constexpr double kCostUpdateWeight = 0.1;
+  // Splitting a batch must save at least this fraction of its estimated cost,
+  // so that noisy measurements don't make the batching flip-flop.
+  static constexpr double kMinSavingsFraction = 0.05;
+
+ private:
+  // Returns the allowed batch size that a batch of `batch_size` is padded to,
+  // or `batch_size` if it is larger than all of them.
+  int64_t PaddedBatchSize(int64_t batch_size) const;
+
+  // Returns the estimated cost of a batch padded to `padded_batch_size`,
+  // given the measured `costs` (0 for sizes without measurements).
+  double EstimateCost(const std::vector<double>& costs,
+                      int64_t padded_batch_size) const;
+
+  const std::vector<int32> allowed_batch_sizes_;
+
+  mutable mutex mu_;
+  // The moving average of the cost of each allowed batch size, or 0 if it has
+  // not been measured yet.
+  std::vector<double> costs_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_BATCH_COST_MODEL_H_
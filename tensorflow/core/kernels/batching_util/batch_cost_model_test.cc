@@ -0,0 +1,102 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/batch_cost_model.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(BatchCostModelTest, NoMeasurements) {
+  BatchCostModel model({8, 16, 32, 64});
+  EXPECT_EQ(model.EstimatedCost(16), 0);
+  EXPECT_THAT(model.PlanBatches({32, 1}), ElementsAre(2));
+  EXPECT_THAT(model.PlanBatches({}), ElementsAre());
+}
+
+TEST(BatchCostModelTest, MovingAverage) {
+  BatchCostModel model({8, 16});
+  model.RecordBatchCost(8, 100);
+  EXPECT_EQ(model.EstimatedCost(8), 100);
+  model.RecordBatchCost(8, 200);
+  EXPECT_DOUBLE_EQ(model.EstimatedCost(8),
+                   100 + BatchCostModel::kCostUpdateWeight * 100);
+  // Sizes that are not allowed are ignored.
+  model.RecordBatchCost(12, 1000);
+  EXPECT_DOUBLE_EQ(model.EstimatedCost(8),
+                   100 + BatchCostModel::kCostUpdateWeight * 100);
+}
+
+TEST(BatchCostModelTest, EstimatesUnmeasuredSizes) {
+  BatchCostModel model({8, 16, 32, 64});
+  model.RecordBatchCost(16, 100);
+  model.RecordBatchCost(32, 200);
+  // Interpolated between the measured sizes.
+  EXPECT_DOUBLE_EQ(model.EstimatedCost(24), 150);
+  // No cheaper than the smallest measured size.
+  EXPECT_DOUBLE_EQ(model.EstimatedCost(8), 100);
+  // Extrapolated proportionally to the batch size.
+  EXPECT_DOUBLE_EQ(model.EstimatedCost(64), 400);
+}
+
+TEST(BatchCostModelTest, SplitsWhenPaddingIsExpensive) {
+  BatchCostModel model({8, 16, 32, 64});
+  model.RecordBatchCost(8, 100);
+  model.RecordBatchCost(32, 330);
+  model.RecordBatchCost(64, 640);
+  // 33 examples are padded to 64, but 32 + 8 is cheaper.
+  std::vector<int64_t> task_sizes(33, 1);
+  EXPECT_THAT(model.PlanBatches(task_sizes), ElementsAre(32, 1));
+}
+
+TEST(BatchCostModelTest, DoesNotSplitWhenOverheadDominates) {
+  BatchCostModel model({8, 16, 32, 64});
+  model.RecordBatchCost(8, 80);
+  model.RecordBatchCost(32, 90);
+  model.RecordBatchCost(64, 100);
+  std::vector<int64_t> task_sizes(33, 1);
+  EXPECT_THAT(model.PlanBatches(task_sizes), ElementsAre(33));
+}
+
+TEST(BatchCostModelTest, DoesNotSplitForNegligibleSavings) {
+  BatchCostModel model({32, 64});
+  model.RecordBatchCost(32, 320);
+  model.RecordBatchCost(64, 660);
+  EXPECT_THAT(model.PlanBatches({32, 32}), ElementsAre(2));
+}
+
+TEST(BatchCostModelTest, SplitsAtTaskBoundaries) {
+  BatchCostModel model({8, 16, 32, 64});
+  model.RecordBatchCost(8, 80);
+  model.RecordBatchCost(16, 160);
+  model.RecordBatchCost(32, 320);
+  model.RecordBatchCost(64, 640);
+  // Costs are proportional to the padded size, so the padding is minimized:
+  // 20 + (13 + 2) is padded to 32 + 16 rather than 64.
+  EXPECT_THAT(model.PlanBatches({20, 13, 2}), ElementsAre(1, 2));
+  // A single task is never split.
+  EXPECT_THAT(model.PlanBatches({33}), ElementsAre(1));
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -37,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/incremental_barrier.h"
 
 namespace tensorflow {
@@ -200,6 +201,18 @@ void RecordBatchParamAllowedBatchSizes(const string& allowed_batch_sizes,
   cell->GetCell(model_name, op_name)->Set(allowed_batch_sizes);
 }
 
+void RecordCostBasedSplit(int32_t num_batches, const string& model_name,
+                          const string& op_name) {
+  static auto* cell = monitoring::Counter<3>::New(
+      "/tensorflow/serving/batching/cost_based_splits",
+      "Tracks the batches split into smaller batches with less padding by "
+      "model_name and op name (if available), by the number of batches they "
+      "are split into.",
+      "model_name", "op_name", "num_batches");
+  cell->GetCell(model_name, op_name, std::to_string(num_batches))
+      ->IncrementBy(1);
+}
+
 const string& GetModelName(OpKernelContext* ctx) {
   static string* kModelNameUnset = new string("model_name_unset");
   if (!ctx->session_metadata()) return *kModelNameUnset;
@@ -751,8 +764,13 @@ void BatchResourceBase::ProcessFuncBatch(std::unique_ptr<BatchT> batch) const {
   // Releases the cleanup method here, because the callback of the function
   // library runtime will handle it now.
   finally.release();
+  const uint64 start_time_micros = EnvTime::NowMicros();
   ProcessFuncBatchImpl(
       last_task, args, &combined_outputs, [&](const Status& run_status) {
+        if (cost_model_ != nullptr && run_status.ok()) {
+          cost_model_->RecordBatchCost(
+              processed_size, EnvTime::NowMicros() - start_time_micros);
+        }
         Status final_status;
         auto run_finally = gtl::MakeCleanup([&]() {
           // We do the cleanup here as an optimization, so that
@@ -771,6 +789,56 @@ void BatchResourceBase::ProcessFuncBatch(std::unique_ptr<BatchT> batch) const {
       });
 }
 
+void BatchResourceBase::ProcessFuncBatchWithCostModel(
+    std::unique_ptr<BatchT> batch) const {
+  std::vector<int64_t> task_sizes;
+  task_sizes.reserve(batch->num_tasks());
+  for (int i = 0; i < batch->num_tasks(); ++i) {
+    task_sizes.push_back(batch->task(i).size());
+  }
+  const std::vector<int> plan = cost_model_->PlanBatches(task_sizes);
+  if (plan.size() <= 1) {
+    ProcessFuncBatch(std::move(batch));
+    return;
+  }
+
+  OpKernelContext* last_task_context =
+      batch->task(batch->num_tasks() - 1).context;
+  RecordCostBasedSplit(plan.size(), GetModelName(last_task_context),
+                       last_task_context->op_kernel().name());
+  std::vector<std::unique_ptr<BatchTask>> tasks = batch->RemoveAllTasks();
+  int next_task = 0;
+  for (int num_tasks : plan) {
+    auto sub_batch = std::make_unique<BatchT>(batch->traceme_context_id());
+    for (int i = 0; i < num_tasks; ++i) {
+      sub_batch->AddTask(std::move(tasks[next_task++]));
+    }
+    sub_batch->Close();
+    ProcessFuncBatch(std::move(sub_batch));
+  }
+}
+
+/*static*/ std::unique_ptr<BatchCostModel>
+BatchResourceBase::MaybeCreateBatchCostModel(
+    bool has_process_batch_function,
+    const std::vector<int32>& allowed_batch_sizes) {
+  static const bool enabled = [] {
+    bool enabled;
+    Status status = ReadBoolFromEnvVar("TF_BATCHING_COST_BASED_SPLITTING",
+                                       /*default_val=*/false, &enabled);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to read TF_BATCHING_COST_BASED_SPLITTING: "
+                 << status;
+      return false;
+    }
+    return enabled;
+  }();
+  if (!enabled || !has_process_batch_function || allowed_batch_sizes.empty()) {
+    return nullptr;
+  }
+  return std::make_unique<BatchCostModel>(allowed_batch_sizes);
+}
+
 // Processes a batch of one or more BatchTask entries.
 void BatchResourceBase::ProcessBatch(std::unique_ptr<BatchT> batch) const {
   if (batch->empty()) {
@@ -891,6 +959,8 @@ Status BatchResourceBase::LookupOrCreateBatcherQueue(const string& queue_name,
   auto process_batch_callback = [this](std::unique_ptr<BatchT> batch) {
     if (!has_process_batch_function_) {
       ProcessBatch(std::move(batch));
+    } else if (cost_model_ != nullptr && !batch->empty()) {
+      ProcessFuncBatchWithCostModel(std::move(batch));
     } else {
       ProcessFuncBatch(std::move(batch));
     }
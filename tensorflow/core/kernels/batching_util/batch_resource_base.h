@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/batching_util/adaptive_shared_batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/batch_cost_model.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/threadsafe_status.h"
@@ -133,7 +134,9 @@ class BatchResourceBase : public ResourceBase {
       : has_process_batch_function_(has_process_batch_function),
         batcher_(std::move(batcher)),
         batcher_queue_options_(batcher_queue_options),
-        allowed_batch_sizes_(std::move(allowed_batch_sizes)) {
+        allowed_batch_sizes_(std::move(allowed_batch_sizes)),
+        cost_model_(MaybeCreateBatchCostModel(has_process_batch_function,
+                                              allowed_batch_sizes_)) {
     allowed_batch_sizes_str_ = absl::StrJoin(allowed_batch_sizes_, ",");
   }
 
@@ -144,7 +147,9 @@ class BatchResourceBase : public ResourceBase {
       : has_process_batch_function_(has_process_batch_function),
         adaptive_batcher_(std::move(batcher)),
         adaptive_batcher_queue_options_(batcher_queue_options),
-        allowed_batch_sizes_(std::move(allowed_batch_sizes)) {}
+        allowed_batch_sizes_(std::move(allowed_batch_sizes)),
+        cost_model_(MaybeCreateBatchCostModel(has_process_batch_function,
+                                              allowed_batch_sizes_)) {}
 
   static BatcherT::QueueOptions GetBatcherQueueOptions(
       int32_t num_batch_threads, int32_t max_batch_size,
@@ -225,6 +230,18 @@ class BatchResourceBase : public ResourceBase {
 
   void ProcessFuncBatch(std::unique_ptr<BatchT> batch) const;
 
+  // Processes 'batch' as the cheapest sequence of smaller batches according to
+  // 'cost_model_', with less padding than the batch as a whole.
+  void ProcessFuncBatchWithCostModel(std::unique_ptr<BatchT> batch) const;
+
+  // Returns a cost model of the batches if cost-based splitting is enabled
+  // (with TF_BATCHING_COST_BASED_SPLITTING=true) and applies to the resource,
+  // i.e. it has a batch function and allowed batch sizes. Returns nullptr
+  // otherwise.
+  static std::unique_ptr<BatchCostModel> MaybeCreateBatchCostModel(
+      bool has_process_batch_function,
+      const std::vector<int32>& allowed_batch_sizes);
+
   // Processes a batch of one or more BatchTask entries.
   void ProcessBatch(std::unique_ptr<BatchT> batch) const;
 
@@ -264,6 +281,11 @@ class BatchResourceBase : public ResourceBase {
   // A concatenated string of <allowed_batch_sizes_>, separated by ",". This is
   // used to record batching parameter.
   string allowed_batch_sizes_str_;
+
+  // Learns the cost of the batches of each allowed size, to split batches
+  // that would be cheaper to process with less padding. Null if cost-based
+  // splitting is disabled.
+  const std::unique_ptr<BatchCostModel> cost_model_;
 };
 
 }  // namespace serving
@@ -46,6 +46,15 @@ limitations under the License.
 namespace tensorflow {
 namespace serving {
 
+// The priority of a BatchTask. Queues that enable priority queueing (see
+// SharedBatchScheduler::QueueOptions) batch higher priority tasks first.
+enum class BatchTaskPriority {
+  kHigh = 0,
+  kDefault = 1,
+  kLow = 2,
+};
+constexpr int kNumBatchTaskPriorities = 3;
+
 // The abstract superclass for a unit of work to be done as part of a batch.
 //
 // An implementing subclass typically contains (or points to):
@@ -64,6 +73,15 @@ class BatchTask {
   // Returns the size of the task, in terms of how much it contributes to the
   // size of a batch. (A batch's size is the sum of its task sizes.)
   virtual size_t size() const = 0;
+
+  // Returns the priority of the task.
+  virtual BatchTaskPriority priority() const {
+    return BatchTaskPriority::kDefault;
+  }
+
+  // Returns the time (in microseconds, as given by Env::NowMicros()) by which
+  // the task should have been processed, or 0 if the task has no deadline.
+  virtual uint64 deadline_micros() const { return 0; }
 };
 
 // A thread-safe collection of BatchTasks, to be executed together in some
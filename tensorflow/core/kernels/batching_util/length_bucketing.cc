@@ -0,0 +1,100 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/length_bucketing.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/tstring.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+template <typename T>
+int64_t GetIntegerSequenceLength(const Tensor& tensor) {
+  int64_t length = 0;
+  if (tensor.dims() == 1) {
+    const auto values = tensor.flat<T>();
+    for (int64_t i = 0; i < values.size(); ++i) {
+      length = std::max<int64_t>(length, values(i));
+    }
+    return length;
+  }
+  // Dimension 1 is the sequence dimension. Any further dimensions (e.g.
+  // features of each token) are collapsed, and a position only counts as
+  // padding if all of its elements are zero.
+  const int64_t sequence_length = tensor.dim_size(1);
+  int64_t position_size = 1;
+  for (int d = 2; d < tensor.dims(); ++d) {
+    position_size *= tensor.dim_size(d);
+  }
+  const auto examples = tensor.template shaped<T, 3>(
+      {tensor.dim_size(0), sequence_length, position_size});
+  for (int64_t i = 0; i < examples.dimension(0); ++i) {
+    // Scans each example backwards, only as far as the longest length so far.
+    for (int64_t j = sequence_length - 1; j >= length; --j) {
+      bool padding = true;
+      for (int64_t k = 0; k < position_size && padding; ++k) {
+        padding = examples(i, j, k) == 0;
+      }
+      if (!padding) {
+        length = j + 1;
+        break;
+      }
+    }
+  }
+  return length;
+}
+
+}  // namespace
+
+Status GetSequenceLength(const Tensor& tensor, int64_t* length) {
+  if (tensor.dims() == 0) {
+    return errors::InvalidArgument(
+        "Length bucketing input must have at least one dimension.");
+  }
+  switch (tensor.dtype()) {
+    case DT_STRING: {
+      const auto values = tensor.flat<tstring>();
+      *length = 0;
+      for (int64_t i = 0; i < values.size(); ++i) {
+        *length = std::max<int64_t>(*length, values(i).size());
+      }
+      return OkStatus();
+    }
+    case DT_INT32:
+      *length = GetIntegerSequenceLength<int32>(tensor);
+      return OkStatus();
+    case DT_INT64:
+      *length = GetIntegerSequenceLength<int64_t>(tensor);
+      return OkStatus();
+    default:
+      return errors::InvalidArgument(
+          "Length bucketing input must be a string, int32 or int64 tensor; "
+          "got ",
+          DataTypeString(tensor.dtype()));
+  }
+}
+
+int GetLengthBucket(int64_t length, absl::Span<const int32> boundaries) {
+  return std::upper_bound(boundaries.begin(), boundaries.end(), length) -
+         boundaries.begin();
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,53 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LENGTH_BUCKETING_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LENGTH_BUCKETING_H_
+
+#include <cstdint>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Utilities to batch inputs of similar sequence lengths together, so that a
+// model padding its batch to the longest sequence pads less.
+
+// Returns in `length` the longest sequence length of the examples in
+// `tensor`, whose 0th dimension is the batch dimension:
+// - For string tensors, the length in bytes of the longest string.
+// - For integer tensors of rank 1, the largest value, i.e. the tensor holds
+//   the sequence lengths.
+// - For integer tensors of higher rank, such as padded token ids, the largest
+//   number of positions along dimension 1 of an example up to its last
+//   position with a non-zero element. Trailing all-zero positions are assumed
+//   to be padding.
+// Returns InvalidArgument for other tensors.
+Status GetSequenceLength(const Tensor& tensor, int64_t* length);
+
+// Returns the bucket of a sequence of `length` given the increasing bucket
+// `boundaries`: bucket `i` holds the lengths in
+// [boundaries[i - 1], boundaries[i]), and the last bucket, with index
+// `boundaries.size()`, holds the lengths from the last boundary on.
+int GetLengthBucket(int64_t length, absl::Span<const int32> boundaries);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LENGTH_BUCKETING_H_
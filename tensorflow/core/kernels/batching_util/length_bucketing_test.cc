@@ -0,0 +1,92 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/length_bucketing.h"
+
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(LengthBucketingTest, StringLength) {
+  int64_t length;
+  TF_ASSERT_OK(GetSequenceLength(
+      test::AsTensor<tstring>({"a", "abcde", "abc"}), &length));
+  EXPECT_EQ(length, 5);
+}
+
+TEST(LengthBucketingTest, LengthsTensor) {
+  int64_t length;
+  TF_ASSERT_OK(GetSequenceLength(test::AsTensor<int64_t>({3, 12, 7}), &length));
+  EXPECT_EQ(length, 12);
+}
+
+TEST(LengthBucketingTest, PaddedTokenIds) {
+  int64_t length;
+  TF_ASSERT_OK(GetSequenceLength(
+      test::AsTensor<int32>({5, 6, 0, 0, 0,  //
+                             7, 0, 8, 9, 0,  //
+                             1, 0, 0, 0, 0},
+                            TensorShape({3, 5})),
+      &length));
+  EXPECT_EQ(length, 4);
+
+  TF_ASSERT_OK(GetSequenceLength(
+      test::AsTensor<int32>({0, 0, 0, 0}, TensorShape({2, 2})), &length));
+  EXPECT_EQ(length, 0);
+}
+
+TEST(LengthBucketingTest, PaddedTokenFeatures) {
+  int64_t length;
+  // The length is measured along dimension 1. A position is padding only if
+  // all of its elements are zero.
+  TF_ASSERT_OK(GetSequenceLength(
+      test::AsTensor<int64_t>({1, 2, 0, 3, 0, 0,  //
+                               4, 0, 0, 0, 0, 0},
+                              TensorShape({2, 3, 2})),
+      &length));
+  EXPECT_EQ(length, 2);
+
+  TF_ASSERT_OK(GetSequenceLength(
+      test::AsTensor<int32>({}, TensorShape({0, 3, 2})), &length));
+  EXPECT_EQ(length, 0);
+}
+
+TEST(LengthBucketingTest, UnsupportedTensors) {
+  int64_t length;
+  EXPECT_EQ(GetSequenceLength(test::AsScalar<int32>(1), &length).code(),
+            error::INVALID_ARGUMENT);
+  EXPECT_EQ(GetSequenceLength(test::AsTensor<float>({1.0}), &length).code(),
+            error::INVALID_ARGUMENT);
+}
+
+TEST(LengthBucketingTest, Buckets) {
+  const std::vector<int32> boundaries = {16, 64};
+  EXPECT_EQ(GetLengthBucket(0, boundaries), 0);
+  EXPECT_EQ(GetLengthBucket(15, boundaries), 0);
+  EXPECT_EQ(GetLengthBucket(16, boundaries), 1);
+  EXPECT_EQ(GetLengthBucket(63, boundaries), 1);
+  EXPECT_EQ(GetLengthBucket(64, boundaries), 2);
+  EXPECT_EQ(GetLengthBucket(1000, boundaries), 2);
+  EXPECT_EQ(GetLengthBucket(1000, {}), 0);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -18,10 +18,12 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <array>
 #include <deque>
 #include <functional>
 #include <list>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -34,6 +36,8 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/periodic_function.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/cpu_info.h"
@@ -100,6 +104,12 @@ namespace serving {
 // For bulk processing jobs and throughput-oriented benchmarks, you may want to
 // set the maximum queue size to a large value.
 //
+// Queues serving a mix of latency-critical and bulk traffic can enable priority
+// queueing (see QueueOptions::enable_priority_queueing), in which case batches
+// are formed from the enqueued tasks by BatchTask::priority() rather than in
+// arrival order, and tasks that can't make their BatchTask::deadline_micros()
+// are dropped or deferred.
+//
 // TODO(b/26539183): Support queue servicing policies other than round-robin.
 // E.g. let each queue specify a "share" (an int >= 1), so e.g. with queues A
 // and B having shares 1 and 2 respectively, the servicing pattern is ABBABB...
@@ -218,6 +228,28 @@ class SharedBatchScheduler
     // submit batches whose size is in a small set of allowed sizes, that can be
     // done by adding padding in the process-batch callback.
     size_t max_execution_batch_size = 1000;
+
+    // If true, enqueued tasks are held in one lane per BatchTask::priority(),
+    // and a batch is only formed when a batch thread asks for one. Batches are
+    // filled from the highest priority lane first, and in arrival order within
+    // a lane. The open batch is scheduled before `batch_timeout_micros` if
+    // waiting for it would miss the deadline of an enqueued task.
+    //
+    // A task misses its BatchTask::deadline_micros() if it can't be processed
+    // by then, judging by how long recent batches took to process. Such tasks
+    // are handed to `expired_task_callback`, or, if it is unset, deferred
+    // behind all the tasks that can still make their deadline.
+    //
+    // Large input tasks are split into tasks of at most
+    // `max_execution_batch_size` when they are enqueued. Must be false if
+    // `enable_lazy_split` is true.
+    bool enable_priority_queueing = false;
+
+    // Called with the tasks that have missed their deadline if
+    // `enable_priority_queueing` is true, with a DeadlineExceeded error to
+    // report to them. Invoked from a batch thread.
+    std::function<void(std::unique_ptr<TaskType> task, const Status& status)>
+        expired_task_callback;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -279,6 +311,41 @@ class SharedBatchScheduler
 
 namespace internal {
 
+inline const char* BatchTaskPriorityName(BatchTaskPriority priority) {
+  switch (priority) {
+    case BatchTaskPriority::kHigh:
+      return "high";
+    case BatchTaskPriority::kDefault:
+      return "default";
+    case BatchTaskPriority::kLow:
+      return "low";
+  }
+  return "unknown";
+}
+
+inline void RecordPriorityQueueingDelayUs(int64_t queueing_delay_us,
+                                          BatchTaskPriority priority) {
+  static auto* cell = monitoring::Sampler<1>::New(
+      {"/tensorflow/serving/batching/priority_queueing_delay_us",
+       "Tracks the time (in microseconds) tasks wait in the lanes of queues "
+       "with priority queueing before they are batched, by priority.",
+       "priority"},
+      // It's 27 buckets with the last bucket being 2^26 to DBL_MAX;
+      // so the limits are [1, 2, 4, 8, ..., 64 * 1024 * 1024, DBL_MAX].
+      monitoring::Buckets::Exponential(1, 2, 27));
+  cell->GetCell(BatchTaskPriorityName(priority))
+      ->Add(static_cast<double>(queueing_delay_us));
+}
+
+inline void RecordExpiredTask(BatchTaskPriority priority) {
+  static auto* cell = monitoring::Counter<1>::New(
+      "/tensorflow/serving/batching/expired_tasks",
+      "Tracks the number of tasks dropped by queues with priority queueing "
+      "for missing their deadline, by priority.",
+      "priority");
+  cell->GetCell(BatchTaskPriorityName(priority))->IncrementBy(1);
+}
+
 // A task queue for SharedBatchScheduler. Accepts tasks and accumulates them
 // into batches, and dispenses those batches to be processed via a "pull"
 // interface. The queue's behavior is governed by maximum batch size, timeout
@@ -328,6 +395,10 @@ class Queue {
   // dequeued (out of mutex-protected area).
   Status ScheduleWithLazySplit(std::unique_ptr<TaskType>* task);
 
+  // Enqueue `task` in the lane of its priority. Batches are formed from the
+  // lanes when they are scheduled by `ScheduleBatchWithPriority`.
+  Status ScheduleWithPriority(std::unique_ptr<TaskType>* task);
+
   // Returns the number of enqueued tasks, with the same semantics as
   // BatchScheduler::NumEnqueuedTasks().
   size_t NumEnqueuedTasks() const;
@@ -354,6 +425,12 @@ class Queue {
   // Batches are guaranteed to form at task enqueue time.
   std::unique_ptr<Batch<TaskType>> ScheduleBatchWithEagerSplit();
 
+  // A variant of `ScheduleBatch`.
+  // Batches are formed from the priority lanes at dequeue time. The returned
+  // batch may be empty if the only tasks to process are expired ones, which
+  // are handed to `expired_task_callback` by `ProcessBatch`.
+  std::unique_ptr<Batch<TaskType>> ScheduleBatchWithPriority();
+
   // Processes a batch that has been returned earlier by ScheduleBatch().
   void ProcessBatch(std::unique_ptr<Batch<TaskType>> batch);
 
@@ -405,6 +482,35 @@ class Queue {
   bool IsOpenBatchSchedulableAfterEagerSplit() const
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // A task enqueued in a priority lane.
+  struct LaneEntry {
+    std::unique_ptr<TaskType> task;
+    // The deadline of the task, or of the task it was split from.
+    uint64 deadline_micros;
+    uint64 enqueue_time_micros;
+  };
+  using Lane = std::deque<LaneEntry>;
+
+  // A variant of `IsOpenBatchSchedulable`; used when tasks are enqueued in
+  // priority lanes.
+  bool IsPriorityBatchSchedulable() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Whether the task of `entry` can no longer be processed by its deadline.
+  bool IsLate(const LaneEntry& entry, uint64 now_micros) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Removes the task `*it` points to from `lanes_[priority]`, and advances
+  // `*it` to the next task of the lane.
+  std::unique_ptr<TaskType> RemoveFromLane(int priority,
+                                           typename Lane::iterator* it)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Moves tasks from the lanes into `batch` until it is full, from the highest
+  // priority lane first. Only takes the tasks that are late if `late` is true,
+  // and only those that aren't otherwise.
+  void FillBatchFromLanes(bool late, uint64 now_micros, Batch<TaskType>* batch)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Same as SchedulingCapacity(), but assumes the caller already holds a
   // lock on 'mu_'.
   size_t SchedulingCapacityInternal() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
@@ -462,6 +568,28 @@ class Queue {
   std::deque<std::unique_ptr<Batch<BatchInputTaskHandle<TaskType>>>>
       task_handle_batches_ TF_GUARDED_BY(mu_);
 
+  // The tasks enqueued by `ScheduleWithPriority`, indexed by priority.
+  //
+  // Used iff `QueueOptions.enable_priority_queueing` is true, in which case
+  // `batches_` only holds an empty open batch.
+  std::array<Lane, kNumBatchTaskPriorities> lanes_ TF_GUARDED_BY(mu_);
+
+  // The number and total size of the tasks in `lanes_`.
+  size_t num_lane_tasks_ TF_GUARDED_BY(mu_) = 0;
+  size_t lane_tasks_size_ TF_GUARDED_BY(mu_) = 0;
+
+  // The deadlines of the tasks in `lanes_` that have one.
+  std::multiset<uint64> lane_deadlines_ TF_GUARDED_BY(mu_);
+
+  // Tasks removed from `lanes_` for missing their deadline, to be handed to
+  // `expired_task_callback` by `ProcessBatch`.
+  std::vector<std::unique_ptr<TaskType>> expired_tasks_ TF_GUARDED_BY(mu_);
+
+  // A moving average of the time `process_batch_callback_` takes, which is
+  // the time a task needs to make its deadline. Only tracked with priority
+  // queueing.
+  double batch_processing_micros_ TF_GUARDED_BY(mu_) = 0;
+
   // The counter of the TraceMe context ids.
   uint64 traceme_context_id_counter_ TF_GUARDED_BY(mu_) = 0;
 
@@ -603,6 +731,11 @@ Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         "enable_large_batch_splitting is enabled.");
   }
 
+  if (options.enable_priority_queueing && options.enable_lazy_split) {
+    return errors::InvalidArgument(
+        "enable_priority_queueing is not supported with enable_lazy_split.");
+  }
+
   if (options.enable_large_batch_splitting &&
       (options.input_batch_size_limit < options.max_execution_batch_size)) {
     return errors::InvalidArgument(
@@ -796,6 +929,9 @@ Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
                                    " is larger than maximum input batch size ",
                                    options_.input_batch_size_limit);
   }
+  if (options_.enable_priority_queueing) {
+    return ScheduleWithPriority(task);
+  }
   if (options_.enable_lazy_split) {
     return ScheduleWithLazySplit(std::move(task));
   }
@@ -939,10 +1075,71 @@ Status Queue<TaskType>::ScheduleWithoutOrEagerSplit(
   return OkStatus();
 }
 
+template <typename TaskType>
+Status Queue<TaskType>::ScheduleWithPriority(std::unique_ptr<TaskType>* task) {
+  profiler::TraceMe trace_me([task] {
+    return profiler::TraceMeEncode(
+        "ScheduleWithPriority",
+        {{"batching_input_task_size", (*task)->size()},
+         {"priority", BatchTaskPriorityName((*task)->priority())}});
+  });
+
+  bool notify_of_schedulable_batch = false;
+  {
+    mutex_lock l(mu_);
+
+    DCHECK(!closed_);
+
+    TF_RETURN_IF_ERROR(ValidateBatchTaskQueueCapacity((*task).get()));
+
+    const int priority = static_cast<int>((*task)->priority());
+    DCHECK_GE(priority, 0);
+    DCHECK_LT(priority, kNumBatchTaskPriorities);
+    const uint64 deadline_micros = (*task)->deadline_micros();
+
+    std::vector<std::unique_ptr<TaskType>> output_tasks;
+    if ((*task)->size() <= max_execution_batch_size() ||
+        !options_.enable_large_batch_splitting) {
+      output_tasks.push_back(std::move(*task));
+    } else {
+      // Batches are formed at dequeue time, so the first output task can be
+      // as large as any other.
+      TF_RETURN_IF_ERROR(options_.split_input_task_func(
+          task, max_execution_batch_size(), max_execution_batch_size(),
+          &output_tasks));
+    }
+
+    const uint64 now_micros = env_->NowMicros();
+    for (auto& output_task : output_tasks) {
+      if (deadline_micros != 0) {
+        lane_deadlines_.insert(deadline_micros);
+      }
+      ++num_lane_tasks_;
+      lane_tasks_size_ += output_task->size();
+      lanes_[priority].push_back(
+          {std::move(output_task), deadline_micros, now_micros});
+    }
+
+    if (!schedulable_batch_ && IsPriorityBatchSchedulable()) {
+      schedulable_batch_ = true;
+      notify_of_schedulable_batch = true;
+    }
+  }
+
+  if (notify_of_schedulable_batch) {
+    schedulable_batch_callback_();
+  }
+
+  return OkStatus();
+}
+
 template <typename TaskType>
 size_t Queue<TaskType>::NumEnqueuedTasks() const {
   size_t num_enqueued_tasks = 0;
   mutex_lock l(mu_);
+  if (options_.enable_priority_queueing) {
+    return num_lane_tasks_;
+  }
   if (options_.enable_lazy_split) {
     for (const auto& batch : task_handle_batches_) {
       num_enqueued_tasks += batch->num_tasks();
@@ -964,6 +1161,10 @@ size_t Queue<TaskType>::SchedulingCapacity() const {
 
 template <typename TaskType>
 size_t Queue<TaskType>::SchedulingCapacityInternal() const {
+  if (options_.enable_priority_queueing) {
+    return options_.max_enqueued_batches * max_execution_batch_size() -
+           lane_tasks_size_;
+  }
   const int64 num_new_batches_schedulable =
       static_cast<int64_t>(options_.max_enqueued_batches) -
       this->num_enqueued_batches();
@@ -978,6 +1179,20 @@ size_t Queue<TaskType>::SchedulingCapacityInternal() const {
 
 template <typename TaskType>
 Status Queue<TaskType>::ValidateBatchTaskQueueCapacity(TaskType* task) const {
+  if (options_.enable_priority_queueing) {
+    if (task->size() > SchedulingCapacityInternal()) {
+      return errors::Unavailable(
+          "The batch scheduling queue to which this task was submitted is "
+          "full; task size is ",
+          task->size(), " but scheduling capacity is only ",
+          SchedulingCapacityInternal(), " (num_enqueued_tasks=",
+          num_lane_tasks_, ", max_enqueued_batches=",
+          options_.max_enqueued_batches,
+          ", max_execution_batch_size=", max_execution_batch_size(), ")");
+    }
+    return OkStatus();
+  }
+
   // Queue creation requires that `enable_large_batch_splitting` is true
   // when `enable_lazy_split` is true, so this covers both eager split and
   // lazy split.
@@ -1045,9 +1260,63 @@ Queue<TaskType>::ScheduleBatchWithEagerSplit() {
   return batch_to_schedule;
 }
 
+template <typename TaskType>
+std::unique_ptr<Batch<TaskType>> Queue<TaskType>::ScheduleBatchWithPriority() {
+  std::unique_ptr<Batch<TaskType>> batch_to_schedule;
+
+  {
+    mutex_lock l(mu_);
+
+    if (!IsPriorityBatchSchedulable()) {
+      schedulable_batch_ = false;
+      return nullptr;
+    }
+
+    const uint64 now_micros = env_->NowMicros();
+    // Whether any task is late, so that the lanes only need to be scanned for
+    // late tasks if one is.
+    const bool any_late =
+        !lane_deadlines_.empty() &&
+        now_micros + batch_processing_micros_ > *lane_deadlines_.begin();
+    if (any_late && options_.expired_task_callback != nullptr) {
+      for (int priority = 0; priority < kNumBatchTaskPriorities; ++priority) {
+        auto it = lanes_[priority].begin();
+        while (it != lanes_[priority].end()) {
+          if (IsLate(*it, now_micros)) {
+            RecordExpiredTask(static_cast<BatchTaskPriority>(priority));
+            expired_tasks_.push_back(RemoveFromLane(priority, &it));
+          } else {
+            ++it;
+          }
+        }
+      }
+    }
+
+    batch_to_schedule =
+        std::make_unique<Batch<TaskType>>(++traceme_context_id_counter_);
+    FillBatchFromLanes(/*late=*/false, now_micros, batch_to_schedule.get());
+    if (any_late && options_.expired_task_callback == nullptr) {
+      // Late tasks are deferred behind the others rather than dropped.
+      FillBatchFromLanes(/*late=*/true, now_micros, batch_to_schedule.get());
+    }
+    batch_to_schedule->Close();
+
+    if (batch_to_schedule->empty() && expired_tasks_.empty()) {
+      schedulable_batch_ = false;
+      return nullptr;
+    }
+    ++num_batches_being_processed_;
+  }
+
+  return batch_to_schedule;
+}
+
 template <typename TaskType>
 typename SharedBatchScheduler<TaskType>::BatchUniquePtr
 Queue<TaskType>::ScheduleBatch() {
+  if (options_.enable_priority_queueing) {
+    return ScheduleBatchWithPriority();
+  }
   if (!options_.enable_lazy_split) {
     return ScheduleBatchWithEagerSplit();
   }
@@ -1087,7 +1356,36 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
       },
       profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
-  process_batch_callback_(std::move(batch));
+  if (!options_.enable_priority_queueing) {
+    process_batch_callback_(std::move(batch));
+  } else {
+    std::vector<std::unique_ptr<TaskType>> expired_tasks;
+    {
+      mutex_lock l(mu_);
+      expired_tasks.swap(expired_tasks_);
+    }
+    for (auto& task : expired_tasks) {
+      options_.expired_task_callback(
+          std::move(task),
+          errors::DeadlineExceeded(
+              "The task would have missed its deadline in the batch "
+              "scheduling queue."));
+    }
+    if (!batch->empty()) {
+      const uint64 start_time_micros = env_->NowMicros();
+      process_batch_callback_(std::move(batch));
+      const double processing_micros = env_->NowMicros() - start_time_micros;
+      mutex_lock l(mu_);
+      // An exponential moving average, to adapt to changing batch sizes and
+      // load but not to outliers.
+      constexpr double kWeight = 0.1;
+      batch_processing_micros_ =
+          batch_processing_micros_ == 0
+              ? processing_micros
+              : (1 - kWeight) * batch_processing_micros_ +
+                    kWeight * processing_micros;
+    }
+  }
 
   {
     mutex_lock l(mu_);
@@ -1128,7 +1426,8 @@ bool Queue<TaskType>::IsEmptyInternal() const {
            task_handle_batches_.back()->empty();
   }
   return num_batches_being_processed_ == 0 && batches_.size() == 1 &&
-         batches_.back()->empty();
+         batches_.back()->empty() && num_lane_tasks_ == 0 &&
+         expired_tasks_.empty();
 }
 
 template <typename TaskType>
@@ -1180,6 +1479,69 @@ bool Queue<TaskType>::IsOpenBatchSchedulable() const {
              open_batch_start_time_micros_ + options_.batch_timeout_micros;
 }
 
+template <typename TaskType>
+bool Queue<TaskType>::IsPriorityBatchSchedulable() const {
+  if (num_lane_tasks_ == 0) {
+    return false;
+  }
+  if (closed_ || lane_tasks_size_ >= max_execution_batch_size()) {
+    return true;
+  }
+  const uint64 now_micros = env_->NowMicros();
+  for (const Lane& lane : lanes_) {
+    // Lanes are in arrival order, so the front task has waited the longest.
+    if (!lane.empty() && now_micros >= lane.front().enqueue_time_micros +
+                                           options_.batch_timeout_micros) {
+      return true;
+    }
+  }
+  // Don't wait for the timeout if that would miss a deadline.
+  return !lane_deadlines_.empty() &&
+         now_micros + batch_processing_micros_ >= *lane_deadlines_.begin();
+}
+
+template <typename TaskType>
+bool Queue<TaskType>::IsLate(const LaneEntry& entry, uint64 now_micros) const {
+  return entry.deadline_micros != 0 &&
+         now_micros + batch_processing_micros_ > entry.deadline_micros;
+}
+
+template <typename TaskType>
+std::unique_ptr<TaskType> Queue<TaskType>::RemoveFromLane(
+    int priority, typename Lane::iterator* it) {
+  std::unique_ptr<TaskType> task = std::move((*it)->task);
+  if ((*it)->deadline_micros != 0) {
+    lane_deadlines_.erase(lane_deadlines_.find((*it)->deadline_micros));
+  }
+  --num_lane_tasks_;
+  lane_tasks_size_ -= task->size();
+  *it = lanes_[priority].erase(*it);
+  return task;
+}
+
+template <typename TaskType>
+void Queue<TaskType>::FillBatchFromLanes(bool late, uint64 now_micros,
+                                         Batch<TaskType>* batch) {
+  for (int priority = 0; priority < kNumBatchTaskPriorities; ++priority) {
+    Lane& lane = lanes_[priority];
+    auto it = lane.begin();
+    while (it != lane.end() && batch->size() < max_execution_batch_size()) {
+      if (IsLate(*it, now_micros) != late) {
+        ++it;
+        continue;
+      }
+      if (batch->size() + it->task->size() > max_execution_batch_size()) {
+        // Keep the lane in arrival order; lower priority lanes may still have
+        // tasks that fit.
+        break;
+      }
+      RecordPriorityQueueingDelayUs(now_micros - it->enqueue_time_micros,
+                                    static_cast<BatchTaskPriority>(priority));
+      batch->AddTask(RemoveFromLane(priority, &it));
+    }
+  }
+}
+
 template <typename TaskType>
 size_t Queue<TaskType>::tail_batch_task_size() const {
   if (options_.enable_lazy_split) {
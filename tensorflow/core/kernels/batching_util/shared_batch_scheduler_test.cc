@@ -44,14 +44,24 @@ using ::testing::HasSubstr;
 
 class FakeTask : public BatchTask {
  public:
-  explicit FakeTask(size_t size) : size_(size) {}
+  explicit FakeTask(size_t size)
+      : FakeTask(size, BatchTaskPriority::kDefault) {}
+
+  FakeTask(size_t size, BatchTaskPriority priority, uint64 deadline_micros = 0)
+      : size_(size), priority_(priority), deadline_micros_(deadline_micros) {}
 
   ~FakeTask() override = default;
 
   size_t size() const override { return size_; }
 
+  BatchTaskPriority priority() const override { return priority_; }
+
+  uint64 deadline_micros() const override { return deadline_micros_; }
+
  private:
   const size_t size_;
+  const BatchTaskPriority priority_;
+  const uint64 deadline_micros_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(FakeTask);
 };
@@ -74,6 +84,16 @@ Status ScheduleTask(size_t task_size, BatchScheduler<FakeTask>* scheduler) {
   return status;
 }
 
+// Like above, for a task with the given priority and deadline.
+Status ScheduleTask(size_t task_size, BatchTaskPriority priority,
+                    uint64 deadline_micros,
+                    BatchScheduler<FakeTask>* scheduler) {
+  auto task = std::make_unique<FakeTask>(task_size, priority, deadline_micros);
+  Status status = scheduler->Schedule(&task);
+  CHECK_EQ(status.ok(), task == nullptr);
+  return status;
+}
+
 // Creates a thread that waits on 'start' and then advances the fake clock in
 // 'env' in a loop until 'stop' is notified. Useful for allowing objects that
 // use the clock to be destroyed.
@@ -804,6 +824,222 @@ INSTANTIATE_TEST_SUITE_P(
                       std::make_tuple(/*enable_input_batch_split=*/false,
                                       /*enable_lazy_split=*/false)));
 
+// Tests of queues with priority queueing. Each test first occupies the only
+// batch thread with a full batch, so that the tasks it schedules afterwards are
+// formed into batches together once the thread is released.
+class PriorityQueueingTest : public ::testing::Test {
+ protected:
+  // The priority and size of a task, as seen by the process-batch callback.
+  using TaskInfo = std::pair<BatchTaskPriority, size_t>;
+
+  PriorityQueueingTest()
+      : env_(Env::Default()),
+        teardown_thread_(CreateFakeClockAdvancerThread(&env_, &start_teardown_,
+                                                       &stop_teardown_)) {}
+
+  ~PriorityQueueingTest() override {
+    Unblock();
+    start_teardown_.Notify();
+    queue_ = nullptr;
+    scheduler_ = nullptr;
+    stop_teardown_.Notify();
+  }
+
+  QueueOptions CreatePriorityQueueOptions(size_t max_execution_batch_size,
+                                          size_t batch_timeout_micros) {
+    QueueOptions options = CreateQueueOptions(
+        max_execution_batch_size, max_execution_batch_size,
+        batch_timeout_micros, /*max_enqueued_batches=*/3,
+        /*enable_large_batch_splitting=*/false, /*enable_lazy_split=*/false,
+        /*split_func=*/nullptr);
+    options.enable_priority_queueing = true;
+    return options;
+  }
+
+  // Creates `queue_`, and blocks its batch thread with a batch of size
+  // `max_execution_batch_size` until `Unblock()`.
+  void CreateBlockedQueue(const QueueOptions& options) {
+    scheduler_ = CreateSharedBatchScheduler(1, &env_);
+    queue_ = CreateQueue(
+        scheduler_, options, [this](std::unique_ptr<Batch<FakeTask>> batch) {
+          if (!blocked_.HasBeenNotified()) {
+            blocked_.Notify();
+            unblock_.WaitForNotification();
+            return;
+          }
+          std::vector<TaskInfo> tasks;
+          for (int i = 0; i < batch->num_tasks(); ++i) {
+            tasks.emplace_back(batch->task(i).priority(),
+                               batch->task(i).size());
+          }
+          mutex_lock l(mu_);
+          batches_.push_back(std::move(tasks));
+        });
+    TF_ASSERT_OK(ScheduleTask(options.max_execution_batch_size, queue_.get()));
+    blocked_.WaitForNotification();
+  }
+
+  void Unblock() {
+    if (!unblock_.HasBeenNotified()) {
+      unblock_.Notify();
+    }
+  }
+
+  // Waits until `num_batches` batches have been processed after the blocking
+  // one, and returns them.
+  std::vector<std::vector<TaskInfo>> WaitForBatches(int num_batches) {
+    for (;;) {
+      {
+        mutex_lock l(mu_);
+        if (batches_.size() >= num_batches) {
+          return batches_;
+        }
+      }
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+  }
+
+  test_util::FakeClockEnv env_;
+  Notification start_teardown_, stop_teardown_;
+  std::unique_ptr<Thread> teardown_thread_;
+  std::shared_ptr<Scheduler> scheduler_;
+  std::unique_ptr<Queue> queue_;
+
+ private:
+  Notification blocked_, unblock_;
+  mutex mu_;
+  std::vector<std::vector<TaskInfo>> batches_ TF_GUARDED_BY(mu_);
+};
+
+constexpr BatchTaskPriority kHigh = BatchTaskPriority::kHigh;
+constexpr BatchTaskPriority kDefault = BatchTaskPriority::kDefault;
+constexpr BatchTaskPriority kLow = BatchTaskPriority::kLow;
+
+TEST_F(PriorityQueueingTest, FillsBatchesFromHighPriorityFirst) {
+  CreateBlockedQueue(CreatePriorityQueueOptions(
+      /*max_execution_batch_size=*/4, /*batch_timeout_micros=*/10));
+  TF_ASSERT_OK(ScheduleTask(2, kLow, 0, queue_.get()));
+  TF_ASSERT_OK(ScheduleTask(2, kDefault, 0, queue_.get()));
+  TF_ASSERT_OK(ScheduleTask(1, kHigh, 0, queue_.get()));
+  TF_ASSERT_OK(ScheduleTask(1, kLow, 0, queue_.get()));
+  TF_ASSERT_OK(ScheduleTask(1, kHigh, 0, queue_.get()));
+  EXPECT_EQ(queue_->NumEnqueuedTasks(), 5);
+  Unblock();
+  // The second batch is underfull, and waits for the timeout.
+  env_.AdvanceByMicroseconds(10);
+  EXPECT_THAT(
+      WaitForBatches(2),
+      ::testing::ElementsAre(
+          ::testing::ElementsAre(TaskInfo(kHigh, 1), TaskInfo(kHigh, 1),
+                                 TaskInfo(kDefault, 2)),
+          ::testing::ElementsAre(TaskInfo(kLow, 2), TaskInfo(kLow, 1))));
+}
+
+TEST_F(PriorityQueueingTest, DropsExpiredTasks) {
+  QueueOptions options = CreatePriorityQueueOptions(
+      /*max_execution_batch_size=*/4, /*batch_timeout_micros=*/0);
+  mutex mu;
+  std::vector<Status> expired_statuses;
+  options.expired_task_callback = [&](std::unique_ptr<FakeTask> task,
+                                      const Status& status) {
+    EXPECT_EQ(task->size(), 3);
+    mutex_lock l(mu);
+    expired_statuses.push_back(status);
+  };
+  CreateBlockedQueue(options);
+  TF_ASSERT_OK(ScheduleTask(3, kHigh, env_.NowMicros() + 5, queue_.get()));
+  TF_ASSERT_OK(ScheduleTask(1, kLow, 0, queue_.get()));
+  env_.AdvanceByMicroseconds(10);
+  Unblock();
+  EXPECT_THAT(WaitForBatches(1), ::testing::ElementsAre(::testing::ElementsAre(
+                                     TaskInfo(kLow, 1))));
+  // Expired tasks are handed to the callback before the batch is processed.
+  mutex_lock l(mu);
+  ASSERT_EQ(expired_statuses.size(), 1);
+  EXPECT_EQ(expired_statuses[0].code(), error::DEADLINE_EXCEEDED);
+}
+
+TEST_F(PriorityQueueingTest, DefersExpiredTasksWithoutCallback) {
+  CreateBlockedQueue(CreatePriorityQueueOptions(
+      /*max_execution_batch_size=*/4, /*batch_timeout_micros=*/0));
+  TF_ASSERT_OK(ScheduleTask(1, kHigh, env_.NowMicros() + 5, queue_.get()));
+  TF_ASSERT_OK(ScheduleTask(1, kLow, 0, queue_.get()));
+  env_.AdvanceByMicroseconds(10);
+  Unblock();
+  EXPECT_THAT(WaitForBatches(1), ::testing::ElementsAre(::testing::ElementsAre(
+                                     TaskInfo(kLow, 1), TaskInfo(kHigh, 1))));
+}
+
+TEST_F(PriorityQueueingTest, SchedulesBatchBeforeTimeoutForDeadline) {
+  CreateBlockedQueue(CreatePriorityQueueOptions(
+      /*max_execution_batch_size=*/4, /*batch_timeout_micros=*/1000 * 1000));
+  Unblock();
+  TF_ASSERT_OK(ScheduleTask(1, kDefault, env_.NowMicros() + 100, queue_.get()));
+  Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+  EXPECT_EQ(queue_->NumEnqueuedTasks(), 1);
+  env_.AdvanceByMicroseconds(100);
+  EXPECT_THAT(WaitForBatches(1), ::testing::ElementsAre(::testing::ElementsAre(
+                                     TaskInfo(kDefault, 1))));
+}
+
+TEST_F(PriorityQueueingTest, SplitsLargeTasksAndObeysCapacity) {
+  QueueOptions options = CreatePriorityQueueOptions(
+      /*max_execution_batch_size=*/4, /*batch_timeout_micros=*/10);
+  options.input_batch_size_limit = 10;
+  options.enable_large_batch_splitting = true;
+  options.split_input_task_func =
+      [](std::unique_ptr<FakeTask>* input_task, int first_output_task_size,
+         int max_batch_size,
+         std::vector<std::unique_ptr<FakeTask>>* output_tasks) -> Status {
+    const internal::InputSplitMetadata input_split_metadata(
+        (*input_task)->size(), first_output_task_size, max_batch_size);
+    for (int task_size : input_split_metadata.task_sizes()) {
+      output_tasks->push_back(
+          std::make_unique<FakeTask>(task_size, (*input_task)->priority()));
+    }
+    input_task->reset();
+    return OkStatus();
+  };
+  CreateBlockedQueue(options);
+  EXPECT_EQ(queue_->SchedulingCapacity(), 12);
+  TF_ASSERT_OK(ScheduleTask(10, kLow, 0, queue_.get()));
+  EXPECT_EQ(queue_->NumEnqueuedTasks(), 3);
+  EXPECT_EQ(queue_->SchedulingCapacity(), 2);
+  EXPECT_THAT(ScheduleTask(3, kHigh, 0, queue_.get()),
+              testing::StatusIs(error::UNAVAILABLE));
+  TF_ASSERT_OK(ScheduleTask(2, kHigh, 0, queue_.get()));
+  Unblock();
+  // The last part of the split task is underfull, and waits for the timeout.
+  env_.AdvanceByMicroseconds(10);
+  EXPECT_THAT(WaitForBatches(4),
+              ::testing::ElementsAre(
+                  ::testing::ElementsAre(TaskInfo(kHigh, 2)),
+                  ::testing::ElementsAre(TaskInfo(kLow, 4)),
+                  ::testing::ElementsAre(TaskInfo(kLow, 4)),
+                  ::testing::ElementsAre(TaskInfo(kLow, 2))));
+}
+
+TEST(SharedBatchSchedulerPriorityQueueingTest, InvalidWithLazySplit) {
+  auto scheduler = CreateSharedBatchScheduler(1);
+  QueueOptions options = CreateQueueOptions(
+      /*max_execution_batch_size=*/4, /*input_batch_size_limit=*/4,
+      /*batch_timeout_micros=*/0, /*max_enqueued_batches=*/2,
+      /*enable_large_batch_splitting=*/true, /*enable_lazy_split=*/true,
+      [](std::unique_ptr<FakeTask>* input_task, int first_output_task_size,
+         int max_batch_size,
+         std::vector<std::unique_ptr<FakeTask>>* output_tasks) {
+        return OkStatus();
+      });
+  options.enable_priority_queueing = true;
+  std::unique_ptr<Queue> queue;
+  EXPECT_THAT(
+      scheduler->AddQueue(
+          options, [](std::unique_ptr<Batch<FakeTask>> batch) {}, &queue),
+      testing::StatusIs(error::INVALID_ARGUMENT,
+                        "enable_priority_queueing is not supported with "
+                        "enable_lazy_split."));
+}
+
 #ifdef PLATFORM_GOOGLE
 // This benchmark relies on https://github.com/google/benchmark features,
 // (in particular, `Benchmark::ThreadRange`) not available in open-sourced TF
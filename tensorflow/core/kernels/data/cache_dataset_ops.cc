@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -46,6 +47,8 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const CacheDatasetOp::kMemoryBudgetBytes;
+/* static */ constexpr const char* const CacheDatasetOp::kSpillDirectory;
 
 namespace {
 
@@ -64,6 +67,12 @@ constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+constexpr char kMemoryTier[] = "memory";
+constexpr char kDiskTier[] = "disk";
+constexpr char kSpillWrite[] = "write";
+constexpr char kSpillRead[] = "read";
+constexpr char kSpillFilename[] = "spill_filename";
+constexpr char kSpillNumElements[] = "spill_num_elements";
 constexpr char kIncompleteCacheErrorMessage[] =
     "The calling iterator did not fully read the dataset being cached. In "
     "order to avoid unexpected truncation of the dataset, the partially cached "
@@ -438,11 +447,21 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
         }
         filename_ = strings::StrCat(dataset()->filename_, "_", shard_id_);
         lockfile_ = strings::StrCat(filename_, kLockFileSuffix);
-        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_);
+        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_,
+                                                 BundleWriterOptions());
         return OkStatus();
       }
 
      private:
+      // Aligns the cached tensors in the data files so that
+      // `FileReaderIterator` can hand out tensors backed directly by a memory
+      // mapping of the cache.
+      static BundleWriter::Options BundleWriterOptions() {
+        BundleWriter::Options options;
+        options.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+        return options;
+      }
+
       Status EnsureLockFileExists(bool* end_of_sequence)
           TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         if (iteration_completed_) {
@@ -500,7 +519,8 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
         // conditions are not met since BundleWriter's constructor creates
         // new temp files which can delete the temp files created by a
         // BundleWriter in another Session.
-        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_);
+        writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_,
+                                                 BundleWriterOptions());
         lockfile_created_ = true;
         return OkStatus();
       }
@@ -586,7 +606,10 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
           }
           StringPiece key = reader_.key();
           DCHECK_EQ(key, dataset()->FormatName(cur_index_, i));
-          TF_RETURN_IF_ERROR(reader_.ReadCurrent(&(*out_tensors)[i]));
+          // Tensors are served directly from the page cache whenever the
+          // cache layout allows it, avoiding an allocation and a copy per
+          // tensor on every epoch.
+          TF_RETURN_IF_ERROR(reader_.ReadCurrentMapped(&(*out_tensors)[i]));
           TF_RETURN_IF_ERROR(reader_.status());
         }
         cur_index_++;
@@ -724,10 +747,15 @@ class CacheDatasetOp::FileDatasetV2 : public CacheDatasetOp::FileDatasetBase {
 class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
  public:
   explicit MemoryDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
-                             std::shared_ptr<MemoryCache> cache)
+                             std::shared_ptr<MemoryCache> cache,
+                             int64_t memory_budget_bytes,
+                             std::string spill_directory)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
-        cache_(std::move(cache)) {
+        cache_(std::move(cache)),
+        memory_budget_bytes_(memory_budget_bytes),
+        spill_directory_(std::move(spill_directory)),
+        env_(ctx->env()) {
     input_->Ref();
   }
 
@@ -794,6 +822,98 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
   }
 
  protected:
+  // Returns whether an element of `element_bytes` bytes can be kept in memory
+  // when `used_bytes` bytes of the memory budget are already in use.
+  bool FitsInMemoryBudget(int64_t used_bytes, int64_t element_bytes) const {
+    return memory_budget_bytes_ <= 0 ||
+           used_bytes + element_bytes <= memory_budget_bytes_;
+  }
+
+  // Writes a reference to the elements of `spill` to the checkpoint under
+  // `key_prefix`. The elements are not read back into memory, which the memory
+  // budget bounds, so the checkpoint can only be restored while the spill file
+  // exists, i.e. by the process that wrote it.
+  static Status WriteSpillToCheckpoint(IteratorStateWriter* writer,
+                                       const std::string& key_prefix,
+                                       const CacheSpill& spill) {
+    if (spill.num_elements == 0) {
+      return OkStatus();
+    }
+    TF_RETURN_IF_ERROR(
+        writer->WriteScalar(key_prefix, kSpillFilename, spill.filename));
+    return writer->WriteScalar(key_prefix, kSpillNumElements,
+                               spill.num_elements);
+  }
+
+  // Opens the spill file referred to by the checkpoint under `key_prefix`, if
+  // any, and sets `num_elements` to the number of its elements the checkpoint
+  // refers to.
+  Status OpenSpillFromCheckpoint(
+      IteratorStateReader* reader, const std::string& key_prefix,
+      std::unique_ptr<CacheSpillReader>* spill_reader,
+      int64_t* num_elements) const {
+    *num_elements = 0;
+    if (!reader->Contains(key_prefix, kSpillFilename)) {
+      return OkStatus();
+    }
+    tstring filename;
+    TF_RETURN_IF_ERROR(
+        reader->ReadScalar(key_prefix, kSpillFilename, &filename));
+    TF_RETURN_IF_ERROR(
+        reader->ReadScalar(key_prefix, kSpillNumElements, num_elements));
+    CacheSpill spill;
+    spill.filename = filename;
+    spill.num_elements = *num_elements;
+    Status s = env_->FileExists(spill.filename);
+    if (!s.ok()) {
+      return errors::FailedPrecondition(
+          "Failed to restore the memory cache: the spill file ",
+          spill.filename,
+          " the checkpoint refers to no longer exists. Checkpoints of a cache "
+          "that spilled elements to disk can only be restored while the cache "
+          "that wrote them exists: ",
+          s.ToString());
+    }
+    return CacheSpillReader::Create(env_, spill, output_dtypes(),
+                                    spill_reader);
+  }
+
+  // Copies the elements of the spill file referred to by the checkpoint under
+  // `key_prefix`, if any, to a new spill file described by `spill`, one
+  // element at a time.
+  Status CopySpillFromCheckpoint(IteratorStateReader* reader,
+                                 const std::string& key_prefix,
+                                 CacheSpill* spill) const {
+    std::unique_ptr<CacheSpillReader> spill_reader;
+    int64_t num_elements = 0;
+    TF_RETURN_IF_ERROR(OpenSpillFromCheckpoint(reader, key_prefix,
+                                               &spill_reader, &num_elements));
+    if (!spill_reader) {
+      return OkStatus();
+    }
+    std::unique_ptr<CacheSpillWriter> spill_writer;
+    TF_RETURN_IF_ERROR(CacheSpillWriter::Create(
+        env_, spill_directory_, output_dtypes(), &spill_writer));
+    for (int64_t i = 0; i < num_elements; ++i) {
+      std::vector<Tensor> element;
+      TF_RETURN_IF_ERROR(spill_reader->Read(&element));
+      TF_RETURN_IF_ERROR(spill_writer->Write(element));
+    }
+    return spill_writer->Finish(spill);
+  }
+
+  // Adds the memory budget attributes of the dataset to `attrs`.
+  void AddSpillAttrs(
+      DatasetGraphDefBuilder* b,
+      std::vector<std::pair<StringPiece, AttrValue>>* attrs) const {
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
+    attrs->emplace_back(kMemoryBudgetBytes, memory_budget_bytes);
+    AttrValue spill_directory;
+    b->BuildAttrValue(spill_directory_, &spill_directory);
+    attrs->emplace_back(kSpillDirectory, spill_directory);
+  }
+
   class MemoryIterator : public DatasetIterator<MemoryDatasetBase> {
    public:
     explicit MemoryIterator(const Params& params, MemoryCache* cache)
@@ -825,6 +945,8 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCacheCompleted), ""));
         TF_RETURN_IF_ERROR(
             WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+        TF_RETURN_IF_ERROR(
+            WriteSpillToCheckpoint(writer, prefix(), cache_->spill()));
       }
       return SaveInput(ctx, writer, iterator_);
     }
@@ -832,13 +954,22 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
       mutex_lock l(mu_);
-      iterator_.reset();
-      cache_->Reset();
-      if (reader->Contains(full_name(kCacheCompleted))) {
-        std::vector<std::vector<Tensor>> temp_cache;
+      // The checkpoint may refer to the spill file of the cache, or of the
+      // writer iterator, so both are kept until the checkpoint is restored.
+      std::unique_ptr<IteratorBase> previous_iterator = std::move(iterator_);
+      const bool cache_completed = reader->Contains(full_name(kCacheCompleted));
+      std::vector<std::vector<Tensor>> temp_cache;
+      CacheSpill spill;
+      if (cache_completed) {
         TF_RETURN_IF_ERROR(
             ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
-        cache_->Complete(std::move(temp_cache));
+        TF_RETURN_IF_ERROR(
+            dataset()->CopySpillFromCheckpoint(reader, prefix(), &spill));
+      }
+      cache_->Reset();
+      if (cache_completed) {
+        cache_->Complete(std::move(temp_cache), std::move(spill),
+                         dataset()->env_);
       }
       TF_RETURN_IF_ERROR(InitializeIterator(ctx));
       return RestoreInput(ctx, reader, iterator_);
@@ -852,7 +983,8 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 
       ~MemoryWriterIterator() override {
         mutex_lock l(mu_);
-        if (!temp_cache_.empty() && !cache_->IsCompleted()) {
+        if ((!temp_cache_.empty() || spill_writer_) &&
+            !cache_->IsCompleted()) {
           LOG(WARNING) << kIncompleteCacheErrorMessage;
           cache_->Reset();
         }
@@ -872,16 +1004,15 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         if (*end_of_sequence) {
           if (!cache_->IsCompleted()) {
             VLOG(2) << "Finalizing the cache because EOF has been reached.";
-            cache_->Complete(std::move(temp_cache_));
+            TF_RETURN_IF_ERROR(CompleteCache());
           }
           return OkStatus();
         }
-        RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
-        if (temp_cache_.size() == dataset()->input_->Cardinality()) {
+        TF_RETURN_IF_ERROR(AddElement(ctx, *out_tensors));
+        if (NumCachedElements() == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
-          cache_->Complete(std::move(temp_cache_));
+          TF_RETURN_IF_ERROR(CompleteCache());
         }
         return OkStatus();
       }
@@ -899,6 +1030,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         if (!cache_->IsCompleted()) {
           TF_RETURN_IF_ERROR(
               WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+          if (spill_writer_) {
+            TF_RETURN_IF_ERROR(spill_writer_->Flush());
+            TF_RETURN_IF_ERROR(WriteSpillToCheckpoint(writer, prefix(),
+                                                      spill_writer_->spill()));
+          }
         }
         return SaveInput(ctx, writer, input_impl_);
       }
@@ -907,17 +1043,92 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              IteratorStateReader* reader) override {
         mutex_lock l(mu_);
         if (!reader->Contains(full_name(kCacheCompleted))) {
+          std::vector<std::vector<Tensor>> elements;
           TF_RETURN_IF_ERROR(
-              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache_));
+              ReadElementsFromCheckpoint(ctx, reader, prefix(), &elements));
+          std::unique_ptr<CacheSpillReader> spill_reader;
+          int64_t num_spilled = 0;
+          TF_RETURN_IF_ERROR(dataset()->OpenSpillFromCheckpoint(
+              reader, prefix(), &spill_reader, &num_spilled));
+          // The checkpoint may refer to the spill file of this iterator, so it
+          // is kept until its elements are added again.
+          std::unique_ptr<CacheSpillWriter> previous_spill_writer =
+              std::move(spill_writer_);
+          temp_cache_.clear();
+          memory_bytes_ = 0;
+          for (const auto& element : elements) {
+            TF_RETURN_IF_ERROR(AddElement(ctx, element));
+          }
+          // Spilled elements are streamed, so that they are not all held in
+          // memory at once.
+          for (int64_t i = 0; i < num_spilled; ++i) {
+            std::vector<Tensor> element;
+            TF_RETURN_IF_ERROR(spill_reader->Read(&element));
+            TF_RETURN_IF_ERROR(AddElement(ctx, element));
+          }
         }
         return RestoreInput(ctx, reader, input_impl_);
       }
 
      private:
+      // Adds `element` to the cache. Once the memory budget is exhausted, this
+      // and all subsequent elements are appended to the spill file, so that
+      // the cache holds the prefix of the dataset in memory.
+      Status AddElement(IteratorContext* ctx,
+                        const std::vector<Tensor>& element)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        const int64_t bytes = GetTotalBytes(element);
+        if (!spill_writer_ &&
+            dataset()->FitsInMemoryBudget(memory_bytes_, bytes)) {
+          RecordBufferEnqueue(ctx, element);
+          memory_bytes_ += bytes;
+          temp_cache_.emplace_back(element);
+          return OkStatus();
+        }
+        if (!spill_writer_) {
+          TF_RETURN_IF_ERROR(CacheSpillWriter::Create(
+              dataset()->env_, dataset()->spill_directory_,
+              dataset()->output_dtypes(), &spill_writer_));
+          VLOG(2) << "Memory budget of " << dataset()->memory_budget_bytes_
+                  << " bytes exhausted after " << temp_cache_.size()
+                  << " elements. Spilling the remaining elements to "
+                  << spill_writer_->spill().filename;
+        }
+        const uint64 start_us = EnvTime::NowMicros();
+        TF_RETURN_IF_ERROR(spill_writer_->Write(element));
+        metrics::RecordTFDataCacheSpill(kSpillWrite, bytes,
+                                        EnvTime::NowMicros() - start_us);
+        return OkStatus();
+      }
+
+      int64_t NumCachedElements() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        int64_t num_elements = temp_cache_.size();
+        if (spill_writer_) {
+          num_elements += spill_writer_->spill().num_elements;
+        }
+        return num_elements;
+      }
+
+      Status CompleteCache() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        CacheSpill spill;
+        if (spill_writer_) {
+          TF_RETURN_IF_ERROR(spill_writer_->Finish(&spill));
+          spill_writer_.reset();
+        }
+        memory_bytes_ = 0;
+        cache_->Complete(std::move(temp_cache_), std::move(spill),
+                         dataset()->env_);
+        return OkStatus();
+      }
+
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       std::vector<std::vector<Tensor>> temp_cache_ TF_GUARDED_BY(mu_);
+      // The number of bytes of the elements in `temp_cache_`.
+      int64_t memory_bytes_ TF_GUARDED_BY(mu_) = 0;
+      // Holds the elements that did not fit into the memory budget, if any.
+      std::unique_ptr<CacheSpillWriter> spill_writer_ TF_GUARDED_BY(mu_);
     };  // MemoryWriterIterator
 
     class MemoryReaderIterator : public DatasetIterator<MemoryDatasetBase> {
@@ -950,11 +1161,23 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                               cache_tensors.end());
           index_++;
           *end_of_sequence = false;
+          metrics::RecordTFDataCacheLookup(kMemoryTier);
           return OkStatus();
-        } else {
+        }
+        const CacheSpill spill = cache_->spill();
+        const int64_t spill_index = index_ - cache_->size();
+        if (spill_index >= spill.num_elements) {
           *end_of_sequence = true;
           return OkStatus();
         }
+        std::vector<Tensor> element;
+        TF_RETURN_IF_ERROR(ReadSpilledElement(spill, spill_index, &element));
+        out_tensors->insert(out_tensors->begin(), element.begin(),
+                            element.end());
+        index_++;
+        *end_of_sequence = false;
+        metrics::RecordTFDataCacheLookup(kDiskTier);
+        return OkStatus();
       }
 
      protected:
@@ -976,20 +1199,48 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         mutex_lock l(mu_);
         {
           // kIndex will not be set if we are restoring from a checkpoint
-          // written by a MemoryWriterIterator that has completed its cache.
-          int64_t temp = cache_->size();
+          // written by a MemoryWriterIterator that has completed its cache,
+          // including the elements it spilled.
+          int64_t temp = cache_->size() + cache_->spill().num_elements;
           if (reader->Contains(full_name(kIndex))) {
             TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kIndex), &temp));
           }
           index_ = static_cast<size_t>(temp);
         }
+        spill_reader_.reset();
         return OkStatus();
       }
 
      private:
+      // Reads the element at position `spill_index` of the spill file. The
+      // spill file is streamed sequentially, so reads are cheap as long as
+      // they happen in order.
+      Status ReadSpilledElement(const CacheSpill& spill, int64_t spill_index,
+                                std::vector<Tensor>* element)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (spill_reader_ && spill_reader_->position() > spill_index) {
+          spill_reader_.reset();
+        }
+        if (!spill_reader_) {
+          TF_RETURN_IF_ERROR(CacheSpillReader::Create(
+              dataset()->env_, spill, dataset()->output_dtypes(),
+              &spill_reader_));
+        }
+        if (spill_reader_->position() < spill_index) {
+          TF_RETURN_IF_ERROR(
+              spill_reader_->Skip(spill_index - spill_reader_->position()));
+        }
+        const uint64 start_us = EnvTime::NowMicros();
+        TF_RETURN_IF_ERROR(spill_reader_->Read(element));
+        metrics::RecordTFDataCacheSpill(kSpillRead, GetTotalBytes(*element),
+                                        EnvTime::NowMicros() - start_us);
+        return OkStatus();
+      }
+
       mutex mu_;
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       size_t index_ TF_GUARDED_BY(mu_);
+      std::unique_ptr<CacheSpillReader> spill_reader_ TF_GUARDED_BY(mu_);
     };  // MemoryReaderIterator
 
     Status InitializeIterator(IteratorContext* ctx)
@@ -1017,6 +1268,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
   mutable mutex mu_;
   const DatasetBase* const input_;
   const std::shared_ptr<MemoryCache> cache_;
+  // If positive, at most this many bytes of elements are kept in memory and
+  // the remaining elements are spilled to files in `spill_directory_`.
+  const int64_t memory_budget_bytes_;
+  const std::string spill_directory_;
+  Env* const env_;
   mutable std::unique_ptr<PartialCache> partial_cache_ TF_GUARDED_BY(mu_);
 };  // MemoryDatasetBase
 
@@ -1026,8 +1282,10 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 class CacheDatasetOp::MemoryDataset : public CacheDatasetOp::MemoryDatasetBase {
  public:
   MemoryDataset(OpKernelContext* ctx, const DatasetBase* input,
-                MemoryCacheManager* manager, ResourceHandle&& resource_handle)
-      : MemoryDatasetBase(ctx, input, manager->get()),
+                MemoryCacheManager* manager, ResourceHandle&& resource_handle,
+                int64_t memory_budget_bytes, std::string spill_directory)
+      : MemoryDatasetBase(ctx, input, manager->get(), memory_budget_bytes,
+                          std::move(spill_directory)),
         manager_(manager),
         resource_handle_(std::move(resource_handle)),
         resource_mgr_(ctx->resource_manager()) {}
@@ -1049,8 +1307,10 @@ class CacheDatasetOp::MemoryDataset : public CacheDatasetOp::MemoryDatasetBase {
     TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
     Node* filename_node = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
+    std::vector<std::pair<StringPiece, AttrValue>> attrs;
+    AddSpillAttrs(b, &attrs);
     TF_RETURN_IF_ERROR(
-        b->AddDataset(this, {input_node, filename_node}, output));
+        b->AddDataset(this, {input_node, filename_node}, attrs, output));
     return OkStatus();
   }
 
@@ -1068,8 +1328,10 @@ class CacheDatasetOp::MemoryDatasetV2
  public:
   MemoryDatasetV2(OpKernelContext* ctx, const DatasetBase* input,
                   MemoryCacheManager* manager, ResourceHandle&& resource_handle,
-                  bool owns_resource)
-      : MemoryDatasetBase(ctx, input, manager->get()),
+                  bool owns_resource, int64_t memory_budget_bytes,
+                  std::string spill_directory)
+      : MemoryDatasetBase(ctx, input, manager->get(), memory_budget_bytes,
+                          std::move(spill_directory)),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -1098,8 +1360,11 @@ class CacheDatasetOp::MemoryDatasetV2
     Tensor handle(DT_RESOURCE, TensorShape({}));
     handle.scalar<ResourceHandle>()() = resource_handle_;
     TF_RETURN_IF_ERROR(b->AddTensor(handle, &resource_handle_node));
+    std::vector<std::pair<StringPiece, AttrValue>> attrs;
+    AddSpillAttrs(b, &attrs);
     TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {input_node, filename_node, resource_handle_node}, output));
+        this, {input_node, filename_node, resource_handle_node}, attrs,
+        output));
     return OkStatus();
   }
 
@@ -1112,7 +1377,19 @@ class CacheDatasetOp::MemoryDatasetV2
 
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+    OP_REQUIRES(ctx, memory_budget_bytes_ >= 0,
+                errors::InvalidArgument("`", kMemoryBudgetBytes,
+                                        "` must be non-negative but is ",
+                                        memory_budget_bytes_, "."));
+  }
+  if (ctx->HasAttr(kSpillDirectory)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kSpillDirectory, &spill_directory_));
+  }
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
@@ -1145,7 +1422,8 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
       }
       // Ownership of manager is transferred onto `MemoryDatasetV2`.
       *output = new MemoryDatasetV2(ctx, input, manager, std::move(handle),
-                                    owns_resource);
+                                    owns_resource, memory_budget_bytes_,
+                                    spill_directory_);
     } else {
       MemoryCacheManager* manager;
       OP_REQUIRES_OK(
@@ -1157,7 +1435,8 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
       auto handle =
           MakeResourceHandle<MemoryCacheManager>(ctx, container, name);
       // Ownership of manager is transferred onto `MemoryDataset`.
-      *output = new MemoryDataset(ctx, input, manager, std::move(handle));
+      *output = new MemoryDataset(ctx, input, manager, std::move(handle),
+                                  memory_budget_bytes_, spill_directory_);
     }
   } else {
     if (op_version_ == 2) {
@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_DATASET_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_DATASET_OPS_H_
 
+#include <string>
+
 #include "tensorflow/core/framework/dataset.h"
 
 namespace tensorflow {
@@ -30,6 +32,9 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kFileName = "filename";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
+  static constexpr const char* const kSpillDirectory = "spill_directory";
 
   explicit CacheDatasetOp(OpKernelConstruction* ctx);
 
@@ -44,6 +49,10 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   class MemoryDatasetV2;
 
   const int op_version_;
+  // If positive, the in-memory cache keeps at most this many bytes of elements
+  // in memory and spills the remaining elements to `spill_directory_`.
+  int64_t memory_budget_bytes_ = 0;
+  std::string spill_directory_;
 };
 
 }  // namespace data
@@ -14,30 +14,169 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/snapshot_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kSpillFilePrefix[] = "tf_data_cache_spill_";
+constexpr char kSpillFileSuffix[] = ".spill";
+// Spill files are only ever read back by the process that wrote them, so the
+// snapshot format version only needs to be consistent within this file.
+constexpr int kSpillFileVersion = 1;
+
+void DeleteSpillFile(Env* env, const CacheSpill& spill) {
+  if (spill.filename.empty()) {
+    return;
+  }
+  Status s = env->DeleteFile(spill.filename);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to delete cache spill file " << spill.filename
+                 << ": " << s;
+  }
+}
 
 }  // namespace
 
 string MemoryCacheManager::DebugString() const { return kMemoryCache; }
 
+Status CacheSpillWriter::Create(Env* env, const std::string& directory,
+                                const DataTypeVector& dtypes,
+                                std::unique_ptr<CacheSpillWriter>* out_writer) {
+  std::vector<string> directories;
+  if (directory.empty()) {
+    env->GetLocalTempDirectories(&directories);
+  } else {
+    TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(directory));
+    directories.push_back(directory);
+  }
+  for (const string& dir : directories) {
+    std::string filename = io::JoinPath(dir, kSpillFilePrefix);
+    if (!env->CreateUniqueFileName(&filename, kSpillFileSuffix)) {
+      continue;
+    }
+    std::unique_ptr<snapshot_util::Writer> writer;
+    TF_RETURN_IF_ERROR(snapshot_util::Writer::Create(
+        env, filename, io::compression::kNone, kSpillFileVersion, dtypes,
+        &writer));
+    out_writer->reset(
+        new CacheSpillWriter(env, std::move(filename), std::move(writer)));
+    return OkStatus();
+  }
+  return errors::Unavailable("Failed to create a cache spill file in ",
+                             directory.empty() ? "any local temporary directory"
+                                               : directory);
+}
+
+CacheSpillWriter::CacheSpillWriter(
+    Env* env, std::string filename,
+    std::unique_ptr<snapshot_util::Writer> writer)
+    : env_(env), writer_(std::move(writer)) {
+  spill_.filename = std::move(filename);
+}
+
+CacheSpillWriter::~CacheSpillWriter() {
+  if (writer_) {
+    writer_->Close().IgnoreError();
+    Status s = env_->DeleteFile(spill_.filename);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete cache spill file " << spill_.filename
+                   << ": " << s;
+    }
+  }
+}
+
+Status CacheSpillWriter::Write(const std::vector<Tensor>& element) {
+  if (!writer_) {
+    return errors::FailedPrecondition("Cache spill file ", spill_.filename,
+                                      " has already been finished.");
+  }
+  TF_RETURN_IF_ERROR(writer_->WriteTensors(element));
+  spill_.num_elements++;
+  spill_.num_bytes += GetTotalBytes(element);
+  return OkStatus();
+}
+
+Status CacheSpillWriter::Flush() {
+  if (!writer_) {
+    return OkStatus();
+  }
+  return writer_->Sync();
+}
+
+Status CacheSpillWriter::Finish(CacheSpill* spill) {
+  if (!writer_) {
+    return errors::FailedPrecondition("Cache spill file ", spill_.filename,
+                                      " has already been finished.");
+  }
+  TF_RETURN_IF_ERROR(writer_->Close());
+  writer_.reset();
+  *spill = spill_;
+  return OkStatus();
+}
+
+Status CacheSpillReader::Create(Env* env, const CacheSpill& spill,
+                                const DataTypeVector& dtypes,
+                                std::unique_ptr<CacheSpillReader>* out_reader) {
+  std::unique_ptr<snapshot_util::Reader> reader;
+  TF_RETURN_IF_ERROR(snapshot_util::Reader::Create(
+      env, spill.filename, io::compression::kNone, kSpillFileVersion, dtypes,
+      &reader));
+  out_reader->reset(new CacheSpillReader(std::move(reader)));
+  return OkStatus();
+}
+
+CacheSpillReader::CacheSpillReader(
+    std::unique_ptr<snapshot_util::Reader> reader)
+    : reader_(std::move(reader)) {}
+
+Status CacheSpillReader::Read(std::vector<Tensor>* element) {
+  TF_RETURN_IF_ERROR(reader_->ReadTensors(element));
+  position_++;
+  return OkStatus();
+}
+
+Status CacheSpillReader::Skip(int64_t num_elements) {
+  TF_RETURN_IF_ERROR(reader_->SkipRecords(num_elements));
+  position_ += num_elements;
+  return OkStatus();
+}
+
+MemoryCache::~MemoryCache() { DeleteSpillFile(spill_env_, spill_); }
+
 void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
+  Complete(std::move(cache), CacheSpill(), /*spill_env=*/nullptr);
+}
+
+void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache,
+                           CacheSpill spill, Env* spill_env) {
   mutex_lock l(mu_);
   if (!completed_) {
     cache_ = std::move(cache);
+    spill_ = std::move(spill);
+    spill_env_ = spill_env;
     completed_ = true;
+  } else {
+    DeleteSpillFile(spill_env, spill);
   }
 }
 
@@ -50,6 +189,9 @@ void MemoryCache::Reset() {
   mutex_lock l(mu_);
   completed_ = false;
   cache_.clear();
+  DeleteSpillFile(spill_env_, spill_);
+  spill_ = CacheSpill();
+  spill_env_ = nullptr;
 }
 
 const std::vector<Tensor>& MemoryCache::at(int64_t index) {
@@ -63,6 +205,11 @@ size_t MemoryCache::size() {
   return cache_.size();
 }
 
+CacheSpill MemoryCache::spill() {
+  tf_shared_lock l(mu_);
+  return spill_;
+}
+
 const std::vector<std::vector<Tensor>>& MemoryCache::data() {
   tf_shared_lock l(mu_);
   return cache_;
@@ -16,24 +16,112 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/snapshot_utils.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 
 namespace tensorflow {
 namespace data {
 
+// Describes the elements of a `MemoryCache` which did not fit into the memory
+// budget of the cache and were spilled, in order, to a file on local disk.
+struct CacheSpill {
+  std::string filename;
+  int64_t num_elements = 0;
+  int64_t num_bytes = 0;
+};
+
+// Appends dataset elements to a spill file. The file is written strictly
+// sequentially using the uncompressed snapshot format, so that the spilled
+// elements can be streamed back with large sequential reads.
+//
+// If the writer is destroyed before `Finish()` is called, the spill file is
+// deleted.
+class CacheSpillWriter {
+ public:
+  // Creates a new spill file in `directory`. If `directory` is empty, the file
+  // is created in one of the local temporary directories of `env`.
+  static Status Create(Env* env, const std::string& directory,
+                       const DataTypeVector& dtypes,
+                       std::unique_ptr<CacheSpillWriter>* out_writer);
+
+  ~CacheSpillWriter();
+
+  // Appends `element` to the spill file.
+  Status Write(const std::vector<Tensor>& element);
+
+  // Flushes the elements written so far so that they can be read back by a
+  // `CacheSpillReader`.
+  Status Flush();
+
+  // Closes the spill file and transfers its ownership to the caller.
+  Status Finish(CacheSpill* spill);
+
+  // Returns a description of the elements written so far.
+  const CacheSpill& spill() const { return spill_; }
+
+ private:
+  CacheSpillWriter(Env* env, std::string filename,
+                   std::unique_ptr<snapshot_util::Writer> writer);
+
+  Env* const env_;
+  std::unique_ptr<snapshot_util::Writer> writer_;
+  CacheSpill spill_;
+};
+
+// Reads elements back from a spill file in the order they were written.
+class CacheSpillReader {
+ public:
+  static Status Create(Env* env, const CacheSpill& spill,
+                       const DataTypeVector& dtypes,
+                       std::unique_ptr<CacheSpillReader>* out_reader);
+
+  // Reads the next element of the spill file into `element`.
+  Status Read(std::vector<Tensor>* element);
+
+  // Skips the next `num_elements` elements of the spill file.
+  Status Skip(int64_t num_elements);
+
+  // Returns the index of the next element to be read.
+  int64_t position() const { return position_; }
+
+ private:
+  explicit CacheSpillReader(std::unique_ptr<snapshot_util::Reader> reader);
+
+  std::unique_ptr<snapshot_util::Reader> reader_;
+  int64_t position_ = 0;
+};
+
 // A thread-safe data structure for caching dataset elements.
 //
 // The expected use is that a single `MemoryWriterIterator` populates the
 // cache with dataset elements. Once all elements are cached, the cache can
 // be used by one or more `MemoryReaderIterator`s.
+//
+// If the writer iterator runs out of memory budget, the elements which do not
+// fit are spilled to a file on local disk and the cache only holds the
+// in-memory prefix of the dataset, followed by the spilled elements.
+// Checkpoints refer to the spill file rather than store the spilled elements,
+// so they can only be restored while the spill file exists.
 class MemoryCache {
  public:
   MemoryCache() = default;
 
+  ~MemoryCache();
+
   // Marks the cache as completed.
   void Complete(std::vector<std::vector<Tensor>>&& cache);
 
+  // Marks the cache as completed. The elements described by `spill` follow the
+  // in-memory elements of `cache`, and the cache takes ownership of the spill
+  // file, which it deletes through `spill_env` once it no longer needs it.
+  void Complete(std::vector<std::vector<Tensor>>&& cache, CacheSpill spill,
+                Env* spill_env);
+
   // Returns whether the cache is completed.
   bool IsCompleted();
 
@@ -43,9 +131,12 @@ class MemoryCache {
   // Returns the element at the given index.
   const std::vector<Tensor>& at(int64_t index);
 
-  // Returns the size of the cache.
+  // Returns the number of elements held in memory by the cache.
   size_t size();
 
+  // Returns a description of the elements spilled to disk.
+  CacheSpill spill();
+
   // Returns a reference to the cache's data. The returned reference will be
   // invalidated by any call to Reset().
   const std::vector<std::vector<Tensor>>& data();
@@ -55,6 +146,8 @@ class MemoryCache {
   // Determines whether all elements of the dataset have been cached.
   bool completed_ TF_GUARDED_BY(mu_) = false;
   std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
+  CacheSpill spill_ TF_GUARDED_BY(mu_);
+  Env* spill_env_ TF_GUARDED_BY(mu_) = nullptr;
 };
 
 // A resource wrapping a shared instance of a memory cache.
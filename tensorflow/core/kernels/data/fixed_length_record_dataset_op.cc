@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/fixed_length_record_dataset_op.h"
 
+#include <algorithm>
+#include <memory>
+
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -21,9 +24,12 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
+#include "tensorflow/core/lib/io/prefetching_random_access_file.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -48,6 +54,81 @@ constexpr char kCurrentPos[] = "current_pos";
 constexpr char kZLIB[] = "ZLIB";
 constexpr char kGZIP[] = "GZIP";
 
+namespace {
+
+// Returns the number of windows of `buffer_size` bytes that are read ahead of
+// the iterators, as set by TF_DATA_FIXED_LENGTH_RECORD_READ_AHEAD_WINDOWS.
+// Read-ahead is disabled by default.
+int64_t ReadAheadWindows() {
+  static const int64_t num_windows = []() {
+    int64_t value = 0;
+    Status s = ReadInt64FromEnvVar(
+        "TF_DATA_FIXED_LENGTH_RECORD_READ_AHEAD_WINDOWS", 0, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to read "
+                    "TF_DATA_FIXED_LENGTH_RECORD_READ_AHEAD_WINDOWS: "
+                 << s;
+      return int64_t{0};
+    }
+    return std::max<int64_t>(value, 0);
+  }();
+  return num_windows;
+}
+
+// The file an iterator reads from. If read-ahead is enabled, reads are served
+// from windows that are read ahead of the iterator in the background through
+// `RandomAccessFile::ReadAsync()`, so file systems with asynchronous reads
+// (e.g. io_uring) keep reads in flight while records are produced.
+class InputFile {
+ public:
+  // Opens `filename`, closing the file that is currently open, if any. Reads
+  // ahead in windows of `window_size` bytes if read-ahead is enabled.
+  Status Open(Env* env, const string& filename, int64_t window_size) {
+    Close();
+    TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file_));
+    const int64_t num_windows = ReadAheadWindows();
+    if (num_windows > 0) {
+      if (!read_ahead_thread_pool_) {
+        read_ahead_thread_pool_ = std::make_unique<thread::ThreadPool>(
+            env, ThreadOptions(), "fixed_length_record_read_ahead",
+            num_windows, /*low_latency_hint=*/false);
+      }
+      io::PrefetchingRandomAccessFile::Options options;
+      options.window_size = window_size;
+      options.num_windows = num_windows;
+      read_ahead_file_ = std::make_unique<io::PrefetchingRandomAccessFile>(
+          file_.get(), read_ahead_thread_pool_.get(), options);
+    }
+    return OkStatus();
+  }
+
+  void Close() {
+    if (read_ahead_file_) {
+      static monitoring::CounterCell* stall_counter =
+          metrics::GetTFDataReadAheadStallCounter(
+              FixedLengthRecordDatasetOp::kDatasetType);
+      stall_counter->IncrementBy(read_ahead_file_->stats().stall_time_us);
+      read_ahead_file_.reset();
+    }
+    file_.reset();
+  }
+
+  // Returns the file to read from, or nullptr if no file is open.
+  RandomAccessFile* get() const {
+    if (read_ahead_file_) return read_ahead_file_.get();
+    return file_.get();
+  }
+
+ private:
+  // `read_ahead_file_` borrows `file_` and runs its reads on
+  // `read_ahead_thread_pool_`, so it must be destroyed first.
+  std::unique_ptr<thread::ThreadPool> read_ahead_thread_pool_;
+  std::unique_ptr<RandomAccessFile> file_;
+  std::unique_ptr<io::PrefetchingRandomAccessFile> read_ahead_file_;
+};
+
+}  // namespace
+
 class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
@@ -158,7 +239,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
           // We have reached the end of the current file, so maybe move on to
           // next file.
           input_buffer_.reset();
-          file_.reset();
+          file_.Close();
           ++current_file_index_;
         }
 
@@ -187,8 +268,9 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
               " bytes, which is not an exact multiple of the record length (",
               dataset()->record_bytes_, " bytes).");
         }
-        TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
-            TranslateFileName(next_filename), &file_));
+        TF_RETURN_IF_ERROR(file_.Open(ctx->env(),
+                                      TranslateFileName(next_filename),
+                                      dataset()->buffer_size_));
         input_buffer_ = std::make_unique<io::InputBuffer>(
             file_.get(), dataset()->buffer_size_);
         TF_RETURN_IF_ERROR(input_buffer_->SkipNBytes(dataset()->header_bytes_));
@@ -224,7 +306,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
 
       // Seek to current_pos.
       input_buffer_.reset();
-      file_.reset();
+      file_.Close();
       if (current_pos >= 0) {  // There was an active input_buffer_.
         uint64 file_size;
         const std::string& current_filename =
@@ -232,8 +314,9 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(
             ctx->env()->GetFileSize(current_filename, &file_size));
         file_pos_limit_ = file_size - dataset()->footer_bytes_;
-        TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
-            TranslateFileName(current_filename), &file_));
+        TF_RETURN_IF_ERROR(file_.Open(ctx->env(),
+                                      TranslateFileName(current_filename),
+                                      dataset()->buffer_size_));
         input_buffer_ = std::make_unique<io::InputBuffer>(
             file_.get(), dataset()->buffer_size_);
         TF_RETURN_IF_ERROR(input_buffer_->Seek(current_pos));
@@ -245,8 +328,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
    private:
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
-    std::unique_ptr<RandomAccessFile> file_
-        TF_GUARDED_BY(mu_);  // must outlive input_buffer_
+    InputFile file_ TF_GUARDED_BY(mu_);  // must outlive input_buffer_
     std::unique_ptr<io::InputBuffer> input_buffer_ TF_GUARDED_BY(mu_);
     int64_t file_pos_limit_ TF_GUARDED_BY(mu_) = -1;
   };
@@ -319,7 +401,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
           // We have reached the end of the current file, so maybe move on to
           // next file.
           buffered_input_stream_.reset();
-          file_.reset();
+          file_.Close();
           ++current_file_index_;
         }
 
@@ -351,9 +433,10 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
                 dataset()->record_bytes_, " bytes).");
           }
         }
-        TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
+        TF_RETURN_IF_ERROR(file_.Open(
+            ctx->env(),
             TranslateFileName(dataset()->filenames_[current_file_index_]),
-            &file_));
+            dataset()->buffer_size_));
         if (!dataset()->compression_type_.empty()) {
           const io::ZlibCompressionOptions zlib_options =
               dataset()->compression_type_ == kZLIB
@@ -413,11 +496,12 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
 
       // Seek to current_pos.
       buffered_input_stream_.reset();
-      file_.reset();
+      file_.Close();
       if (current_pos >= 0) {  // There was an active buffered_input_stream_.
-        TF_RETURN_IF_ERROR(ctx->env()->NewRandomAccessFile(
+        TF_RETURN_IF_ERROR(file_.Open(
+            ctx->env(),
             TranslateFileName(dataset()->filenames_[current_file_index_]),
-            &file_));
+            dataset()->buffer_size_));
         const io::ZlibCompressionOptions zlib_options =
             dataset()->compression_type_ == kZLIB
                 ? io::ZlibCompressionOptions::DEFAULT()
@@ -440,8 +524,7 @@ class FixedLengthRecordDatasetOp::Dataset : public DatasetBase {
    private:
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
-    std::unique_ptr<RandomAccessFile> file_
-        TF_GUARDED_BY(mu_);  // must outlive buffered_input_stream_
+    InputFile file_ TF_GUARDED_BY(mu_);  // must outlive buffered_input_stream_
     std::unique_ptr<io::RandomAccessInputStream>
         file_stream_;  // must outlive buffered_input_stream_
     std::unique_ptr<io::InputStreamInterface> buffered_input_stream_
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/iterator_ops.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -50,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/platform/resource.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -71,6 +73,23 @@ bool SymbolicCheckpointEnabled(const Options& options) {
          options.symbolic_checkpoint();
 }
 
+// Returns the maximum number of bytes that the element arena of an iterator
+// may keep cached for reuse, as set by TF_DATA_ELEMENT_ARENA_MAX_BYTES. Zero
+// (the default) disables element arenas.
+int64_t ElementArenaMaxCachedBytes() {
+  static const int64_t max_cached_bytes = []() {
+    int64_t value = 0;
+    Status s =
+        ReadInt64FromEnvVar("TF_DATA_ELEMENT_ARENA_MAX_BYTES", 0, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to read TF_DATA_ELEMENT_ARENA_MAX_BYTES: " << s;
+      return int64_t{0};
+    }
+    return std::max<int64_t>(value, 0);
+  }();
+  return max_cached_bytes;
+}
+
 }  // namespace
 
 /* static */ constexpr const char* const
@@ -92,6 +111,13 @@ IteratorResource::IteratorResource(
       output_dtypes_(output_dtypes),
       output_shapes_(output_shapes) {
   VLOG(2) << "creating iterator resource";
+  // Element arenas are only used for host-side iterators; device-side
+  // iterators created by the multi-device iterator allocate device memory.
+  const int64_t max_cached_bytes = ElementArenaMaxCachedBytes();
+  if (max_cached_bytes > 0 && flr->device()->device_type() == DEVICE_CPU) {
+    element_arena_.reset(new ElementArena(
+        flr->device()->GetAllocator(AllocatorAttributes()), max_cached_bytes));
+  }
 }
 
 IteratorResource::~IteratorResource() {
@@ -122,6 +148,7 @@ Status IteratorResource::GetNext(OpKernelContext* ctx,
   params.symbolic_checkpoint = SymbolicCheckpointEnabled(dataset->options());
   params.thread_factory = unbounded_thread_pool_.get_thread_factory();
   params.thread_pool = &unbounded_thread_pool_;
+  MaybeUseElementArena(&params);
   std::function<void()> deregister_fn;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
       ctx->cancellation_manager(),
@@ -132,6 +159,11 @@ Status IteratorResource::GetNext(OpKernelContext* ctx,
   const absl::Time start_time = metrics_collector_.RecordStart();
   auto status = iterator->GetNext(&iter_ctx, out_tensors, end_of_sequence);
   metrics_collector_.RecordStop(start_time, *out_tensors);
+  if (element_arena_) {
+    metrics_collector_.RecordElementArenaStats(
+        element_arena_->bytes_recycled(),
+        element_arena_->allocations_avoided());
+  }
   captured_state->MergeCheckpoint(iter_ctx.checkpoint());
   return status;
 }
@@ -201,6 +233,7 @@ Status IteratorResource::Restore(OpKernelContext* ctx,
       SymbolicCheckpointEnabled(input_dataset->options());
   params.thread_factory = unbounded_thread_pool_.get_thread_factory();
   params.thread_pool = &unbounded_thread_pool_;
+  MaybeUseElementArena(&params);
   std::function<void()> deregister_fn;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
       ctx->cancellation_manager(),
@@ -239,6 +272,7 @@ Status IteratorResource::SetIteratorFromDataset(OpKernelContext* ctx,
   params.symbolic_checkpoint = SymbolicCheckpointEnabled(dataset->options());
   params.thread_factory = unbounded_thread_pool_.get_thread_factory();
   params.thread_pool = &unbounded_thread_pool_;
+  MaybeUseElementArena(&params);
   std::function<void()> deregister_fn;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
       ctx->cancellation_manager(),
@@ -269,6 +303,23 @@ Status IteratorResource::SetIteratorFromDataset(OpKernelContext* ctx,
   return OkStatus();
 }
 
+void IteratorResource::MaybeUseElementArena(IteratorContext::Params* params) {
+  if (!element_arena_) {
+    return;
+  }
+  // Allocations with non-default attributes (e.g. GPU-compatible host memory)
+  // keep going through the device allocator.
+  params->allocator_getter =
+      [arena = element_arena_.get(),
+       allocator_getter = std::move(params->allocator_getter)](
+          AllocatorAttributes attrs) -> Allocator* {
+    if (attrs.value == 0) {
+      return arena;
+    }
+    return allocator_getter(attrs);
+  };
+}
+
 void IteratorResource::State::DowncastAndSetIteratorAndDataset(
     std::unique_ptr<IteratorBase> it, const DatasetBase* dataset) {
   iterator_.reset(static_cast<DatasetBaseIterator*>(it.release()));
@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/element_arena.h"
 #include "tensorflow/core/data/metric_utils.h"
 #include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -134,7 +135,15 @@ class IteratorResource : public ResourceBase {
     MemoryCheckpoint checkpoint_;
   };
 
+  // Routes default allocations of the iterator through `element_arena_`, if
+  // element arenas are enabled.
+  void MaybeUseElementArena(IteratorContext::Params* params);
+
   IteratorMetricsCollector metrics_collector_;
+  // Recycles the buffers of elements produced by the iterator across steps.
+  // Declared before `iterator_state_` so that it outlives the iterator and its
+  // background threads. Null if element arenas are disabled.
+  core::RefCountPtr<ElementArena> element_arena_;
   UnboundedThreadPool unbounded_thread_pool_;
 
   mutex mu_;
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <cstdint>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/random/philox_random.h"
@@ -52,6 +54,9 @@ namespace data {
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kOutputShapes;
 /* static */ constexpr const char* const
     ShuffleDatasetOpBase::kReshuffleEachIteration;
+/* static */ constexpr const char* const
+    ShuffleDatasetOpBase::kMemoryBudgetBytes;
+/* static */ constexpr const char* const ShuffleDatasetOpBase::kSpillDirectory;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
 
@@ -61,6 +66,8 @@ namespace data {
 
 const int64_t kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64_t kMaxEpochsInBuffer = 3;
+// Number of buckets each pass of the external shuffle scatters elements into.
+const int64_t kExternalShuffleFanOut = 64;
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kDataProduced[] = "data_produced";
@@ -72,6 +79,9 @@ constexpr char kSlicesStart[] = "slices_start";
 constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kSeedGenerator[] = "SeedGenerator";
 constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+constexpr char kEpochInProgress[] = "epoch_in_progress";
+constexpr char kEpochNumElements[] = "epoch_num_elements";
+constexpr char kNumProduced[] = "num_produced";
 constexpr char kShuffleDatasetV1[] = "ShuffleDataset";
 constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
@@ -87,12 +97,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
                      int64_t buffer_size,
                      std::shared_ptr<SeedGenerator> seed_generator,
-                     int64_t count)
+                     int64_t count, int64_t memory_budget_bytes = 0,
+                     std::string spill_directory = "")
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        memory_budget_bytes_(memory_budget_bytes),
+        spill_directory_(std::move(spill_directory)),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -167,6 +180,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
       const string& prefix) const override {
+    if (memory_budget_bytes_ > 0) {
+      return std::make_unique<ExternalIterator>(
+          ExternalIterator::Params{
+              this, name_utils::IteratorPrefix(op_type(), prefix)},
+          seed_generator_.get());
+    }
     return std::make_unique<Iterator>(
         Iterator::Params{this, name_utils::IteratorPrefix(op_type(), prefix)},
         seed_generator_.get());
@@ -502,6 +521,358 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
   };
 
+  // Shuffles each epoch of the input with a two-pass external shuffle, which
+  // buffers at most `memory_budget_bytes_` of elements in memory, instead of
+  // sampling from a window of `buffer_size_` elements.
+  //
+  // The first pass scatters the elements of the epoch into up to
+  // `kExternalShuffleFanOut` spill files ("buckets") in `spill_directory_`,
+  // picking the bucket of each element uniformly at random. The second pass
+  // visits the buckets in random order. A bucket that fits into the memory
+  // budget is read into memory, shuffled, and produced; a larger bucket is
+  // scattered again into smaller buckets.
+  //
+  // Checkpoints store the number of elements produced in the current epoch
+  // instead of the buckets. Restoring replays the epoch from its seeds, which
+  // requires the input to produce the same elements in the same order.
+  class ExternalIterator : public DatasetIterator<ShuffleDatasetBase> {
+   public:
+    explicit ExternalIterator(const Params& params,
+                              SeedGenerator* seed_generator)
+        : DatasetIterator<ShuffleDatasetBase>(params),
+          seed_generator_(seed_generator),
+          parent_generator_(seed_generator->seed(), seed_generator->seed2()),
+          generator_(&parent_generator_) {}
+
+    ~ExternalIterator() override {
+      mutex_lock l(mu_);
+      DeleteBuckets();
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      if (!ctx->split_providers().empty()) {
+        return errors::Unimplemented(
+            "Shuffling with a memory budget does not support splitting the "
+            "input dataset.");
+      }
+      mutex_lock l(mu_);
+      env_ = ctx->env();
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      ResetRngs();
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      while (true) {
+        if (!buffer_.empty()) {
+          *out_tensors = std::move(buffer_.back());
+          buffer_.pop_back();
+          RecordBufferDequeue(ctx, *out_tensors);
+          num_produced_++;
+          *end_of_sequence = false;
+          return OkStatus();
+        }
+        if (!pending_.empty()) {
+          TF_RETURN_IF_ERROR(ProcessNextBucket(ctx));
+          continue;
+        }
+        if (epoch_in_progress_) {
+          FinishEpoch();
+          if (epoch_num_elements_ == 0 && dataset()->count_ == -1) {
+            // The input is empty; repeating it would loop forever.
+            *end_of_sequence = true;
+            return OkStatus();
+          }
+        }
+        if (dataset()->count_ != -1 && epoch_ >= dataset()->count_) {
+          *end_of_sequence = true;
+          return OkStatus();
+        }
+        TF_RETURN_IF_ERROR(StartEpoch(ctx));
+      }
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kEpochNumRandomSamples),
+                              seed_generator_->num_random_samples()));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed), seed_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed2), seed2_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kEpoch), epoch_));
+      if (epoch_in_progress_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kEpochInProgress), ""));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kEpochNumElements),
+                                               epoch_num_elements_));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kNumProduced), num_produced_));
+      }
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      int64_t num_random_samples;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumRandomSamples),
+                                            &num_random_samples));
+      seed_generator_->set_num_random_samples(num_random_samples);
+      seed_generator_->Reset();
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed), &seed_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed2), &seed2_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpoch), &epoch_));
+      DeleteBuckets();
+      buffer_.clear();
+      num_random_samples_ = 0;
+      ResetRngs();
+      epoch_in_progress_ = false;
+      epoch_num_elements_ = 0;
+      num_produced_ = 0;
+      if (!reader->Contains(full_name(kEpochInProgress))) {
+        return OkStatus();
+      }
+
+      // Replay the current epoch up to the element that is produced next.
+      int64_t epoch_num_elements;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumElements),
+                                            &epoch_num_elements));
+      int64_t num_produced;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kNumProduced), &num_produced));
+      epoch_--;
+      TF_RETURN_IF_ERROR(StartEpoch(ctx));
+      if (epoch_num_elements_ != epoch_num_elements) {
+        return errors::FailedPrecondition(
+            "Failed to restore the external shuffle of epoch ", epoch_,
+            ": the input produced ", epoch_num_elements_,
+            " elements, but the checkpoint was taken after ",
+            epoch_num_elements,
+            " elements. Restoring requires the input to be deterministic.");
+      }
+      return SkipProduced(ctx, num_produced);
+    }
+
+    TraceMeMetadata GetTraceMeMetadata() const override {
+      return dataset()->traceme_metadata_;
+    }
+
+   private:
+    random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      num_random_samples_++;
+      return generator_();
+    }
+
+    void ResetRngs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      parent_generator_ = random::PhiloxRandom(seed_, seed2_);
+      generator_ =
+          random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator_);
+      generator_.Skip(num_random_samples_);
+    }
+
+    // Runs the first pass of the shuffle over a new epoch of the input.
+    Status StartEpoch(IteratorContext* ctx) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      std::unique_ptr<IteratorBase> input_impl;
+      TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+          ctx, this, prefix(), &input_impl));
+      epoch_++;
+      epoch_in_progress_ = true;
+      epoch_num_elements_ = 0;
+      num_produced_ = 0;
+      const int64_t start_micros = EnvTime::NowMicros();
+      int64_t num_log_entries = 0;
+      TF_RETURN_IF_ERROR(Scatter(
+          [&](std::vector<Tensor>* element, bool* end_of_sequence) {
+            if (EnvTime::NowMicros() >
+                ((num_log_entries + 1) * kLogIntervalMicros) + start_micros) {
+              num_log_entries++;
+              LOG(INFO) << "Scattering shuffle input to disk (this may take a "
+                           "while): "
+                        << epoch_num_elements_ << " elements";
+            }
+            TF_RETURN_IF_ERROR(
+                input_impl->GetNext(ctx, element, end_of_sequence));
+            if (!*end_of_sequence) epoch_num_elements_++;
+            return OkStatus();
+          }));
+      VLOG(1) << "Scattered " << epoch_num_elements_
+              << " elements of epoch " << epoch_ << " into " << pending_.size()
+              << " buckets.";
+      return OkStatus();
+    }
+
+    void FinishEpoch() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      epoch_in_progress_ = false;
+      // Reinitialize the RNG state for the next epoch.
+      num_random_samples_ = 0;
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      ResetRngs();
+    }
+
+    // Writes the elements returned by `next` into new buckets, picking the
+    // bucket of each element uniformly at random, and pushes the non-empty
+    // buckets onto `pending_` in random order.
+    Status Scatter(
+        const std::function<Status(std::vector<Tensor>*, bool*)>& next)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      std::vector<std::unique_ptr<CacheSpillWriter>> writers(
+          kExternalShuffleFanOut);
+      while (true) {
+        std::vector<Tensor> element;
+        bool end_of_sequence = false;
+        TF_RETURN_IF_ERROR(next(&element, &end_of_sequence));
+        if (end_of_sequence) break;
+        std::unique_ptr<CacheSpillWriter>& writer =
+            writers[Random() % kExternalShuffleFanOut];
+        if (!writer) {
+          TF_RETURN_IF_ERROR(CacheSpillWriter::Create(
+              env_, dataset()->spill_directory_, dataset()->output_dtypes(),
+              &writer));
+        }
+        TF_RETURN_IF_ERROR(writer->Write(element));
+      }
+      const int64_t first = pending_.size();
+      for (auto& writer : writers) {
+        if (!writer) continue;
+        CacheSpill bucket;
+        TF_RETURN_IF_ERROR(writer->Finish(&bucket));
+        pending_.push_back(std::move(bucket));
+      }
+      for (int64_t i = static_cast<int64_t>(pending_.size()) - 1; i > first;
+           --i) {
+        std::swap(pending_[i], pending_[first + Random() % (i - first + 1)]);
+      }
+      return OkStatus();
+    }
+
+    // Returns true if the bucket is read into memory instead of being
+    // scattered again.
+    bool FitsInMemory(const CacheSpill& bucket) const {
+      return bucket.num_bytes <= dataset()->memory_budget_bytes_ ||
+             bucket.num_elements <= 1;
+    }
+
+    // Runs the second pass of the shuffle over the next pending bucket.
+    Status ProcessNextBucket(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      CacheSpill bucket = std::move(pending_.back());
+      pending_.pop_back();
+      std::unique_ptr<CacheSpillReader> reader;
+      Status s = CacheSpillReader::Create(env_, bucket,
+                                          dataset()->output_dtypes(), &reader);
+      if (s.ok()) {
+        auto read = [&](std::vector<Tensor>* element, bool* end_of_sequence) {
+          *end_of_sequence = reader->position() == bucket.num_elements;
+          return *end_of_sequence ? OkStatus() : reader->Read(element);
+        };
+        if (FitsInMemory(bucket)) {
+          buffer_.reserve(bucket.num_elements);
+          bool end_of_sequence = false;
+          while (s.ok()) {
+            std::vector<Tensor> element;
+            s = read(&element, &end_of_sequence);
+            if (!s.ok() || end_of_sequence) break;
+            RecordBufferEnqueue(ctx, element);
+            buffer_.push_back(std::move(element));
+          }
+          // Elements are produced from the back of `buffer_`.
+          for (int64_t i = static_cast<int64_t>(buffer_.size()) - 1; i > 0;
+               --i) {
+            std::swap(buffer_[i], buffer_[Random() % (i + 1)]);
+          }
+        } else {
+          s = Scatter(read);
+        }
+      }
+      DeleteBucket(bucket);
+      return s;
+    }
+
+    // Skips the first `num_elements` elements of the current epoch without
+    // reading the buckets that contain them.
+    Status SkipProduced(IteratorContext* ctx, int64_t num_elements)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (num_produced_ < num_elements) {
+        if (!buffer_.empty()) {
+          buffer_.pop_back();
+          num_produced_++;
+          continue;
+        }
+        if (pending_.empty()) {
+          return errors::FailedPrecondition(
+              "Failed to restore the external shuffle of epoch ", epoch_,
+              ": the checkpoint was taken after ", num_elements,
+              " elements were produced, but the epoch has only ",
+              num_produced_, " elements.");
+        }
+        const CacheSpill& bucket = pending_.back();
+        if (FitsInMemory(bucket) &&
+            num_produced_ + bucket.num_elements <= num_elements) {
+          // Advance the generator past the shuffle of the bucket.
+          const int64_t num_samples = std::max<int64_t>(
+              bucket.num_elements - 1, 0);
+          generator_.Skip(num_samples);
+          num_random_samples_ += num_samples;
+          num_produced_ += bucket.num_elements;
+          DeleteBucket(bucket);
+          pending_.pop_back();
+          continue;
+        }
+        TF_RETURN_IF_ERROR(ProcessNextBucket(ctx));
+      }
+      return OkStatus();
+    }
+
+    void DeleteBucket(const CacheSpill& bucket)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      Status s = env_->DeleteFile(bucket.filename);
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to delete shuffle bucket " << bucket.filename
+                     << ": " << s;
+      }
+    }
+
+    void DeleteBuckets() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      for (const CacheSpill& bucket : pending_) {
+        DeleteBucket(bucket);
+      }
+      pending_.clear();
+    }
+
+    mutex mu_;
+    SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
+    Env* env_ TF_GUARDED_BY(mu_) = nullptr;
+    int64_t epoch_ TF_GUARDED_BY(mu_) = 0;
+    bool epoch_in_progress_ TF_GUARDED_BY(mu_) = false;
+    // The number of elements in the current epoch.
+    int64_t epoch_num_elements_ TF_GUARDED_BY(mu_) = 0;
+    // The number of elements produced in the current epoch.
+    int64_t num_produced_ TF_GUARDED_BY(mu_) = 0;
+    // Buckets of the current epoch that have not been visited yet. The next
+    // bucket to visit is at the back.
+    std::vector<CacheSpill> pending_ TF_GUARDED_BY(mu_);
+    // Shuffled elements of the bucket being produced.
+    std::vector<std::vector<Tensor>> buffer_ TF_GUARDED_BY(mu_);
+    int64_t seed_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
+    random::PhiloxRandom parent_generator_ TF_GUARDED_BY(mu_);
+    random::SingleSampleAdapter<random::PhiloxRandom> generator_
+        TF_GUARDED_BY(mu_);
+    int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
+  };
+
   const DatasetBase* const input_;
   const int64_t buffer_size_;
   const std::shared_ptr<SeedGenerator> seed_generator_;
@@ -509,6 +880,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // If positive, the shuffle is an external shuffle which buffers at most this
+  // many bytes of elements in memory and spills the rest to disk.
+  const int64_t memory_budget_bytes_;
+  // The directory of the spill files of the external shuffle. If empty, the
+  // local temporary directories are used.
+  const std::string spill_directory_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -634,8 +1011,10 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
  public:
   DatasetV3(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
             int64_t count, RandomSeeds&& seeds, SeedGeneratorManager* manager,
-            ResourceHandle&& resource_handle, bool owns_resource)
-      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count),
+            ResourceHandle&& resource_handle, bool owns_resource,
+            int64_t memory_budget_bytes, std::string spill_directory)
+      : ShuffleDatasetBase(ctx, input, buffer_size, manager->get(), count,
+                           memory_budget_bytes, std::move(spill_directory)),
         manager_(manager),
         owns_resource_(owns_resource),
         resource_handle_(std::move(resource_handle)),
@@ -674,12 +1053,19 @@ class ShuffleDatasetOp::DatasetV3 : public ShuffleDatasetBase {
     AttrValue reshuffle_each_iteration;
     b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
                       &reshuffle_each_iteration);
+    AttrValue memory_budget_bytes;
+    b->BuildAttrValue(memory_budget_bytes_, &memory_budget_bytes);
+    AttrValue spill_directory;
+    b->BuildAttrValue(spill_directory_, &spill_directory);
     TF_RETURN_IF_ERROR(
         b->AddDataset(this,
                       {input_graph_node, buffer_size_node, seed_node,
                        seed2_node, resource_handle_node},  // Inputs
                       {std::make_pair(kReshuffleEachIteration,
-                                      reshuffle_each_iteration)},  // Attrs
+                                      reshuffle_each_iteration),
+                       std::make_pair(kMemoryBudgetBytes, memory_budget_bytes),
+                       std::make_pair(kSpillDirectory,
+                                      spill_directory)},  // Attrs
                       output));
     return OkStatus();
   }
@@ -706,6 +1092,17 @@ ShuffleDatasetOp::ShuffleDatasetOp(OpKernelConstruction* ctx)
     OP_REQUIRES_OK(
         ctx, ctx->GetAttr(kReshuffleEachIteration, &reshuffle_each_iteration_));
   }
+  if (ctx->HasAttr(kMemoryBudgetBytes)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kMemoryBudgetBytes, &memory_budget_bytes_));
+    OP_REQUIRES(ctx, memory_budget_bytes_ >= 0,
+                errors::InvalidArgument(
+                    "`memory_budget_bytes` must be non-negative, but got ",
+                    memory_budget_bytes_, "."));
+  }
+  if (ctx->HasAttr(kSpillDirectory)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kSpillDirectory, &spill_directory_));
+  }
 }
 
 void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
@@ -756,9 +1153,10 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     }
 
     // Ownership of manager is transferred onto `DatasetV3`.
-    *output = new ShuffleDatasetOp::DatasetV3(ctx, input, buffer_size, count,
-                                              std::move(seeds), manager,
-                                              std::move(handle), owns_resource);
+    *output = new ShuffleDatasetOp::DatasetV3(
+        ctx, input, buffer_size, count, std::move(seeds), manager,
+        std::move(handle), owns_resource, memory_budget_bytes_,
+        spill_directory_);
   } else if (op_version_ == 2) {
     auto handle = HandleFromInput(ctx, 2);
     SeedGeneratorManager* manager = nullptr;
@@ -30,6 +30,9 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
   static constexpr const char* const kOutputShapes = "output_shapes";
   static constexpr const char* const kReshuffleEachIteration =
       "reshuffle_each_iteration";
+  static constexpr const char* const kMemoryBudgetBytes =
+      "memory_budget_bytes";
+  static constexpr const char* const kSpillDirectory = "spill_directory";
 
   explicit ShuffleDatasetOpBase(OpKernelConstruction* ctx);
 
@@ -53,6 +56,8 @@ class ShuffleDatasetOp : public ShuffleDatasetOpBase {
   class DatasetV3;
   int op_version_ = 0;
   bool reshuffle_each_iteration_ = true;
+  int64_t memory_budget_bytes_ = 0;
+  std::string spill_directory_;
 };
 
 class ShuffleAndRepeatDatasetOp : public ShuffleDatasetOpBase {
@@ -11,6 +11,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <numeric>
 #include <string>
 #include <utility>
 
@@ -33,14 +34,19 @@ class ShuffleDatasetParams : public DatasetParams {
                        bool reshuffle_each_iteration,
                        DataTypeVector output_dtypes,
                        std::vector<PartialTensorShape> output_shapes,
-                       string node_name)
+                       string node_name, int64_t memory_budget_bytes = 0)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
         buffer_size_(buffer_size),
         seed_(seed),
         seed2_(seed2),
         count_(count),
-        reshuffle_each_iteration_(reshuffle_each_iteration) {
+        reshuffle_each_iteration_(reshuffle_each_iteration),
+        memory_budget_bytes_(memory_budget_bytes) {
+    // Only `ShuffleDatasetV3` supports a memory budget.
+    if (memory_budget_bytes_ != 0) {
+      op_version_ = 3;
+    }
     input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -56,6 +62,11 @@ class ShuffleDatasetParams : public DatasetParams {
       input_tensors.emplace_back(
           CreateTensor<int64_t>(TensorShape({}), {count_}));
     }
+    if (op_version_ == 3) {
+      // A handle to a missing resource makes the op create the seed generator.
+      input_tensors.emplace_back(
+          CreateTensor<ResourceHandle>(TensorShape({}), {ResourceHandle()}));
+    }
     return input_tensors;
   }
 
@@ -68,6 +79,9 @@ class ShuffleDatasetParams : public DatasetParams {
     if (count_ != 1) {
       input_names->emplace_back(ShuffleAndRepeatDatasetOp::kCount);
     }
+    if (op_version_ == 3) {
+      input_names->emplace_back("seed_generator");
+    }
     return OkStatus();
   }
 
@@ -78,6 +92,11 @@ class ShuffleDatasetParams : public DatasetParams {
     attr_vector->emplace_back("reshuffle_each_iteration",
                               reshuffle_each_iteration_);
     attr_vector->emplace_back("metadata", "");
+    if (op_version_ == 3) {
+      attr_vector->emplace_back(ShuffleDatasetOpBase::kMemoryBudgetBytes,
+                                memory_budget_bytes_);
+      attr_vector->emplace_back(ShuffleDatasetOpBase::kSpillDirectory, "");
+    }
     return OkStatus();
   }
 
@@ -96,6 +115,7 @@ class ShuffleDatasetParams : public DatasetParams {
   int64_t seed2_;
   int64_t count_;
   bool reshuffle_each_iteration_;
+  int64_t memory_budget_bytes_;
 };
 
 class ShuffleDatasetOpTest : public DatasetOpsTestBase {};
@@ -244,6 +264,34 @@ ShuffleDatasetParams ShuffleAndRepeatDatasetParamsWithInvalidCount() {
                               /*node_name=*/kShuffleAndRepeatNodeName);
 }
 
+// Test case 9: test shuffle_dataset with a memory budget of 10 elements, which
+// makes it scatter the 100 input elements into buckets on disk.
+ShuffleDatasetParams ExternalShuffleDatasetParams() {
+  return ShuffleDatasetParams(RangeDatasetParams(0, 100, 1),
+                              /*buffer_size=*/10,
+                              /*seed=*/1,
+                              /*seed2=*/2,
+                              /*count=*/1,
+                              /*reshuffle_each_iteration=*/false,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/kShuffleNodeName,
+                              /*memory_budget_bytes=*/10 * sizeof(int64_t));
+}
+
+ShuffleDatasetParams ExternalShuffleDatasetParamsWithInvalidMemoryBudget() {
+  return ShuffleDatasetParams(RangeDatasetParams(0, 10, 1),
+                              /*buffer_size=*/10,
+                              /*seed=*/1,
+                              /*seed2=*/2,
+                              /*count=*/1,
+                              /*reshuffle_each_iteration=*/false,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/kShuffleNodeName,
+                              /*memory_budget_bytes=*/-1);
+}
+
 template <typename T>
 struct GetNextTestCase {
   T dataset_params;
@@ -554,11 +602,80 @@ INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+TEST_F(ShuffleDatasetOpTest, ExternalShuffleGetNext) {
+  auto dataset_params = ExternalShuffleDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> out_tensors;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+
+  std::vector<int64_t> range(100);
+  std::iota(range.begin(), range.end(), 0);
+  std::vector<Tensor> expected_outputs;
+  for (int64_t i : range) {
+    expected_outputs.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/false));
+  EXPECT_FALSE(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true)
+                   .ok());
+}
+
+TEST_F(ShuffleDatasetOpTest, ExternalShuffleSaveAndRestore) {
+  auto dataset_params = ExternalShuffleDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> expected_outputs;
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    expected_outputs.insert(expected_outputs.end(), next.begin(), next.end());
+  }
+
+  // Restoring replays the scatter pass and skips the elements produced
+  // before each breakpoint.
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  std::vector<Tensor> out_tensors;
+  int cur_iteration = 0;
+  end_of_sequence = false;
+  for (int breakpoint : {0, 7, 42, 99, 101}) {
+    VariantTensorDataWriter writer;
+    TF_EXPECT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+    std::vector<const VariantTensorData*> data;
+    writer.GetData(&data);
+    VariantTensorDataReader reader(data);
+    TF_EXPECT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                                 dataset_params.iterator_prefix(), *dataset_,
+                                 &iterator_));
+
+    while (cur_iteration <= breakpoint) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+      cur_iteration++;
+    }
+  }
+  EXPECT_TRUE(end_of_sequence);
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
        ShuffleAndRepeatDatasetParamsWithInvalidBufferSize(),
-       ShuffleAndRepeatDatasetParamsWithInvalidCount()});
+       ShuffleAndRepeatDatasetParamsWithInvalidCount(),
+       ExternalShuffleDatasetParamsWithInvalidMemoryBudget()});
   for (const auto& dataset_params : dataset_params_vec) {
     EXPECT_EQ(Initialize(dataset_params).code(),
               tensorflow::error::INVALID_ARGUMENT);
@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
+#include <memory>
+
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -21,10 +24,13 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
+#include "tensorflow/core/lib/io/prefetching_random_access_file.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -44,6 +50,40 @@ constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
 
+// Returns the number of windows that are read ahead of each file, as set by
+// the `TF_DATA_TFRECORD_READ_AHEAD_WINDOWS` environment variable. Read-ahead
+// is disabled if this is 0 (the default).
+int64_t ReadAheadWindows() {
+  static const int64_t num_windows = []() {
+    int64_t value = 0;
+    Status s =
+        ReadInt64FromEnvVar("TF_DATA_TFRECORD_READ_AHEAD_WINDOWS", 0, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to read TF_DATA_TFRECORD_READ_AHEAD_WINDOWS: " << s;
+      return int64_t{0};
+    }
+    return std::max<int64_t>(value, 0);
+  }();
+  return num_windows;
+}
+
+// Returns the size of the windows that are read ahead, as set by the
+// `TF_DATA_TFRECORD_READ_AHEAD_WINDOW_SIZE` environment variable.
+int64_t ReadAheadWindowSize() {
+  static const int64_t window_size = []() {
+    const int64_t kDefaultWindowSize = 1 << 20;  // 1MB.
+    int64_t value = kDefaultWindowSize;
+    Status s = ReadInt64FromEnvVar("TF_DATA_TFRECORD_READ_AHEAD_WINDOW_SIZE",
+                                   kDefaultWindowSize, &value);
+    if (!s.ok() || value <= 0) {
+      LOG(ERROR) << "Invalid TF_DATA_TFRECORD_READ_AHEAD_WINDOW_SIZE: " << s;
+      return kDefaultWindowSize;
+    }
+    return value;
+  }();
+  return window_size;
+}
+
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
     defined(LIBTPU_ON_GCE)
@@ -114,6 +154,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     explicit Iterator(const Params& params)
         : DatasetIterator<Dataset>(params) {}
 
+    ~Iterator() override {
+      mutex_lock l(mu_);
+      ResetStreamsLocked();
+    }
+
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
@@ -250,23 +295,51 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
           TranslateFileName(dataset()->filenames_[current_file_index_]),
           &file_));
+      RandomAccessFile* file = file_.get();
+      const int64_t num_windows = ReadAheadWindows();
+      if (num_windows > 0) {
+        if (!read_ahead_thread_pool_) {
+          read_ahead_thread_pool_ = std::make_unique<thread::ThreadPool>(
+              env, ThreadOptions(), "tf_record_read_ahead", num_windows,
+              /*low_latency_hint=*/false);
+        }
+        io::PrefetchingRandomAccessFile::Options options;
+        options.window_size = ReadAheadWindowSize();
+        options.num_windows = num_windows;
+        read_ahead_file_ = std::make_unique<io::PrefetchingRandomAccessFile>(
+            file, read_ahead_thread_pool_.get(), options);
+        file = read_ahead_file_.get();
+      }
       reader_ = std::make_unique<io::SequentialRecordReader>(
-          file_.get(), dataset()->options_);
+          file, dataset()->options_);
       return OkStatus();
     }
 
     // Resets all reader streams.
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
+      if (read_ahead_file_) {
+        static monitoring::CounterCell* stall_counter =
+            metrics::GetTFDataReadAheadStallCounter(kDatasetType);
+        stall_counter->IncrementBy(read_ahead_file_->stats().stall_time_us);
+        read_ahead_file_.reset();
+      }
       file_.reset();
     }
 
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
 
-    // `reader_` will borrow the object that `file_` points to, so
-    // we must destroy `reader_` before `file_`.
+    // Runs the background reads of `read_ahead_file_`, if read-ahead is
+    // enabled.
+    std::unique_ptr<thread::ThreadPool> read_ahead_thread_pool_;
+
+    // `reader_` will borrow the object that `file_` (or `read_ahead_file_`, if
+    // read-ahead is enabled) points to, so we must destroy `reader_` before
+    // `read_ahead_file_` and `read_ahead_file_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
+    std::unique_ptr<io::PrefetchingRandomAccessFile> read_ahead_file_
+        TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
   };
 
@@ -15,16 +15,21 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +105,144 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+constexpr int kKeysPerOp = 1024;
+
+// Builds a graph of `num_ops` ops that run concurrently on the same
+// MutableHashTableV2, each on `kKeysPerOp` random keys. `insert_percent` of
+// the ops are LookupTableInsertV2 ops and the others LookupTableFindV2 ops.
+static Graph* MutableHashTableFindAndInsert(int num_ops, int insert_percent) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableHashTableV2")
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_FLOAT)
+                  .Finalize(g, &table));
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor default_value(DT_FLOAT, TensorShape({}));
+  default_value.scalar<float>()() = -1;
+  Node* default_node = test::graph::Constant(g, default_value);
+  const int num_inserts = num_ops * insert_percent / 100;
+  for (int op = 0; op < num_ops; ++op) {
+    Tensor keys(DT_INT64, TensorShape({kKeysPerOp}));
+    for (int i = 0; i < kKeysPerOp; ++i) {
+      keys.flat<int64_t>()(i) = rnd.Uniform64(num_ops * kKeysPerOp);
+    }
+    Node* keys_node = test::graph::Constant(g, keys);
+    Node* node;
+    if (op < num_inserts) {
+      Tensor values(DT_FLOAT, TensorShape({kKeysPerOp}));
+      values.flat<float>().setRandom();
+      TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                      .Input(table)
+                      .Input(keys_node)
+                      .Input(test::graph::Constant(g, values))
+                      .Finalize(g, &node));
+    } else {
+      TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                      .Input(table)
+                      .Input(keys_node)
+                      .Input(default_node)
+                      .Finalize(g, &node));
+    }
+  }
+  return g;
+}
+
+static void BM_MutableHashTableFindAndInsert(
+    ::testing::benchmark::State& state) {
+  const int num_ops = state.range(0);
+  const int insert_percent = state.range(1);
+  test::Benchmark("cpu", MutableHashTableFindAndInsert(num_ops, insert_percent),
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * num_ops *
+                          kKeysPerOp);
+}
+
+BENCHMARK(BM_MutableHashTableFindAndInsert)
+    ->UseRealTime()
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 100)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 10)
+    ->ArgPair(32, 50)
+    ->ArgPair(32, 100);
+
+constexpr int kDenseHashTableLookups = 100000;
+
+// Returns a MutableDenseHashTableV2 node of int64 keys and float values, shared
+// between the graphs that create it.
+static Node* SharedMutableDenseHashTable(Graph* g) {
+  Tensor empty_key(DT_INT64, TensorShape({}));
+  empty_key.scalar<int64_t>()() = -1;
+  Tensor deleted_key(DT_INT64, TensorShape({}));
+  deleted_key.scalar<int64_t>()() = -2;
+  Node* table;
+  TF_CHECK_OK(NodeBuilder("dense_table", "MutableDenseHashTableV2")
+                  .Input(test::graph::Constant(g, empty_key))
+                  .Input(test::graph::Constant(g, deleted_key))
+                  .Attr("shared_name", "dense_table")
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_FLOAT)
+                  .Finalize(g, &table));
+  return table;
+}
+
+// Inserts the keys 0 to `table_size` - 1 in the shared dense hash table.
+static Graph* MutableDenseHashTableInsert(int table_size) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor keys(DT_INT64, TensorShape({table_size}));
+  for (int i = 0; i < table_size; ++i) {
+    keys.flat<int64_t>()(i) = i;
+  }
+  Tensor values(DT_FLOAT, TensorShape({table_size}));
+  values.flat<float>().setRandom();
+  Node* insert;
+  TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                  .Input(SharedMutableDenseHashTable(g))
+                  .Input(test::graph::Constant(g, keys))
+                  .Input(test::graph::Constant(g, values))
+                  .Finalize(g, &insert));
+  return g;
+}
+
+// Looks up `kDenseHashTableLookups` random keys in the shared dense hash
+// table, half of which are in a table of `table_size` keys.
+static Graph* MutableDenseHashTableFind(int table_size) {
+  Graph* g = new Graph(OpRegistry::Global());
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor keys(DT_INT64, TensorShape({kDenseHashTableLookups}));
+  for (int i = 0; i < kDenseHashTableLookups; ++i) {
+    keys.flat<int64_t>()(i) = rnd.Uniform64(2 * table_size);
+  }
+  Tensor default_value(DT_FLOAT, TensorShape({}));
+  default_value.scalar<float>()() = -1;
+  Node* find;
+  TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                  .Input(SharedMutableDenseHashTable(g))
+                  .Input(test::graph::Constant(g, keys))
+                  .Input(test::graph::Constant(g, default_value))
+                  .Finalize(g, &find));
+  return g;
+}
+
+static void BM_MutableDenseHashTableFind(::testing::benchmark::State& state) {
+  const int table_size = state.range(0);
+  test::Benchmark("cpu", MutableDenseHashTableFind(table_size),
+                  /*options=*/nullptr, MutableDenseHashTableInsert(table_size))
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kDenseHashTableLookups);
+}
+
+BENCHMARK(BM_MutableDenseHashTableFind)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 22);
+
 }  // namespace
 }  // namespace tensorflow
@@ -16,9 +16,14 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <array>
+#include <optional>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
@@ -26,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/platform/random.h"
 
 namespace tensorflow {
@@ -36,11 +42,196 @@ std::string UniqueNodeName(const std::string& base) {
   return strings::StrCat(base, "/", counter.fetch_add(1), "/", random::New64());
 }
 
+namespace {
+
+// Number of shards of the mutable hash tables. Each shard has its own lock, so
+// that finds and inserts of keys in different shards do not contend.
+constexpr int kNumHashTableShards = 16;
+
+template <typename T>
+inline int HashTableShard(const T& key) {
+  return Hash64(reinterpret_cast<const char*>(&key), sizeof(key)) %
+         kNumHashTableShards;
+}
+
+inline int HashTableShard(const tstring& key) {
+  return Hash64(key) % kNumHashTableShards;
+}
+
+// An unordered_map split into kNumHashTableShards shards by the hash of the
+// key. Operations on a batch of keys group the keys by shard and lock each
+// shard once, so that concurrent batches only wait for each other while they
+// touch the same shard, and finds only wait for inserts and removals.
+//
+// The shards of a batch are locked one after the other, so inserts and
+// removals of several keys are not atomic: a concurrent find may see some of
+// the keys of a batch updated and others not yet. Only inserts that clear the
+// map and WithSnapshot() lock all shards at once.
+template <class K, class V>
+class ShardedHashMap {
+ public:
+  // Returns the number of entries. Entries inserted or removed concurrently
+  // may or may not be counted.
+  size_t size() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+  // Calls `fn(i, value)` for each index `i` of `keys`, with `value` the value
+  // of the key, or nullptr if the key is not in the map.
+  template <typename KeysFlat, typename Fn>
+  void Find(const KeysFlat& keys, Fn fn) const {
+    const KeyIndicesByShard by_shard(keys);
+    for (int s = 0; s < kNumHashTableShards; ++s) {
+      if (by_shard.empty(s)) continue;
+      const Shard& shard = shards_[s];
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = by_shard.begin(s); j < by_shard.end(s); ++j) {
+        const int64_t i = by_shard.indices[j];
+        fn(i, gtl::FindOrNull(shard.map, SubtleMustCopyIfIntegral(keys(i))));
+      }
+    }
+  }
+
+  // Maps each key of `keys` to `value_fn(i)`, with `i` its index. If a key
+  // occurs more than once, the last one wins. If `clear`, first removes all
+  // entries, atomically with the insertion.
+  template <typename KeysFlat, typename ValueFn>
+  void Insert(bool clear, const KeysFlat& keys, ValueFn value_fn) {
+    const KeyIndicesByShard by_shard(keys);
+    std::vector<mutex_lock> all_shards_locks;
+    if (clear) {
+      all_shards_locks = LockAllShards();
+      for (Shard& shard : shards_) {
+        shard.map.clear();
+      }
+    }
+    for (int s = 0; s < kNumHashTableShards; ++s) {
+      if (by_shard.empty(s)) continue;
+      Shard& shard = shards_[s];
+      std::optional<mutex_lock> l;
+      if (!clear) l.emplace(shard.mu);
+      for (int64_t j = by_shard.begin(s); j < by_shard.end(s); ++j) {
+        const int64_t i = by_shard.indices[j];
+        gtl::InsertOrUpdate(&shard.map, SubtleMustCopyIfIntegral(keys(i)),
+                            value_fn(i));
+      }
+    }
+  }
+
+  // Removes the keys of `keys`.
+  template <typename KeysFlat>
+  void Remove(const KeysFlat& keys) {
+    const KeyIndicesByShard by_shard(keys);
+    for (int s = 0; s < kNumHashTableShards; ++s) {
+      if (by_shard.empty(s)) continue;
+      Shard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64_t j = by_shard.begin(s); j < by_shard.end(s); ++j) {
+        shard.map.erase(SubtleMustCopyIfIntegral(keys(by_shard.indices[j])));
+      }
+    }
+  }
+
+  // Calls `fn(size, for_each_entry)` with all shards locked, so that `fn` sees
+  // a consistent snapshot of the map. `for_each_entry(entry_fn)` calls
+  // `entry_fn(key, value)` for each of the `size` entries.
+  template <typename Fn>
+  auto WithSnapshot(Fn fn) const {
+    std::vector<tf_shared_lock> locks;
+    locks.reserve(kNumHashTableShards);
+    int64_t size = 0;
+    for (const Shard& shard : shards_) {
+      locks.emplace_back(shard.mu);
+      size += shard.map.size();
+    }
+    auto for_each_entry = [this](auto entry_fn) {
+      for (const Shard& shard : shards_) {
+        for (const auto& entry : shard.map) {
+          entry_fn(entry.first, entry.second);
+        }
+      }
+    };
+    return fn(size, for_each_entry);
+  }
+
+  // Returns the number of buckets of the underlying maps, counting empty
+  // buckets as one entry.
+  int64_t NumBuckets() const {
+    int64_t ret = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      for (unsigned i = 0; i < shard.map.bucket_count(); ++i) {
+        ret += std::max<size_t>(shard.map.bucket_size(i), 1);
+      }
+    }
+    return ret;
+  }
+
+ private:
+  // The indices of a batch of keys grouped by shard: those of the keys of shard
+  // `s` are `indices[begin(s)]` to `indices[end(s) - 1]`, in increasing order.
+  struct KeyIndicesByShard {
+    template <typename KeysFlat>
+    explicit KeyIndicesByShard(const KeysFlat& keys) : indices(keys.size()) {
+      std::vector<uint8> shards(keys.size());
+      offsets.fill(0);
+      for (int64_t i = 0; i < keys.size(); ++i) {
+        shards[i] = HashTableShard(SubtleMustCopyIfIntegral(keys(i)));
+        ++offsets[shards[i] + 1];
+      }
+      for (int s = 0; s < kNumHashTableShards; ++s) {
+        offsets[s + 1] += offsets[s];
+      }
+      std::array<int64_t, kNumHashTableShards> next;
+      std::copy(offsets.begin(), offsets.end() - 1, next.begin());
+      for (int64_t i = 0; i < keys.size(); ++i) {
+        indices[next[shards[i]]++] = i;
+      }
+    }
+
+    int64_t begin(int s) const { return offsets[s]; }
+    int64_t end(int s) const { return offsets[s + 1]; }
+    bool empty(int s) const { return begin(s) == end(s); }
+
+    std::array<int64_t, kNumHashTableShards + 1> offsets;
+    std::vector<int64_t> indices;
+  };
+
+  // Locks all shards, in order, to replace the whole map.
+  std::vector<mutex_lock> LockAllShards() {
+    std::vector<mutex_lock> locks;
+    locks.reserve(kNumHashTableShards);
+    for (Shard& shard : shards_) {
+      locks.emplace_back(shard.mu);
+    }
+    return locks;
+  }
+
+  struct Shard {
+    mutable mutex mu;
+    // Guarded by `mu`. Not annotated since whole-map operations hold all the
+    // shard locks at once.
+    std::unordered_map<K, V> map;
+  };
+  std::array<Shard, kNumHashTableShards> shards_;
+};
+
+}  // namespace
+
 // Lookup table that wraps an unordered_map, where the key and value data type
 // is specified. Each individual value must be a scalar. If vector values are
 // required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// The map is sharded by key so that concurrent finds and inserts from many
+// threads mostly do not contend. As a result, an insert or removal of several
+// keys is not atomic with respect to concurrent finds, which may see only part
+// of it. Imports and exports still are.
 //
 // Sample use case:
 //
@@ -55,10 +246,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
  public:
   MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -70,18 +258,18 @@ class MutableHashTableOfScalars final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    table_.Find(key_values, [&](int64_t i, const V* found) {
       // is_full_size_default is true:
       //   Each key has an independent default value, key_values(i)
       //   corresponding uses default_flat(i) as its default value.
       //
       // is_full_size_default is false:
       //   All keys will share the default_flat(0) as default value.
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyIfIntegral(key_values(i)),
-          is_full_size_default ? default_flat(i) : default_flat(0));
-    }
+      value_values(i) =
+          found != nullptr
+              ? *found
+              : (is_full_size_default ? default_flat(i) : default_flat(0));
+    });
 
     return OkStatus();
   }
@@ -90,14 +278,9 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          SubtleMustCopyIfIntegral(value_values(i)));
-    }
+    table_.Insert(clear, key_values, [&](int64_t i) {
+      return SubtleMustCopyIfIntegral(value_values(i));
+    });
     return OkStatus();
   }
 
@@ -107,12 +290,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
-    const auto key_values = keys.flat<K>();
-
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.Remove(keys.flat<K>());
     return OkStatus();
   }
 
@@ -122,17 +300,16 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("values", TensorShape({size}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return table_.WithSnapshot([&](int64_t size, auto for_each_entry) {
+      Tensor* keys;
+      Tensor* values;
+      TF_RETURN_IF_ERROR(
+          ctx->allocate_output("keys", TensorShape({size}), &keys));
+      TF_RETURN_IF_ERROR(
+          ctx->allocate_output("values", TensorShape({size}), &values));
+      ExportKeysAndValues(for_each_entry, keys, values);
+      return OkStatus();
+    });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -144,25 +321,17 @@ class MutableHashTableOfScalars final : public LookupInterface {
   TensorShape value_shape() const override { return TensorShape(); }
 
   int64_t MemoryUsed() const override {
-    int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
-    }
-    return sizeof(MutableHashTableOfScalars) + ret;
+    return sizeof(MutableHashTableOfScalars) + table_.NumBuckets();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    table_.WithSnapshot([&](int64_t size, auto for_each_entry) {
+      keys = Tensor(key_dtype(), TensorShape({size}));
+      values = Tensor(value_dtype(), TensorShape({size}));
+      ExportKeysAndValues(for_each_entry, &keys, &values);
+    });
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableV2 kernel. This means that the lifetime
@@ -195,21 +364,22 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  // Writes all keys and values visited by `for_each_entry` into `keys` and
+  // `values`, which must point to tensors of the size of the table snapshot.
+  template <typename ForEachEntry>
+  static void ExportKeysAndValues(const ForEachEntry& for_each_entry,
+                                  Tensor* keys, Tensor* values) {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
-    }
+    for_each_entry([&](const K& key, const V& value) {
+      keys_data(i) = key;
+      values_data(i) = value;
+      ++i;
+    });
   }
 
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, V> table_;
 };
 
 // Lookup table that wraps an unordered_map. Behaves identical to
@@ -226,10 +396,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
                                 value_shape_.DebugString()));
   }
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -242,10 +409,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec =
-          gtl::FindOrNull(table_, SubtleMustCopyIfIntegral(key_values(i)));
+    table_.Find(key_values, [&](int64_t i, const ValueArray* value_vec) {
       if (value_vec != nullptr) {
         for (int64_t j = 0; j < value_dim; j++) {
           value_values(i, j) = value_vec->at(j);
@@ -262,7 +426,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
               is_full_size_default ? default_flat(i, j) : default_flat(0, j);
         }
       }
-    }
+    });
 
     return OkStatus();
   }
@@ -272,19 +436,14 @@ class MutableHashTableOfTensors final : public LookupInterface {
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64_t value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    table_.Insert(clear, key_values, [&](int64_t i) {
       ValueArray value_vec;
       for (int64_t j = 0; j < value_dim; j++) {
         V value = value_values(i, j);
         value_vec.push_back(value);
       }
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
-                          value_vec);
-    }
+      return value_vec;
+    });
     return OkStatus();
   }
 
@@ -294,12 +453,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
-    const auto key_values = keys.flat<K>();
-
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.Remove(keys.flat<K>());
     return OkStatus();
   }
 
@@ -309,18 +463,17 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
     int64_t value_dim = value_shape_.dim_size(0);
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(ctx->allocate_output(
-        "values", TensorShape({size, value_dim}), &values));
-    ExportKeysAndValues(keys, values);
-    return OkStatus();
+    return table_.WithSnapshot([&](int64_t size, auto for_each_entry) {
+      Tensor* keys;
+      Tensor* values;
+      TF_RETURN_IF_ERROR(
+          ctx->allocate_output("keys", TensorShape({size}), &keys));
+      TF_RETURN_IF_ERROR(ctx->allocate_output(
+          "values", TensorShape({size, value_dim}), &values));
+      ExportKeysAndValues(for_each_entry, keys, values);
+      return OkStatus();
+    });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -332,25 +485,18 @@ class MutableHashTableOfTensors final : public LookupInterface {
   TensorShape value_shape() const override { return value_shape_; }
 
   int64_t MemoryUsed() const override {
-    int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
-    }
-    return sizeof(MutableHashTableOfTensors) + ret;
+    return sizeof(MutableHashTableOfTensors) + table_.NumBuckets();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    table_.WithSnapshot([&](int64_t size, auto for_each_entry) {
+      keys = Tensor(key_dtype(), TensorShape({size}));
+      values = Tensor(value_dtype(),
+                      TensorShape({size, value_shape_.dim_size(0)}));
+      ExportKeysAndValues(for_each_entry, &keys, &values);
+    });
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableOfTensorsV2 kernel. This means that the
@@ -384,28 +530,28 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+
+  // Writes all keys and values visited by `for_each_entry` into `keys` and
+  // `values`, which must point to tensors of the size of the table snapshot.
+  template <typename ForEachEntry>
+  void ExportKeysAndValues(const ForEachEntry& for_each_entry, Tensor* keys,
+                           Tensor* values) const {
     int64_t value_dim = value_shape_.dim_size(0);
     auto keys_data = keys->flat<K>();
     auto values_data = values->matrix<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
+    for_each_entry([&](const K& key, const ValueArray& value) {
       keys_data(i) = key;
       for (int64_t j = 0; j < value_dim; j++) {
         values_data(i, j) = value[j];
       }
-    }
+      ++i;
+    });
   }
 
   TensorShape value_shape_;
-  mutable mutex mu_;
-  typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
+  ShardedHashMap<K, ValueArray> table_;
 };
 
 namespace {
@@ -520,9 +666,29 @@ class MutableDenseHashTable final : public LookupInterface {
     const auto deleted_key_matrix =
         deleted_key_.template shaped<K, 2>({1, key_size});
     const int64_t bit_mask = num_buckets_ - 1;
+    // Hashes the keys kFindPrefetchDistance lookups ahead and prefetches their
+    // first bucket, so that the cache misses of consecutive lookups overlap
+    // instead of stalling each probe in turn.
+    std::array<uint64, kFindPrefetchDistance> key_hashes;
+    auto hash_and_prefetch = [&](int64_t i) {
+      const uint64 key_hash = HashKey(key_matrix, i);
+      key_hashes[i % kFindPrefetchDistance] = key_hash;
+      const int64_t bucket_index = key_hash & bit_mask;
+      port::prefetch<port::PREFETCH_HINT_T0>(key_buckets_matrix.data() +
+                                             bucket_index * key_size);
+      port::prefetch<port::PREFETCH_HINT_T0>(value_buckets_matrix.data() +
+                                             bucket_index * value_size);
+    };
+    for (int64_t i = 0; i < std::min(num_elements, kFindPrefetchDistance);
+         ++i) {
+      hash_and_prefetch(i);
+    }
     // TODO(andreasst): parallelize using work_sharder
     for (int64_t i = 0; i < num_elements; ++i) {
-      const uint64 key_hash = HashKey(key_matrix, i);
+      const uint64 key_hash = key_hashes[i % kFindPrefetchDistance];
+      if (i + kFindPrefetchDistance < num_elements) {
+        hash_and_prefetch(i + kFindPrefetchDistance);
+      }
       if (empty_key_hash_ == key_hash &&
           IsEqualKey(empty_key_matrix, 0, key_matrix, i)) {
         return errors::InvalidArgument(
@@ -864,6 +1030,10 @@ class MutableDenseHashTable final : public LookupInterface {
     return true;
   }
 
+  // Number of keys that Find hashes and prefetches ahead of the key it looks
+  // up. Enough to cover the latency of a cache miss with that of the probes.
+  static constexpr int64_t kFindPrefetchDistance = 8;
+
   TensorShape key_shape_;
   TensorShape value_shape_;
   float max_load_factor_;
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -250,6 +251,25 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
+// Whether the tensors restored with TF_RESTORE_V2_MAP_READ_ONLY have their
+// checksums validated. Validating reads every page of each mapped tensor at
+// restore time, which gives up the lazy paging that the mappings are for, so
+// it is off by default: a corrupted data file then goes undetected for the
+// mapped tensors. The tensors that are copied are always validated.
+bool VerifyMappedRestore() {
+  static const bool verify_mapped_restore = [] {
+    bool value;
+    Status s = ReadBoolFromEnvVar("TF_RESTORE_V2_MAP_VERIFY_CHECKSUMS",
+                                  /*default_val=*/false, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return false;
+    }
+    return value;
+  }();
+  return verify_mapped_restore;
+}
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -349,6 +369,19 @@ struct RestoreOp {
     return OkStatus();
   }
 
+  // Restores the full tensor as a read-only tensor backed by a memory mapping
+  // of its data file when possible.
+  Status run_mapped(BundleReader* reader) {
+    DCHECK(shape_and_slice.empty());
+    Tensor restored_tensor;
+    TF_RETURN_IF_ERROR(reader->LookupMapped(tensor_name, &restored_tensor,
+                                            VerifyMappedRestore()));
+    VLOG(1) << "Restored tensor " << idx << " : " << tensor_name << " : "
+            << restored_tensor.NumElements();
+    context->set_output(idx, restored_tensor);
+    return OkStatus();
+  }
+
   OpKernelContext* context;
   int idx;
   string tensor_name;
@@ -359,6 +392,64 @@ struct RestoreOp {
   ::tensorflow::Status status;
 };
 
+// Restores the full tensors of "restore_ops" with a single
+// BundleReader::LookupMany() call, which reads them in parallel on
+// "thread_pool".
+Status RunBatchedRestoreOps(BundleReader* reader,
+                            gtl::ArraySlice<RestoreOp*> restore_ops,
+                            thread::ThreadPool* thread_pool) {
+  std::vector<StringPiece> keys;
+  std::vector<Tensor*> restored_tensors;
+  keys.reserve(restore_ops.size());
+  restored_tensors.reserve(restore_ops.size());
+  for (RestoreOp* op : restore_ops) {
+    TensorShape restored_full_shape;
+    TF_RETURN_IF_ERROR(
+        reader->LookupTensorShape(op->tensor_name, &restored_full_shape));
+    Tensor* restored_tensor;
+    TF_RETURN_IF_ERROR(op->context->allocate_output(
+        op->idx, restored_full_shape, &restored_tensor));
+    keys.push_back(op->tensor_name);
+    restored_tensors.push_back(restored_tensor);
+  }
+  VLOG(1) << "Restoring " << keys.size() << " tensors in parallel";
+  return reader->LookupMany(keys, restored_tensors, thread_pool);
+}
+
+// Whether RestoreTensorsV2() restores full tensors as read-only tensors backed
+// by memory mappings of the data files, for serving models whose variables are
+// never mutated. Only entries written with data_alignment of at least
+// EIGEN_MAX_ALIGN_BYTES can be mapped; the others are copied as usual.
+bool UseMappedRestore() {
+  static const bool use_mapped_restore = [] {
+    bool value;
+    Status s = ReadBoolFromEnvVar("TF_RESTORE_V2_MAP_READ_ONLY",
+                                  /*default_val=*/false, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return false;
+    }
+    return value;
+  }();
+  return use_mapped_restore;
+}
+
+// Whether RestoreTensorsV2() restores full tensors with a single batched
+// lookup instead of one lookup per tensor.
+bool UseBatchedRestore() {
+  static const bool use_batched_restore = [] {
+    bool value;
+    Status s = ReadBoolFromEnvVar("TF_RESTORE_V2_BATCHED_LOOKUP",
+                                  /*default_val=*/true, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return true;
+    }
+    return value;
+  }();
+  return use_batched_restore;
+}
+
 }  // namespace
 
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
@@ -402,10 +493,21 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
+  // Full tensors are restored together with a batched lookup, which reads
+  // them in parallel. Slices are restored one at a time.
+  // In the read-only mode, they are mapped instead.
+  const bool use_mapped_restore = UseMappedRestore();
+  const bool use_batched_restore = UseBatchedRestore();
+  std::vector<RestoreOp*> mapped_restore_ops;
+  std::vector<RestoreOp*> batched_restore_ops;
   std::vector<RestoreOp*> pool_restore_ops;
   std::vector<RestoreOp*> direct_restore_ops;
   for (RestoreOp& restore_op : restore_ops) {
-    if (restore_op.should_run_in_pool(&default_reader)) {
+    if (use_mapped_restore && restore_op.shape_and_slice.empty()) {
+      mapped_restore_ops.push_back(&restore_op);
+    } else if (use_batched_restore && restore_op.shape_and_slice.empty()) {
+      batched_restore_ops.push_back(&restore_op);
+    } else if (restore_op.should_run_in_pool(&default_reader)) {
       pool_restore_ops.push_back(&restore_op);
     } else {
       direct_restore_ops.push_back(&restore_op);
@@ -416,7 +518,7 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
+    if (!pool_restore_ops.empty() || !batched_restore_ops.empty()) {
       reader_pool.reset(
           new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
       for (auto* op : pool_restore_ops) {
@@ -428,6 +530,15 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     for (auto* op : direct_restore_ops) {
       TF_RETURN_IF_ERROR(op->run(&default_reader));
     }
+
+    for (auto* op : mapped_restore_ops) {
+      TF_RETURN_IF_ERROR(op->run_mapped(&default_reader));
+    }
+
+    if (!batched_restore_ops.empty()) {
+      TF_RETURN_IF_ERROR(RunBatchedRestoreOps(
+          &default_reader, batched_restore_ops, reader_pool.get()));
+    }
   }
 
   // Check status of pool ops; this must come after the pool shuts down.
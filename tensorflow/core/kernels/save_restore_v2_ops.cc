@@ -15,6 +15,8 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -31,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
@@ -87,6 +90,56 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
   }
 }
 
+// Returns the number of data files SaveV2 spreads the tensors over. With more
+// than one, the files are written concurrently by background threads.
+int64_t SaveV2NumDataFiles() {
+  static const int64_t num_data_files = [] {
+    int64_t value;
+    Status s = ReadInt64FromEnvVar("TF_SAVE_V2_NUM_DATA_FILES",
+                                   /*default_val=*/1, &value);
+    if (!s.ok() || value < 1) {
+      LOG(ERROR) << "Invalid TF_SAVE_V2_NUM_DATA_FILES: " << s;
+      return int64_t{1};
+    }
+    return value;
+  }();
+  return num_data_files;
+}
+
+// Returns the alignment of the tensor data written by SaveV2. Aligning it to
+// at least EIGEN_MAX_ALIGN_BYTES lets readers map the tensors instead of
+// copying them (see TF_RESTORE_V2_MAP_READ_ONLY).
+int64_t SaveV2DataAlignment() {
+  static const int64_t data_alignment = [] {
+    int64_t value;
+    Status s = ReadInt64FromEnvVar("TF_SAVE_V2_DATA_ALIGNMENT",
+                                   /*default_val=*/1, &value);
+    if (!s.ok() || value < 1) {
+      LOG(ERROR) << "Invalid TF_SAVE_V2_DATA_ALIGNMENT: " << s;
+      return int64_t{1};
+    }
+    return value;
+  }();
+  return data_alignment;
+}
+
+// Whether SaveV2 returns once the tensors are snapshotted, and finishes
+// writing the bundle in the background. Readers and merges of the bundle in
+// this process wait for the write.
+bool SaveV2Async() {
+  static const bool async = [] {
+    bool value;
+    Status s = ReadBoolFromEnvVar("TF_SAVE_V2_ASYNC", /*default_val=*/false,
+                                  &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return false;
+    }
+    return value;
+  }();
+  return async;
+}
+
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
@@ -108,7 +161,18 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<tstring>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
+    BundleWriter::Options options;
+    options.num_shards = SaveV2NumDataFiles();
+    options.data_alignment = SaveV2DataAlignment();
+    const bool async = SaveV2Async();
+    if (async) {
+      // Uses the sharded writer, whose Add() only snapshots the tensors, so
+      // that the data is written in the background too.
+      options.num_shards = std::max(options.num_shards, 2);
+    }
+    auto writer_ptr =
+        std::make_unique<BundleWriter>(Env::Default(), prefix_string, options);
+    BundleWriter& writer = *writer_ptr;
     OP_REQUIRES_OK(context, writer.status());
     VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
 
@@ -157,8 +221,14 @@ class SaveV2 : public OpKernel {
 
       VLOG(2) << "Done save of " << tensor_name;
     }
-    OP_REQUIRES_OK(context, writer.Finish());
-    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
+    if (async) {
+      BundleWriter::FinishAsync(std::move(writer_ptr));
+      VLOG(1) << "Finishing BundleWriter in the background, prefix_string: "
+              << prefix_string;
+    } else {
+      OP_REQUIRES_OK(context, writer.Finish());
+      VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
+    }
 
     ResourceMgr* resource_manager = context->resource_manager();
     if (resource_manager != nullptr) {
@@ -202,6 +272,8 @@ class RestoreV2 : public OpKernel {
     if (!context->status().ok()) return;
 
     const string& prefix_string = prefix.scalar<tstring>()();
+    // Waits for a SaveV2 of this prefix that is still being written.
+    OP_REQUIRES_OK(context, WaitForPendingBundleWrites(prefix_string));
 
     // Intention: we plan to use the RestoreV2 op as a backward-compatible
     // reader as we upgrade to the V2 format.  This allows transparent upgrade.
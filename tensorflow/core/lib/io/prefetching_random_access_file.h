@@ -0,0 +1,29 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_LIB_IO_PREFETCHING_RANDOM_ACCESS_FILE_H_
+#define TENSORFLOW_CORE_LIB_IO_PREFETCHING_RANDOM_ACCESS_FILE_H_
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/tsl/lib/io/prefetching_random_access_file.h"
+
+namespace tensorflow {
+namespace io {
+using tsl::io::PrefetchingRandomAccessFile;  // NOLINT(misc-unused-using-decls)
+}
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_IO_PREFETCHING_RANDOM_ACCESS_FILE_H_
@@ -54,6 +54,12 @@ REGISTER_OP("BatchFunction")
     // NOTE: Support for `enable_large_batch_splitting == true` is still
     // developed in progress.
     .Attr("enable_large_batch_splitting: bool = false")
+    // If 'length_bucketing_input' is non-negative, inputs are batched only
+    // with inputs of similar sequence length, i.e. in the same bucket of
+    // 'length_bucket_boundaries', taking the length from the input tensor at
+    // this index of 'in_tensors'.
+    .Attr("length_bucketing_input: int = -1")
+    .Attr("length_bucket_boundaries: list(int) = []")
     // TODO(apassos): Fix this shape inference function. It requires shape
     // inference of function calls.
     .SetShapeFn(shape_inference::UnknownShape)
@@ -95,6 +95,14 @@ struct FastParseExampleConfig {
   // If `true`, `Result::feature_stats` will contain one
   // `PerExampleFeatureStats` for each serialized example in the input.
   bool collect_feature_stats = false;
+
+  // If `true`, `FastParseExample()` parses configs that only contain
+  // fixed-length dense `DT_FLOAT` and `DT_INT64` features column by column:
+  // it first locates every configured feature in every example, and then
+  // decodes each feature for the whole batch at once. The parsed values are
+  // identical to those of the row-wise parser, which is used for all other
+  // configs.
+  bool columnar_fixed_length_dense = true;
 };
 
 // Statistics about the features in each example passed to
@@ -19,8 +19,12 @@ limitations under the License.
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -427,6 +431,174 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+// Returns a fixed-length dense config with a float feature "f" of shape {3}
+// and an int64 feature "i" of shape {2}, both with default values.
+FastParseExampleConfig FixedLengthDenseConfig(bool columnar) {
+  FastParseExampleConfig config;
+  AddDenseFeature("f", DT_FLOAT, {3}, false, 3, &config);
+  config.dense.back().default_value = test::AsTensor<float>({-1, -2, -3});
+  AddDenseFeature("i", DT_INT64, {2}, false, 2, &config);
+  config.dense.back().default_value = test::AsTensor<int64_t>({-4, -5});
+  config.columnar_fixed_length_dense = columnar;
+  return config;
+}
+
+void ExpectColumnarMatchesRowWise(const FastParseExampleConfig& config,
+                                  const std::vector<tstring>& serialized,
+                                  thread::ThreadPool* thread_pool) {
+  FastParseExampleConfig row_wise_config = config;
+  row_wise_config.columnar_fixed_length_dense = false;
+  Result row_wise;
+  TF_ASSERT_OK(FastParseExample(row_wise_config, serialized, {}, thread_pool,
+                                &row_wise));
+  Result columnar;
+  TF_ASSERT_OK(
+      FastParseExample(config, serialized, {}, thread_pool, &columnar));
+  ASSERT_EQ(row_wise.dense_values.size(), columnar.dense_values.size());
+  for (size_t d = 0; d < row_wise.dense_values.size(); ++d) {
+    test::ExpectEqual(row_wise.dense_values[d], columnar.dense_values[d]);
+  }
+}
+
+TEST(FastParseExampleColumnar, MatchesRowWise) {
+  std::vector<tstring> serialized;
+  for (int i = 0; i < 100; ++i) {
+    Example example;
+    auto& features = *example.mutable_features()->mutable_feature();
+    if (i % 3 != 0) {
+      auto* floats = features["f"].mutable_float_list();
+      for (int j = 0; j < 3; ++j) floats->add_value(i * 0.5f + j);
+    }
+    if (i % 5 != 0) {
+      // Mixes single-byte, multi-byte and negative varints.
+      auto* int64s = features["i"].mutable_int64_list();
+      int64s->add_value(i);
+      int64s->add_value(i % 2 == 0 ? i << 20 : -i);
+    }
+    if (i % 7 == 0) {
+      // Empty features are treated as missing.
+      features["f"].Clear();
+    }
+    features["unused"].mutable_bytes_list()->add_value("x");
+    string s = Serialize(example);
+    if (i % 11 == 0) {
+      // Concatenated examples: the last occurrence of a feature wins.
+      Example other;
+      (*other.mutable_features()->mutable_feature())["i"]
+          .mutable_int64_list()
+          ->add_value(7);
+      (*other.mutable_features()->mutable_feature())["i"]
+          .mutable_int64_list()
+          ->add_value(8);
+      s += Serialize(other);
+    }
+    serialized.push_back(s);
+  }
+
+  const FastParseExampleConfig config =
+      FixedLengthDenseConfig(/*columnar=*/true);
+  ExpectColumnarMatchesRowWise(config, serialized, nullptr);
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  ExpectColumnarMatchesRowWise(config, serialized, &thread_pool);
+
+  Result result;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  test::ExpectTensorEqual<float>(
+      result.dense_values[0].SubSlice(1),
+      test::AsTensor<float>({0.5f, 1.5f, 2.5f}));
+  test::ExpectTensorEqual<float>(result.dense_values[0].SubSlice(0),
+                                 config.dense[0].default_value);
+  test::ExpectTensorEqual<int64_t>(result.dense_values[1].SubSlice(2),
+                                   test::AsTensor<int64_t>({2, 2 << 20}));
+  test::ExpectTensorEqual<int64_t>(result.dense_values[1].SubSlice(11),
+                                   test::AsTensor<int64_t>({7, 8}));
+}
+
+TEST(FastParseExampleColumnar, NonPackedInt64) {
+  // An example with the non-packed int64 feature "age" = [13].
+  const std::vector<tstring> serialized = {
+      "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d"};
+  FastParseExampleConfig config;
+  AddDenseFeature("age", DT_INT64, {1}, false, 1, &config);
+  Result result;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  test::ExpectTensorEqual<int64_t>(result.dense_values[0],
+                                   test::AsTensor<int64_t>({13}, {1, 1}));
+}
+
+TEST(FastParseExampleColumnar, ErrorsMatchRowWise) {
+  Example example;
+  (*example.mutable_features()->mutable_feature())["f"]
+      .mutable_float_list()
+      ->add_value(1);
+  const std::vector<tstring> serialized = {Serialize(example)};
+
+  FastParseExampleConfig config = FixedLengthDenseConfig(/*columnar=*/true);
+  FastParseExampleConfig row_wise_config =
+      FixedLengthDenseConfig(/*columnar=*/false);
+  Result result;
+  Status columnar_status =
+      FastParseExample(config, serialized, {}, nullptr, &result);
+  Status row_wise_status =
+      FastParseExample(row_wise_config, serialized, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(columnar_status));
+  EXPECT_EQ(columnar_status, row_wise_status);
+
+  // A missing feature without a default value is an error.
+  (*example.mutable_features()->mutable_feature())["f"]
+      .mutable_float_list()
+      ->add_value(2);
+  (*example.mutable_features()->mutable_feature())["f"]
+      .mutable_float_list()
+      ->add_value(3);
+  config.dense[1].default_value = Tensor(DT_INT64, {0});
+  row_wise_config.dense[1].default_value = Tensor(DT_INT64, {0});
+  const std::vector<tstring> missing = {Serialize(example)};
+  columnar_status = FastParseExample(config, missing, {}, nullptr, &result);
+  row_wise_status =
+      FastParseExample(row_wise_config, missing, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(columnar_status));
+  EXPECT_EQ(columnar_status, row_wise_status);
+}
+
+void BM_FastParseExampleFixedLengthDense(::testing::benchmark::State& state) {
+  const bool columnar = state.range(0);
+  const int num_examples = state.range(1);
+  constexpr int kNumFeatures = 8;
+  constexpr int kNumValues = 16;
+
+  FastParseExampleConfig config;
+  config.columnar_fixed_length_dense = columnar;
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  for (int k = 0; k < kNumFeatures; ++k) {
+    const string float_name = strings::StrCat("float_", k);
+    const string int64_name = strings::StrCat("int64_", k);
+    AddDenseFeature(float_name.c_str(), DT_FLOAT, {kNumValues}, false,
+                    kNumValues, &config);
+    AddDenseFeature(int64_name.c_str(), DT_INT64, {kNumValues}, false,
+                    kNumValues, &config);
+    for (int j = 0; j < kNumValues; ++j) {
+      features[float_name].mutable_float_list()->add_value(j * 0.25f);
+      features[int64_name].mutable_int64_list()->add_value(j * 1000);
+    }
+  }
+  const std::vector<tstring> serialized(num_examples, Serialize(example));
+
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_examples);
+}
+
+BENCHMARK(BM_FastParseExampleFixedLengthDense)
+    ->ArgPair(0, 128)
+    ->ArgPair(1, 128)
+    ->ArgPair(0, 2048)
+    ->ArgPair(1, 2048);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -18,10 +18,15 @@ limitations under the License.
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
@@ -42,9 +47,12 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
@@ -76,6 +84,14 @@ const int64_t kLargeTensorThreshold = static_cast<int64_t>(1) << 32;
 const int kMaxFileReadThreads = 8;
 // Minimum size of a file section handled by each thread.
 const int64_t kMinSectionSize = static_cast<int64_t>(1) << 31;
+// Maximum number of bytes fetched by a single read of LookupMany(). Larger
+// entries are split into several reads.
+const int64_t kMaxCoalescedReadSize = 8 << 20;
+// Maximum number of unused bytes between two entries that LookupMany() fetches
+// with the same read.
+const int64_t kMaxCoalescedReadGap = 64 << 10;
+// Maximum number of reads that LookupMany() keeps in flight.
+const size_t kMaxReadsInFlight = 16;
 
 namespace {
 
@@ -402,6 +418,24 @@ table::Options TableBuilderOptions() {
   return o;
 }
 
+// Runs "fn(i)" for each i in [0, n) on "thread_pool", or on the calling
+// thread if "thread_pool" is nullptr, and waits for all of them to finish.
+void ParallelRun(thread::ThreadPool* thread_pool, int64_t n,
+                 const std::function<void(int64_t)>& fn) {
+  if (thread_pool == nullptr) {
+    for (int64_t i = 0; i < n; ++i) fn(i);
+    return;
+  }
+  BlockingCounter counter(n);
+  for (int64_t i = 0; i < n; ++i) {
+    thread_pool->Schedule([&fn, &counter, i]() {
+      fn(i);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
 // Writes zeros to output buffer to align the next write to the requested
 // alignment. "size" is the current size of the buffer and is updated to the
 // new size.
@@ -418,8 +452,183 @@ Status PadAlignment(FileOutputBuffer* out, int alignment, int64_t* size) {
   return status;
 }
 
+// Appends "val" to "out", whose current size is "*size", fills in the offset,
+// size and checksum of "entry", and pads the file to "alignment".
+Status WriteEntry(const Tensor& val, int alignment, FileOutputBuffer* out,
+                  int64_t* size, BundleEntryProto* entry) {
+  entry->set_offset(*size);
+
+  size_t data_bytes_written = 0;
+  uint32 crc32c = 0;
+  out->clear_crc32c();
+  if (val.dtype() == DT_STRING) {
+    TF_RETURN_IF_ERROR(
+        WriteStringTensor(val, out, &data_bytes_written, &crc32c));
+  } else if (val.dtype() == DT_VARIANT) {
+    TF_RETURN_IF_ERROR(
+        WriteVariantTensor(val, out, &data_bytes_written, &crc32c));
+  } else {
+    TF_RETURN_IF_ERROR(WriteTensor(val, out, &data_bytes_written));
+    crc32c = out->crc32c();
+  }
+
+  entry->set_size(data_bytes_written);
+  entry->set_crc32c(crc32c::Mask(crc32c));
+  *size += data_bytes_written;
+  return PadAlignment(out, alignment, size);
+}
+
+mutex pending_bundle_writes_mu(LINKER_INITIALIZED);
+
+// Maps each prefix to the most recent write started for it. Writes are removed
+// once waited for, so that an error is only reported to the first waiter and
+// does not fail every later save or restore of the prefix.
+std::unordered_map<string, std::shared_ptr<PendingBundleWrite>>*
+PendingBundleWrites() TF_EXCLUSIVE_LOCKS_REQUIRED(pending_bundle_writes_mu) {
+  static auto* pending_writes =
+      new std::unordered_map<string, std::shared_ptr<PendingBundleWrite>>();
+  return pending_writes;
+}
+
+// A read-only tensor buffer pointing into a memory-mapped data file. Holds a
+// reference on the mapping so that it outlives every tensor reading from it.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     uint64 offset, size_t size)
+      : TensorBuffer(const_cast<char*>(
+            static_cast<const char*>(region->data()) + offset)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+
+  TensorBuffer* root_buffer() override { return this; }
+
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(static_cast<int64_t>(size_));
+    proto->set_allocator_name("BundleReaderMappedFile");
+    proto->set_ptr(reinterpret_cast<uintptr_t>(data()));
+  }
+
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 }  // namespace
 
+class BundleWriter::ShardWriter {
+ public:
+  ShardWriter(Env* env, int32_t shard_id, const string& path,
+              std::unique_ptr<WritableFile> file, int data_alignment,
+              int64_t max_pending_bytes)
+      : shard_id_(shard_id),
+        path_(path),
+        data_alignment_(data_alignment),
+        max_pending_bytes_(max_pending_bytes),
+        out_(new FileOutputBuffer(file.release(), 8 << 20 /* 8MB */)) {
+    thread_.reset(env->StartThread(ThreadOptions(), "bundle_shard_writer",
+                                   [this]() { WriteLoop(); }));
+  }
+
+  ~ShardWriter() { Close().IgnoreError(); }
+
+  const string& path() const { return path_; }
+
+  // The number of bytes of the tensors added so far.
+  int64_t bytes_added() const { return bytes_added_; }
+
+  // Snapshots "val" and queues it to be written under "entry". Blocks while
+  // too many bytes are waiting to be written. Returns the first error of the
+  // previous writes.
+  Status Add(const Tensor& val, BundleEntryProto* entry) {
+    entry->set_shard_id(shard_id_);
+    // The caller may modify "val" once Add() returns, so it cannot be shared.
+    // See Options::num_shards for the cost.
+    Tensor snapshot = tensor::DeepCopy(val);
+    const int64_t bytes = snapshot.TotalBytes();
+    bytes_added_ += bytes;
+    mutex_lock l(mu_);
+    while (status_.ok() && !queue_.empty() &&
+           pending_bytes_ + bytes > max_pending_bytes_) {
+      cv_.wait(l);
+    }
+    TF_RETURN_IF_ERROR(status_);
+    queue_.emplace_back(std::move(snapshot), entry);
+    pending_bytes_ += bytes;
+    cv_.notify_all();
+    return OkStatus();
+  }
+
+  // Writes the queued tensors and closes the data file.
+  Status Close() {
+    if (thread_ != nullptr) {
+      {
+        mutex_lock l(mu_);
+        closing_ = true;
+        cv_.notify_all();
+      }
+      thread_.reset();
+      Status s = out_->Close();
+      mutex_lock l(mu_);
+      status_.Update(s);
+    }
+    mutex_lock l(mu_);
+    return status_;
+  }
+
+ private:
+  void WriteLoop() {
+    while (true) {
+      Tensor val;
+      BundleEntryProto* entry;
+      bool ok;
+      {
+        mutex_lock l(mu_);
+        while (queue_.empty() && !closing_) {
+          cv_.wait(l);
+        }
+        if (queue_.empty()) return;
+        val = std::move(queue_.front().first);
+        entry = queue_.front().second;
+        queue_.pop_front();
+        ok = status_.ok();
+      }
+      // Once a write fails, the remaining tensors are dropped.
+      Status s;
+      if (ok) {
+        s = WriteEntry(val, data_alignment_, out_.get(), &size_, entry);
+      }
+      mutex_lock l(mu_);
+      pending_bytes_ -= val.TotalBytes();
+      status_.Update(s);
+      cv_.notify_all();
+    }
+  }
+
+  const int32_t shard_id_;
+  const string path_;
+  const int data_alignment_;
+  const int64_t max_pending_bytes_;
+  int64_t bytes_added_ = 0;
+
+  // Only accessed by the write thread, and by Close() once it is joined.
+  const std::unique_ptr<FileOutputBuffer> out_;
+  int64_t size_ = 0;
+
+  mutex mu_;
+  condition_variable cv_;
+  std::deque<std::pair<Tensor, BundleEntryProto*>> queue_ TF_GUARDED_BY(mu_);
+  int64_t pending_bytes_ TF_GUARDED_BY(mu_) = 0;
+  bool closing_ TF_GUARDED_BY(mu_) = false;
+  Status status_ TF_GUARDED_BY(mu_);
+
+  std::unique_ptr<Thread> thread_;
+};
+
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
     : env_(env), options_(options), prefix_(prefix), out_(nullptr), size_(0) {
   status_ = env_->HasAtomicMove(prefix_, &use_temp_file_);
@@ -438,6 +647,24 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
     return;
   }
 
+  if (options_.num_shards > 1) {
+    for (int i = 0; i < options_.num_shards; ++i) {
+      string path = DataFilename(prefix_, i, options_.num_shards);
+      if (use_temp_file_) {
+        path = strings::StrCat(path, ".tempstate", random::New64());
+      }
+      std::unique_ptr<WritableFile> file;
+      status_ = env_->NewWritableFile(path, &file);
+      if (!status_.ok()) return;
+      shard_writers_.push_back(std::make_unique<ShardWriter>(
+          env_, i, path, std::move(file), options_.data_alignment,
+          options_.max_pending_bytes / options_.num_shards));
+    }
+    VLOG(1) << "Writing to " << options_.num_shards << " data files of "
+            << prefix_;
+    return;
+  }
+
   std::unique_ptr<WritableFile> wrapper;
   status_ = env_->NewWritableFile(data_path_, &wrapper);
   if (!status_.ok()) return;
@@ -459,31 +686,26 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
-  entry->set_shard_id(0);
-  entry->set_offset(size_);
 
   // Updates the data file.
-  size_t data_bytes_written = 0;
-  uint32 crc32c = 0;
-  out_->clear_crc32c();
-  if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
-    crc32c = out_->crc32c();
-  }
+  status_ = AddData(val, entry);
+  return status_;
+}
 
-  if (status_.ok()) {
-    entry->set_size(data_bytes_written);
-    entry->set_crc32c(crc32c::Mask(crc32c));
-    size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+Status BundleWriter::AddData(const Tensor& val, BundleEntryProto* entry) {
+  if (shard_writers_.empty()) {
+    entry->set_shard_id(0);
+    return WriteEntry(val, options_.data_alignment, out_.get(), &size_, entry);
   }
-  return status_;
+  ShardWriter* shard_writer =
+      absl::c_min_element(shard_writers_, [](const auto& a, const auto& b) {
+        return a->bytes_added() < b->bytes_added();
+      })->get();
+  return shard_writer->Add(val, entry);
 }
 
+BundleWriter::~BundleWriter() {}
+
 Status BundleWriter::AddSlice(StringPiece full_tensor_key,
                               const TensorShape& full_tensor_shape,
                               const TensorSlice& slice_spec,
@@ -540,6 +762,21 @@ Status BundleWriter::Finish() {
       Env::Default()->DeleteFile(data_path_).IgnoreError();
     }
   }
+  if (!shard_writers_.empty()) {
+    for (auto& shard_writer : shard_writers_) {
+      status_.Update(shard_writer->Close());
+    }
+    for (int i = 0; i < shard_writers_.size(); ++i) {
+      const string& path = shard_writers_[i]->path();
+      if (!status_.ok()) {
+        Env::Default()->DeleteFile(path).IgnoreError();
+      } else if (use_temp_file_) {
+        status_ = Env::Default()->RenameFile(
+            path, DataFilename(prefix_, i, shard_writers_.size()));
+      }
+    }
+    shard_writers_.clear();
+  }
   if (!status_.ok()) return status_;
   // Build key -> BundleEntryProto table.
   std::unique_ptr<WritableFile> file;
@@ -553,7 +790,7 @@ Status BundleWriter::Finish() {
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(std::max(options_.num_shards, 1));
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -580,6 +817,79 @@ Status BundleWriter::Finish() {
   return OkStatus();
 }
 
+std::shared_ptr<PendingBundleWrite> BundleWriter::FinishAsync(
+    std::unique_ptr<BundleWriter> writer) {
+  // The background threads are detached, so the writes still pending at exit
+  // would otherwise be cut short.
+  static const bool wait_at_exit TF_ATTRIBUTE_UNUSED = [] {
+    std::atexit([]() { WaitForAllPendingBundleWrites().IgnoreError(); });
+    return true;
+  }();
+  auto write = std::make_shared<PendingBundleWrite>();
+  std::shared_ptr<PendingBundleWrite> previous;
+  {
+    mutex_lock l(pending_bundle_writes_mu);
+    std::shared_ptr<PendingBundleWrite>& pending =
+        (*PendingBundleWrites())[writer->prefix_];
+    previous = std::move(pending);
+    pending = write;
+  }
+  Env* env = writer->env_;
+  // Released into a raw pointer, as std::function must be copyable.
+  BundleWriter* raw_writer = writer.release();
+  env->SchedClosure([raw_writer, write, previous]() {
+    std::unique_ptr<BundleWriter> writer(raw_writer);
+    if (previous != nullptr) {
+      previous->done_.WaitForNotification();
+    }
+    write->status_ = writer->Finish();
+    if (!write->status_.ok()) {
+      LOG(ERROR) << "Failed to write the tensor bundle at " << writer->prefix_
+                 << ": " << write->status_;
+    }
+    writer.reset();
+    write->done_.Notify();
+  });
+  return write;
+}
+
+Status WaitForPendingBundleWrites(StringPiece prefix) {
+  const string prefix_string(prefix);
+  std::shared_ptr<PendingBundleWrite> write;
+  {
+    mutex_lock l(pending_bundle_writes_mu);
+    auto it = PendingBundleWrites()->find(prefix_string);
+    if (it == PendingBundleWrites()->end()) return OkStatus();
+    write = it->second;
+  }
+  const Status status = write->Wait();
+  {
+    mutex_lock l(pending_bundle_writes_mu);
+    auto it = PendingBundleWrites()->find(prefix_string);
+    if (it != PendingBundleWrites()->end() && it->second == write) {
+      PendingBundleWrites()->erase(it);
+    }
+  }
+  return status;
+}
+
+Status WaitForAllPendingBundleWrites() {
+  // Each write waits for the previous one of its prefix, so waiting for the
+  // most recent write of each prefix waits for all of them.
+  std::vector<std::shared_ptr<PendingBundleWrite>> writes;
+  {
+    mutex_lock l(pending_bundle_writes_mu);
+    for (const auto& p : *PendingBundleWrites()) {
+      writes.push_back(p.second);
+    }
+  }
+  Status status;
+  for (const auto& write : writes) {
+    status.Update(write->Wait());
+  }
+  return status;
+}
+
 // Merging tensor bundles.
 
 // Accumulator of metadata states during a merge.
@@ -710,6 +1020,7 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
   if (!status.ok() && !errors::IsAlreadyExists(status)) return status;
   bool atleast_one_file_exists = false;
   for (auto& prefix : prefixes) {
+    TF_RETURN_IF_ERROR(WaitForPendingBundleWrites(prefix));
     if (!env->FileExists(MetaFilename(prefix)).ok()) {
       if (allow_missing_files) continue;
       return errors::InvalidArgument(
@@ -774,6 +1085,9 @@ BundleReader::BundleReader(
       iter_(nullptr),
       need_to_swap_bytes_(false),
       enable_multi_threading_for_testing_(enable_multi_threading_for_testing) {
+  status_ = WaitForPendingBundleWrites(prefix_);
+  if (!status_.ok()) return;
+
   const string filename = MetaFilename(prefix_);
   uint64 file_size;
   status_ = env_->GetFileSize(filename, &file_size);
@@ -865,6 +1179,21 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return OkStatus();
 }
 
+Status BundleReader::GetDataFile(int32_t shard_id,
+                                 io::InputBuffer** buffered_file) {
+  // Open the data file if it has not been opened.
+  io::InputBuffer*& data = data_[shard_id];
+  if (data == nullptr) {
+    std::unique_ptr<RandomAccessFile> file = nullptr;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &file));
+    data = new io::InputBuffer(file.release(), kBufferSize);
+    // The InputBuffer and RandomAccessFile objects are both released in dtor.
+  }
+  *buffered_file = data;
+  return OkStatus();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
@@ -894,17 +1223,8 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
   }
 
-  // Open the data file if it has not been opened.
-  io::InputBuffer* buffered_file = data_[entry.shard_id()];
-  if (buffered_file == nullptr) {
-    std::unique_ptr<RandomAccessFile> file = nullptr;
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file.release(), kBufferSize);
-    // The InputBuffer and RandomAccessFile objects are both released in dtor.
-    data_[entry.shard_id()] = buffered_file;
-  }
-  CHECK(buffered_file != nullptr);
+  io::InputBuffer* buffered_file;
+  TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
 
   TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
@@ -1020,6 +1340,222 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMapped(StringPiece key, Tensor* val,
+                                  bool verify_checksum) {
+  CHECK(val != nullptr);
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+
+  const TensorShape stored_shape(entry.shape());
+  if (!entry.slices().empty()) {
+    *val = Tensor(entry.dtype(), stored_shape);
+    return GetSliceValue(key, entry,
+                         /* a full slice */ TensorSlice(stored_shape.dims()),
+                         val);
+  }
+  bool mapped = false;
+  TF_RETURN_IF_ERROR(GetMappedValue(entry, verify_checksum, val, &mapped));
+  if (mapped) {
+    return OkStatus();
+  }
+  *val = Tensor(entry.dtype(), stored_shape);
+  return GetValue(entry, val);
+}
+
+Status BundleReader::LookupMany(gtl::ArraySlice<StringPiece> keys,
+                                gtl::ArraySlice<Tensor*> vals,
+                                thread::ThreadPool* thread_pool) {
+  CHECK_EQ(keys.size(), vals.size());
+  // An entry restored by the parallel reads.
+  struct ParallelEntry {
+    BundleEntryProto entry;
+    RandomAccessFile* file;
+    char* data;
+    Tensor* val;
+  };
+  std::vector<ParallelEntry> parallel_entries;
+  parallel_entries.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    CHECK(vals[i] != nullptr);
+    BundleEntryProto entry;
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &entry));
+    if (!entry.slices().empty()) {
+      TF_RETURN_IF_ERROR(GetSliceValue(
+          keys[i], entry,
+          /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()),
+          vals[i]));
+      continue;
+    }
+    if (!DataTypeCanUseMemcpy(entry.dtype())) {
+      TF_RETURN_IF_ERROR(GetValue(entry, vals[i]));
+      continue;
+    }
+    if (vals[i]->NumElements() == 0) {
+      *vals[i] = Tensor(entry.dtype(), TensorShape(entry.shape()));
+    }
+    if (entry.size() != vals[i]->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", keys[i],
+                              "; stored size ", entry.size(),
+                              "; expected size ", vals[i]->TotalBytes());
+    }
+    io::InputBuffer* buffered_file;
+    TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
+    char* data = const_cast<char*>(vals[i]->tensor_data().data());
+    parallel_entries.push_back(
+        {std::move(entry), buffered_file->file(), data, vals[i]});
+  }
+
+  // Plans the reads: walks the entries in file order, merging neighbors into
+  // reads of at most kMaxCoalescedReadSize bytes, and splitting entries larger
+  // than that into several reads straight into their tensors.
+  struct ReadRequest {
+    RandomAccessFile* file = nullptr;
+    uint64 offset = 0;
+    size_t size = 0;
+    // If set, the bytes are read straight into "target". Otherwise they are
+    // read into a temporary buffer and copied to "entries".
+    char* target = nullptr;
+    std::vector<const ParallelEntry*> entries;
+  };
+  std::vector<const ParallelEntry*> sorted_entries;
+  sorted_entries.reserve(parallel_entries.size());
+  for (const ParallelEntry& e : parallel_entries) {
+    if (e.entry.size() > 0) sorted_entries.push_back(&e);
+  }
+  absl::c_sort(sorted_entries,
+               [](const ParallelEntry* a, const ParallelEntry* b) {
+                 if (a->entry.shard_id() != b->entry.shard_id()) {
+                   return a->entry.shard_id() < b->entry.shard_id();
+                 }
+                 return a->entry.offset() < b->entry.offset();
+               });
+  std::vector<ReadRequest> reads;
+  ReadRequest group;
+  auto flush_group = [&reads, &group]() {
+    if (group.entries.empty()) return;
+    if (group.entries.size() == 1) {
+      group.target = group.entries[0]->data;
+      group.entries.clear();
+    }
+    reads.push_back(std::move(group));
+    group = ReadRequest();
+  };
+  for (const ParallelEntry* e : sorted_entries) {
+    const uint64 offset = e->entry.offset();
+    const uint64 end = offset + e->entry.size();
+    if (e->entry.size() >= kMaxCoalescedReadSize) {
+      flush_group();
+      for (uint64 chunk = 0; chunk < e->entry.size();
+           chunk += kMaxCoalescedReadSize) {
+        ReadRequest read;
+        read.file = e->file;
+        read.offset = offset + chunk;
+        read.size =
+            std::min<uint64>(kMaxCoalescedReadSize, e->entry.size() - chunk);
+        read.target = e->data + chunk;
+        reads.push_back(std::move(read));
+      }
+      continue;
+    }
+    const uint64 group_end = group.offset + group.size;
+    if (group.entries.empty() || group.file != e->file ||
+        offset > group_end + kMaxCoalescedReadGap ||
+        std::max(end, group_end) - group.offset > kMaxCoalescedReadSize) {
+      flush_group();
+      group.file = e->file;
+      group.offset = offset;
+    }
+    group.size = std::max(end, group.offset + group.size) - group.offset;
+    group.entries.push_back(e);
+  }
+  flush_group();
+
+  // Issues the reads through ReadAsync(), keeping up to kMaxReadsInFlight of
+  // them in flight. Files that read asynchronously (e.g. with io_uring)
+  // overlap them without blocking a thread each. Files that read
+  // synchronously block a thread of "thread_pool" (or the calling thread) for
+  // each read instead, as with Read().
+  std::vector<Status> statuses(reads.size());
+  std::vector<std::unique_ptr<char[]>> buffers(reads.size());
+  mutex mu;
+  condition_variable cond_var;
+  size_t num_in_flight = 0;  // Guarded by "mu".
+  auto read_done = [&](size_t i, const Status& status, StringPiece sp) {
+    const ReadRequest& read = reads[i];
+    statuses[i] = status;
+    if (status.ok()) {
+      if (read.target != nullptr) {
+        if (sp.data() != read.target) {
+          memmove(read.target, sp.data(), read.size);
+        }
+      } else {
+        for (const ParallelEntry* e : read.entries) {
+          memcpy(e->data, sp.data() + (e->entry.offset() - read.offset),
+                 e->entry.size());
+        }
+      }
+    }
+    buffers[i].reset();
+    mutex_lock l(mu);
+    --num_in_flight;
+    cond_var.notify_all();
+  };
+  auto start_read = [&](size_t i) {
+    const ReadRequest& read = reads[i];
+    char* scratch = read.target;
+    if (scratch == nullptr) {
+      buffers[i].reset(new char[read.size]);
+      scratch = buffers[i].get();
+    }
+    read.file->ReadAsync(read.offset, read.size, scratch,
+                         [&read_done, i](const Status& status, StringPiece sp) {
+                           read_done(i, status, sp);
+                         });
+  };
+  for (size_t i = 0; i < reads.size(); ++i) {
+    {
+      mutex_lock l(mu);
+      while (num_in_flight >= kMaxReadsInFlight) cond_var.wait(l);
+      ++num_in_flight;
+    }
+    if (thread_pool == nullptr) {
+      start_read(i);
+    } else {
+      thread_pool->Schedule([&start_read, i]() { start_read(i); });
+    }
+  }
+  {
+    mutex_lock l(mu);
+    while (num_in_flight > 0) cond_var.wait(l);
+  }
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  statuses.assign(parallel_entries.size(), OkStatus());
+  ParallelRun(thread_pool, parallel_entries.size(), [&](int64_t i) {
+    const ParallelEntry& e = parallel_entries[i];
+    // Note that we compute the checksum *before* byte-swapping. The checksum
+    // should be on the bytes in the order they appear in the file.
+    const uint32 actual_crc32c = crc32c::Value(e.data, e.entry.size());
+    if (crc32c::Unmask(e.entry.crc32c()) != actual_crc32c) {
+      statuses[i] = errors::DataLoss(
+          "TensorBundle at ", prefix_, " shard ", e.entry.shard_id(), " (",
+          e.entry.size(), " bytes): Checksum does not match: stored ",
+          strings::Printf("%08u", crc32c::Unmask(e.entry.crc32c())),
+          " vs. calculated on the restored bytes ", actual_crc32c);
+      return;
+    }
+    if (need_to_swap_bytes_) {
+      statuses[i] = ByteSwapTensor(e.val);
+    }
+  });
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return OkStatus();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1038,6 +1574,103 @@ Status BundleReader::ReadCurrent(Tensor* val) {
   }
 }
 
+Status BundleReader::ReadCurrentMapped(Tensor* val) {
+  CHECK(val != nullptr);
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(ParseEntryProto(iter_->key(), iter_->value(), &entry));
+  if (!TensorShape::IsValid(entry.shape())) {
+    return errors::DataLoss("Invalid tensor shape: ", iter_->key(), " ",
+                            entry.shape().ShortDebugString());
+  }
+
+  if (!entry.slices().empty()) {
+    return GetSliceValue(
+        iter_->key(), entry,
+        /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()), val);
+  }
+  bool mapped = false;
+  TF_RETURN_IF_ERROR(
+      GetMappedValue(entry, /*verify_checksum=*/true, val, &mapped));
+  if (mapped) {
+    return OkStatus();
+  }
+  return GetValue(entry, val);
+}
+
+Status BundleReader::GetMappedDataFile(
+    int32_t shard_id, std::shared_ptr<ReadOnlyMemoryRegion>* region) {
+  auto it = mapped_data_.find(shard_id);
+  if (it != mapped_data_.end()) {
+    *region = it->second;
+    return OkStatus();
+  }
+  const string filename = DataFilename(prefix_, shard_id, num_shards_);
+  std::unique_ptr<ReadOnlyMemoryRegion> new_region;
+  Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &new_region);
+  if (errors::IsUnimplemented(s)) {
+    VLOG(1) << "Memory mapping is not supported for " << filename
+            << ", falling back to copying reads: " << s;
+    new_region.reset();
+  } else if (!s.ok()) {
+    return s;
+  }
+  *region = std::shared_ptr<ReadOnlyMemoryRegion>(std::move(new_region));
+  mapped_data_[shard_id] = *region;
+  return OkStatus();
+}
+
+Status BundleReader::GetMappedValue(const BundleEntryProto& entry,
+                                    bool verify_checksum, Tensor* val,
+                                    bool* mapped) {
+  *mapped = false;
+  // Only tensors whose in-memory representation matches the bytes stored in
+  // the data file can be served from a mapping. Tensor buffers must also
+  // satisfy the alignment that Eigen expects.
+  if (!DataTypeCanUseMemcpy(entry.dtype()) || need_to_swap_bytes_ ||
+      entry.size() == 0 || entry.offset() % EIGEN_MAX_ALIGN_BYTES != 0) {
+    return OkStatus();
+  }
+  const TensorShape stored_shape(entry.shape());
+  const uint64 expected_size =
+      stored_shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                            "; stored size ", entry.size(),
+                            "; expected size ", expected_size);
+  }
+
+  std::shared_ptr<ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(GetMappedDataFile(entry.shard_id(), &region));
+  if (region == nullptr) {
+    return OkStatus();
+  }
+  if (entry.offset() + entry.size() > region->length()) {
+    return errors::DataLoss("TensorBundle at ", prefix_, " shard ",
+                            entry.shard_id(), ": entry for key ", key(),
+                            " at offset ", entry.offset(), " (", entry.size(),
+                            " bytes) exceeds the file size ", region->length());
+  }
+
+  if (verify_checksum) {
+    const char* data =
+        static_cast<const char*>(region->data()) + entry.offset();
+    const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+    if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+      return errors::DataLoss(
+          "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
+          entry.size(), " bytes): Checksum does not match: stored ",
+          strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+          " vs. calculated on the mapped bytes ", actual_crc32c);
+    }
+  }
+
+  core::RefCountPtr<TensorBuffer> buffer(
+      new MappedTensorBuffer(std::move(region), entry.offset(), entry.size()));
+  *val = Tensor(entry.dtype(), stored_shape, std::move(buffer));
+  *mapped = true;
+  return OkStatus();
+}
+
 Status BundleReader::LookupTensorSlices(StringPiece key,
                                         std::vector<TensorSlice>* slices) {
   slices->clear();
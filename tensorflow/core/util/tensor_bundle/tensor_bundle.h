@@ -62,8 +62,10 @@ limitations under the License.
 #define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
@@ -72,6 +74,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/cache.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
@@ -80,6 +83,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
@@ -103,6 +107,26 @@ extern const int kTensorBundleVersion;
 // corresponding value is a BundleHeaderProto.
 extern const char* const kHeaderEntryKey;
 
+// A BundleWriter being finished in the background by
+// BundleWriter::FinishAsync().
+class PendingBundleWrite {
+ public:
+  // Blocks until the write is done and returns the status of its Finish().
+  Status Wait() {
+    done_.WaitForNotification();
+    return status_;
+  }
+
+  // Returns true if the write is done.
+  bool IsDone() const { return done_.HasBeenNotified(); }
+
+ private:
+  friend class BundleWriter;
+
+  Notification done_;
+  Status status_;  // Set before "done_" is notified.
+};
+
 // Builds a string-string table of tensor names to BundleEntryProto (metadata).
 //
 // On construction, attempts to create a directory given by the dirname of
@@ -116,12 +140,30 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Number of data files the tensors are spread over. With the default of 1,
+    // Add() serializes and writes each tensor before returning. With more,
+    // Add() only snapshots the tensor into a host buffer and assigns it to the
+    // data file with the fewest bytes; each data file is then serialized,
+    // checksummed and written by its own background thread.
+    //
+    // The snapshot is a deep copy, as the caller may modify the tensor (e.g.
+    // a variable updated by the next training step) once Add() returns. It
+    // costs a memcpy of the tensor on the calling thread, and up to
+    // max_pending_bytes of host memory.
+    int num_shards{1};
+    // With num_shards > 1, the maximum number of snapshotted bytes waiting to
+    // be written. Add() blocks while it is exceeded.
+    int64_t max_pending_bytes{int64_t{1} << 30};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
+  ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
+  //
+  // With num_shards > 1, errors writing "val" may only be returned by a later
+  // call or by Finish().
   Status Add(StringPiece key, const Tensor& val);
 
   // Partitioned variables support.
@@ -147,9 +189,26 @@ class BundleWriter {
   // Finishes the writer and flushes.
   Status Finish() TF_MUST_USE_RESULT;
 
+  // Finishes "writer" on a background thread and returns immediately, with a
+  // handle to wait for the write and get its status. Until it is done,
+  // WaitForPendingBundleWrites() on the writer's prefix blocks, and so do
+  // BundleReader's constructor and MergeBundles() on that prefix. A later
+  // FinishAsync() on the same prefix finishes after this one. The writes
+  // still pending when the process exits are waited for at exit.
+  static std::shared_ptr<PendingBundleWrite> FinishAsync(
+      std::unique_ptr<BundleWriter> writer);
+
   Status status() const { return status_; }
 
  private:
+  // Serializes and writes the tensors of one data file from a background
+  // thread. Used when options_.num_shards > 1.
+  class ShardWriter;
+
+  // Adds the data of "val" to the data files and fills in the location,
+  // size and checksum of "entry".
+  Status AddData(const Tensor& val, BundleEntryProto* entry);
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
@@ -158,12 +217,25 @@ class BundleWriter {
   bool use_temp_file_;
   std::unique_ptr<FileOutputBuffer> out_;
   int64_t size_;  // Number of bytes written into out_.
+  // Used instead of "out_" when options_.num_shards > 1.
+  std::vector<std::unique_ptr<ShardWriter>> shard_writers_;
   std::map<string, BundleEntryProto> entries_;
   Status status_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
 };
 
+// Blocks until the writes started by BundleWriter::FinishAsync() for "prefix"
+// are done, and returns the status of the most recent one. Returns OK if there
+// are none. A failed write is reported once: later calls return OK until
+// another write is started.
+Status WaitForPendingBundleWrites(StringPiece prefix);
+
+// Blocks until all the writes started by BundleWriter::FinishAsync() are done,
+// and returns the first error among the most recent write of each prefix.
+// Unlike WaitForPendingBundleWrites(), does not consume the errors.
+Status WaitForAllPendingBundleWrites();
+
 // Merges a set of bundles (given their prefixes) into a single bundle with the
 // given "merged_prefix".  The merged metadata is guaranteed to be consistent.
 //
@@ -246,6 +318,40 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Like Lookup(), but avoids copying the tensor contents when possible, as
+  // described for ReadCurrentMapped(). Unlike Lookup(), "val" is replaced by a
+  // tensor of the stored dtype and shape, so it need not be allocated first.
+  //
+  // Meant for read-only serving: the mapped bytes are shared with the page
+  // cache, so loading is cheap, processes mapping the same bundle share the
+  // memory, and unused weights can be paged out. Tensors backed by the
+  // mapping must not be mutated.
+  //
+  // If "verify_checksum" is true, the stored crc32c checksum is validated
+  // against the mapped bytes, which reads (and faults in) every page of the
+  // tensor up front. If false, mapped tensors are not checked, so loading
+  // touches none of their pages, but a corrupted data file goes undetected.
+  // Tensors that are read with a copy are always checked.
+  // REQUIRES: status().ok()
+  Status LookupMapped(StringPiece key, Tensor* val,
+                      bool verify_checksum = true) TF_MUST_USE_RESULT;
+
+  // Looks up the tensors keyed by "keys" into the corresponding "vals", with
+  // the same semantics as calling Lookup() on each pair.
+  //
+  // Non-partitioned tensors of memcpy-able dtypes are restored in parallel on
+  // "thread_pool": their entries are grouped by data file and sorted by
+  // offset, neighboring entries are fetched with one coalesced read, large
+  // entries are split into several reads, and the checksums are validated on
+  // the pool as well. All other tensors are read serially with Lookup(). If
+  // "thread_pool" is nullptr, all reads run on the calling thread.
+  //
+  // On error, "vals" may contain nonsense data.
+  // REQUIRES: status().ok() && keys.size() == vals.size()
+  Status LookupMany(gtl::ArraySlice<StringPiece> keys,
+                    gtl::ArraySlice<Tensor*> vals,
+                    thread::ThreadPool* thread_pool) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -254,6 +360,22 @@ class BundleReader {
   // REQUIRES: status().ok() && Valid()
   Status ReadCurrent(Tensor* val) TF_MUST_USE_RESULT;
 
+  // Like ReadCurrent(), but avoids copying the tensor contents when possible.
+  //
+  // If the current entry holds a non-partitioned tensor of a memcpy-able dtype
+  // whose data is aligned to EIGEN_MAX_ALIGN_BYTES in its data file, "val" is
+  // replaced by a tensor backed directly by a read-only memory mapping of the
+  // data file. The mapping is shared by all tensors read from the same data
+  // file and stays alive for as long as any of them does. Otherwise (and on
+  // file systems that do not support memory mapping) this falls back to
+  // ReadCurrent().
+  //
+  // Tensors backed by the mapping must not be mutated.
+  //
+  // Validates the stored crc32c checksum against the mapped bytes.
+  // REQUIRES: status().ok() && Valid()
+  Status ReadCurrentMapped(Tensor* val) TF_MUST_USE_RESULT;
+
   // Looks up the slices of the tensor keyed by "key".  On OK, "slices"
   // is non-empty if and only if the tensor is a partitioned tensor.
   //
@@ -297,11 +419,29 @@ class BundleReader {
   Status GetBundleEntryProto(StringPiece key,
                              BundleEntryProto* entry) TF_MUST_USE_RESULT;
 
+  // Returns the buffered reader of data file "shard_id", opening the file if
+  // it has not been opened yet.
+  Status GetDataFile(int32_t shard_id,
+                     io::InputBuffer** buffered_file) TF_MUST_USE_RESULT;
+
   // Reads the tensor value described by the metadata proto "entry".
   // Usage for "val" follows the comment of "Lookup()".
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Reads the tensor value described by "entry" as a tensor backed by a
+  // memory mapping of its data file, validating its checksum if
+  // "verify_checksum" is true. Sets "*mapped" to false and leaves "val"
+  // untouched if the entry cannot be served from a mapping.
+  Status GetMappedValue(const BundleEntryProto& entry, bool verify_checksum,
+                        Tensor* val, bool* mapped) TF_MUST_USE_RESULT;
+
+  // Returns the memory mapping of data file "shard_id" in "region", or nullptr
+  // if the file system does not support memory mapping.
+  Status GetMappedDataFile(int32_t shard_id,
+                           std::shared_ptr<ReadOnlyMemoryRegion>* region)
+      TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -320,6 +460,11 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Memory mappings of the data files, created on demand by
+  // ReadCurrentMapped(). A null entry means that the data file cannot be
+  // mapped.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
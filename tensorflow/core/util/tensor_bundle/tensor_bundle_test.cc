@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -1201,6 +1202,270 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST(TensorBundleTest, ReadCurrentMapped) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("mapped"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int64_t>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<tstring>("two")));
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<double>(3)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("mapped"));
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  reader.Seek("foo_000");
+  TF_ASSERT_OK(reader.ReadCurrentMapped(&val));
+  test::ExpectTensorEqual<float>(val, Constant_2x3<float>(0));
+  reader.Next();
+  TF_ASSERT_OK(reader.ReadCurrentMapped(&val));
+  test::ExpectTensorEqual<int64_t>(val, Constant_2x3<int64_t>(1));
+  // String tensors cannot be mapped and are read with a copy instead.
+  reader.Next();
+  TF_ASSERT_OK(reader.ReadCurrentMapped(&val));
+  test::ExpectTensorEqual<tstring>(val, Constant_2x3<tstring>("two"));
+  reader.Next();
+  TF_ASSERT_OK(reader.ReadCurrentMapped(&val));
+  test::ExpectTensorEqual<double>(val, Constant_100x100<double>(3));
+
+  // Reading the same entry twice returns tensors sharing the mapped bytes.
+  Tensor other;
+  TF_ASSERT_OK(reader.ReadCurrentMapped(&other));
+  EXPECT_EQ(val.tensor_data().data(), other.tensor_data().data());
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(val.tensor_data().data()) %
+                   EIGEN_MAX_ALIGN_BYTES);
+}
+
+TEST(TensorBundleTest, LookupMapped) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("lookup_mapped"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_100x100<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<tstring>("one")));
+    TF_EXPECT_OK(writer.AddSlice("foo_002", TensorShape({5, 10}),
+                                 TensorSlice::ParseOrDie("-:0,1"),
+                                 Constant<float>(2, TensorShape({5, 1}))));
+    TF_EXPECT_OK(writer.AddSlice("foo_002", TensorShape({5, 10}),
+                                 TensorSlice::ParseOrDie("-:1,9"),
+                                 Constant<float>(2, TensorShape({5, 9}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("lookup_mapped"));
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  TF_ASSERT_OK(reader.LookupMapped("foo_000", &val));
+  test::ExpectTensorEqual<float>(val, Constant_100x100<float>(0));
+  Tensor other;
+  TF_ASSERT_OK(reader.LookupMapped("foo_000", &other));
+  EXPECT_EQ(val.tensor_data().data(), other.tensor_data().data());
+  // String and partitioned tensors are read with a copy.
+  TF_ASSERT_OK(reader.LookupMapped("foo_001", &val));
+  test::ExpectTensorEqual<tstring>(val, Constant_2x3<tstring>("one"));
+  TF_ASSERT_OK(reader.LookupMapped("foo_002", &val));
+  test::ExpectTensorEqual<float>(val, Constant<float>(2, TensorShape({5, 10})));
+  EXPECT_TRUE(errors::IsNotFound(reader.LookupMapped("bar", &val)));
+}
+
+TEST(TensorBundleTest, LookupMappedChecksum) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("mapped_checksum"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_100x100<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  // Corrupts the first byte of the tensor.
+  const string datafile = DataFilename(Prefix("mapped_checksum"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+
+  BundleReader reader(Env::Default(), Prefix("mapped_checksum"));
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  EXPECT_TRUE(errors::IsDataLoss(reader.LookupMapped("foo", &val)));
+  // Without verification, the corruption goes undetected.
+  TF_EXPECT_OK(reader.LookupMapped("foo", &val, /*verify_checksum=*/false));
+  EXPECT_EQ(val.flat<float>()(1), 1);
+}
+
+TEST(TensorBundleTest, ReadCurrentMappedUnaligned) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("unaligned"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant(true, TensorShape({3}))));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  // The second tensor is not aligned, so it is read with a copy.
+  BundleReader reader(Env::Default(), Prefix("unaligned"));
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  reader.Seek("foo_001");
+  TF_ASSERT_OK(reader.ReadCurrentMapped(&val));
+  test::ExpectTensorEqual<float>(val, Constant_2x3<float>(1));
+}
+
+TEST(TensorBundleTest, LookupMany) {
+  const TensorShape kFullShape({5, 10});
+  // Large enough to be split into several reads.
+  const TensorShape kLargeShape({3 << 20});
+  {
+    BundleWriter writer(Env::Default(), Prefix("many"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int64_t>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<tstring>("two")));
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<double>(3)));
+    TF_EXPECT_OK(writer.Add("foo_004", Constant<float>(4, kLargeShape)));
+    TF_EXPECT_OK(writer.Add("foo_005", Constant<int32>(5, TensorShape({0}))));
+    TF_EXPECT_OK(writer.AddSlice("foo_006", kFullShape,
+                                 TensorSlice::ParseOrDie("-:0,10"),
+                                 Constant<float>(6, kFullShape)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  for (thread::ThreadPool* pool : {&thread_pool, {}}) {
+    BundleReader reader(Env::Default(), Prefix("many"));
+    TF_ASSERT_OK(reader.status());
+    // Not in file order, with one uninitialized output.
+    std::vector<StringPiece> keys = {"foo_006", "foo_003", "foo_000",
+                                     "foo_004", "foo_002", "foo_005",
+                                     "foo_001"};
+    std::vector<Tensor> vals = {
+        Tensor(DT_FLOAT, kFullShape),     Tensor(DT_DOUBLE, {100, 100}),
+        Tensor(),                         Tensor(DT_FLOAT, kLargeShape),
+        Tensor(DT_STRING, {2, 3}),        Tensor(DT_INT32, {0}),
+        Tensor(DT_INT64, {2, 3})};
+    std::vector<Tensor*> val_ptrs;
+    for (Tensor& val : vals) val_ptrs.push_back(&val);
+    TF_ASSERT_OK(reader.LookupMany(keys, val_ptrs, pool));
+    test::ExpectTensorEqual<float>(vals[0], Constant<float>(6, kFullShape));
+    test::ExpectTensorEqual<double>(vals[1], Constant_100x100<double>(3));
+    test::ExpectTensorEqual<float>(vals[2], Constant_2x3<float>(0));
+    test::ExpectTensorEqual<float>(vals[3], Constant<float>(4, kLargeShape));
+    test::ExpectTensorEqual<tstring>(vals[4], Constant_2x3<tstring>("two"));
+    EXPECT_EQ(vals[5].NumElements(), 0);
+    test::ExpectTensorEqual<int64_t>(vals[6], Constant_2x3<int64_t>(1));
+
+    Tensor missing(DT_FLOAT, {2, 3});
+    Tensor* missing_ptr = &missing;
+    EXPECT_TRUE(errors::IsNotFound(
+        reader.LookupMany({"bar"}, {missing_ptr}, pool)));
+  }
+}
+
+TEST(TensorBundleTest, ShardedWriter) {
+  BundleWriter::Options opts;
+  opts.num_shards = 3;
+  opts.data_alignment = 8;
+  // Small enough for Add() to block on the background writes.
+  opts.max_pending_bytes = 1 << 10;
+  Tensor mutated = Constant_100x100<float>(1);
+  {
+    BundleWriter writer(Env::Default(), Prefix("sharded"), opts);
+    TF_ASSERT_OK(writer.status());
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", mutated));
+    // The writer snapshots the tensor in Add().
+    mutated.flat<float>().setConstant(-1);
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<tstring>("two")));
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_100x100<double>(3)));
+    TF_EXPECT_OK(writer.AddSlice("foo_004", TensorShape({5, 10}),
+                                 TensorSlice::ParseOrDie("-:0,1"),
+                                 Constant<float>(4, TensorShape({5, 1}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  for (int i = 0; i < 3; ++i) {
+    TF_EXPECT_OK(
+        Env::Default()->FileExists(DataFilename(Prefix("sharded"), i, 3)));
+  }
+  BundleReader reader(Env::Default(), Prefix("sharded"));
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "foo_000", Constant_2x3<float>(0));
+  Expect<float>(&reader, "foo_001", Constant_100x100<float>(1));
+  Expect<tstring>(&reader, "foo_002", Constant_2x3<tstring>("two"));
+  Expect<double>(&reader, "foo_003", Constant_100x100<double>(3));
+  Tensor slice(DT_FLOAT, TensorShape({5, 1}));
+  TF_ASSERT_OK(reader.LookupSlice(
+      "foo_004", TensorSlice::ParseOrDie("-:0,1"), &slice));
+  test::ExpectTensorEqual<float>(slice,
+                                Constant<float>(4, TensorShape({5, 1})));
+}
+
+TEST(TensorBundleTest, FinishAsync) {
+  BundleWriter::Options opts;
+  opts.num_shards = 2;
+  for (int i = 0; i < 3; ++i) {
+    auto writer = std::make_unique<BundleWriter>(Env::Default(),
+                                                 Prefix("async"), opts);
+    TF_ASSERT_OK(writer->status());
+    TF_EXPECT_OK(writer->Add("foo", Constant_100x100<float>(i)));
+    BundleWriter::FinishAsync(std::move(writer));
+  }
+  // Waits for the writes, which finish in order.
+  BundleReader reader(Env::Default(), Prefix("async"));
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "foo", Constant_100x100<float>(2));
+  TF_EXPECT_OK(WaitForPendingBundleWrites(Prefix("async")));
+  TF_EXPECT_OK(WaitForPendingBundleWrites(Prefix("never_written")));
+}
+
+TEST(TensorBundleTest, FinishAsyncHandle) {
+  BundleWriter::Options opts;
+  opts.num_shards = 2;
+  std::vector<std::shared_ptr<PendingBundleWrite>> writes;
+  for (int i = 0; i < 3; ++i) {
+    auto writer = std::make_unique<BundleWriter>(
+        Env::Default(), Prefix(strings::StrCat("async_handle", i)), opts);
+    TF_ASSERT_OK(writer->status());
+    TF_EXPECT_OK(writer->Add("foo", Constant_100x100<float>(i)));
+    writes.push_back(BundleWriter::FinishAsync(std::move(writer)));
+  }
+  TF_EXPECT_OK(writes[0]->Wait());
+  EXPECT_TRUE(writes[0]->IsDone());
+  TF_EXPECT_OK(WaitForAllPendingBundleWrites());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(writes[i]->IsDone());
+    BundleReader reader(Env::Default(),
+                        Prefix(strings::StrCat("async_handle", i)));
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo", Constant_100x100<float>(i));
+  }
+}
+
+TEST(TensorBundleTest, FinishAsyncFailure) {
+  const string dir = Prefix("async_failure");
+  const string prefix = io::JoinPath(dir, "bundle");
+  BundleWriter::Options opts;
+  opts.num_shards = 2;
+  auto writer = std::make_unique<BundleWriter>(Env::Default(), prefix, opts);
+  TF_ASSERT_OK(writer->status());
+  TF_EXPECT_OK(writer->Add("foo", Constant_2x3<float>(1)));
+  // Makes renaming the data files fail.
+  int64_t undeleted_files, undeleted_dirs;
+  TF_ASSERT_OK(Env::Default()->DeleteRecursively(dir, &undeleted_files,
+                                                 &undeleted_dirs));
+  std::shared_ptr<PendingBundleWrite> write =
+      BundleWriter::FinishAsync(std::move(writer));
+  EXPECT_FALSE(WaitForPendingBundleWrites(prefix).ok());
+  // The handle reports the error too.
+  EXPECT_TRUE(write->IsDone());
+  EXPECT_FALSE(write->Wait().ok());
+  // The error is reported once, and does not fail later writes of the prefix.
+  TF_EXPECT_OK(WaitForPendingBundleWrites(prefix));
+  {
+    BundleWriter writer(Env::Default(), prefix);
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3<float>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "foo", Constant_2x3<float>(2));
+}
+
 static void BM_BundleAlignment(::testing::benchmark::State& state) {
   {
     const int alignment = state.range(0);
@@ -1227,6 +1492,83 @@ BENCHMARK(BM_BundleAlignment)->ArgPair(4096, 512);
 BENCHMARK(BM_BundleAlignment)->ArgPair(4096, 4096);
 BENCHMARK(BM_BundleAlignment)->ArgPair(4096, 1048576);
 
+static void BM_BundleReadCurrent(::testing::benchmark::State& state) {
+  const bool mapped = state.range(0);
+  const int tensor_size = state.range(1);
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    TF_CHECK_OK(writer.Add("big", Constant(32.1, TensorShape({tensor_size}))));
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader reader(Env::Default(), Prefix("foo"));
+  TF_CHECK_OK(reader.status());
+  reader.Seek("big");
+  for (auto s : state) {
+    Tensor t;
+    if (mapped) {
+      TF_CHECK_OK(reader.ReadCurrentMapped(&t));
+    } else {
+      TF_CHECK_OK(reader.ReadCurrent(&t));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * tensor_size * sizeof(double));
+}
+
+BENCHMARK(BM_BundleReadCurrent)->ArgPair(0, 4096);
+BENCHMARK(BM_BundleReadCurrent)->ArgPair(0, 1048576);
+BENCHMARK(BM_BundleReadCurrent)->ArgPair(1, 4096);
+BENCHMARK(BM_BundleReadCurrent)->ArgPair(1, 1048576);
+
+static void BM_BundleLookupMany(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const int num_tensors = state.range(1);
+  const int tensor_size = state.range(2);
+  std::vector<string> keys;
+  {
+    BundleWriter writer(Env::Default(), Prefix("foo"));
+    for (int i = 0; i < num_tensors; ++i) {
+      keys.push_back(strings::StrCat("tensor_", i));
+      TF_CHECK_OK(
+          writer.Add(keys.back(), Constant(32.1f, TensorShape({tensor_size}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  std::unique_ptr<thread::ThreadPool> thread_pool;
+  if (num_threads > 0) {
+    thread_pool = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "restore", num_threads);
+  }
+  std::vector<StringPiece> key_pieces(keys.begin(), keys.end());
+  for (auto s : state) {
+    BundleReader reader(Env::Default(), Prefix("foo"));
+    TF_CHECK_OK(reader.status());
+    std::vector<Tensor> vals(num_tensors,
+                             Tensor(DT_FLOAT, TensorShape({tensor_size})));
+    std::vector<Tensor*> val_ptrs;
+    for (Tensor& val : vals) val_ptrs.push_back(&val);
+    if (thread_pool == nullptr) {
+      // The serial baseline.
+      for (int i = 0; i < num_tensors; ++i) {
+        TF_CHECK_OK(reader.Lookup(keys[i], val_ptrs[i]));
+      }
+    } else {
+      TF_CHECK_OK(reader.LookupMany(key_pieces, val_ptrs, thread_pool.get()));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * num_tensors * tensor_size *
+                          sizeof(float));
+}
+
+BENCHMARK(BM_BundleLookupMany)
+    ->Args({0, 1000, 1024})
+    ->Args({8, 1000, 1024})
+    ->Args({0, 64, 1 << 20})
+    ->Args({8, 64, 1 << 20})
+    ->Args({0, 4, 16 << 20})
+    ->Args({8, 4, 16 << 20});
+
 static void BM_BundleWriterSmallTensor(::testing::benchmark::State& state) {
   const int64_t bytes = state.range(0);
   Tensor t = Constant(static_cast<int8>('a'), TensorShape{bytes});
@@ -1252,4 +1594,23 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+static void BM_BundleWriterSharded(::testing::benchmark::State& state) {
+  const int num_shards = state.range(0);
+  const int num_tensors = 16;
+  const int64_t bytes = 16 << 20;
+  Tensor t = Constant(static_cast<int8>('a'), TensorShape{bytes});
+  BundleWriter::Options opts;
+  opts.num_shards = num_shards;
+  for (auto s : state) {
+    BundleWriter writer(Env::Default(), Prefix("foo"), opts);
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("big", i), t));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  state.SetBytesProcessed(state.iterations() * num_tensors * bytes);
+}
+
+BENCHMARK(BM_BundleWriterSharded)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
 }  // namespace tensorflow
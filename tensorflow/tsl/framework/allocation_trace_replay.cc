@@ -0,0 +1,139 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/allocation_trace_replay.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/numbers.h"
+#include "tensorflow/tsl/platform/strcat.h"
+
+namespace tsl {
+
+namespace {
+
+// Hands out consecutive addresses of a simulated address space without any
+// memory behind them, which is fine as a BFCAllocator never touches the memory
+// it manages.
+class SimulatedSubAllocator : public SubAllocator {
+ public:
+  explicit SimulatedSubAllocator(bool coalesce_regions)
+      : SubAllocator({}, {}), coalesce_regions_(coalesce_regions) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    void* ptr = reinterpret_cast<void*>(next_address_);
+    next_address_ += num_bytes;
+    *bytes_received = num_bytes;
+    return ptr;
+  }
+
+  void Free(void* ptr, size_t num_bytes) override {}
+
+  bool SupportsCoalescing() const override { return coalesce_regions_; }
+
+ private:
+  const bool coalesce_regions_;
+  uintptr_t next_address_ = uintptr_t{1} << 40;
+};
+
+double Fragmentation(BFCAllocator* allocator) {
+  const AllocatorStats stats = *allocator->GetStats();
+  const int64_t free_bytes = stats.pool_bytes.value_or(0) - stats.bytes_in_use;
+  if (free_bytes <= 0) return 0;
+  const tensorflow::MemoryDump dump = allocator->RecordMemoryMap();
+  int64_t largest_free_chunk = 0;
+  for (const tensorflow::MemChunk& chunk : dump.chunk()) {
+    if (!chunk.in_use()) {
+      largest_free_chunk = std::max(largest_free_chunk, chunk.size());
+    }
+  }
+  return static_cast<double>(free_bytes - largest_free_chunk) / free_bytes;
+}
+
+}  // namespace
+
+std::string AllocationTraceReplayResult::DebugString() const {
+  return strings::StrCat(
+      "allocations: ", num_allocations,
+      " failed allocations: ", num_failed_allocations,
+      " unmatched deallocations: ", num_unmatched_deallocations,
+      " peak in use: ", strings::HumanReadableNumBytes(peak_bytes_in_use),
+      " peak pool: ", strings::HumanReadableNumBytes(peak_pool_bytes),
+      " max fragmentation: ", max_fragmentation,
+      " final fragmentation: ", final_fragmentation);
+}
+
+AllocationTraceReplayResult ReplayAllocationTrace(
+    const AllocationTrace& trace, const AllocationTraceReplayOptions& options) {
+  const int64_t memory_limit =
+      options.memory_limit > 0 ? options.memory_limit : trace.bytes_limit();
+  BFCAllocator allocator(
+      std::make_unique<SimulatedSubAllocator>(options.coalesce_regions),
+      memory_limit, strings::StrCat(trace.allocator_name(), "_replay"),
+      options.allocator_options);
+  // Failed allocations are part of the result, waiting for memory to be freed
+  // would only stall the replay.
+  AllocationAttributes allocation_attr;
+  allocation_attr.retry_on_failure = false;
+
+  AllocationTraceReplayResult result;
+  const int64_t sample_interval =
+      std::max<int64_t>(options.fragmentation_sample_interval, 1);
+  // Maps the traced addresses to the replayed ones.
+  absl::flat_hash_map<uint64, void*> live;
+  int64_t num_events = 0;
+  for (const tensorflow::AllocationEvent& event : trace.event()) {
+    if (event.kind() == tensorflow::AllocationEvent::ALLOCATE) {
+      ++result.num_allocations;
+      void* ptr = allocator.AllocateRaw(event.alignment(), event.size(),
+                                        allocation_attr);
+      if (ptr == nullptr) {
+        ++result.num_failed_allocations;
+      } else {
+        live[event.address()] = ptr;
+      }
+    } else {
+      auto it = live.find(event.address());
+      if (it == live.end()) {
+        ++result.num_unmatched_deallocations;
+      } else {
+        allocator.DeallocateRaw(it->second);
+        live.erase(it);
+      }
+    }
+    if (++num_events % sample_interval == 0) {
+      result.max_fragmentation =
+          std::max(result.max_fragmentation, Fragmentation(&allocator));
+    }
+  }
+
+  result.final_fragmentation = Fragmentation(&allocator);
+  result.max_fragmentation =
+      std::max(result.max_fragmentation, result.final_fragmentation);
+  const AllocatorStats stats = *allocator.GetStats();
+  result.peak_bytes_in_use = stats.peak_bytes_in_use;
+  result.peak_pool_bytes = stats.peak_pool_bytes.value_or(0);
+
+  for (const auto& entry : live) {
+    allocator.DeallocateRaw(entry.second);
+  }
+  return result;
+}
+
+}  // namespace tsl
@@ -0,0 +1,69 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_FRAMEWORK_ALLOCATION_TRACE_REPLAY_H_
+#define TENSORFLOW_TSL_FRAMEWORK_ALLOCATION_TRACE_REPLAY_H_
+
+#include <cstdint>
+#include <string>
+
+#include "tensorflow/tsl/framework/bfc_allocator.h"
+#include "tensorflow/tsl/protobuf/bfc_memory_map.pb.h"
+
+namespace tsl {
+
+struct AllocationTraceReplayOptions {
+  BFCAllocator::Options allocator_options;
+
+  // The memory limit of the allocator. If 0, the limit of the traced
+  // allocator is used.
+  int64_t memory_limit = 0;
+
+  // Whether adjacent regions of the simulated memory may be coalesced, as for
+  // GPU virtual memory.
+  bool coalesce_regions = false;
+
+  // Fragmentation is sampled every this many events, and after the last one.
+  int64_t fragmentation_sample_interval = 1000;
+};
+
+struct AllocationTraceReplayResult {
+  int64_t num_allocations = 0;
+  int64_t num_failed_allocations = 0;
+  // Deallocations of memory allocated before the first event of the trace, or
+  // by an allocation that failed in the replay.
+  int64_t num_unmatched_deallocations = 0;
+
+  int64_t peak_bytes_in_use = 0;
+  int64_t peak_pool_bytes = 0;
+
+  // The fragmentation of the free memory in the pool, i.e. the fraction of it
+  // outside of the largest free chunk.
+  double max_fragmentation = 0;
+  double final_fragmentation = 0;
+
+  std::string DebugString() const;
+};
+
+// Replays the allocations and deallocations of `trace`, recorded with
+// BFCAllocator::RecordAllocationTrace(), against a BFCAllocator configured by
+// `options`. The allocator manages simulated memory, so traces of any size
+// can be replayed without allocating their memory.
+AllocationTraceReplayResult ReplayAllocationTrace(
+    const AllocationTrace& trace, const AllocationTraceReplayOptions& options);
+
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_FRAMEWORK_ALLOCATION_TRACE_REPLAY_H_
@@ -0,0 +1,149 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Replays a BFCAllocator allocation trace against allocator configurations
+// and reports their peak memory and fragmentation. Traces are written next to
+// the memory dumps of TF_BFC_MEMORY_DUMP by allocators with
+// Options::allocation_trace_size set, and by
+// BFCAllocator::RecordAllocationTrace().
+//
+// Each configuration flag takes a comma-separated list of values, and every
+// combination of them is replayed, e.g.:
+//
+//   allocation_trace_replay_main --trace=/tmp/dump_GPU_0_bfc.123.trace \
+//       --allow_growth=true,false --garbage_collection=true,false
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "tensorflow/tsl/framework/allocation_trace_replay.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/init_main.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/numbers.h"
+#include "tensorflow/tsl/platform/str_util.h"
+#include "tensorflow/tsl/util/command_line_flags.h"
+
+namespace tsl {
+namespace {
+
+bool ParseBools(const std::string& values, std::vector<bool>* result) {
+  for (const std::string& value : str_util::Split(values, ',')) {
+    if (value == "true") {
+      result->push_back(true);
+    } else if (value == "false") {
+      result->push_back(false);
+    } else {
+      return false;
+    }
+  }
+  return !result->empty();
+}
+
+bool ParseDoubles(const std::string& values, std::vector<double>* result) {
+  for (const std::string& value : str_util::Split(values, ',')) {
+    double d;
+    if (!strings::safe_strtod(value, &d)) return false;
+    result->push_back(d);
+  }
+  return !result->empty();
+}
+
+int Main(int argc, char** argv) {
+  std::string trace_file;
+  int64_t memory_limit = 0;
+  std::string allow_growth = "true";
+  std::string garbage_collection = "false";
+  std::string fragmentation_fraction = "0";
+  std::string small_allocation_cache = "false";
+  bool coalesce_regions = false;
+  int64_t fragmentation_sample_interval = 1000;
+  std::vector<Flag> flag_list = {
+      Flag("trace", &trace_file, "The allocation trace to replay."),
+      Flag("memory_limit", &memory_limit,
+           "The memory limit in bytes, or 0 for the one of the trace."),
+      Flag("allow_growth", &allow_growth,
+           "Values of BFCAllocator::Options::allow_growth."),
+      Flag("garbage_collection", &garbage_collection,
+           "Values of BFCAllocator::Options::garbage_collection."),
+      Flag("fragmentation_fraction", &fragmentation_fraction,
+           "Values of BFCAllocator::Options::fragmentation_fraction."),
+      Flag("small_allocation_cache", &small_allocation_cache,
+           "Values of BFCAllocator::Options::small_allocation_cache."),
+      Flag("coalesce_regions", &coalesce_regions,
+           "Whether adjacent memory regions may be coalesced."),
+      Flag("fragmentation_sample_interval", &fragmentation_sample_interval,
+           "The number of events between fragmentation samples."),
+  };
+  const std::string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_ok = Flags::Parse(&argc, argv, flag_list);
+  port::InitMain(usage.c_str(), &argc, &argv);
+  std::vector<bool> allow_growth_values;
+  std::vector<bool> garbage_collection_values;
+  std::vector<double> fragmentation_fraction_values;
+  std::vector<bool> small_allocation_cache_values;
+  if (!parse_ok || trace_file.empty() || argc > 1 ||
+      !ParseBools(allow_growth, &allow_growth_values) ||
+      !ParseBools(garbage_collection, &garbage_collection_values) ||
+      !ParseDoubles(fragmentation_fraction, &fragmentation_fraction_values) ||
+      !ParseBools(small_allocation_cache, &small_allocation_cache_values)) {
+    LOG(ERROR) << usage;
+    return 1;
+  }
+
+  AllocationTrace trace;
+  Status status = ReadBinaryProto(Env::Default(), trace_file, &trace);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to read " << trace_file << ": " << status;
+    return 1;
+  }
+  printf("Replaying %d events of allocator %s", trace.event_size(),
+         trace.allocator_name().c_str());
+  if (trace.num_dropped_events() > 0) {
+    printf(" (%lld older events were dropped)",
+           static_cast<long long>(trace.num_dropped_events()));
+  }
+  printf("\n");
+
+  for (bool growth : allow_growth_values) {
+    for (bool gc : garbage_collection_values) {
+      for (double fraction : fragmentation_fraction_values) {
+        for (bool cache : small_allocation_cache_values) {
+          AllocationTraceReplayOptions options;
+          options.allocator_options.allow_growth = growth;
+          options.allocator_options.garbage_collection = gc;
+          options.allocator_options.fragmentation_fraction = fraction;
+          options.allocator_options.small_allocation_cache = cache;
+          options.memory_limit = memory_limit;
+          options.coalesce_regions = coalesce_regions;
+          options.fragmentation_sample_interval = fragmentation_sample_interval;
+          const AllocationTraceReplayResult result =
+              ReplayAllocationTrace(trace, options);
+          printf(
+              "allow_growth=%d garbage_collection=%d "
+              "fragmentation_fraction=%g small_allocation_cache=%d: %s\n",
+              growth, gc, fraction, cache, result.DebugString().c_str());
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tsl
+
+int main(int argc, char** argv) { return tsl::Main(argc, argv); }
@@ -0,0 +1,202 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/allocation_trace_replay.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/tsl/framework/bfc_allocator.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/mem.h"
+#include "tensorflow/tsl/platform/strcat.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+#include "tensorflow/tsl/profiler/lib/scoped_memory_debug_annotation.h"
+
+namespace tsl {
+namespace {
+
+class HostSubAllocator : public SubAllocator {
+ public:
+  HostSubAllocator() : SubAllocator({}, {}) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    *bytes_received = num_bytes;
+    // Aligned like device memory, as the slabs of the small allocation cache
+    // need to be.
+    return port::AlignedMalloc(num_bytes, SlabCache::kMinObjectBytes);
+  }
+
+  void Free(void* ptr, size_t num_bytes) override { port::AlignedFree(ptr); }
+
+  bool SupportsCoalescing() const override { return false; }
+};
+
+std::unique_ptr<BFCAllocator> CreateAllocator(
+    int64_t trace_size, bool small_allocation_cache = false) {
+  BFCAllocator::Options opts;
+  opts.allow_growth = true;
+  opts.allocation_trace_size = trace_size;
+  opts.small_allocation_cache = small_allocation_cache;
+  return std::make_unique<BFCAllocator>(std::make_unique<HostSubAllocator>(),
+                                        64 << 20, "trace_test", opts);
+}
+
+TEST(AllocationTraceTest, RecordsEvents) {
+  auto allocator = CreateAllocator(100);
+  void* a = allocator->AllocateRaw(64, 1024);
+  void* b;
+  {
+    profiler::ScopedMemoryDebugAnnotation annotation("matmul", /*step_id=*/7);
+    b = allocator->AllocateRaw(64, 4096);
+  }
+  allocator->DeallocateRaw(a);
+
+  const AllocationTrace trace = allocator->RecordAllocationTrace();
+  EXPECT_EQ(trace.allocator_name(), "trace_test");
+  EXPECT_EQ(trace.bytes_limit(), 64 << 20);
+  EXPECT_EQ(trace.num_dropped_events(), 0);
+  ASSERT_EQ(trace.event_size(), 3);
+  EXPECT_EQ(trace.event(0).kind(), tensorflow::AllocationEvent::ALLOCATE);
+  EXPECT_EQ(trace.event(0).address(), reinterpret_cast<uint64>(a));
+  EXPECT_EQ(trace.event(0).size(), 1024);
+  EXPECT_EQ(trace.event(0).alignment(), 64);
+  EXPECT_EQ(trace.op_name(trace.event(0).op_name_index()), "");
+  EXPECT_EQ(trace.event(1).address(), reinterpret_cast<uint64>(b));
+  EXPECT_EQ(trace.op_name(trace.event(1).op_name_index()), "matmul");
+  EXPECT_EQ(trace.event(1).step_id(), 7);
+  EXPECT_EQ(trace.event(2).kind(), tensorflow::AllocationEvent::DEALLOCATE);
+  EXPECT_EQ(trace.event(2).address(), reinterpret_cast<uint64>(a));
+  EXPECT_LE(trace.event(0).timestamp_us(), trace.event(2).timestamp_us());
+  allocator->DeallocateRaw(b);
+}
+
+TEST(AllocationTraceTest, SwitchesOpNames) {
+  auto allocator = CreateAllocator(100);
+  for (const char* op_name : {"a", "b", "a"}) {
+    profiler::ScopedMemoryDebugAnnotation annotation(op_name);
+    allocator->DeallocateRaw(allocator->AllocateRaw(64, 1024));
+  }
+  const AllocationTrace trace = allocator->RecordAllocationTrace();
+  ASSERT_EQ(trace.event_size(), 6);
+  EXPECT_EQ(trace.op_name(trace.event(0).op_name_index()), "a");
+  EXPECT_EQ(trace.op_name(trace.event(2).op_name_index()), "b");
+  EXPECT_EQ(trace.op_name(trace.event(4).op_name_index()), "a");
+  EXPECT_EQ(trace.op_name_size(), 3);
+}
+
+TEST(AllocationTraceTest, RecordsConcurrentSmallAllocations) {
+  auto allocator = CreateAllocator(10000, /*small_allocation_cache=*/true);
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAllocations = 500;
+  {
+    thread::ThreadPool pool(Env::Default(), "trace_test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&allocator, t]() {
+        const std::string op_name = strings::StrCat("op", t);
+        profiler::ScopedMemoryDebugAnnotation annotation(op_name.c_str());
+        for (int i = 0; i < kNumAllocations; ++i) {
+          // The size identifies the thread.
+          allocator->DeallocateRaw(allocator->AllocateRaw(64, 64 * (t + 1)));
+        }
+      });
+    }
+  }
+  const AllocationTrace trace = allocator->RecordAllocationTrace();
+  EXPECT_EQ(trace.num_dropped_events(), 0);
+  ASSERT_EQ(trace.event_size(), 2 * kNumThreads * kNumAllocations);
+  for (const tensorflow::AllocationEvent& event : trace.event()) {
+    if (event.kind() != tensorflow::AllocationEvent::ALLOCATE) continue;
+    EXPECT_EQ(trace.op_name(event.op_name_index()),
+              strings::StrCat("op", event.size() / 64 - 1));
+  }
+}
+
+TEST(AllocationTraceTest, DisabledByDefault) {
+  auto allocator = CreateAllocator(0);
+  allocator->DeallocateRaw(allocator->AllocateRaw(64, 1024));
+  EXPECT_EQ(allocator->RecordAllocationTrace().event_size(), 0);
+}
+
+TEST(AllocationTraceTest, KeepsMostRecentEvents) {
+  auto allocator = CreateAllocator(4);
+  for (int i = 1; i <= 5; ++i) {
+    allocator->DeallocateRaw(allocator->AllocateRaw(64, i * 1024));
+  }
+  const AllocationTrace trace = allocator->RecordAllocationTrace();
+  EXPECT_EQ(trace.num_dropped_events(), 6);
+  ASSERT_EQ(trace.event_size(), 4);
+  EXPECT_EQ(trace.event(0).size(), 4 * 1024);
+  EXPECT_EQ(trace.event(1).kind(), tensorflow::AllocationEvent::DEALLOCATE);
+  EXPECT_EQ(trace.event(2).size(), 5 * 1024);
+  EXPECT_EQ(trace.event(3).kind(), tensorflow::AllocationEvent::DEALLOCATE);
+}
+
+TEST(AllocationTraceReplayTest, ReplaysTrace) {
+  auto allocator = CreateAllocator(1000);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    ptrs.push_back(allocator->AllocateRaw(64, (i % 10 + 1) * 10000));
+  }
+  // Free every other allocation to fragment the memory.
+  for (int i = 0; i < 100; i += 2) {
+    allocator->DeallocateRaw(ptrs[i]);
+  }
+  const AllocationTrace trace = allocator->RecordAllocationTrace();
+
+  AllocationTraceReplayOptions options;
+  options.allocator_options.allow_growth = true;
+  options.fragmentation_sample_interval = 10;
+  AllocationTraceReplayResult result = ReplayAllocationTrace(trace, options);
+  EXPECT_EQ(result.num_allocations, 100);
+  EXPECT_EQ(result.num_failed_allocations, 0);
+  EXPECT_EQ(result.num_unmatched_deallocations, 0);
+  EXPECT_EQ(result.peak_bytes_in_use,
+            allocator->GetStats()->peak_bytes_in_use);
+  EXPECT_GT(result.final_fragmentation, 0);
+  EXPECT_GE(result.max_fragmentation, result.final_fragmentation);
+  EXPECT_LT(result.max_fragmentation, 1);
+
+  // The same trace doesn't fit into half the memory.
+  options.memory_limit = result.peak_bytes_in_use / 2;
+  result = ReplayAllocationTrace(trace, options);
+  EXPECT_GT(result.num_failed_allocations, 0);
+  EXPECT_GT(result.num_unmatched_deallocations, 0);
+  EXPECT_LE(result.peak_bytes_in_use, options.memory_limit);
+
+  for (int i = 1; i < 100; i += 2) {
+    allocator->DeallocateRaw(ptrs[i]);
+  }
+}
+
+TEST(AllocationTraceReplayTest, UnmatchedDeallocations) {
+  auto allocator = CreateAllocator(2);
+  void* a = allocator->AllocateRaw(64, 1024);
+  void* b = allocator->AllocateRaw(64, 1024);
+  allocator->DeallocateRaw(a);
+  allocator->DeallocateRaw(b);
+  // Only the deallocations are left in the trace.
+  AllocationTraceReplayResult result = ReplayAllocationTrace(
+      allocator->RecordAllocationTrace(), AllocationTraceReplayOptions());
+  EXPECT_EQ(result.num_allocations, 0);
+  EXPECT_EQ(result.num_unmatched_deallocations, 2);
+  EXPECT_EQ(result.peak_bytes_in_use, 0);
+}
+
+}  // namespace
+}  // namespace tsl
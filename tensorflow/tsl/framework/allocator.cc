@@ -28,7 +28,7 @@ limitations under the License.
 namespace tsl {
 
 string AllocatorStats::DebugString() const {
-  return strings::Printf(
+  string result = strings::Printf(
       "Limit:            %20lld\n"
       "InUse:            %20lld\n"
       "MaxInUse:         %20lld\n"
@@ -45,6 +45,16 @@ string AllocatorStats::DebugString() const {
       static_cast<long long>(this->bytes_reserved),
       static_cast<long long>(this->peak_bytes_reserved),
       static_cast<long long>(this->largest_free_block_bytes));
+  if (this->num_slab_allocs > 0 || this->slab_bytes_reserved > 0) {
+    strings::Appendf(&result,
+                     "NumSlabAllocs:    %20lld\n"
+                     "SlabInUse:        %20lld\n"
+                     "SlabReserved:     %20lld\n",
+                     static_cast<long long>(this->num_slab_allocs),
+                     static_cast<long long>(this->slab_bytes_in_use),
+                     static_cast<long long>(this->slab_bytes_reserved));
+  }
+  return result;
 }
 
 constexpr size_t Allocator::kAllocatorAlignment;
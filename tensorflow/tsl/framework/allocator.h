@@ -92,6 +92,13 @@ struct AllocatorStats {
   std::optional<int64_t> pool_bytes;
   std::optional<int64_t> peak_pool_bytes;
 
+  // Stats for small allocations served from slabs (e.g. by the small
+  // allocation cache of BFCAllocator). The slabs themselves are counted as
+  // regular allocations in the stats above.
+  int64_t num_slab_allocs;      // Number of allocations served from slabs.
+  int64_t slab_bytes_in_use;    // Bytes of those allocations in use.
+  int64_t slab_bytes_reserved;  // Bytes of the slabs.
+
   AllocatorStats()
       : num_allocs(0),
         bytes_in_use(0),
@@ -99,7 +106,10 @@ struct AllocatorStats {
         largest_alloc_size(0),
         bytes_reserved(0),
         peak_bytes_reserved(0),
-        largest_free_block_bytes(0) {}
+        largest_free_block_bytes(0),
+        num_slab_allocs(0),
+        slab_bytes_in_use(0),
+        slab_bytes_reserved(0) {}
 
   std::string DebugString() const;
 };
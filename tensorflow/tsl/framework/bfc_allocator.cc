@@ -23,6 +23,7 @@ limitations under the License.
 #include "absl/strings/string_view.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
 #include "tensorflow/tsl/lib/core/bits.h"
+#include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/file_system.h"
 #include "tensorflow/tsl/platform/logging.h"
 #include "tensorflow/tsl/platform/mutex.h"
@@ -39,6 +40,16 @@ namespace tsl {
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
 
+namespace {
+
+// Returns a process-wide unique id for the allocation trace of an allocator.
+int64_t NextTraceId() {
+  static std::atomic<int64_t> next_trace_id(0);
+  return next_trace_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
 BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
                            size_t total_memory, const string& name,
                            const Options& opts)
@@ -47,7 +58,8 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       sub_allocator_(std::move(sub_allocator)),
       name_(name),
       free_chunks_list_(kInvalidChunkHandle),
-      next_allocation_id_(1) {
+      next_allocation_id_(1),
+      trace_id_(NextTraceId()) {
   if (opts.allow_growth) {
     // 2MiB smallest initial allocation, unless total memory available
     // is less.
@@ -84,6 +96,23 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+  if (opts.small_allocation_cache) {
+    slab_cache_ = std::make_unique<SlabCache>([this] {
+      return AllocateRawInternal(Allocator::kAllocatorAlignment,
+                                 SlabCache::kSlabBytes,
+                                 /*dump_log_on_failure=*/false,
+                                 /*freed_before=*/0);
+    });
+  }
+
+  if (opts.allocation_trace_size > 0) {
+    trace_events_.reset(new TraceEvent[opts.allocation_trace_size]);
+    trace_capacity_ = opts.allocation_trace_size;
+    // Index 0 is the name of events outside of any op.
+    trace_op_names_.push_back("");
+    trace_op_name_indices_[""] = 0;
+  }
 }
 
 BFCAllocator::~BFCAllocator() {
@@ -264,6 +293,18 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes;
+  // Timestamped allocations can't reuse objects freed to the cache.
+  if (slab_cache_ != nullptr && allocation_attr.freed_by_func == nullptr) {
+    void* result = slab_cache_->Allocate(num_bytes);
+    if (result != nullptr) {
+      VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " "
+              << result;
+      if (opts_.allocation_trace_size > 0) {
+        RecordTraceEvent(result, num_bytes, unused_alignment);
+      }
+      return result;
+    }
+  }
   void* result = [&] {
     if (!opts_.allow_retry_on_failure || !allocation_attr.retry_on_failure) {
       // If we have globally disabled retry-on-failure and fail to allocate an
@@ -311,6 +352,9 @@ void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
     }
   }();
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " " << result;
+  if (result != nullptr && opts_.allocation_trace_size > 0) {
+    RecordTraceEvent(result, num_bytes, unused_alignment);
+  }
   return result;
 }
 
@@ -464,6 +508,16 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Give the empty slabs of the small allocation cache back to the bins and
+  // try again.
+  if (slab_cache_ != nullptr && ReleaseEmptySlabs()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   // Reaching this point means that no chunks can satisfy the request. Also,
   // the unallocated bytes cannot satisfy the request. Before giving up, let's
   // try deallocating free regions so that suballocator can combine them with
@@ -684,6 +738,14 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(3) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
+  if (ptr != nullptr && opts_.allocation_trace_size > 0) {
+    RecordTraceEvent(ptr, 0, 0);
+  }
+  if (slab_cache_ != nullptr && slab_cache_->Deallocate(ptr)) {
+    // The object's slab stays allocated, so there's no point in waking up
+    // allocations waiting for memory.
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -694,7 +756,10 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     return;
   }
   mutex_lock l(lock_);
+  FreeChunkPtr(ptr);
+}
 
+void BFCAllocator::FreeChunkPtr(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -723,6 +788,15 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   }
 }
 
+bool BFCAllocator::ReleaseEmptySlabs() {
+  std::vector<void*> slabs = slab_cache_->ReleaseEmptySlabs();
+  VLOG(2) << "Releasing " << slabs.size() << " empty slabs";
+  for (void* slab : slabs) {
+    FreeChunkPtr(slab);
+  }
+  return !slabs.empty();
+}
+
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
 // We merge Chunk(h2) into Chunk(h1).
 void BFCAllocator::Merge(BFCAllocator::ChunkHandle h1,
@@ -937,6 +1011,10 @@ bool BFCAllocator::TracksAllocationSizes() const { return true; }
 
 size_t BFCAllocator::RequestedSize(const void* ptr) const {
   CHECK(ptr);
+  SlabCache::Object object;
+  if (slab_cache_ != nullptr && slab_cache_->Lookup(ptr, &object)) {
+    return object.requested_size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -946,6 +1024,10 @@ size_t BFCAllocator::RequestedSize(const void* ptr) const {
 }
 
 size_t BFCAllocator::AllocatedSize(const void* ptr) const {
+  SlabCache::Object object;
+  if (slab_cache_ != nullptr && slab_cache_->Lookup(ptr, &object)) {
+    return object.allocated_size;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -955,6 +1037,10 @@ size_t BFCAllocator::AllocatedSize(const void* ptr) const {
 }
 
 int64_t BFCAllocator::AllocationId(const void* ptr) const {
+  SlabCache::Object object;
+  if (slab_cache_ != nullptr && slab_cache_->Lookup(ptr, &object)) {
+    return object.allocation_id;
+  }
   mutex_lock l(lock_);
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle)
@@ -1131,9 +1217,120 @@ void BFCAllocator::MaybeWriteMemoryMap() {
       LOG(ERROR) << "Error on writing to file " << gpu_memory_map_file << ": "
                  << status;
     }
+    if (opts_.allocation_trace_size > 0) {
+      const string trace_file_name = strings::StrCat(file_name, ".trace");
+      status = WriteBinaryProto(Env::Default(), trace_file_name,
+                                RecordAllocationTrace());
+      if (!status.ok()) {
+        LOG(ERROR) << "Error on writing to file " << trace_file_name << ": "
+                   << status;
+      }
+    }
   }
 }
 
+void BFCAllocator::RecordTraceEvent(const void* ptr, size_t num_bytes,
+                                    size_t alignment) {
+  const profiler::MemoryDebugAnnotation& annotation =
+      profiler::ScopedMemoryDebugAnnotation::CurrentAnnotation();
+  const int32 op_name_index =
+      annotation.pending_op_name == nullptr
+          ? 0
+          : TraceOpNameIndex(annotation.pending_op_name);
+  const int64_t index =
+      num_trace_events_.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent& event = trace_events_[index % trace_capacity_];
+  // A seqlock write: readers skip the event unless its sequence number is the
+  // same before and after they read it.
+  event.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.ptr.store(ptr, std::memory_order_relaxed);
+  event.num_bytes.store(num_bytes, std::memory_order_relaxed);
+  event.alignment.store(alignment, std::memory_order_relaxed);
+  event.timestamp_us.store(Env::Default()->NowMicros(),
+                           std::memory_order_relaxed);
+  event.op_name_index.store(op_name_index, std::memory_order_relaxed);
+  event.step_id.store(annotation.pending_step_id, std::memory_order_relaxed);
+  event.sequence.store(index + 1, std::memory_order_release);
+}
+
+int32 BFCAllocator::TraceOpNameIndex(const char* op_name) {
+  // The annotation only lives as long as the op, so its name is compared and
+  // copied rather than its address.
+  struct CachedOpName {
+    int64_t trace_id = -1;
+    string op_name;
+    int32 index = 0;
+  };
+  static thread_local CachedOpName cached;
+  if (cached.trace_id == trace_id_ && cached.op_name == op_name) {
+    return cached.index;
+  }
+  int32 index;
+  {
+    mutex_lock l(trace_lock_);
+    auto it = trace_op_name_indices_.find(absl::string_view(op_name));
+    if (it == trace_op_name_indices_.end()) {
+      it = trace_op_name_indices_.emplace(op_name, trace_op_names_.size())
+               .first;
+      trace_op_names_.push_back(op_name);
+    }
+    index = it->second;
+  }
+  cached.trace_id = trace_id_;
+  cached.op_name = op_name;
+  cached.index = index;
+  return index;
+}
+
+AllocationTrace BFCAllocator::RecordAllocationTrace() {
+  AllocationTrace trace;
+  trace.set_allocator_name(Name());
+  trace.set_bytes_limit(memory_limit_);
+  if (trace_capacity_ == 0) {
+    return trace;
+  }
+  {
+    mutex_lock l(trace_lock_);
+    for (const string& op_name : trace_op_names_) {
+      trace.add_op_name(op_name);
+    }
+  }
+  // Events that are still being written, or are overwritten while they are
+  // read, are counted as dropped.
+  const int64_t num_events = num_trace_events_.load(std::memory_order_relaxed);
+  const int64_t first = std::max<int64_t>(0, num_events - trace_capacity_);
+  int64_t num_dropped_events = first;
+  for (int64_t i = first; i < num_events; ++i) {
+    const TraceEvent& e = trace_events_[i % trace_capacity_];
+    const int64_t sequence = e.sequence.load(std::memory_order_acquire);
+    const void* ptr = e.ptr.load(std::memory_order_relaxed);
+    const size_t num_bytes = e.num_bytes.load(std::memory_order_relaxed);
+    const size_t alignment = e.alignment.load(std::memory_order_relaxed);
+    const uint64 timestamp_us = e.timestamp_us.load(std::memory_order_relaxed);
+    const int32 op_name_index = e.op_name_index.load(std::memory_order_relaxed);
+    const int64_t step_id = e.step_id.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence != i + 1 ||
+        e.sequence.load(std::memory_order_relaxed) != sequence ||
+        op_name_index >= trace.op_name_size()) {
+      ++num_dropped_events;
+      continue;
+    }
+    tensorflow::AllocationEvent* event = trace.add_event();
+    event->set_kind(num_bytes > 0 ? tensorflow::AllocationEvent::ALLOCATE
+                                  : tensorflow::AllocationEvent::DEALLOCATE);
+    event->set_address(reinterpret_cast<uint64>(ptr));
+    event->set_size(num_bytes);
+    event->set_alignment(alignment);
+    event->set_timestamp_us(timestamp_us);
+    event->set_op_name_index(op_name_index);
+    event->set_step_id(step_id);
+  }
+  trace.set_num_dropped_events(num_dropped_events);
+  return trace;
+}
+
 MemoryDump BFCAllocator::RecordMemoryMap() {
   mutex_lock l(lock_);
   return RecordMemoryMapInternal();
@@ -1207,7 +1404,14 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  if (slab_cache_ != nullptr) {
+    const SlabCache::Stats slab_stats = slab_cache_->GetStats();
+    stats.num_slab_allocs = slab_stats.num_allocs;
+    stats.slab_bytes_in_use = slab_stats.bytes_in_use;
+    stats.slab_bytes_reserved = slab_stats.bytes_reserved;
+  }
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
@@ -1215,6 +1419,9 @@ bool BFCAllocator::ClearStats() {
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
+  if (slab_cache_ != nullptr) {
+    slab_cache_->ClearStats();
+  }
   return true;
 }
 
@@ -17,16 +17,19 @@ limitations under the License.
 #define TENSORFLOW_TSL_FRAMEWORK_BFC_ALLOCATOR_H_
 
 #include <array>
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/tsl/framework/allocator.h"
 #include "tensorflow/tsl/framework/allocator_retry.h"
 #include "tensorflow/tsl/framework/shared_counter.h"
+#include "tensorflow/tsl/framework/slab_cache.h"
 #include "tensorflow/tsl/platform/macros.h"
 #include "tensorflow/tsl/platform/mutex.h"
 #include "tensorflow/tsl/platform/numbers.h"
@@ -35,9 +38,11 @@ limitations under the License.
 #include "tensorflow/tsl/platform/types.h"
 
 namespace tensorflow {
+class AllocationTrace;
 class MemoryDump;
 }
 namespace tsl {
+using tensorflow::AllocationTrace;
 using tensorflow::MemoryDump;
 
 // A memory allocator that implements a 'best-fit with coalescing'
@@ -68,6 +73,17 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // If true, allocations of up to SlabCache::kMaxObjectBytes without a
+    // freed_by_func are served without locking from a cache of size-class
+    // slabs, which are themselves allocated from the bins. Empty slabs are
+    // returned to the bins when an allocation can't be satisfied otherwise.
+    bool small_allocation_cache = false;
+
+    // If positive, the allocator records its most recent allocations and
+    // deallocations in a ring buffer of this many events, see
+    // RecordAllocationTrace().
+    int64_t allocation_trace_size = 0;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -107,6 +123,11 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Returns the events recorded if Options::allocation_trace_size is positive.
+  // They can be replayed against other allocator configurations with
+  // ReplayAllocationTrace().
+  AllocationTrace RecordAllocationTrace();
+
  private:
   struct Bin;
 
@@ -120,6 +141,13 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  // Frees the chunk allocated at 'ptr'.
+  void FreeChunkPtr(void* ptr) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns the empty slabs of the small allocation cache to the bins.
+  // Returns true if any were returned.
+  bool ReleaseEmptySlabs() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -495,6 +523,13 @@ class BFCAllocator : public Allocator {
   // Removes the chunk metadata represented by 'h'.
   void DeleteChunk(ChunkHandle h) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Records an allocation or, if 'num_bytes' is 0, a deallocation of 'ptr' in
+  // the allocation trace.
+  void RecordTraceEvent(const void* ptr, size_t num_bytes, size_t alignment);
+
+  // Returns the index of 'op_name' in trace_op_names_, interning it if needed.
+  int32 TraceOpNameIndex(const char* op_name);
+
   string RenderOccupancy() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void DumpMemoryLog(size_t num_bytes) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
   tensorflow::MemoryDump RecordMemoryMapInternal()
@@ -591,6 +626,8 @@ class BFCAllocator : public Allocator {
 
   std::unique_ptr<SubAllocator> sub_allocator_;
   string name_;
+  // Null unless opts_.small_allocation_cache.
+  std::unique_ptr<SlabCache> slab_cache_;
   SharedCounter* timing_counter_ = nullptr;
   std::deque<ChunkHandle> timestamped_chunks_;
 
@@ -611,6 +648,38 @@ class BFCAllocator : public Allocator {
 
   // Stats.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
+
+  // The allocation trace, a ring buffer of the most recent events. It is
+  // written without locks, as small allocations don't take lock_: each event
+  // claims a slot by incrementing num_trace_events_, and publishes it through
+  // the slot's sequence number once written.
+  struct TraceEvent {
+    // The index of the event in the slot plus one, or 0 while it is written.
+    std::atomic<int64_t> sequence{0};
+    std::atomic<const void*> ptr{nullptr};
+    // 0 for deallocations.
+    std::atomic<size_t> num_bytes{0};
+    std::atomic<size_t> alignment{0};
+    std::atomic<uint64> timestamp_us{0};
+    std::atomic<int32> op_name_index{0};
+    std::atomic<int64_t> step_id{0};
+  };
+  std::unique_ptr<TraceEvent[]> trace_events_;
+  int64_t trace_capacity_ = 0;
+  // The number of events recorded so far, of which only the last
+  // trace_capacity_ are kept.
+  std::atomic<int64_t> num_trace_events_{0};
+  // Distinguishes the allocators in the per-thread op name caches.
+  const int64_t trace_id_;
+
+  // The op names of the events, interned under trace_lock_. Each thread
+  // caches the index of the last op name it recorded, so that the lock is
+  // only taken when a thread moves on to another op.
+  mutex trace_lock_;
+  std::vector<string> trace_op_names_ TF_GUARDED_BY(trace_lock_);
+  absl::flat_hash_map<string, int32> trace_op_name_indices_
+      TF_GUARDED_BY(trace_lock_);
+
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ TF_GUARDED_BY(lock_) = 0;
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
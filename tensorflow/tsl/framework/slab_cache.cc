@@ -0,0 +1,385 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/slab_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/numeric/bits.h"
+#include "tensorflow/tsl/lib/core/bits.h"
+#include "tensorflow/tsl/platform/logging.h"
+
+namespace tsl {
+
+namespace {
+
+constexpr int kSlabBits = 16;
+static_assert(SlabCache::kSlabBytes == size_t{1} << kSlabBits,
+              "kSlabBits must match kSlabBytes");
+
+// The allocation ids of the objects start here, so that they never collide
+// with the ids a BFCAllocator assigns sequentially from 1.
+constexpr int64_t kFirstAllocationId = int64_t{1} << 62;
+
+}  // namespace
+
+constexpr size_t SlabCache::kSlabBytes;
+constexpr size_t SlabCache::kMinObjectBytes;
+constexpr size_t SlabCache::kMaxObjectBytes;
+
+SlabCache::SlabMap::SlabMap() : root_(new Node()) {}
+
+SlabCache::SlabMap::~SlabMap() { DeleteNode(root_, 0); }
+
+// static
+void SlabCache::SlabMap::DeleteNode(Node* node, int level) {
+  for (auto& child : node->children) {
+    void* c = child.load(std::memory_order_relaxed);
+    if (c == nullptr) continue;
+    if (level + 2 < kNumLevels) {
+      DeleteNode(static_cast<Node*>(c), level + 1);
+    } else {
+      delete static_cast<Leaf*>(c);
+    }
+  }
+  delete node;
+}
+
+// static
+size_t SlabCache::SlabMap::ChildIndex(uintptr_t window, int level) {
+  const int shift = (kNumLevels - 1 - level) * kBitsPerLevel;
+  return static_cast<size_t>(window >> shift) & (kFanout - 1);
+}
+
+SlabCache::SlabMap::Leaf* SlabCache::SlabMap::FindLeaf(
+    uintptr_t window) const {
+  void* node = root_;
+  for (int level = 0; level + 1 < kNumLevels && node != nullptr; ++level) {
+    node = static_cast<Node*>(node)
+               ->children[ChildIndex(window, level)]
+               .load(std::memory_order_acquire);
+  }
+  return static_cast<Leaf*>(node);
+}
+
+SlabCache::SlabMap::Leaf* SlabCache::SlabMap::FindOrCreateLeaf(
+    uintptr_t window) {
+  Node* node = root_;
+  for (int level = 0; level + 1 < kNumLevels; ++level) {
+    std::atomic<void*>& child = node->children[ChildIndex(window, level)];
+    void* c = child.load(std::memory_order_relaxed);
+    if (c == nullptr) {
+      if (level + 2 < kNumLevels) {
+        c = new Node();
+      } else {
+        c = new Leaf();
+      }
+      child.store(c, std::memory_order_release);
+    }
+    if (level + 2 == kNumLevels) return static_cast<Leaf*>(c);
+    node = static_cast<Node*>(c);
+  }
+  return nullptr;
+}
+
+void SlabCache::SlabMap::Insert(Slab* slab) {
+  const uintptr_t start = reinterpret_cast<uintptr_t>(slab->base.load());
+  const uintptr_t first = start >> kSlabBits;
+  const uintptr_t last = (start + kSlabBytes - 1) >> kSlabBits;
+  mutex_lock l(mu_);
+  FindOrCreateLeaf(first)
+      ->starting[ChildIndex(first, kNumLevels - 1)]
+      .store(slab, std::memory_order_release);
+  if (last != first) {
+    FindOrCreateLeaf(last)
+        ->ending[ChildIndex(last, kNumLevels - 1)]
+        .store(slab, std::memory_order_release);
+  }
+}
+
+void SlabCache::SlabMap::Erase(Slab* slab) {
+  const uintptr_t start = reinterpret_cast<uintptr_t>(slab->base.load());
+  const uintptr_t first = start >> kSlabBits;
+  const uintptr_t last = (start + kSlabBytes - 1) >> kSlabBits;
+  mutex_lock l(mu_);
+  FindLeaf(first)
+      ->starting[ChildIndex(first, kNumLevels - 1)]
+      .store(nullptr, std::memory_order_release);
+  if (last != first) {
+    FindLeaf(last)
+        ->ending[ChildIndex(last, kNumLevels - 1)]
+        .store(nullptr, std::memory_order_release);
+  }
+}
+
+SlabCache::Slab* SlabCache::SlabMap::Lookup(const void* ptr) const {
+  const uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t window = p >> kSlabBits;
+  const Leaf* leaf = FindLeaf(window);
+  if (leaf == nullptr) return nullptr;
+  const size_t i = ChildIndex(window, kNumLevels - 1);
+  // A slab starting in this window extends past its end, and one starting in
+  // the previous window starts before it.
+  Slab* slab = leaf->starting[i].load(std::memory_order_acquire);
+  if (slab != nullptr &&
+      p >= reinterpret_cast<uintptr_t>(
+               slab->base.load(std::memory_order_relaxed))) {
+    return slab;
+  }
+  slab = leaf->ending[i].load(std::memory_order_acquire);
+  if (slab != nullptr &&
+      p < reinterpret_cast<uintptr_t>(
+              slab->base.load(std::memory_order_relaxed)) +
+              kSlabBytes) {
+    return slab;
+  }
+  return nullptr;
+}
+
+SlabCache::SlabCache(AllocateSlabFn allocate_slab)
+    : allocate_slab_(std::move(allocate_slab)) {
+  for (int c = 0; c < kNumSizeClasses; ++c) {
+    SizeClass& size_class = size_classes_[c];
+    size_class.object_bytes = kMinObjectBytes << c;
+    size_class.object_bits = Log2Floor64(size_class.object_bytes);
+    size_class.num_objects = kSlabBytes / size_class.object_bytes;
+    size_class.num_mask_words = (size_class.num_objects + 63) / 64;
+    for (int w = 0; w < size_class.num_mask_words; ++w) {
+      const int bits = std::min(64, size_class.num_objects - 64 * w);
+      size_class.full_mask[w] =
+          bits == 64 ? ~uint64{0} : (uint64{1} << bits) - 1;
+    }
+  }
+  CHECK_EQ(size_classes_[kNumSizeClasses - 1].object_bytes, kMaxObjectBytes);
+}
+
+SlabCache::~SlabCache() {}
+
+// static
+int SlabCache::SizeClassFor(size_t num_bytes) {
+  if (num_bytes <= kMinObjectBytes) return 0;
+  return Log2Ceiling64(num_bytes) - Log2Floor64(kMinObjectBytes);
+}
+
+// static
+SlabCache::Shard* SlabCache::CurrentShard(Shard* shards) {
+  static std::atomic<int> next_shard{0};
+  static thread_local int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return &shards[shard];
+}
+
+// static
+int SlabCache::Claim(const SizeClass& size_class, Slab* slab) {
+  for (int w = 0; w < size_class.num_mask_words; ++w) {
+    uint64 mask = slab->free_mask[w].load(std::memory_order_relaxed);
+    while (mask != 0) {
+      if (slab->free_mask[w].compare_exchange_weak(
+              mask, mask & (mask - 1), std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return 64 * w + absl::countr_zero(mask);
+      }
+    }
+  }
+  return -1;
+}
+
+// static
+bool SlabCache::ClaimAll(const SizeClass& size_class, Slab* slab) {
+  int w = 0;
+  for (; w < size_class.num_mask_words; ++w) {
+    uint64 expected = size_class.full_mask[w];
+    if (!slab->free_mask[w].compare_exchange_strong(
+            expected, 0, std::memory_order_acquire,
+            std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  if (w == size_class.num_mask_words) return true;
+  // The words claimed so far had no allocated objects, so nothing else could
+  // have changed them.
+  while (--w >= 0) {
+    slab->free_mask[w].store(size_class.full_mask[w],
+                             std::memory_order_release);
+  }
+  return false;
+}
+
+void* SlabCache::Allocate(size_t num_bytes) {
+  if (num_bytes == 0 || num_bytes > kMaxObjectBytes) return nullptr;
+  const int c = SizeClassFor(num_bytes);
+  const SizeClass& size_class = size_classes_[c];
+  Shard* shard = CurrentShard(shards_);
+
+  Slab* slab = shard->current[c].load(std::memory_order_acquire);
+  int index = slab == nullptr ? -1 : Claim(size_class, slab);
+  if (index < 0) {
+    slab = Refill(c, shard, &index);
+    if (slab == nullptr) return nullptr;
+  }
+
+  slab->requested_sizes[index].store(num_bytes, std::memory_order_relaxed);
+  const int64_t id =
+      shard->next_allocation_id.fetch_add(1, std::memory_order_relaxed);
+  slab->allocation_ids[index].store(
+      kFirstAllocationId + id * kNumShards + (shard - shards_),
+      std::memory_order_relaxed);
+  shard->num_allocs.fetch_add(1, std::memory_order_relaxed);
+  shard->bytes_in_use.fetch_add(size_class.object_bytes,
+                                std::memory_order_relaxed);
+  return slab->base.load(std::memory_order_relaxed) +
+         (static_cast<size_t>(index) << size_class.object_bits);
+}
+
+SlabCache::Slab* SlabCache::Refill(int c, Shard* shard, int* index) {
+  SizeClass& size_class = size_classes_[c];
+  {
+    mutex_lock l(size_class.mu);
+    const size_t num_slabs = size_class.slabs.size();
+    for (size_t n = 0; n < num_slabs; ++n) {
+      if (size_class.next_slab >= num_slabs) size_class.next_slab = 0;
+      Slab* slab = size_class.slabs[size_class.next_slab].get();
+      *index = Claim(size_class, slab);
+      if (*index >= 0) {
+        shard->current[c].store(slab, std::memory_order_release);
+        return slab;
+      }
+      ++size_class.next_slab;
+    }
+  }
+
+  // The backing allocator may need to release empty slabs to satisfy this, so
+  // it's called without holding `mu`.
+  char* base = static_cast<char*>(allocate_slab_());
+  if (base == nullptr) return nullptr;
+  DCHECK_EQ(reinterpret_cast<uintptr_t>(base) % kMinObjectBytes, 0);
+
+  mutex_lock l(size_class.mu);
+  std::unique_ptr<Slab> slab;
+  if (!size_class.released_slabs.empty()) {
+    slab = std::move(size_class.released_slabs.back());
+    size_class.released_slabs.pop_back();
+  } else {
+    slab = std::make_unique<Slab>();
+    slab->size_class = c;
+    slab->requested_sizes.reset(
+        new std::atomic<uint32>[size_class.num_objects]);
+    slab->allocation_ids.reset(
+        new std::atomic<int64_t>[size_class.num_objects]);
+  }
+  slab->base.store(base, std::memory_order_relaxed);
+  // Object 0 is claimed for the caller. Publishing the masks makes the slab
+  // available to threads that still refer to this Slab from its previous use.
+  *index = 0;
+  slab->free_mask[0].store(size_class.full_mask[0] & ~uint64{1},
+                           std::memory_order_release);
+  for (int w = 1; w < size_class.num_mask_words; ++w) {
+    slab->free_mask[w].store(size_class.full_mask[w],
+                             std::memory_order_release);
+  }
+  slab_map_.Insert(slab.get());
+  bytes_reserved_.fetch_add(kSlabBytes, std::memory_order_relaxed);
+  Slab* result = slab.get();
+  size_class.slabs.push_back(std::move(slab));
+  shard->current[c].store(result, std::memory_order_release);
+  return result;
+}
+
+bool SlabCache::Deallocate(void* ptr) {
+  if (ptr == nullptr) return false;
+  Slab* slab = slab_map_.Lookup(ptr);
+  if (slab == nullptr) return false;
+  const SizeClass& size_class = size_classes_[slab->size_class];
+  const size_t offset =
+      static_cast<char*>(ptr) - slab->base.load(std::memory_order_relaxed);
+  DCHECK_EQ(offset & (size_class.object_bytes - 1), 0)
+      << "Deallocating a pointer into an object: " << ptr;
+  const size_t index = offset >> size_class.object_bits;
+
+  Shard* shard = CurrentShard(shards_);
+  shard->bytes_in_use.fetch_sub(size_class.object_bytes,
+                                std::memory_order_relaxed);
+  const uint64 bit = uint64{1} << (index % 64);
+  const uint64 mask =
+      slab->free_mask[index / 64].fetch_or(bit, std::memory_order_release);
+  DCHECK_EQ(mask & bit, 0) << "Double free of " << ptr;
+  return true;
+}
+
+bool SlabCache::Lookup(const void* ptr, Object* object) const {
+  if (ptr == nullptr) return false;
+  const Slab* slab = slab_map_.Lookup(ptr);
+  if (slab == nullptr) return false;
+  const SizeClass& size_class = size_classes_[slab->size_class];
+  const size_t index = (static_cast<const char*>(ptr) -
+                        slab->base.load(std::memory_order_relaxed)) >>
+                       size_class.object_bits;
+  object->requested_size =
+      slab->requested_sizes[index].load(std::memory_order_relaxed);
+  object->allocated_size = size_class.object_bytes;
+  object->allocation_id =
+      slab->allocation_ids[index].load(std::memory_order_relaxed);
+  return true;
+}
+
+std::vector<void*> SlabCache::ReleaseEmptySlabs() {
+  std::vector<void*> released;
+  for (int c = 0; c < kNumSizeClasses; ++c) {
+    SizeClass& size_class = size_classes_[c];
+    mutex_lock l(size_class.mu);
+    auto& slabs = size_class.slabs;
+    for (size_t i = 0; i < slabs.size();) {
+      Slab* slab = slabs[i].get();
+      // Once all objects are claimed no thread can allocate from the slab,
+      // even if it still holds it as its current one.
+      if (!ClaimAll(size_class, slab)) {
+        ++i;
+        continue;
+      }
+      for (Shard& shard : shards_) {
+        Slab* expected = slab;
+        shard.current[c].compare_exchange_strong(expected, nullptr);
+      }
+      slab_map_.Erase(slab);
+      released.push_back(slab->base.load(std::memory_order_relaxed));
+      size_class.released_slabs.push_back(std::move(slabs[i]));
+      slabs[i] = std::move(slabs.back());
+      slabs.pop_back();
+    }
+    size_class.next_slab = 0;
+  }
+  bytes_reserved_.fetch_sub(released.size() * kSlabBytes,
+                            std::memory_order_relaxed);
+  return released;
+}
+
+SlabCache::Stats SlabCache::GetStats() const {
+  Stats stats;
+  for (const Shard& shard : shards_) {
+    stats.num_allocs += shard.num_allocs.load(std::memory_order_relaxed);
+    stats.bytes_in_use += shard.bytes_in_use.load(std::memory_order_relaxed);
+  }
+  stats.bytes_reserved = bytes_reserved_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void SlabCache::ClearStats() {
+  for (Shard& shard : shards_) {
+    shard.num_allocs.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace tsl
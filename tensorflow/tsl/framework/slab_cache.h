@@ -0,0 +1,205 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_FRAMEWORK_SLAB_CACHE_H_
+#define TENSORFLOW_TSL_FRAMEWORK_SLAB_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/tsl/platform/macros.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+
+// A cache of small allocations of a few fixed size classes, carved out of
+// larger slabs obtained from a backing allocator (e.g. the bins of a
+// BFCAllocator).
+//
+// Allocating and deallocating an object never takes a lock: each slab tracks
+// its free objects in an atomic bitmap, and threads are spread over a few
+// shards, each with its own current slab per size class. A lock is only taken
+// when a shard's current slab is exhausted.
+//
+// All bookkeeping lives in host memory; the memory of the slabs is never
+// touched, so the cache can front allocators of device memory.
+//
+// Slabs are only returned to the backing allocator, in bulk, by
+// ReleaseEmptySlabs().
+//
+// This class is thread-safe.
+class SlabCache {
+ public:
+  // Size of each slab. Slabs only need to be aligned to kMinObjectBytes.
+  static constexpr size_t kSlabBytes = size_t{64} << 10;
+  // Size classes are the powers of two from kMinObjectBytes to
+  // kMaxObjectBytes.
+  static constexpr size_t kMinObjectBytes = 256;
+  static constexpr size_t kMaxObjectBytes = 4096;
+  static constexpr int kNumSizeClasses = 5;
+
+  // Returns kSlabBytes of memory, or nullptr if none is available. Called
+  // without any of the cache's locks held.
+  using AllocateSlabFn = std::function<void*()>;
+
+  explicit SlabCache(AllocateSlabFn allocate_slab);
+
+  // Does not release the slabs still held by the cache; their memory belongs
+  // to the backing allocator.
+  ~SlabCache();
+
+  // Returns an object of at least `num_bytes`, or nullptr if `num_bytes` is 0
+  // or larger than kMaxObjectBytes, or if no slab could be allocated.
+  void* Allocate(size_t num_bytes);
+
+  // Returns false, and does nothing, if `ptr` was not allocated by this cache.
+  bool Deallocate(void* ptr);
+
+  // Information about an allocated object.
+  struct Object {
+    size_t requested_size = 0;
+    size_t allocated_size = 0;
+    // Unique among the objects allocated by this cache, greater than zero and
+    // disjoint from the allocation ids of a BFCAllocator.
+    int64_t allocation_id = 0;
+  };
+
+  // Returns false if `ptr` was not allocated by this cache.
+  bool Lookup(const void* ptr, Object* object) const;
+
+  // Removes the slabs none of whose objects are allocated from the cache and
+  // returns them. The caller is responsible for freeing them.
+  std::vector<void*> ReleaseEmptySlabs();
+
+  struct Stats {
+    int64_t num_allocs = 0;      // Number of objects allocated.
+    int64_t bytes_in_use = 0;    // Bytes of the objects in use.
+    int64_t bytes_reserved = 0;  // Bytes of the slabs held by the cache.
+  };
+  Stats GetStats() const;
+
+  // Resets Stats::num_allocs.
+  void ClearStats();
+
+ private:
+  // The number of 64-bit words needed for the free bitmap of the smallest
+  // size class.
+  static constexpr int kMaxMaskWords = kSlabBytes / kMinObjectBytes / 64;
+  static constexpr int kNumShards = 16;
+
+  struct Slab {
+    // Set before the slab is published, and only changed while no thread can
+    // allocate from it. A Slab is only ever reused for the same size class.
+    std::atomic<char*> base{nullptr};
+    int size_class = 0;
+    // Bit i is set iff object i is free.
+    std::atomic<uint64> free_mask[kMaxMaskWords];
+    std::unique_ptr<std::atomic<uint32>[]> requested_sizes;
+    std::unique_ptr<std::atomic<int64_t>[]> allocation_ids;
+  };
+
+  struct SizeClass {
+    size_t object_bytes = 0;
+    int object_bits = 0;
+    int num_objects = 0;
+    int num_mask_words = 0;
+    uint64 full_mask[kMaxMaskWords] = {};
+
+    mutex mu;
+    // Slabs the objects of this class are allocated from.
+    std::vector<std::unique_ptr<Slab>> slabs TF_GUARDED_BY(mu);
+    // Released slabs, kept alive for threads that may still refer to them and
+    // reused for new slabs.
+    std::vector<std::unique_ptr<Slab>> released_slabs TF_GUARDED_BY(mu);
+    // Where to continue searching `slabs` for free objects.
+    size_t next_slab TF_GUARDED_BY(mu) = 0;
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<Slab*> current[kNumSizeClasses] = {};
+    std::atomic<int64_t> num_allocs{0};
+    std::atomic<int64_t> bytes_in_use{0};
+    std::atomic<int64_t> next_allocation_id{0};
+  };
+
+  // Maps pointers to the slab containing them, without locks on lookup. The
+  // address space is split into kSlabBytes sized windows, and as slabs are
+  // only aligned to kMinObjectBytes, each window overlaps with at most one
+  // slab starting in it and one slab starting in the previous window. The
+  // windows are indexed by a four-level radix tree.
+  class SlabMap {
+   public:
+    SlabMap();
+    ~SlabMap();
+
+    void Insert(Slab* slab);
+    void Erase(Slab* slab);
+    Slab* Lookup(const void* ptr) const;
+
+   private:
+    static constexpr int kBitsPerLevel = 12;
+    static constexpr int kNumLevels = 4;
+    static constexpr size_t kFanout = size_t{1} << kBitsPerLevel;
+
+    struct Leaf {
+      std::atomic<Slab*> starting[kFanout];
+      std::atomic<Slab*> ending[kFanout];
+    };
+    struct Node {
+      std::atomic<void*> children[kFanout];
+    };
+
+    static size_t ChildIndex(uintptr_t window, int level);
+    Leaf* FindLeaf(uintptr_t window) const;
+    Leaf* FindOrCreateLeaf(uintptr_t window) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+    static void DeleteNode(Node* node, int level);
+
+    mutex mu_;
+    Node* const root_;
+
+    TF_DISALLOW_COPY_AND_ASSIGN(SlabMap);
+  };
+
+  static int SizeClassFor(size_t num_bytes);
+  static Shard* CurrentShard(Shard* shards);
+
+  // Claims a free object of `slab`, returning its index or -1 if it is full.
+  static int Claim(const SizeClass& size_class, Slab* slab);
+  // Claims all objects of `slab`, returning false if any is allocated.
+  static bool ClaimAll(const SizeClass& size_class, Slab* slab);
+
+  // Finds or allocates a slab with a free object of `size_class`, claims the
+  // object and makes the slab current for `shard`. Returns nullptr if no slab
+  // is available.
+  Slab* Refill(int size_class, Shard* shard, int* index);
+
+  const AllocateSlabFn allocate_slab_;
+  SizeClass size_classes_[kNumSizeClasses];
+  Shard shards_[kNumShards];
+  SlabMap slab_map_;
+  std::atomic<int64_t> bytes_reserved_{0};
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SlabCache);
+};
+
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_FRAMEWORK_SLAB_CACHE_H_
@@ -0,0 +1,271 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/framework/slab_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/mem.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+
+namespace tsl {
+namespace {
+
+constexpr size_t kSlabBytes = SlabCache::kSlabBytes;
+
+class SlabCacheTest : public ::testing::Test {
+ protected:
+  static constexpr int kMaxSlabs = 128;
+
+  SlabCacheTest()
+      : arena_(port::AlignedMalloc((kMaxSlabs + 1) * kSlabBytes, kSlabBytes)),
+        cache_([this] { return AllocateSlab(); }) {
+    // Offset the slabs so that each of them straddles two aligned windows.
+    char* base = static_cast<char*>(arena_) + SlabCache::kMinObjectBytes;
+    for (int i = kMaxSlabs - 1; i >= 0; --i) {
+      free_slabs_.push_back(base + i * kSlabBytes);
+    }
+  }
+
+  ~SlabCacheTest() override { port::AlignedFree(arena_); }
+
+  void* AllocateSlab() {
+    mutex_lock l(mu_);
+    if (free_slabs_.empty()) return nullptr;
+    void* slab = free_slabs_.back();
+    free_slabs_.pop_back();
+    return slab;
+  }
+
+  // Releases the empty slabs of the cache and returns how many there were.
+  int ReleaseEmptySlabs() {
+    std::vector<void*> slabs = cache_.ReleaseEmptySlabs();
+    mutex_lock l(mu_);
+    for (void* slab : slabs) {
+      EXPECT_GE(slab, arena_);
+      EXPECT_LT(slab, static_cast<char*>(arena_) + kMaxSlabs * kSlabBytes);
+      free_slabs_.push_back(slab);
+    }
+    return slabs.size();
+  }
+
+  int NumFreeSlabs() {
+    mutex_lock l(mu_);
+    return free_slabs_.size();
+  }
+
+  void* const arena_;
+  mutex mu_;
+  std::vector<void*> free_slabs_ TF_GUARDED_BY(mu_);
+  SlabCache cache_;
+};
+
+TEST_F(SlabCacheTest, AllocatesSizeClasses) {
+  const std::vector<std::pair<size_t, size_t>> sizes = {
+      {1, 256}, {256, 256}, {257, 512}, {1000, 1024}, {2048, 2048},
+      {4096, 4096}};
+  std::vector<void*> ptrs;
+  for (const auto& size : sizes) {
+    void* ptr = cache_.Allocate(size.first);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % SlabCache::kMinObjectBytes,
+              0);
+    SlabCache::Object object;
+    ASSERT_TRUE(cache_.Lookup(ptr, &object));
+    EXPECT_EQ(object.requested_size, size.first);
+    EXPECT_EQ(object.allocated_size, size.second);
+    EXPECT_GT(object.allocation_id, 0);
+    ptrs.push_back(ptr);
+  }
+  EXPECT_EQ(cache_.Allocate(0), nullptr);
+  EXPECT_EQ(cache_.Allocate(SlabCache::kMaxObjectBytes + 1), nullptr);
+  for (void* ptr : ptrs) {
+    EXPECT_TRUE(cache_.Deallocate(ptr));
+  }
+}
+
+TEST_F(SlabCacheTest, DistinctObjects) {
+  // Enough objects to fill several slabs.
+  constexpr int kNumObjects = 1000;
+  std::vector<char*> ptrs;
+  std::set<int64_t> ids;
+  for (int i = 0; i < kNumObjects; ++i) {
+    char* ptr = static_cast<char*>(cache_.Allocate(500));
+    ASSERT_NE(ptr, nullptr);
+    SlabCache::Object object;
+    ASSERT_TRUE(cache_.Lookup(ptr, &object));
+    ids.insert(object.allocation_id);
+    ptrs.push_back(ptr);
+  }
+  EXPECT_EQ(ids.size(), kNumObjects);
+  std::sort(ptrs.begin(), ptrs.end());
+  for (int i = 1; i < kNumObjects; ++i) {
+    EXPECT_GE(ptrs[i] - ptrs[i - 1], 512);
+  }
+  for (char* ptr : ptrs) {
+    EXPECT_TRUE(cache_.Deallocate(ptr));
+  }
+}
+
+TEST_F(SlabCacheTest, IgnoresUnknownPointers) {
+  void* ptr = cache_.Allocate(256);
+  ASSERT_NE(ptr, nullptr);
+  int local = 0;
+  SlabCache::Object object;
+  EXPECT_FALSE(cache_.Lookup(&local, &object));
+  EXPECT_FALSE(cache_.Deallocate(&local));
+  EXPECT_FALSE(cache_.Deallocate(nullptr));
+  // Memory right before and after the slab, sharing its windows.
+  char* slab = static_cast<char*>(ptr);
+  EXPECT_FALSE(cache_.Lookup(slab - SlabCache::kMinObjectBytes, &object));
+  EXPECT_FALSE(cache_.Lookup(slab + kSlabBytes, &object));
+  EXPECT_TRUE(cache_.Lookup(slab + kSlabBytes - SlabCache::kMinObjectBytes,
+                            &object));
+  EXPECT_TRUE(cache_.Deallocate(ptr));
+}
+
+TEST_F(SlabCacheTest, ReusesFreedObjects) {
+  void* ptr = cache_.Allocate(1024);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_TRUE(cache_.Deallocate(ptr));
+  EXPECT_EQ(cache_.Allocate(1024), ptr);
+  EXPECT_TRUE(cache_.Deallocate(ptr));
+  EXPECT_EQ(NumFreeSlabs(), kMaxSlabs - 1);
+}
+
+TEST_F(SlabCacheTest, ReleaseEmptySlabs) {
+  // Two slabs of 256 byte objects.
+  constexpr int kNumObjects = kSlabBytes / 256 + 1;
+  std::vector<void*> ptrs;
+  for (int i = 0; i < kNumObjects; ++i) {
+    ptrs.push_back(cache_.Allocate(256));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+  EXPECT_EQ(ReleaseEmptySlabs(), 0);
+  EXPECT_EQ(cache_.GetStats().bytes_reserved, 2 * kSlabBytes);
+
+  // Empty the first slab.
+  for (int i = 0; i < kNumObjects - 1; ++i) {
+    EXPECT_TRUE(cache_.Deallocate(ptrs[i]));
+  }
+  EXPECT_EQ(ReleaseEmptySlabs(), 1);
+  EXPECT_EQ(cache_.GetStats().bytes_reserved, kSlabBytes);
+  SlabCache::Object object;
+  EXPECT_FALSE(cache_.Lookup(ptrs[0], &object));
+  EXPECT_TRUE(cache_.Lookup(ptrs.back(), &object));
+
+  EXPECT_TRUE(cache_.Deallocate(ptrs.back()));
+  EXPECT_EQ(ReleaseEmptySlabs(), 1);
+  EXPECT_EQ(cache_.GetStats().bytes_reserved, 0);
+  EXPECT_EQ(NumFreeSlabs(), kMaxSlabs);
+
+  // Released slabs are allocated again on demand.
+  void* ptr = cache_.Allocate(256);
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_TRUE(cache_.Deallocate(ptr));
+  EXPECT_EQ(ReleaseEmptySlabs(), 1);
+}
+
+TEST_F(SlabCacheTest, RunsOutOfSlabs) {
+  std::vector<void*> ptrs;
+  for (int i = 0; i < kMaxSlabs * (kSlabBytes / 4096); ++i) {
+    ptrs.push_back(cache_.Allocate(4096));
+    ASSERT_NE(ptrs.back(), nullptr);
+  }
+  EXPECT_EQ(cache_.Allocate(4096), nullptr);
+  EXPECT_EQ(cache_.Allocate(256), nullptr);
+  EXPECT_TRUE(cache_.Deallocate(ptrs.back()));
+  EXPECT_EQ(cache_.Allocate(4096), ptrs.back());
+  for (void* ptr : ptrs) {
+    EXPECT_TRUE(cache_.Deallocate(ptr));
+  }
+  EXPECT_EQ(ReleaseEmptySlabs(), kMaxSlabs);
+}
+
+TEST_F(SlabCacheTest, Stats) {
+  void* a = cache_.Allocate(100);
+  void* b = cache_.Allocate(3000);
+  SlabCache::Stats stats = cache_.GetStats();
+  EXPECT_EQ(stats.num_allocs, 2);
+  EXPECT_EQ(stats.bytes_in_use, 256 + 4096);
+  EXPECT_EQ(stats.bytes_reserved, 2 * kSlabBytes);
+
+  EXPECT_TRUE(cache_.Deallocate(a));
+  cache_.ClearStats();
+  stats = cache_.GetStats();
+  EXPECT_EQ(stats.num_allocs, 0);
+  EXPECT_EQ(stats.bytes_in_use, 4096);
+  EXPECT_TRUE(cache_.Deallocate(b));
+  EXPECT_EQ(cache_.GetStats().bytes_in_use, 0);
+}
+
+TEST_F(SlabCacheTest, ConcurrentAllocations) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumIterations = 20000;
+  constexpr int kMaxLive = 32;
+  std::atomic<int> num_running{kNumThreads};
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads + 1);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([this, t, &num_running] {
+        std::mt19937 rng(t);
+        std::vector<std::pair<char*, size_t>> live;
+        for (int i = 0; i < kNumIterations; ++i) {
+          if (live.size() == kMaxLive || (!live.empty() && rng() % 2 == 0)) {
+            const int j = rng() % live.size();
+            // Objects must not have been handed out twice.
+            char* ptr = live[j].first;
+            ASSERT_EQ(ptr[0], static_cast<char>(t));
+            ASSERT_EQ(ptr[live[j].second - 1], static_cast<char>(t));
+            ASSERT_TRUE(cache_.Deallocate(ptr));
+            live[j] = live.back();
+            live.pop_back();
+          } else {
+            const size_t size = 1 + rng() % SlabCache::kMaxObjectBytes;
+            char* ptr = static_cast<char*>(cache_.Allocate(size));
+            ASSERT_NE(ptr, nullptr);
+            ptr[0] = ptr[size - 1] = static_cast<char>(t);
+            live.emplace_back(ptr, size);
+          }
+        }
+        for (const auto& object : live) {
+          ASSERT_TRUE(cache_.Deallocate(object.first));
+        }
+        --num_running;
+      });
+    }
+    // Release slabs while the other threads allocate from them.
+    pool.Schedule([this, &num_running] {
+      while (num_running > 0) {
+        ReleaseEmptySlabs();
+      }
+    });
+  }
+  EXPECT_EQ(cache_.GetStats().bytes_in_use, 0);
+  ReleaseEmptySlabs();
+  EXPECT_EQ(cache_.GetStats().bytes_reserved, 0);
+  EXPECT_EQ(NumFreeSlabs(), kMaxSlabs);
+}
+
+}  // namespace
+}  // namespace tsl
@@ -0,0 +1,159 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/lib/io/prefetching_random_access_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+
+namespace tsl {
+namespace io {
+
+struct PrefetchingRandomAccessFile::Window {
+  explicit Window(uint64 offset) : offset(offset) {}
+
+  const uint64 offset;
+  // Written by the background read before `done` is set, and immutable
+  // afterwards.
+  std::unique_ptr<char[]> scratch;
+  StringPiece data;
+  Status status;
+  // Guarded by the file's `mu_`.
+  bool done = false;
+};
+
+PrefetchingRandomAccessFile::PrefetchingRandomAccessFile(
+    RandomAccessFile* file, thread::ThreadPool* thread_pool,
+    const Options& options)
+    : file_(file),
+      thread_pool_(thread_pool),
+      window_size_(std::max<int64_t>(options.window_size, 1)),
+      num_windows_(std::max(options.num_windows, 1)),
+      end_of_file_(std::numeric_limits<uint64>::max()) {}
+
+PrefetchingRandomAccessFile::~PrefetchingRandomAccessFile() {
+  mutex_lock l(mu_);
+  while (num_in_flight_ > 0) {
+    cond_var_.wait(l);
+  }
+}
+
+Status PrefetchingRandomAccessFile::Name(StringPiece* result) const {
+  return file_->Name(result);
+}
+
+Status PrefetchingRandomAccessFile::Read(uint64 offset, size_t n,
+                                         StringPiece* result,
+                                         char* scratch) const {
+  mutex_lock l(mu_);
+  size_t bytes_read = 0;
+  while (bytes_read < n) {
+    const uint64 position = offset + bytes_read;
+    if (position >= end_of_file_) break;
+    if (windows_.empty() || position < windows_.front()->offset ||
+        position >= next_offset_) {
+      ResetLocked(position);
+    }
+    // Drop the windows the reader has moved past.
+    while (!windows_.empty() &&
+           windows_.front()->offset + window_size_ <= position) {
+      windows_.pop_front();
+    }
+    ScheduleLocked();
+    DCHECK(!windows_.empty());
+
+    // Holding a reference keeps the window alive if a concurrent read resets
+    // the windows while this one waits.
+    std::shared_ptr<Window> window = windows_.front();
+    if (!window->done) {
+      const uint64 start_us = Env::Default()->NowMicros();
+      while (!window->done) {
+        cond_var_.wait(l);
+      }
+      ++stats_.num_stalls;
+      stats_.stall_time_us += Env::Default()->NowMicros() - start_us;
+    }
+    if (!window->status.ok() && !errors::IsOutOfRange(window->status)) {
+      ResetLocked(position);
+      return window->status;
+    }
+
+    const uint64 window_offset = position - window->offset;
+    if (window_offset >= window->data.size()) break;
+    const size_t bytes_to_copy = std::min<uint64>(
+        window->data.size() - window_offset, n - bytes_read);
+    memcpy(scratch + bytes_read, window->data.data() + window_offset,
+           bytes_to_copy);
+    bytes_read += bytes_to_copy;
+  }
+  *result = StringPiece(scratch, bytes_read);
+  if (bytes_read < n) {
+    return errors::OutOfRange("Read less bytes than requested");
+  }
+  return OkStatus();
+}
+
+PrefetchingRandomAccessFile::Stats PrefetchingRandomAccessFile::stats() const {
+  mutex_lock l(mu_);
+  return stats_;
+}
+
+void PrefetchingRandomAccessFile::ResetLocked(uint64 offset) const {
+  // In-flight reads of the discarded windows still complete, but nothing waits
+  // for their data.
+  windows_.clear();
+  next_offset_ = offset;
+  end_of_file_ = std::numeric_limits<uint64>::max();
+}
+
+void PrefetchingRandomAccessFile::ScheduleLocked() const {
+  while (windows_.size() < num_windows_ && next_offset_ < end_of_file_) {
+    auto window = std::make_shared<Window>(next_offset_);
+    next_offset_ += window_size_;
+    windows_.push_back(window);
+    ++num_in_flight_;
+    // Files with a synchronous `ReadAsync()` block the pool thread, files
+    // with an asynchronous one (e.g. io_uring) return immediately and complete
+    // the window from their own thread.
+    thread_pool_->Schedule([this, window]() {
+      window->scratch.reset(new char[window_size_]);
+      file_->ReadAsync(
+          window->offset, window_size_, window->scratch.get(),
+          [this, window](const Status& status, StringPiece data) {
+            window->status = status;
+            window->data = data;
+            mutex_lock l(mu_);
+            if (window->data.size() < window_size_ &&
+                (window->status.ok() ||
+                 errors::IsOutOfRange(window->status))) {
+              end_of_file_ =
+                  std::min(end_of_file_, window->offset + window->data.size());
+            }
+            stats_.bytes_read_ahead += window->data.size();
+            window->done = true;
+            --num_in_flight_;
+            cond_var_.notify_all();
+          });
+    });
+  }
+}
+
+}  // namespace io
+}  // namespace tsl
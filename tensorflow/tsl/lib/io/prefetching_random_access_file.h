@@ -0,0 +1,117 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_PREFETCHING_RANDOM_ACCESS_FILE_H_
+#define TENSORFLOW_TSL_LIB_IO_PREFETCHING_RANDOM_ACCESS_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/file_system.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/stringpiece.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+// A RandomAccessFile that reads ahead of a sequential reader.
+//
+// The file is split into windows of `Options::window_size` bytes. Whenever a
+// read is served, up to `Options::num_windows` windows at and after the read
+// position are read from the underlying file in the background on
+// `thread_pool`, so a reader that consumes the file front to back (e.g. an
+// InputBuffer or a RecordReader refilling its buffer) finds its data already
+// in memory instead of waiting for the underlying file. A read that is not
+// within the windows read ahead (e.g. after a seek) discards them and
+// restarts reading ahead at the new position.
+//
+// The time reads spend waiting for background reads to complete is exported
+// through `stats()`.
+//
+// This class is thread-safe.
+class PrefetchingRandomAccessFile : public RandomAccessFile {
+ public:
+  struct Options {
+    // The number of bytes read from the underlying file by each background
+    // read.
+    int64_t window_size = 1 << 20;
+    // The maximum number of windows that are read ahead of the reader.
+    int num_windows = 4;
+  };
+
+  struct Stats {
+    // The number of reads that had to wait for a background read.
+    int64_t num_stalls = 0;
+    // The total time reads spent waiting for background reads.
+    int64_t stall_time_us = 0;
+    // The total number of bytes read from the underlying file.
+    int64_t bytes_read_ahead = 0;
+  };
+
+  // Does not take ownership of `file` or `thread_pool`, which must outlive
+  // *this.
+  PrefetchingRandomAccessFile(RandomAccessFile* file,
+                              thread::ThreadPool* thread_pool,
+                              const Options& options);
+
+  // Waits for all outstanding background reads.
+  ~PrefetchingRandomAccessFile() override;
+
+  Status Name(StringPiece* result) const override;
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override;
+
+  Stats stats() const;
+
+ private:
+  struct Window;
+
+  // Discards all windows and restarts reading ahead at `offset`.
+  void ResetLocked(uint64 offset) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Schedules background reads until `num_windows` windows are outstanding.
+  void ScheduleLocked() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  RandomAccessFile* const file_;           // Not owned.
+  thread::ThreadPool* const thread_pool_;  // Not owned.
+  const uint64 window_size_;
+  const size_t num_windows_;
+
+  mutable mutex mu_;
+  mutable condition_variable cond_var_;
+  // The windows at and after the current read position, in file order.
+  mutable std::deque<std::shared_ptr<Window>> windows_ TF_GUARDED_BY(mu_);
+  // The offset of the next window to schedule.
+  mutable uint64 next_offset_ TF_GUARDED_BY(mu_) = 0;
+  // The smallest offset at which a background read hit the end of the file.
+  mutable uint64 end_of_file_ TF_GUARDED_BY(mu_);
+  mutable int64_t num_in_flight_ TF_GUARDED_BY(mu_) = 0;
+  mutable Stats stats_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PrefetchingRandomAccessFile);
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_PREFETCHING_RANDOM_ACCESS_FILE_H_
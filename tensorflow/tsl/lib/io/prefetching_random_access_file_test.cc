@@ -0,0 +1,145 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/lib/io/prefetching_random_access_file.h"
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/lib/io/inputbuffer.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/test.h"
+#include "tensorflow/tsl/platform/threadpool.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+// Returns the contents of the test file: 10000 bytes that differ at every
+// offset modulo 251.
+std::string TestContents() {
+  std::string contents(10000, '\0');
+  for (int i = 0; i < contents.size(); ++i) {
+    contents[i] = static_cast<char>(i % 251);
+  }
+  return contents;
+}
+
+std::string WriteTestFile() {
+  Env* env = Env::Default();
+  std::string fname;
+  EXPECT_TRUE(env->LocalTempFilename(&fname));
+  TF_EXPECT_OK(WriteStringToFile(env, fname, TestContents()));
+  return fname;
+}
+
+// A file whose reads at or after `fail_offset` fail.
+class FailingFile : public RandomAccessFile {
+ public:
+  explicit FailingFile(uint64 fail_offset) : fail_offset_(fail_offset) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    if (offset >= fail_offset_) {
+      return errors::Unavailable("Injected failure");
+    }
+    memset(scratch, 'x', n);
+    *result = StringPiece(scratch, n);
+    return OkStatus();
+  }
+
+ private:
+  const uint64 fail_offset_;
+};
+
+TEST(PrefetchingRandomAccessFileTest, SequentialReads) {
+  const std::string fname = WriteTestFile();
+  const std::string contents = TestContents();
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  for (int64_t window_size : {1, 7, 100, 4096, 100000}) {
+    for (int num_windows : {1, 3}) {
+      std::unique_ptr<RandomAccessFile> file;
+      TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+      PrefetchingRandomAccessFile::Options options;
+      options.window_size = window_size;
+      options.num_windows = num_windows;
+      PrefetchingRandomAccessFile prefetching_file(file.get(), &thread_pool,
+                                                   options);
+      InputBuffer in(&prefetching_file, 333);
+      std::string result;
+      TF_ASSERT_OK(in.ReadNBytes(contents.size(), &result));
+      EXPECT_EQ(result, contents);
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &result)));
+      EXPECT_GE(prefetching_file.stats().bytes_read_ahead, contents.size());
+    }
+  }
+}
+
+TEST(PrefetchingRandomAccessFileTest, Seeks) {
+  const std::string fname = WriteTestFile();
+  const std::string contents = TestContents();
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  PrefetchingRandomAccessFile::Options options;
+  options.window_size = 512;
+  options.num_windows = 2;
+  PrefetchingRandomAccessFile prefetching_file(file.get(), &thread_pool,
+                                               options);
+  char scratch[1000];
+  StringPiece result;
+  for (uint64 offset : {5000, 0, 9000, 100, 3000, 3100, 2000}) {
+    TF_ASSERT_OK(prefetching_file.Read(offset, 1000, &result, scratch));
+    EXPECT_EQ(result, StringPiece(contents).substr(offset, 1000));
+  }
+}
+
+TEST(PrefetchingRandomAccessFileTest, ReadPastEndOfFile) {
+  const std::string fname = WriteTestFile();
+  const std::string contents = TestContents();
+  thread::ThreadPool thread_pool(Env::Default(), "test", 2);
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  PrefetchingRandomAccessFile prefetching_file(
+      file.get(), &thread_pool, PrefetchingRandomAccessFile::Options());
+  char scratch[1000];
+  StringPiece result;
+  EXPECT_TRUE(errors::IsOutOfRange(
+      prefetching_file.Read(9500, 1000, &result, scratch)));
+  EXPECT_EQ(result, StringPiece(contents).substr(9500));
+  EXPECT_TRUE(errors::IsOutOfRange(
+      prefetching_file.Read(20000, 1000, &result, scratch)));
+  EXPECT_TRUE(result.empty());
+}
+
+TEST(PrefetchingRandomAccessFileTest, PropagatesErrors) {
+  FailingFile file(/*fail_offset=*/1024);
+  thread::ThreadPool thread_pool(Env::Default(), "test", 2);
+  PrefetchingRandomAccessFile::Options options;
+  options.window_size = 512;
+  PrefetchingRandomAccessFile prefetching_file(&file, &thread_pool, options);
+  char scratch[512];
+  StringPiece result;
+  TF_ASSERT_OK(prefetching_file.Read(0, 512, &result, scratch));
+  TF_ASSERT_OK(prefetching_file.Read(512, 512, &result, scratch));
+  EXPECT_TRUE(errors::IsUnavailable(
+      prefetching_file.Read(1024, 512, &result, scratch)));
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
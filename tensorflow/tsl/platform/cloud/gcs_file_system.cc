@@ -42,10 +42,12 @@ limitations under the License.
 #include "tensorflow/tsl/platform/cloud/file_block_cache.h"
 #include "tensorflow/tsl/platform/cloud/google_auth_provider.h"
 #include "tensorflow/tsl/platform/cloud/ram_file_block_cache.h"
+#include "tensorflow/tsl/platform/cloud/tiered_file_block_cache.h"
 #include "tensorflow/tsl/platform/cloud/time_util.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/errors.h"
 #include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/notification.h"
 #include "tensorflow/tsl/platform/numbers.h"
 #include "tensorflow/tsl/platform/path.h"
 #include "tensorflow/tsl/platform/protobuf.h"
@@ -53,6 +55,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/str_util.h"
 #include "tensorflow/tsl/platform/stringprintf.h"
 #include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/profiler/lib/traceme.h"
 
 #ifdef _WIN32
@@ -160,11 +163,53 @@ constexpr char kAppendMode[] = "GCS_APPEND_MODE";
 // objects.
 constexpr char kComposeAppend[] = "compose";
 
+// The environment variable that enables parallel composite uploads of the
+// files written, by setting the size of their parts. Files of at least one
+// part are uploaded in parts, concurrently while being written, which are then
+// composed into the object. Specified in MB. Disabled if 0, the default.
+constexpr char kCompositeUploadPartSize[] = "GCS_COMPOSITE_UPLOAD_PART_SIZE_MB";
+// The environment variable that overrides the max number of parts of a file
+// uploaded concurrently.
+constexpr char kCompositeUploadParallelism[] =
+    "GCS_COMPOSITE_UPLOAD_PARALLELISM";
+
+// The max number of objects composed by a single compose request.
+constexpr size_t kMaxComposeSources = 32;
+// The max number of components of a composite object. Since the parts are
+// composed in batches of kMaxComposeSources, these are composed by two levels
+// of compose requests at most.
+constexpr size_t kMaxComposeComponents = 1024;
+
+// The size of the buffer used to copy the parts of a file before uploading
+// them.
+constexpr size_t kPartCopyBufferSize = 1024 * 1024;
+
 Status GetTmpFilename(string* filename) {
   *filename = io::GetTempFilename("");
   return OkStatus();
 }
 
+/// Copies bytes [start, end) of the local file `src` to the new file `dst`.
+Status CopyFileRange(const string& src, uint64 start, uint64 end,
+                     const string& dst) {
+  std::ifstream in(src, std::ifstream::binary);
+  std::ofstream out(dst, std::ofstream::binary);
+  in.seekg(start);
+  std::vector<char> buffer(std::min<uint64>(end - start, kPartCopyBufferSize));
+  uint64 pos = start;
+  while (pos < end &&
+         in.read(buffer.data(), std::min<uint64>(end - pos, buffer.size()))) {
+    out.write(buffer.data(), in.gcount());
+    pos += in.gcount();
+  }
+  out.close();
+  if (pos < end || !out.good()) {
+    return errors::Internal("Could not copy bytes ", start, "-", end,
+                            " of the internal temporary file.");
+  }
+  return OkStatus();
+}
+
 /// Appends a trailing slash if the name doesn't already have one.
 string MaybeAppendSlash(const string& name) {
   if (name.empty()) {
@@ -462,6 +507,11 @@ typedef std::function<Status(const string& fname, const string& bucket,
 ///
 /// Since GCS objects are immutable, this implementation writes to a local
 /// tmp file and copies it to GCS on flush/close.
+///
+/// If composite uploads are enabled, the parts of the tmp file are uploaded to
+/// temporary objects concurrently while the file is being written instead,
+/// and composed into the object on flush/close. The temporary objects are
+/// deleted once closed, or when the file is destroyed if closing it failed.
 class GcsWritableFile : public WritableFile {
  public:
   GcsWritableFile(const string& bucket, const string& object,
@@ -469,6 +519,7 @@ class GcsWritableFile : public WritableFile {
                   GcsFileSystem::TimeoutConfig* timeouts,
                   std::function<void()> file_cache_erase,
                   RetryConfig retry_config, bool compose_append,
+                  GcsFileSystem::CompositeUploadConfig composite_upload,
                   SessionCreator session_creator,
                   ObjectUploader object_uploader, StatusPoller status_poller,
                   GenerationGetter generation_getter)
@@ -480,6 +531,7 @@ class GcsWritableFile : public WritableFile {
         sync_needed_(true),
         retry_config_(retry_config),
         compose_append_(compose_append),
+        composite_upload_(composite_upload),
         start_offset_(0),
         session_creator_(std::move(session_creator)),
         object_uploader_(std::move(object_uploader)),
@@ -503,6 +555,7 @@ class GcsWritableFile : public WritableFile {
                   GcsFileSystem::TimeoutConfig* timeouts,
                   std::function<void()> file_cache_erase,
                   RetryConfig retry_config, bool compose_append,
+                  GcsFileSystem::CompositeUploadConfig composite_upload,
                   SessionCreator session_creator,
                   ObjectUploader object_uploader, StatusPoller status_poller,
                   GenerationGetter generation_getter)
@@ -514,6 +567,7 @@ class GcsWritableFile : public WritableFile {
         sync_needed_(true),
         retry_config_(retry_config),
         compose_append_(compose_append),
+        composite_upload_(composite_upload),
         start_offset_(0),
         session_creator_(std::move(session_creator)),
         object_uploader_(std::move(object_uploader)),
@@ -528,6 +582,10 @@ class GcsWritableFile : public WritableFile {
 
   ~GcsWritableFile() override {
     Close().IgnoreError();
+    // Waits for the parts still being uploaded, which read the tmp file.
+    part_upload_pool_.reset();
+    // The parts are kept after a failed close, for it to be retried.
+    DeleteParts();
     std::remove(tmp_content_filename_.c_str());
   }
 
@@ -540,7 +598,7 @@ class GcsWritableFile : public WritableFile {
       return errors::Internal(
           "Could not append to the internal temporary file.");
     }
-    return OkStatus();
+    return MaybeUploadParts();
   }
 
   Status Close() override {
@@ -549,6 +607,7 @@ class GcsWritableFile : public WritableFile {
       Status sync_status = Sync();
       if (sync_status.ok()) {
         outfile_.close();
+        DeleteParts();
       }
       return sync_status;
     }
@@ -589,17 +648,19 @@ class GcsWritableFile : public WritableFile {
  private:
   /// Copies the current version of the file to GCS.
   ///
-  /// This SyncImpl() uploads the object to GCS.
-  /// In case of a failure, it resumes failed uploads as recommended by the GCS
-  /// resumable API documentation. When the whole upload needs to be
-  /// restarted, Sync() returns UNAVAILABLE and relies on RetryingFileSystem.
+  /// This SyncImpl() uploads the object to GCS, in parts if composite uploads
+  /// are enabled and the file has at least one.
   Status SyncImpl() {
     outfile_.flush();
     if (!outfile_.good()) {
       return errors::Internal(
           "Could not write to the internal temporary file.");
     }
-    UploadSessionHandle session_handle;
+    uint64 file_size;
+    TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
+    if (UploadsParts() && file_size >= composite_upload_.part_size) {
+      return SyncParts(file_size);
+    }
     uint64 start_offset = 0;
     string object_to_upload = object_;
     bool should_compose = false;
@@ -613,24 +674,48 @@ class GcsWritableFile : public WritableFile {
                             io::Basename(object_), ".", start_offset_);
       }
     }
+    const Status upload_status = UploadFile(
+        object_to_upload, tmp_content_filename_, start_offset, file_size);
+    if (upload_status.ok()) {
+      // Erase the file from the file cache on every successful write.
+      // Note: Only local cache, this does nothing on distributed cache. The
+      // distributed cache clears the cache as it is needed.
+      file_cache_erase_();
+      if (should_compose) {
+        TF_RETURN_IF_ERROR(AppendObject(object_to_upload));
+      }
+      start_offset_ = file_size;
+    }
+    return upload_status;
+  }
+
+  /// Uploads bytes [start_offset, file_size) of the local file
+  /// `content_filename` to `object_to_upload`.
+  ///
+  /// In case of a failure, it resumes failed uploads as recommended by the GCS
+  /// resumable API documentation. When the whole upload needs to be
+  /// restarted, returns UNAVAILABLE and relies on RetryingFileSystem.
+  Status UploadFile(const string& object_to_upload,
+                    const string& content_filename, uint64 start_offset,
+                    uint64 file_size) {
+    UploadSessionHandle session_handle;
     TF_RETURN_IF_ERROR(CreateNewUploadSession(start_offset, object_to_upload,
-                                              &session_handle));
+                                              file_size, &session_handle));
     uint64 already_uploaded = 0;
     bool first_attempt = true;
     const Status upload_status = RetryingUtils::CallWithRetries(
-        [&first_attempt, &already_uploaded, &session_handle, &start_offset,
-         this]() {
+        [&first_attempt, &already_uploaded, &session_handle, &content_filename,
+         start_offset, file_size, this]() {
           if (session_handle.resumable && !first_attempt) {
             bool completed;
             TF_RETURN_IF_ERROR(RequestUploadSessionStatus(
-                session_handle.session_uri, &completed, &already_uploaded));
+                session_handle.session_uri, file_size, &completed,
+                &already_uploaded));
             LOG(INFO) << "### RequestUploadSessionStatus: completed = "
                       << completed
                       << ", already_uploaded = " << already_uploaded
                       << ", file = " << GetGcsPath();
             if (completed) {
-              // Erase the file from the file cache on every successful write.
-              file_cache_erase_();
               // It's unclear why UploadToSession didn't return OK in the
               // previous attempt, but GCS reports that the file is fully
               // uploaded, so succeed.
@@ -638,8 +723,8 @@ class GcsWritableFile : public WritableFile {
             }
           }
           first_attempt = false;
-          return UploadToSession(session_handle.session_uri, start_offset,
-                                 already_uploaded);
+          return UploadToSession(session_handle.session_uri, content_filename,
+                                 start_offset, already_uploaded, file_size);
         },
         retry_config_);
     if (errors::IsNotFound(upload_status)) {
@@ -649,13 +734,183 @@ class GcsWritableFile : public WritableFile {
           "Upload to gs://", bucket_, "/", object_,
           " failed, caused by: ", upload_status.error_message()));
     }
-    if (upload_status.ok()) {
-      if (should_compose) {
-        TF_RETURN_IF_ERROR(AppendObject(object_to_upload));
+    return upload_status;
+  }
+
+  /// Whether the file is uploaded in parts once it has at least one.
+  bool UploadsParts() const {
+    return composite_upload_.part_size > 0 && !compose_append_;
+  }
+
+  /// Returns the temporary object the part `index` of the file is uploaded to.
+  string PartObject(size_t index) const {
+    return strings::StrCat(io::Dirname(object_), "/.tmpcompose/",
+                           io::Basename(object_), ".part", index);
+  }
+
+  /// Returns the temporary object the batch `index` of parts is composed into
+  /// when there are more than kMaxComposeSources parts.
+  string ComposedPartsObject(size_t index) const {
+    return strings::StrCat(io::Dirname(object_), "/.tmpcompose/",
+                           io::Basename(object_), ".composed", index);
+  }
+
+  /// Whether another part can be uploaded in the background. The last part
+  /// holds the rest of the file, so that the object has at most
+  /// kMaxComposeComponents components however large the file.
+  bool CanUploadPart(uint64 file_size) const {
+    return parts_.size() + 1 < kMaxComposeComponents &&
+           (parts_.size() + 1) * composite_upload_.part_size <= file_size;
+  }
+
+  /// Starts uploading the parts of the file completed since the last call, if
+  /// any, in the background.
+  Status MaybeUploadParts() {
+    if (!UploadsParts()) {
+      return OkStatus();
+    }
+    const uint64 part_size = composite_upload_.part_size;
+    uint64 file_size;
+    TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
+    if (!CanUploadPart(file_size)) {
+      return OkStatus();
+    }
+    // The parts are read from the tmp file by the upload threads.
+    outfile_.flush();
+    if (!outfile_.good()) {
+      return errors::Internal(
+          "Could not write to the internal temporary file.");
+    }
+    if (part_upload_pool_ == nullptr) {
+      part_upload_pool_ = std::make_unique<thread::ThreadPool>(
+          Env::Default(), "gcs_part_upload",
+          std::max(composite_upload_.parallelism, 1));
+    }
+    while (CanUploadPart(file_size)) {
+      const uint64 start = parts_.size() * part_size;
+      parts_.push_back(std::make_unique<Part>());
+      Part* part = parts_.back().get();
+      part->object = PartObject(parts_.size() - 1);
+      part_upload_pool_->Schedule([this, part, start, part_size] {
+        part->status = UploadPart(part->object, start, start + part_size);
+        part->uploaded.Notify();
+      });
+    }
+    return OkStatus();
+  }
+
+  /// Uploads bytes [start, end) of the file to `part_object`, from a copy of
+  /// them, since the tmp file may still grow while they are uploaded.
+  Status UploadPart(const string& part_object, uint64 start, uint64 end) {
+    string part_filename;
+    TF_RETURN_IF_ERROR(GetTmpFilename(&part_filename));
+    Status status =
+        CopyFileRange(tmp_content_filename_, start, end, part_filename);
+    if (status.ok()) {
+      status = UploadFile(part_object, part_filename, 0, end - start);
+    }
+    std::remove(part_filename.c_str());
+    return status;
+  }
+
+  /// Uploads the rest of the file as its last part once the other parts are
+  /// uploaded, and composes the parts into the object.
+  Status SyncParts(uint64 file_size) {
+    TF_RETURN_IF_ERROR(MaybeUploadParts());
+    const uint64 part_size = composite_upload_.part_size;
+    for (const auto& part : parts_) {
+      part->uploaded.WaitForNotification();
+    }
+    std::vector<string> part_objects;
+    for (size_t i = 0; i < parts_.size(); ++i) {
+      Part* part = parts_[i].get();
+      if (!part->status.ok()) {
+        // The upload of the part was already retried, but the part is not
+        // lost: it is uploaded again before failing the sync.
+        LOG(WARNING) << "Retrying the upload of " << part->object << ": "
+                     << part->status;
+        part->status =
+            UploadPart(part->object, i * part_size, (i + 1) * part_size);
+        TF_RETURN_IF_ERROR(part->status);
+      }
+      part_objects.push_back(part->object);
+    }
+    const uint64 parts_end = parts_.size() * part_size;
+    if (file_size > parts_end) {
+      part_objects.push_back(PartObject(parts_.size()));
+      num_part_objects_ = std::max(num_part_objects_, part_objects.size());
+      TF_RETURN_IF_ERROR(
+          UploadPart(part_objects.back(), parts_end, file_size));
+    }
+    TF_RETURN_IF_ERROR(ComposeParts(part_objects));
+    // Erase the file from the file cache on every successful write.
+    file_cache_erase_();
+    return OkStatus();
+  }
+
+  /// Composes `part_objects` into the object with a single compose request,
+  /// so that the object is never left with only some of the parts. Beyond
+  /// kMaxComposeSources parts, batches of them are first composed into
+  /// temporary objects, which are composed into the object.
+  Status ComposeParts(const std::vector<string>& part_objects) {
+    if (part_objects.size() <= kMaxComposeSources) {
+      return ComposeObjects(object_, SourceObjects(part_objects.begin(),
+                                                   part_objects.end()));
+    }
+    std::vector<string> composed_objects;
+    Status status;
+    for (size_t i = 0; i < part_objects.size() && status.ok();
+         i += kMaxComposeSources) {
+      const size_t end = std::min(part_objects.size(), i + kMaxComposeSources);
+      composed_objects.push_back(ComposedPartsObject(composed_objects.size()));
+      status = ComposeObjects(
+          composed_objects.back(),
+          SourceObjects(part_objects.begin() + i, part_objects.begin() + end));
+    }
+    if (status.ok()) {
+      status = ComposeObjects(object_, SourceObjects(composed_objects.begin(),
+                                                     composed_objects.end()));
+    }
+    // Recomposed from the parts if the sync is retried.
+    DeleteTemporaryObjects(composed_objects);
+    return status;
+  }
+
+  /// Returns the JSON list of the source objects [begin, end) of a compose
+  /// request.
+  static string SourceObjects(std::vector<string>::const_iterator begin,
+                              std::vector<string>::const_iterator end) {
+    string source_objects;
+    for (auto it = begin; it != end; ++it) {
+      strings::StrAppend(&source_objects, source_objects.empty() ? "" : ",",
+                         "{'name': '", *it, "'}");
+    }
+    return source_objects;
+  }
+
+  /// Deletes the temporary objects of the parts of the file, if any.
+  void DeleteParts() {
+    std::vector<string> part_objects;
+    for (size_t i = 0; i < std::max(num_part_objects_, parts_.size()); ++i) {
+      part_objects.push_back(PartObject(i));
+    }
+    DeleteTemporaryObjects(part_objects);
+    parts_.clear();
+    num_part_objects_ = 0;
+  }
+
+  /// Deletes `objects`, logging failures.
+  void DeleteTemporaryObjects(const std::vector<string>& objects) {
+    for (const string& object : objects) {
+      const string path = GetGcsPathWithObject(object);
+      const Status status = RetryingUtils::DeleteWithRetries(
+          [&path, this]() { return filesystem_->DeleteFile(path, nullptr); },
+          retry_config_);
+      if (!status.ok()) {
+        LOG(WARNING) << "Failed to delete the temporary object " << path
+                     << " of " << GetGcsPath() << ": " << status;
       }
-      TF_RETURN_IF_ERROR(GetCurrentFileSize(&start_offset_));
     }
-    return upload_status;
   }
 
   Status CheckWritable() const {
@@ -678,10 +933,8 @@ class GcsWritableFile : public WritableFile {
 
   /// Initiates a new resumable upload session.
   Status CreateNewUploadSession(uint64 start_offset,
-                                std::string object_to_upload,
+                                std::string object_to_upload, uint64 file_size,
                                 UploadSessionHandle* session_handle) {
-    uint64 file_size;
-    TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
     return session_creator_(start_offset, object_to_upload, bucket_, file_size,
                             GetGcsPath(), session_handle);
   }
@@ -696,33 +949,43 @@ class GcsWritableFile : public WritableFile {
     TF_RETURN_IF_ERROR(
         generation_getter_(GetGcsPath(), bucket_, object_, &generation));
 
-    TF_RETURN_IF_ERROR(RetryingUtils::CallWithRetries(
-        [&append_object, &generation, this]() {
+    TF_RETURN_IF_ERROR(ComposeObjects(
+        object_,
+        strings::StrCat("{'name': '", object_,
+                        "','objectPrecondition':{'ifGenerationMatch':",
+                        generation, "}},{'name': '", append_object, "'}")));
+
+    return RetryingUtils::DeleteWithRetries(
+        [&append_object_path, this]() {
+          return filesystem_->DeleteFile(append_object_path, nullptr);
+        },
+        retry_config_);
+  }
+
+  /// Composes the objects of `source_objects`, the JSON list of the source
+  /// objects of a compose request, into `destination`.
+  Status ComposeObjects(const string& destination,
+                        const string& source_objects) {
+    return RetryingUtils::CallWithRetries(
+        [&destination, &source_objects, this]() {
           std::unique_ptr<HttpRequest> request;
           TF_RETURN_IF_ERROR(filesystem_->CreateHttpRequest(&request));
 
           request->SetUri(strings::StrCat(kGcsUriBase, "b/", bucket_, "/o/",
-                                          request->EscapeString(object_),
+                                          request->EscapeString(destination),
                                           "/compose"));
 
-          const string request_body = strings::StrCat(
-              "{'sourceObjects': [{'name': '", object_,
-              "','objectPrecondition':{'ifGenerationMatch':", generation,
-              "}},{'name': '", append_object, "'}]}");
+          const string request_body =
+              strings::StrCat("{'sourceObjects': [", source_objects, "]}");
           request->SetTimeouts(timeouts_->connect, timeouts_->idle,
                                timeouts_->metadata);
           request->AddHeader("content-type", "application/json");
           request->SetPostFromBuffer(request_body.c_str(), request_body.size());
-          TF_RETURN_WITH_CONTEXT_IF_ERROR(request->Send(),
-                                          " when composing to ", GetGcsPath());
+          TF_RETURN_WITH_CONTEXT_IF_ERROR(
+              request->Send(), " when composing to ",
+              GetGcsPathWithObject(destination));
           return OkStatus();
         },
-        retry_config_));
-
-    return RetryingUtils::DeleteWithRetries(
-        [&append_object_path, this]() {
-          return filesystem_->DeleteFile(append_object_path, nullptr);
-        },
         retry_config_);
   }
 
@@ -731,30 +994,18 @@ class GcsWritableFile : public WritableFile {
   /// If the upload has already succeeded, sets 'completed' to true.
   /// Otherwise sets 'completed' to false and 'uploaded' to the currently
   /// uploaded size in bytes.
-  Status RequestUploadSessionStatus(const string& session_uri, bool* completed,
-                                    uint64* uploaded) {
-    uint64 file_size;
-    TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
+  Status RequestUploadSessionStatus(const string& session_uri, uint64 file_size,
+                                    bool* completed, uint64* uploaded) {
     return status_poller_(session_uri, file_size, GetGcsPath(), completed,
                           uploaded);
   }
 
-  /// Uploads data to object.
-  Status UploadToSession(const string& session_uri, uint64 start_offset,
-                         uint64 already_uploaded) {
-    uint64 file_size;
-    TF_RETURN_IF_ERROR(GetCurrentFileSize(&file_size));
-    Status status =
-        object_uploader_(session_uri, start_offset, already_uploaded,
-                         tmp_content_filename_, file_size, GetGcsPath());
-    if (status.ok()) {
-      // Erase the file from the file cache on every successful write.
-      // Note: Only local cache, this does nothing on distributed cache. The
-      // distributed cache clears the cache as it is needed.
-      file_cache_erase_();
-    }
-
-    return status;
+  /// Uploads data of `content_filename` to object.
+  Status UploadToSession(const string& session_uri,
+                         const string& content_filename, uint64 start_offset,
+                         uint64 already_uploaded, uint64 file_size) {
+    return object_uploader_(session_uri, start_offset, already_uploaded,
+                            content_filename, file_size, GetGcsPath());
   }
 
   string GetGcsPathWithObject(string object) const {
@@ -772,12 +1023,28 @@ class GcsWritableFile : public WritableFile {
   bool sync_needed_;  // whether there is buffered data that needs to be synced
   RetryConfig retry_config_ = GetGcsRetryConfig();
   bool compose_append_;
+  const GcsFileSystem::CompositeUploadConfig composite_upload_;
   uint64 start_offset_;
   // Callbacks to the file system used to upload object into GCS.
   const SessionCreator session_creator_;
   const ObjectUploader object_uploader_;
   const StatusPoller status_poller_;
   const GenerationGetter generation_getter_;
+
+  /// \brief A part of the file, uploaded to a temporary object in the
+  /// background.
+  struct Part {
+    string object;
+    /// The status of the upload, once `uploaded` is notified.
+    Status status;
+    Notification uploaded;
+  };
+  // The parts of the file uploaded so far, in order.
+  std::vector<std::unique_ptr<Part>> parts_;
+  // The number of temporary part objects to delete on close.
+  size_t num_part_objects_ = 0;
+  // The threads uploading the parts, created with the first part.
+  std::unique_ptr<thread::ThreadPool> part_upload_pool_;
 };
 
 class GcsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
@@ -846,12 +1113,39 @@ GcsFileSystem::GcsFileSystem(bool make_default_cache) {
   if (GetEnvVar(kMaxStaleness, strings::safe_strtou64, &value)) {
     max_staleness = value;
   }
+
+  StringPiece disk_cache_dir;
+  if (GetEnvVar(kDiskCacheDir, StringPieceIdentity, &disk_cache_dir)) {
+    disk_cache_dir_ = string(disk_cache_dir);
+    max_disk_bytes_ = kDefaultMaxDiskCacheSize;
+  }
+
+  if (GetEnvVar(kMaxDiskCacheSize, strings::safe_strtou64, &value)) {
+    max_disk_bytes_ = value * 1024 * 1024;
+  }
+
+  if (GetEnvVar(kMaxReadaheadBlocks, strings::safe_strtou64, &value)) {
+    max_readahead_blocks_ = value;
+  }
+
+  if (GetEnvVar(kCompositeUploadPartSize, strings::safe_strtou64, &value)) {
+    composite_upload_config_.part_size = value * 1024 * 1024;
+  }
+  int32_t parallelism;
+  if (GetEnvVar(kCompositeUploadParallelism, strings::safe_strto32,
+                &parallelism)) {
+    composite_upload_config_.parallelism = parallelism;
+  }
   if (!make_default_cache) {
     max_bytes = 0;
+    max_disk_bytes_ = 0;
   }
   VLOG(1) << "GCS cache max size = " << max_bytes << " ; "
           << "block size = " << block_size_ << " ; "
-          << "max staleness = " << max_staleness;
+          << "max staleness = " << max_staleness << " ; "
+          << "disk cache dir = " << disk_cache_dir_ << " ; "
+          << "disk cache max size = " << max_disk_bytes_ << " ; "
+          << "max readahead blocks = " << max_readahead_blocks_;
   file_block_cache_ = MakeFileBlockCache(block_size_, max_bytes, max_staleness);
   // Apply overrides for the stat cache max age and max entries, if provided.
   uint64 stat_cache_max_age = kStatCacheDefaultMaxAge;
@@ -1072,16 +1366,35 @@ void GcsFileSystem::ResetFileBlockCache(size_t block_size_bytes,
   }
 }
 
+GcsFileSystem::~GcsFileSystem() {
+  // The block cache may still be reading blocks ahead with the other members.
+  mutex_lock l(block_cache_lock_);
+  file_block_cache_.reset();
+}
+
 // A helper function to build a FileBlockCache for GcsFileSystem.
 std::unique_ptr<FileBlockCache> GcsFileSystem::MakeFileBlockCache(
     size_t block_size, size_t max_bytes, uint64 max_staleness) {
-  std::unique_ptr<FileBlockCache> file_block_cache(new RamFileBlockCache(
-      block_size, max_bytes, max_staleness,
-      [this](const string& filename, size_t offset, size_t n, char* buffer,
-             size_t* bytes_transferred) {
-        return LoadBufferFromGCS(filename, offset, n, buffer,
-                                 bytes_transferred);
-      }));
+  auto block_fetcher = [this](const string& filename, size_t offset, size_t n,
+                              char* buffer, size_t* bytes_transferred) {
+    return LoadBufferFromGCS(filename, offset, n, buffer, bytes_transferred);
+  };
+  // Blocks are only read ahead while the throttle admits requests, so that
+  // reading ahead does not delay the reads themselves.
+  auto readahead_allowed = [this] {
+    return !throttle_.is_enabled() || throttle_.available_tokens() > 0;
+  };
+  std::unique_ptr<FileBlockCache> file_block_cache;
+  if (!disk_cache_dir_.empty() && max_disk_bytes_ > 0) {
+    file_block_cache.reset(new TieredFileBlockCache(
+        block_size, max_bytes, max_staleness, disk_cache_dir_, max_disk_bytes_,
+        block_fetcher, Env::Default(), max_readahead_blocks_,
+        readahead_allowed));
+  } else {
+    file_block_cache.reset(new RamFileBlockCache(
+        block_size, max_bytes, max_staleness, block_fetcher, Env::Default(),
+        max_readahead_blocks_, readahead_allowed));
+  }
 
   // Check if cache is enabled here to avoid unnecessary mutex contention.
   cache_enabled_ = file_block_cache->IsCacheEnabled();
@@ -1347,8 +1660,8 @@ Status GcsFileSystem::NewWritableFile(const string& fname,
   result->reset(new GcsWritableFile(
       bucket, object, this, &timeouts_,
       [this, fname]() { ClearFileCaches(fname); }, retry_config_,
-      compose_append_, session_creator, object_uploader, status_poller,
-      generation_getter));
+      compose_append_, composite_upload_config_, session_creator,
+      object_uploader, status_poller, generation_getter));
   return OkStatus();
 }
 
@@ -1427,8 +1740,8 @@ Status GcsFileSystem::NewAppendableFile(const string& fname,
   result->reset(new GcsWritableFile(
       bucket, object, this, old_content_filename, &timeouts_,
       [this, fname]() { ClearFileCaches(fname); }, retry_config_,
-      compose_append_, session_creator, object_uploader, status_poller,
-      generation_getter));
+      compose_append_, composite_upload_config_, session_creator,
+      object_uploader, status_poller, generation_getter));
   return OkStatus();
 }
 
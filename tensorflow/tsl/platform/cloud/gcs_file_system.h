@@ -62,6 +62,18 @@ constexpr size_t kDefaultMaxCacheSize = 0;
 // will be evicted on the next read.
 constexpr char kMaxStaleness[] = "GCS_READ_CACHE_MAX_STALENESS";
 constexpr uint64 kDefaultMaxStaleness = 0;
+// The environment variable that sets a local directory, e.g. on an SSD, in
+// which blocks read from GCS are also cached. Blocks in the directory are
+// reused across process restarts and shared by the processes of a host.
+constexpr char kDiskCacheDir[] = "GCS_READ_CACHE_DISK_DIR";
+// The environment variable that overrides the max size of the blocks cached in
+// the kDiskCacheDir directory. Specified in MB.
+constexpr char kMaxDiskCacheSize[] = "GCS_READ_CACHE_DISK_MAX_SIZE_MB";
+constexpr size_t kDefaultMaxDiskCacheSize = 10240LL * 1024LL * 1024LL;
+// The environment variable that sets the max number of blocks read ahead of
+// sequential reads, with concurrent requests. Reading ahead is disabled if 0.
+constexpr char kMaxReadaheadBlocks[] = "GCS_READ_CACHE_MAX_READAHEAD_BLOCKS";
+constexpr size_t kDefaultMaxReadaheadBlocks = 0;
 
 // Helper function to extract an environment variable and convert it into a
 // value of type T.
@@ -125,6 +137,7 @@ struct UploadSessionHandle {
 class GcsFileSystem : public FileSystem {
  public:
   struct TimeoutConfig;
+  struct CompositeUploadConfig;
 
   // Main constructor used (via RetryingFileSystem) throughout Tensorflow
   explicit GcsFileSystem(bool make_default_cache = true);
@@ -142,6 +155,8 @@ class GcsFileSystem : public FileSystem {
                 std::pair<const string, const string>* additional_header,
                 bool compose_append);
 
+  ~GcsFileSystem() override;
+
   TF_USE_FILESYSTEM_METHODS_WITH_NO_TRANSACTION_SUPPORT;
 
   Status NewRandomAccessFile(
@@ -209,12 +224,18 @@ class GcsFileSystem : public FileSystem {
     tf_shared_lock l(block_cache_lock_);
     return file_block_cache_->max_staleness();
   }
+  const string& disk_cache_dir() const { return disk_cache_dir_; }
+  size_t max_disk_bytes() const { return max_disk_bytes_; }
+  size_t max_readahead_blocks() const { return max_readahead_blocks_; }
   TimeoutConfig timeouts() const { return timeouts_; }
   std::unordered_set<string> allowed_locations() const {
     return allowed_locations_;
   }
 
   bool compose_append() const { return compose_append_; }
+  CompositeUploadConfig composite_upload_config() const {
+    return composite_upload_config_;
+  }
   string additional_header_name() const {
     return additional_header_ ? additional_header_->first : "";
   }
@@ -267,6 +288,16 @@ class GcsFileSystem : public FileSystem {
           write(write) {}
   };
 
+  struct CompositeUploadConfig {
+    // The size of the parts files are uploaded in, concurrently while being
+    // written, once they have at least one. The parts are composed into the
+    // object on flush. Composite uploads are disabled if 0.
+    uint64 part_size = 0;
+
+    // The max number of parts of a file uploaded concurrently.
+    int parallelism = 8;
+  };
+
   Status CreateHttpRequest(std::unique_ptr<HttpRequest>* request);
 
   /// \brief Sets a new AuthProvider on the GCS FileSystem.
@@ -274,6 +305,13 @@ class GcsFileSystem : public FileSystem {
   /// The new auth provider will be used for all subsequent requests.
   void SetAuthProvider(std::unique_ptr<AuthProvider> auth_provider);
 
+  /// \brief Sets how the files subsequently opened for writing are uploaded.
+  ///
+  /// Composite uploads are not used in the compose append mode.
+  void SetCompositeUploadConfig(const CompositeUploadConfig& config) {
+    composite_upload_config_ = config;
+  }
+
   /// \brief Resets the block cache and re-instantiates it with the new values.
   ///
   /// This method can be used to clear the existing block cache and/or to
@@ -415,6 +453,15 @@ class GcsFileSystem : public FileSystem {
   // Reads smaller than block_size_ will trigger a read of block_size_.
   uint64 block_size_;
 
+  // The local directory in which blocks are also cached, and the max size of
+  // the blocks in it. Blocks are only cached in memory if empty. Declared
+  // before file_block_cache_, which is made with them.
+  string disk_cache_dir_;
+  size_t max_disk_bytes_ = 0;
+
+  // The max number of blocks read ahead of sequential reads.
+  size_t max_readahead_blocks_ = kDefaultMaxReadaheadBlocks;
+
   // block_cache_lock_ protects the file_block_cache_ pointer (Note that
   // FileBlockCache instances are themselves threadsafe).
   mutex block_cache_lock_;
@@ -435,6 +482,7 @@ class GcsFileSystem : public FileSystem {
   std::unique_ptr<BucketLocationCache> bucket_location_cache_;
   std::unordered_set<string> allowed_locations_;
   bool compose_append_;
+  CompositeUploadConfig composite_upload_config_;
 
   GcsStatsInterface* stats_ = nullptr;  // Not owned.
 
@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/tsl/lib/core/status_test_util.h"
 #include "tensorflow/tsl/platform/cloud/http_request_fake.h"
 #include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/path.h"
 #include "tensorflow/tsl/platform/str_util.h"
 #include "tensorflow/tsl/platform/strcat.h"
 #include "tensorflow/tsl/platform/test.h"
@@ -1332,6 +1333,436 @@ TEST(GcsFileSystemTest, NewWritableFile_NoObjectName) {
       fs.NewWritableFile("gs://bucket/", nullptr, &file)));
 }
 
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUpload) {
+  std::vector<HttpRequest*> requests(
+      {// Upload the parts completed by the appends in the background.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.part0\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/location0"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/location0\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-7/8\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: content1\n",
+                           ""),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.part1\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/location1"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/location1\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-7/8\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: ,content\n",
+                           ""),
+       // Upload the rest of the file on close.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.part2\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 1\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/location2"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/location2\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-0/1\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: 2\n",
+                           ""),
+       // Compose the parts into the object.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "path%2Fwriteable/compose\n"
+           "Auth Token: fake_token\n"
+           "Timeouts: 5 1 10\n"
+           "Header content-type: application/json\n"
+           "Post body: {'sourceObjects': ["
+           "{'name': 'path/.tmpcompose/writeable.part0'},"
+           "{'name': 'path/.tmpcompose/writeable.part1'},"
+           "{'name': 'path/.tmpcompose/writeable.part2'}]}\n",
+           ""),
+       // Delete the parts.
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.part0\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           ""),
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.part1\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           ""),
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.part2\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           "")});
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 0 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+  GcsFileSystem::CompositeUploadConfig config;
+  config.part_size = 8;
+  // Uploads the parts one at a time, in the order of the requests above.
+  config.parallelism = 1;
+  fs.SetCompositeUploadConfig(config);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs.NewWritableFile("gs://bucket/path/writeable", nullptr, &file));
+
+  TF_EXPECT_OK(file->Append("content1,"));
+  TF_EXPECT_OK(file->Append("content2"));
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadRetriesFailedPart) {
+  std::vector<HttpRequest*> requests(
+      {// The upload of the first part fails in the background...
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.part0\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", errors::Unavailable("503"), 503),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.part1\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/location1"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/location1\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-7/8\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: content2\n",
+                           ""),
+       // ...and is retried on close, before composing the parts.
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+           "uploadType=resumable&name=path%2F.tmpcompose%2Fwriteable.part0\n"
+           "Auth Token: fake_token\n"
+           "Header X-Upload-Content-Length: 8\n"
+           "Post: yes\n"
+           "Timeouts: 5 1 10\n",
+           "", {{"Location", "https://custom/upload/location0"}}),
+       new FakeHttpRequest("Uri: https://custom/upload/location0\n"
+                           "Auth Token: fake_token\n"
+                           "Header Content-Range: bytes 0-7/8\n"
+                           "Timeouts: 5 1 30\n"
+                           "Put body: content1\n",
+                           ""),
+       new FakeHttpRequest(
+           "Uri: https://www.googleapis.com/storage/v1/b/bucket/o/"
+           "path%2Fwriteable/compose\n"
+           "Auth Token: fake_token\n"
+           "Timeouts: 5 1 10\n"
+           "Header content-type: application/json\n"
+           "Post body: {'sourceObjects': ["
+           "{'name': 'path/.tmpcompose/writeable.part0'},"
+           "{'name': 'path/.tmpcompose/writeable.part1'}]}\n",
+           ""),
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.part0\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           ""),
+       new FakeHttpRequest("Uri: https://www.googleapis.com/storage/v1/b/"
+                           "bucket/o/path%2F.tmpcompose%2Fwriteable.part1\n"
+                           "Auth Token: fake_token\n"
+                           "Timeouts: 5 1 10\n"
+                           "Delete: yes\n",
+                           "")});
+  GcsFileSystem fs(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(&requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 0 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+  GcsFileSystem::CompositeUploadConfig config;
+  config.part_size = 8;
+  config.parallelism = 1;
+  fs.SetCompositeUploadConfig(config);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs.NewWritableFile("gs://bucket/path/writeable", nullptr, &file));
+
+  TF_EXPECT_OK(file->Append("content1"));
+  TF_EXPECT_OK(file->Append("content2"));
+  TF_EXPECT_OK(file->Close());
+}
+
+// Returns the object holding the part `index` of gs://bucket/path/writeable.
+string PartObject(int index) {
+  return strings::StrCat("path/.tmpcompose/writeable.part", index);
+}
+
+// Returns the object holding the batch `index` of parts of
+// gs://bucket/path/writeable.
+string ComposedPartsObject(int index) {
+  return strings::StrCat("path/.tmpcompose/writeable.composed", index);
+}
+
+// Returns `object` escaped as in the URIs of the requests.
+string EscapedObject(const string& object) {
+  return str_util::StringReplace(object, "/", "%2F", /*replace_all=*/true);
+}
+
+// Appends the requests uploading `content` to the part `index` of
+// gs://bucket/path/writeable to `requests`.
+void AddPartUploadRequests(int index, const string& content,
+                           std::vector<HttpRequest*>* requests) {
+  requests->push_back(new FakeHttpRequest(
+      strings::StrCat(
+          "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+          "uploadType=resumable&name=",
+          EscapedObject(PartObject(index)),
+          "\n"
+          "Auth Token: fake_token\n"
+          "Header X-Upload-Content-Length: ",
+          content.size(),
+          "\n"
+          "Post: yes\n"
+          "Timeouts: 5 1 10\n"),
+      "", {{"Location", "https://custom/upload/location"}}));
+  requests->push_back(new FakeHttpRequest(
+      strings::StrCat("Uri: https://custom/upload/location\n"
+                      "Auth Token: fake_token\n"
+                      "Header Content-Range: bytes 0-",
+                      content.size() - 1, "/", content.size(),
+                      "\n"
+                      "Timeouts: 5 1 30\n"
+                      "Put body: ",
+                      content, "\n"),
+      ""));
+}
+
+// Returns the request composing `sources` into `destination` in the bucket.
+HttpRequest* ComposeRequest(const string& destination,
+                            const std::vector<string>& sources,
+                            Status response_status = OkStatus(),
+                            int response_code = 200) {
+  string source_objects;
+  for (const string& source : sources) {
+    strings::StrAppend(&source_objects, source_objects.empty() ? "" : ",",
+                       "{'name': '", source, "'}");
+  }
+  return new FakeHttpRequest(
+      strings::StrCat("Uri: https://www.googleapis.com/storage/v1/b/bucket/o/",
+                      EscapedObject(destination),
+                      "/compose\n"
+                      "Auth Token: fake_token\n"
+                      "Timeouts: 5 1 10\n"
+                      "Header content-type: application/json\n"
+                      "Post body: {'sourceObjects': [",
+                      source_objects, "]}\n"),
+      "", response_status, response_code);
+}
+
+// Returns the request deleting `object` from the bucket.
+HttpRequest* DeleteRequest(const string& object) {
+  return new FakeHttpRequest(
+      strings::StrCat("Uri: https://www.googleapis.com/storage/v1/b/bucket/o/",
+                      EscapedObject(object),
+                      "\n"
+                      "Auth Token: fake_token\n"
+                      "Timeouts: 5 1 10\n"
+                      "Delete: yes\n"),
+      "");
+}
+
+// Returns a file system uploading the files written in parts of `part_size`
+// bytes, with `requests`.
+std::unique_ptr<GcsFileSystem> CompositeUploadFileSystem(
+    std::vector<HttpRequest*>* requests, uint64 part_size) {
+  auto fs = std::make_unique<GcsFileSystem>(
+      std::unique_ptr<AuthProvider>(new FakeAuthProvider),
+      std::unique_ptr<HttpRequest::Factory>(
+          new FakeHttpRequestFactory(requests)),
+      std::unique_ptr<ZoneProvider>(new FakeZoneProvider), 0 /* block size */,
+      0 /* max bytes */, 0 /* max staleness */, 0 /* stat cache max age */,
+      0 /* stat cache max entries */, 0 /* matching paths cache max age */,
+      0 /* matching paths cache max entries */, kTestRetryConfig,
+      kTestTimeoutConfig, *kAllowedLocationsDefault,
+      nullptr /* gcs additional header */, false /* compose append */);
+  GcsFileSystem::CompositeUploadConfig config;
+  config.part_size = part_size;
+  // Uploads the parts one at a time, in the order of the requests.
+  config.parallelism = 1;
+  fs->SetCompositeUploadConfig(config);
+  return fs;
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadOfManyParts) {
+  const int kNumParts = 34;
+  std::vector<HttpRequest*> requests;
+  for (int i = 0; i < kNumParts; ++i) {
+    AddPartUploadRequests(i, string(1, 'a' + i % 26), &requests);
+  }
+  // A compose request has at most 32 sources: the parts are composed in
+  // batches, which are composed into the object by a single request.
+  std::vector<string> parts;
+  for (int i = 0; i < kNumParts; ++i) {
+    parts.push_back(PartObject(i));
+  }
+  requests.push_back(ComposeRequest(
+      ComposedPartsObject(0),
+      std::vector<string>(parts.begin(), parts.begin() + 32)));
+  requests.push_back(ComposeRequest(
+      ComposedPartsObject(1),
+      std::vector<string>(parts.begin() + 32, parts.end())));
+  requests.push_back(ComposeRequest(
+      "path/writeable", {ComposedPartsObject(0), ComposedPartsObject(1)}));
+  requests.push_back(DeleteRequest(ComposedPartsObject(0)));
+  requests.push_back(DeleteRequest(ComposedPartsObject(1)));
+  for (int i = 0; i < kNumParts; ++i) {
+    requests.push_back(DeleteRequest(PartObject(i)));
+  }
+  std::unique_ptr<GcsFileSystem> fs =
+      CompositeUploadFileSystem(&requests, /*part_size=*/1);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs->NewWritableFile("gs://bucket/path/writeable", nullptr, &file));
+
+  for (int i = 0; i < kNumParts; ++i) {
+    TF_EXPECT_OK(file->Append(string(1, 'a' + i % 26)));
+  }
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadAtComponentLimit) {
+  // A composite object has at most 1024 components, so the last part holds
+  // the rest of the file.
+  const int kFileSize = 1100;
+  const int kNumParts = 1024;
+  string content;
+  for (int i = 0; i < kFileSize; ++i) {
+    content.push_back('a' + i % 26);
+  }
+  std::vector<HttpRequest*> requests;
+  for (int i = 0; i < kNumParts - 1; ++i) {
+    AddPartUploadRequests(i, content.substr(i, 1), &requests);
+  }
+  AddPartUploadRequests(kNumParts - 1, content.substr(kNumParts - 1),
+                        &requests);
+  std::vector<string> composed_parts;
+  for (int i = 0; i < kNumParts; i += 32) {
+    std::vector<string> parts;
+    for (int j = i; j < i + 32; ++j) {
+      parts.push_back(PartObject(j));
+    }
+    composed_parts.push_back(ComposedPartsObject(i / 32));
+    requests.push_back(ComposeRequest(composed_parts.back(), parts));
+  }
+  requests.push_back(ComposeRequest("path/writeable", composed_parts));
+  for (const string& composed_part : composed_parts) {
+    requests.push_back(DeleteRequest(composed_part));
+  }
+  for (int i = 0; i < kNumParts; ++i) {
+    requests.push_back(DeleteRequest(PartObject(i)));
+  }
+  std::unique_ptr<GcsFileSystem> fs =
+      CompositeUploadFileSystem(&requests, /*part_size=*/1);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs->NewWritableFile("gs://bucket/path/writeable", nullptr, &file));
+
+  for (char c : content) {
+    TF_EXPECT_OK(file->Append(string(1, c)));
+  }
+  TF_EXPECT_OK(file->Close());
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadFailedCompose) {
+  std::vector<HttpRequest*> requests;
+  AddPartUploadRequests(0, "content1", &requests);
+  AddPartUploadRequests(1, "content2", &requests);
+  // Composing the parts fails on close...
+  requests.push_back(ComposeRequest("path/writeable",
+                                    {PartObject(0), PartObject(1)},
+                                    errors::FailedPrecondition("412"), 412));
+  // ...and again when the file is destroyed, which deletes the parts anyway.
+  requests.push_back(ComposeRequest("path/writeable",
+                                    {PartObject(0), PartObject(1)},
+                                    errors::FailedPrecondition("412"), 412));
+  requests.push_back(DeleteRequest(PartObject(0)));
+  requests.push_back(DeleteRequest(PartObject(1)));
+  std::unique_ptr<GcsFileSystem> fs =
+      CompositeUploadFileSystem(&requests, /*part_size=*/8);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs->NewWritableFile("gs://bucket/path/writeable", nullptr, &file));
+
+  TF_EXPECT_OK(file->Append("content1"));
+  TF_EXPECT_OK(file->Append("content2"));
+  EXPECT_TRUE(errors::IsFailedPrecondition(file->Close()));
+  file.reset();
+}
+
+TEST(GcsFileSystemTest, NewWritableFile_CompositeUploadFailedSync) {
+  std::vector<HttpRequest*> requests;
+  AddPartUploadRequests(0, "content1", &requests);
+  const string last_part_upload = strings::StrCat(
+      "Uri: https://www.googleapis.com/upload/storage/v1/b/bucket/o?"
+      "uploadType=resumable&name=",
+      EscapedObject(PartObject(1)),
+      "\n"
+      "Auth Token: fake_token\n"
+      "Header X-Upload-Content-Length: 1\n"
+      "Post: yes\n"
+      "Timeouts: 5 1 10\n");
+  // Uploading the rest of the file fails on close...
+  requests.push_back(new FakeHttpRequest(last_part_upload, "",
+                                         errors::PermissionDenied("403"), 403));
+  // ...and again when the file is destroyed, which deletes the parts anyway.
+  requests.push_back(new FakeHttpRequest(last_part_upload, "",
+                                         errors::PermissionDenied("403"), 403));
+  requests.push_back(DeleteRequest(PartObject(0)));
+  requests.push_back(DeleteRequest(PartObject(1)));
+  std::unique_ptr<GcsFileSystem> fs =
+      CompositeUploadFileSystem(&requests, /*part_size=*/8);
+
+  std::unique_ptr<WritableFile> file;
+  TF_EXPECT_OK(
+      fs->NewWritableFile("gs://bucket/path/writeable", nullptr, &file));
+
+  TF_EXPECT_OK(file->Append("content1,"));
+  EXPECT_TRUE(errors::IsPermissionDenied(file->Close()));
+  file.reset();
+}
+
 TEST(GcsFileSystemTest, NewAppendableFile) {
   std::vector<HttpRequest*> requests(
       {new FakeHttpRequest(
@@ -3684,6 +4115,61 @@ TEST(GcsFileSystemTest, OverrideCacheParameters) {
   EXPECT_EQ(40, fs5.timeouts().write);
 }
 
+TEST(GcsFileSystemTest, OverrideDiskCacheParameters) {
+  unsetenv("GCS_READ_CACHE_DISK_DIR");
+  unsetenv("GCS_READ_CACHE_DISK_MAX_SIZE_MB");
+  GcsFileSystem fs1;
+  EXPECT_EQ("", fs1.disk_cache_dir());
+  EXPECT_EQ(0, fs1.max_disk_bytes());
+
+  const string cache_dir = io::JoinPath(testing::TmpDir(), "gcs_disk_cache");
+  setenv("GCS_READ_CACHE_DISK_DIR", cache_dir.c_str(), 1);
+  GcsFileSystem fs2;
+  EXPECT_EQ(cache_dir, fs2.disk_cache_dir());
+  EXPECT_EQ(kDefaultMaxDiskCacheSize, fs2.max_disk_bytes());
+
+  setenv("GCS_READ_CACHE_DISK_MAX_SIZE_MB", "32", 1);
+  GcsFileSystem fs3;
+  EXPECT_EQ(32 * 1024 * 1024, fs3.max_disk_bytes());
+  TF_EXPECT_OK(Env::Default()->IsDirectory(cache_dir));
+
+  // No cache at all without the default cache.
+  GcsFileSystem fs4(/*make_default_cache=*/false);
+  EXPECT_EQ(0, fs4.max_disk_bytes());
+
+  unsetenv("GCS_READ_CACHE_DISK_DIR");
+  unsetenv("GCS_READ_CACHE_DISK_MAX_SIZE_MB");
+}
+
+TEST(GcsFileSystemTest, OverrideReadaheadParameters) {
+  unsetenv("GCS_READ_CACHE_MAX_READAHEAD_BLOCKS");
+  GcsFileSystem fs1;
+  EXPECT_EQ(0, fs1.max_readahead_blocks());
+
+  setenv("GCS_READ_CACHE_MAX_READAHEAD_BLOCKS", "4", 1);
+  GcsFileSystem fs2;
+  EXPECT_EQ(4, fs2.max_readahead_blocks());
+
+  unsetenv("GCS_READ_CACHE_MAX_READAHEAD_BLOCKS");
+}
+
+TEST(GcsFileSystemTest, OverrideCompositeUploadParameters) {
+  unsetenv("GCS_COMPOSITE_UPLOAD_PART_SIZE_MB");
+  unsetenv("GCS_COMPOSITE_UPLOAD_PARALLELISM");
+  GcsFileSystem fs1;
+  EXPECT_EQ(0, fs1.composite_upload_config().part_size);
+  EXPECT_EQ(8, fs1.composite_upload_config().parallelism);
+
+  setenv("GCS_COMPOSITE_UPLOAD_PART_SIZE_MB", "64", 1);
+  setenv("GCS_COMPOSITE_UPLOAD_PARALLELISM", "16", 1);
+  GcsFileSystem fs2;
+  EXPECT_EQ(64 * 1024 * 1024, fs2.composite_upload_config().part_size);
+  EXPECT_EQ(16, fs2.composite_upload_config().parallelism);
+
+  unsetenv("GCS_COMPOSITE_UPLOAD_PART_SIZE_MB");
+  unsetenv("GCS_COMPOSITE_UPLOAD_PARALLELISM");
+}
+
 TEST(GcsFileSystemTest, CreateHttpRequest) {
   std::vector<HttpRequest*> requests(
       {// IsDirectory is checking whether there are children objects.
@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/tsl/platform/cloud/ram_file_block_cache.h"
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/cleanup/cleanup.h"
 #include "tensorflow/tsl/platform/env.h"
@@ -41,13 +44,31 @@ std::shared_ptr<RamFileBlockCache::Block> RamFileBlockCache::Lookup(
       if (cache_stats_ != nullptr) {
         cache_stats_->RecordCacheHitBlockSize(entry->second->data.size());
       }
+      if (entry->second->readahead) {
+        entry->second->readahead = false;
+        bool fetched;
+        {
+          mutex_lock l(entry->second->mu);
+          fetched = entry->second->state == FetchState::FINISHED;
+        }
+        auto state = readahead_states_.find(key.first);
+        if (!fetched && state != readahead_states_.end()) {
+          // The read has to wait for the block, so we read further ahead.
+          state->second.num_blocks =
+              std::min(2 * state->second.num_blocks, max_readahead_blocks_);
+        }
+      }
       return entry->second;
     } else {
       // Remove the stale block and continue.
       RemoveFile_Locked(key.first);
     }
   }
+  return AddBlock(key);
+}
 
+std::shared_ptr<RamFileBlockCache::Block> RamFileBlockCache::AddBlock(
+    const Key& key) {
   // Insert a new empty block, setting the bookkeeping to sentinel values
   // in order to update them as appropriate.
   auto new_entry = std::make_shared<Block>();
@@ -88,8 +109,11 @@ Status RamFileBlockCache::UpdateLRU(const Key& key,
   if (block->data.size() < block_size_) {
     Key fmax = std::make_pair(key.first, std::numeric_limits<size_t>::max());
     auto fcmp = block_map_.upper_bound(fmax);
-    if (fcmp != block_map_.begin() && key < (--fcmp)->first) {
-      return errors::Internal("Block cache contents are inconsistent.");
+    while (fcmp != block_map_.begin() && key < (--fcmp)->first) {
+      // Blocks read ahead may lie past the end of the file until fetched.
+      if (!fcmp->second->readahead) {
+        return errors::Internal("Block cache contents are inconsistent.");
+      }
     }
   }
 
@@ -184,6 +208,7 @@ Status RamFileBlockCache::Read(const string& filename, size_t offset, size_t n,
   if (finish < offset + n) {
     finish += block_size_;
   }
+  MaybeReadahead(filename, start, finish);
   size_t total_bytes_transferred = 0;
   // Now iterate through the blocks, reading them one at a time.
   for (size_t pos = start; pos < finish; pos += block_size_) {
@@ -229,6 +254,71 @@ Status RamFileBlockCache::Read(const string& filename, size_t offset, size_t n,
   return OkStatus();
 }
 
+void RamFileBlockCache::MaybeReadahead(const string& filename, size_t start,
+                                       size_t finish) {
+  if (readahead_pool_ == nullptr) {
+    return;
+  }
+  // Checked before locking mu_, since it may lock the filesystem's throttle.
+  const bool allowed = readahead_allowed_ == nullptr || readahead_allowed_();
+  std::vector<std::pair<Key, std::shared_ptr<Block>>> blocks;
+  {
+    mutex_lock lock(mu_);
+    ReadaheadState& state = readahead_states_[filename];
+    const bool sequential = start >= state.start && start <= state.finish;
+    state.start = start;
+    state.finish = finish;
+    if (!sequential || !allowed) {
+      return;
+    }
+    const size_t end =
+        std::min(finish + state.num_blocks * block_size_, state.file_size);
+    for (size_t pos = finish; pos < end; pos += block_size_) {
+      Key key = std::make_pair(filename, pos);
+      if (block_map_.find(key) != block_map_.end()) {
+        continue;
+      }
+      std::shared_ptr<Block> block = AddBlock(key);
+      block->readahead = true;
+      blocks.emplace_back(key, block);
+    }
+  }
+  for (const auto& block : blocks) {
+    readahead_pool_->Schedule([this, block] {
+      Readahead(block.first, block.second);
+    });
+  }
+}
+
+void RamFileBlockCache::Readahead(const Key& key,
+                                  const std::shared_ptr<Block>& block) {
+  Status status = MaybeFetch(key, block);
+  mutex_lock lock(mu_);
+  auto state = readahead_states_.find(key.first);
+  if (status.ok() && block->data.size() < block_size_ &&
+      state != readahead_states_.end()) {
+    // Stops reading ahead at the end of the file.
+    state->second.file_size =
+        std::min(state->second.file_size, key.second + block->data.size());
+  }
+  if (!status.ok() || block->data.empty()) {
+    // Drops failed blocks, which a read fetches again, and blocks past the end
+    // of the file, which would make the cache look inconsistent.
+    auto entry = block_map_.find(key);
+    if (block->timestamp != 0 && entry != block_map_.end() &&
+        entry->second == block) {
+      block->readahead = false;
+      RemoveBlock(entry);
+    }
+    if (!status.ok()) {
+      VLOG(1) << "Failed to read ahead " << key.first << "@" << key.second
+              << ": " << status;
+    }
+    return;
+  }
+  Trim();
+}
+
 bool RamFileBlockCache::ValidateAndUpdateFileSignature(const string& filename,
                                                        int64_t file_signature) {
   mutex_lock lock(mu_);
@@ -274,6 +364,7 @@ void RamFileBlockCache::Flush() {
   lru_list_.clear();
   lra_list_.clear();
   cache_size_ = 0;
+  readahead_states_.clear();
 }
 
 void RamFileBlockCache::RemoveFile(const string& filename) {
@@ -289,16 +380,33 @@ void RamFileBlockCache::RemoveFile_Locked(const string& filename) {
     RemoveBlock(it);
     it = next;
   }
+  readahead_states_.erase(filename);
 }
 
 void RamFileBlockCache::RemoveBlock(BlockMap::iterator entry) {
   // This signals that the block is removed, and should not be inadvertently
   // reinserted into the cache in UpdateLRU.
   entry->second->timestamp = 0;
+  if (entry->second->readahead) {
+    auto state = readahead_states_.find(entry->first.first);
+    if (state != readahead_states_.end()) {
+      // The block was read ahead too far to be read before its eviction.
+      state->second.num_blocks = std::max<size_t>(
+          state->second.num_blocks / 2, 1);
+    }
+  }
   lru_list_.erase(entry->second->lru_iterator);
   lra_list_.erase(entry->second->lra_iterator);
   cache_size_ -= entry->second->data.capacity();
+  // Copies the filename, since `entry` is deleted below.
+  const string filename = entry->first.first;
   block_map_.erase(entry);
+  // Drops the read-ahead state along with the last block of the file, so that
+  // it does not grow with every file ever read.
+  auto next = block_map_.lower_bound(std::make_pair(filename, 0));
+  if (next == block_map_.end() || next->first.first != filename) {
+    readahead_states_.erase(filename);
+  }
 }
 
 }  // namespace tsl
@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_TSL_PLATFORM_CLOUD_RAM_FILE_BLOCK_CACHE_H_
 #define TENSORFLOW_TSL_PLATFORM_CLOUD_RAM_FILE_BLOCK_CACHE_H_
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
@@ -30,6 +32,7 @@ limitations under the License.
 #include "tensorflow/tsl/platform/status.h"
 #include "tensorflow/tsl/platform/stringpiece.h"
 #include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/threadpool.h"
 #include "tensorflow/tsl/platform/types.h"
 
 namespace tsl {
@@ -50,22 +53,47 @@ class RamFileBlockCache : public FileBlockCache {
                                size_t* bytes_transferred)>
       BlockFetcher;
 
+  /// Returns whether blocks can be read ahead of the reads, e.g. whether the
+  /// backing filesystem is not throttled.
+  typedef std::function<bool()> ReadaheadAllowed;
+
+  /// If `max_readahead_blocks` > 0, reads up to that many blocks, and up to
+  /// half the cache, ahead of the sequential reads of a file concurrently. The
+  /// number of blocks read ahead of a file starts at one, doubles whenever a
+  /// read has to wait for a block being read ahead, and halves whenever a
+  /// block read ahead is evicted before being read.
   RamFileBlockCache(size_t block_size, size_t max_bytes, uint64 max_staleness,
-                    BlockFetcher block_fetcher, Env* env = Env::Default())
+                    BlockFetcher block_fetcher, Env* env = Env::Default(),
+                    size_t max_readahead_blocks = 0,
+                    ReadaheadAllowed readahead_allowed = nullptr)
       : block_size_(block_size),
         max_bytes_(max_bytes),
         max_staleness_(max_staleness),
         block_fetcher_(block_fetcher),
-        env_(env) {
+        env_(env),
+        max_readahead_blocks_(
+            IsCacheEnabled()
+                ? std::min(max_readahead_blocks, max_bytes / block_size / 2)
+                : 0),
+        readahead_allowed_(std::move(readahead_allowed)) {
     if (max_staleness_ > 0) {
       pruning_thread_.reset(env_->StartThread(ThreadOptions(), "TF_prune_FBC",
                                               [this] { Prune(); }));
     }
+    if (max_readahead_blocks_ > 0) {
+      readahead_pool_ = std::make_unique<thread::ThreadPool>(
+          env_, "TF_readahead_FBC", max_readahead_blocks_);
+    }
     VLOG(1) << "GCS file block cache is "
-            << (IsCacheEnabled() ? "enabled" : "disabled");
+            << (IsCacheEnabled() ? "enabled" : "disabled")
+            << ", reading up to " << max_readahead_blocks_
+            << " blocks ahead";
   }
 
   ~RamFileBlockCache() override {
+    // Destroying readahead_pool_ will block until the blocks being read ahead
+    // are fetched.
+    readahead_pool_.reset();
     if (pruning_thread_) {
       stop_pruning_thread_.Notify();
       // Destroying pruning_thread_ will block until Prune() receives the above
@@ -131,6 +159,10 @@ class RamFileBlockCache : public FileBlockCache {
   const BlockFetcher block_fetcher_;
   /// The Env from which we read timestamps.
   Env* const env_;  // not owned
+  /// The maximum number of blocks read ahead of the reads of a file.
+  const size_t max_readahead_blocks_;
+  /// Returns whether blocks can be read ahead, or nullptr if they always can.
+  const ReadaheadAllowed readahead_allowed_;
 
   /// \brief The key type for the file block cache.
   ///
@@ -181,6 +213,23 @@ class RamFileBlockCache : public FileBlockCache {
     FetchState state TF_GUARDED_BY(mu) = FetchState::CREATED;
     /// Wait on cond_var if state is FETCHING.
     condition_variable cond_var;
+    /// Whether the block was read ahead, and not read since. Should only be
+    /// accessed while holding mu_.
+    bool readahead = false;
+  };
+
+  /// \brief The read-ahead state of a file.
+  ///
+  /// Reads are sequential if they start in the blocks of the previous read,
+  /// or right after them.
+  struct ReadaheadState {
+    /// The block-aligned start and end of the last read.
+    size_t start = 0;
+    size_t finish = 0;
+    /// The number of blocks to read ahead of sequential reads.
+    size_t num_blocks = 1;
+    /// The size of the file, once a block read ahead reached its end.
+    size_t file_size = std::numeric_limits<size_t>::max();
   };
 
   /// \brief The block map type for the file block cache.
@@ -200,6 +249,19 @@ class RamFileBlockCache : public FileBlockCache {
   Status MaybeFetch(const Key& key, const std::shared_ptr<Block>& block)
       TF_LOCKS_EXCLUDED(mu_);
 
+  /// Reads the blocks following [start, finish) ahead, if a read of [start,
+  /// finish) in `filename` is sequential.
+  void MaybeReadahead(const string& filename, size_t start, size_t finish)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Fetches the block `key` read ahead.
+  void Readahead(const Key& key, const std::shared_ptr<Block>& block)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Creates a block for `key` and adds it to the cache.
+  std::shared_ptr<Block> AddBlock(const Key& key)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   /// Trim the block cache to make room for another entry.
   void Trim() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
@@ -221,6 +283,9 @@ class RamFileBlockCache : public FileBlockCache {
   /// Notification for stopping the cache pruning thread.
   Notification stop_pruning_thread_;
 
+  /// The threads fetching the blocks read ahead, if any.
+  std::unique_ptr<thread::ThreadPool> readahead_pool_;
+
   /// Guards access to the block map, LRU list, and cached byte count.
   mutable mutex mu_;
 
@@ -243,6 +308,8 @@ class RamFileBlockCache : public FileBlockCache {
 
   // A filename->file_signature map.
   std::map<string, int64_t> file_signature_map_ TF_GUARDED_BY(mu_);
+  /// The read-ahead state of the files with blocks in the cache.
+  std::map<string, ReadaheadState> readahead_states_ TF_GUARDED_BY(mu_);
 };
 
 }  // namespace tsl
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/tsl/platform/cloud/ram_file_block_cache.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 
 #include "tensorflow/tsl/lib/core/status_test_util.h"
@@ -566,5 +568,159 @@ TEST(RamFileBlockCacheTest, Flush) {
   EXPECT_EQ(calls, 2);
 }
 
+// A fetcher of files of `file_size` bytes, whose byte at offset i is 'a' + i %
+// 26, that records the offsets it fetches, and takes `delay_micros` to fetch
+// the blocks after the first.
+RamFileBlockCache::BlockFetcher RecordingFetcher(
+    mutex* mu, std::vector<size_t>* offsets, size_t file_size = 1024,
+    uint64 delay_micros = 0) {
+  return [=](const string& filename, size_t offset, size_t n, char* buffer,
+             size_t* bytes_transferred) {
+    {
+      mutex_lock l(*mu);
+      offsets->push_back(offset);
+    }
+    if (offset > 0) {
+      Env::Default()->SleepForMicroseconds(delay_micros);
+    }
+    *bytes_transferred = 0;
+    for (size_t i = offset; i < offset + n && i < file_size; ++i) {
+      buffer[(*bytes_transferred)++] = 'a' + i % 26;
+    }
+    return OkStatus();
+  };
+}
+
+TEST(RamFileBlockCacheTest, ReadaheadOfSequentialReads) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  Notification readahead;
+  auto fetcher = RecordingFetcher(&mu, &offsets);
+  RamFileBlockCache cache(
+      16, 1024, 0,
+      [&](const string& filename, size_t offset, size_t n, char* buffer,
+          size_t* bytes_transferred) {
+        Status status = fetcher(filename, offset, n, buffer, bytes_transferred);
+        if (offset == 16) {
+          readahead.Notify();
+        }
+        return status;
+      },
+      Env::Default(), /*max_readahead_blocks=*/4);
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  // The next block is fetched without being read.
+  EXPECT_TRUE(WaitForNotificationWithTimeout(&readahead, 10000000));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 16, 16, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "qrstuvwxyzabcdef");
+  mutex_lock l(mu);
+  EXPECT_EQ(std::count(offsets.begin(), offsets.end(), 16), 1);
+}
+
+TEST(RamFileBlockCacheTest, NoReadaheadOfRandomReads) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  {
+    RamFileBlockCache cache(16, 1024, 0, RecordingFetcher(&mu, &offsets),
+                            Env::Default(), /*max_readahead_blocks=*/4);
+    std::vector<char> out;
+    TF_EXPECT_OK(ReadCache(&cache, "file", 160, 16, &out));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 480, 16, &out));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 64, 16, &out));
+  }
+  // The cache is destroyed once the blocks read ahead, if any, are fetched.
+  EXPECT_EQ(offsets, std::vector<size_t>({160, 480, 64}));
+}
+
+TEST(RamFileBlockCacheTest, NoReadaheadIfDisallowed) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  {
+    RamFileBlockCache cache(16, 1024, 0, RecordingFetcher(&mu, &offsets),
+                            Env::Default(), /*max_readahead_blocks=*/4,
+                            [] { return false; });
+    std::vector<char> out;
+    TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 16, 16, &out));
+  }
+  EXPECT_EQ(offsets, std::vector<size_t>({0, 16}));
+}
+
+TEST(RamFileBlockCacheTest, ReadaheadPastEndOfFile) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  RamFileBlockCache cache(16, 1024, 0,
+                          RecordingFetcher(&mu, &offsets, /*file_size=*/40),
+                          Env::Default(), /*max_readahead_blocks=*/4);
+  std::vector<char> out;
+  for (int i = 0; i < 2; ++i) {
+    // Blocks read ahead past the end of the file do not make the cache look
+    // inconsistent.
+    TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 16, 16, &out));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 32, 16, &out));
+    EXPECT_EQ(string(out.begin(), out.end()), "ghijklmn");
+  }
+  EXPECT_EQ(ReadCache(&cache, "file", 48, 16, &out).code(),
+            error::OUT_OF_RANGE);
+}
+
+TEST(RamFileBlockCacheTest, ReadaheadGrowsWhileReadsWait) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  {
+    // The second read waits for the block read ahead by the first, since
+    // fetching it is slow, and the third read reads two blocks ahead.
+    RamFileBlockCache cache(
+        16, 1024, 0,
+        RecordingFetcher(&mu, &offsets, /*file_size=*/1024,
+                         /*delay_micros=*/50000),
+        Env::Default(), /*max_readahead_blocks=*/8);
+    std::vector<char> out;
+    for (size_t pos = 0; pos < 48; pos += 16) {
+      TF_EXPECT_OK(ReadCache(&cache, "file", pos, 16, &out));
+    }
+  }
+  EXPECT_EQ(*std::max_element(offsets.begin(), offsets.end()), 64);
+}
+
+TEST(RamFileBlockCacheTest, ReadaheadLimitedByCacheSize) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  {
+    // Reads ahead up to half the cache, i.e. one block.
+    RamFileBlockCache cache(
+        16, 32, 0,
+        RecordingFetcher(&mu, &offsets, /*file_size=*/1024,
+                         /*delay_micros=*/50000),
+        Env::Default(), /*max_readahead_blocks=*/8);
+    std::vector<char> out;
+    for (size_t pos = 0; pos < 80; pos += 16) {
+      TF_EXPECT_OK(ReadCache(&cache, "file", pos, 16, &out));
+    }
+  }
+  EXPECT_EQ(*std::max_element(offsets.begin(), offsets.end()), 80);
+}
+
+TEST(RamFileBlockCacheTest, ReadaheadStateEvictedWithFile) {
+  mutex mu;
+  std::vector<size_t> offsets;
+  std::atomic<bool> allowed(false);
+  {
+    RamFileBlockCache cache(16, 32, 0, RecordingFetcher(&mu, &offsets),
+                            Env::Default(), /*max_readahead_blocks=*/1,
+                            [&] { return allowed.load(); });
+    std::vector<char> out;
+    TF_EXPECT_OK(ReadCache(&cache, "a", 0, 16, &out));
+    // Evicts the only block of "a", and with it the state of its reads.
+    TF_EXPECT_OK(ReadCache(&cache, "b", 0, 16, &out));
+    TF_EXPECT_OK(ReadCache(&cache, "c", 0, 16, &out));
+    allowed = true;
+    // Would read ahead if the first read of "a" was remembered.
+    TF_EXPECT_OK(ReadCache(&cache, "a", 16, 16, &out));
+  }
+  EXPECT_EQ(offsets, std::vector<size_t>({0, 0, 0, 16}));
+}
+
 }  // namespace
 }  // namespace tsl
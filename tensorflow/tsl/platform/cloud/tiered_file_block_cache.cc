@@ -0,0 +1,401 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/platform/cloud/tiered_file_block_cache.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/hash.h"
+#include "tensorflow/tsl/platform/logging.h"
+#include "tensorflow/tsl/platform/path.h"
+#include "tensorflow/tsl/platform/strcat.h"
+
+namespace tsl {
+namespace {
+
+// The suffix of the block files in the cache directory.
+constexpr char kBlockFileSuffix[] = ".blk";
+// The suffix of the temporary files blocks are written to before being renamed
+// to their block file.
+constexpr char kTempFileSuffix[] = ".tmp";
+// The age after which a temporary file is assumed to be left behind by a
+// process that stopped while writing it, rather than still being written.
+constexpr uint64 kStaleTempFileSeconds = 600;
+
+// Returns the prefix of the names of the block files of `filename`.
+string BlockFilePrefix(const string& filename) {
+  return strings::StrCat(strings::Hex(Hash64(filename), strings::kZeroPad16),
+                         "_");
+}
+
+// Sets the access time of the file at `path` to now. Its modification time,
+// against which the staleness of a block is checked, is left unchanged.
+void TouchAccessTime(const string& path) {
+#ifndef _WIN32
+  const struct timespec times[2] = {{0, UTIME_NOW}, {0, UTIME_OMIT}};
+  utimensat(AT_FDCWD, path.c_str(), times, 0);
+#endif
+}
+
+// Returns the time the file at `path` was last read or written, in
+// nanoseconds, given its modification time `mtime_nsec`.
+int64_t LastUseNanos(const string& path, int64_t mtime_nsec) {
+#ifndef _WIN32
+  struct stat sbuf;
+  if (stat(path.c_str(), &sbuf) == 0) {
+    return std::max<int64_t>(mtime_nsec, sbuf.st_atime * 1000000000LL);
+  }
+#endif
+  return mtime_nsec;
+}
+
+}  // namespace
+
+TieredFileBlockCache::TieredFileBlockCache(
+    size_t block_size, size_t max_bytes, uint64 max_staleness,
+    const string& cache_dir, size_t max_disk_bytes, BlockFetcher block_fetcher,
+    Env* env, size_t max_readahead_blocks,
+    RamFileBlockCache::ReadaheadAllowed readahead_allowed)
+    : block_size_(block_size),
+      max_staleness_(max_staleness),
+      cache_dir_(cache_dir),
+      max_disk_bytes_(max_disk_bytes),
+      block_fetcher_(std::move(block_fetcher)),
+      env_(env),
+      ram_cache_(
+          block_size, max_bytes, max_staleness,
+          [this](const string& filename, size_t offset, size_t n, char* buffer,
+                 size_t* bytes_transferred) {
+            return ReadFromDisk(filename, offset, n, buffer, bytes_transferred);
+          },
+          env, max_readahead_blocks, std::move(readahead_allowed)) {
+  if (block_size_ > 0 && max_disk_bytes_ > 0) {
+    LoadIndex();
+  }
+  VLOG(1) << "GCS file block cache on disk in " << cache_dir_ << " is "
+          << (max_disk_bytes_ > 0 ? "enabled" : "disabled");
+}
+
+void TieredFileBlockCache::LoadIndex() {
+  Status status = env_->RecursivelyCreateDir(cache_dir_);
+  std::vector<string> children;
+  if (status.ok()) {
+    status = env_->GetChildren(cache_dir_, &children);
+  }
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to list the GCS block cache directory "
+                 << cache_dir_ << ": " << status;
+    return;
+  }
+  std::vector<std::pair<int64_t, string>> blocks_by_last_use;
+  std::map<string, size_t> block_sizes;
+  const uint64 now_seconds = env_->NowSeconds();
+  for (const string& child : children) {
+    const bool is_block = absl::EndsWith(child, kBlockFileSuffix);
+    const bool is_temp = absl::EndsWith(child, kTempFileSuffix);
+    if (!is_block && !is_temp) continue;
+    const string path = io::JoinPath(cache_dir_, child);
+    FileStatistics stat;
+    if (!env_->Stat(path, &stat).ok()) continue;
+    if (is_temp) {
+      if (stat.mtime_nsec / 1000000000 + kStaleTempFileSeconds < now_seconds) {
+        env_->DeleteFile(path).IgnoreError();
+      }
+      continue;
+    }
+    blocks_by_last_use.emplace_back(LastUseNanos(path, stat.mtime_nsec),
+                                    child);
+    block_sizes[child] = stat.length;
+  }
+  std::sort(blocks_by_last_use.begin(), blocks_by_last_use.end());
+  std::vector<string> evicted;
+  {
+    mutex_lock lock(mu_);
+    for (const auto& block : blocks_by_last_use) {
+      AddOrTouch_Locked(block.second, block_sizes[block.second]);
+    }
+    evicted = Trim_Locked();
+  }
+  DeleteBlockFiles(evicted);
+}
+
+Status TieredFileBlockCache::Read(const string& filename, size_t offset,
+                                  size_t n, char* buffer,
+                                  size_t* bytes_transferred) {
+  return ram_cache_.Read(filename, offset, n, buffer, bytes_transferred);
+}
+
+Status TieredFileBlockCache::ReadFromDisk(const string& filename,
+                                          size_t offset, size_t n,
+                                          char* buffer,
+                                          size_t* bytes_transferred) {
+  *bytes_transferred = 0;
+  if (n == 0) {
+    return OkStatus();
+  }
+  if (block_size_ == 0 || max_disk_bytes_ == 0 || n > max_disk_bytes_) {
+    // The disk tier is disabled, so we pass the read through to the fetcher.
+    return block_fetcher_(filename, offset, n, buffer, bytes_transferred);
+  }
+  // Calculate the block-aligned start and end of the read.
+  size_t start = block_size_ * (offset / block_size_);
+  size_t finish = block_size_ * ((offset + n) / block_size_);
+  if (finish < offset + n) {
+    finish += block_size_;
+  }
+  size_t total_bytes_transferred = 0;
+  for (size_t pos = start; pos < finish; pos += block_size_) {
+    // The range of the block to copy into the result buffer.
+    const size_t begin = offset > pos ? offset - pos : 0;
+    const size_t end = std::min(block_size_, offset + n - pos);
+    size_t block_bytes = 0;
+    TF_RETURN_IF_ERROR(ReadBlock(filename, pos, begin, end,
+                                 &buffer[total_bytes_transferred],
+                                 &block_bytes));
+    if (offset >= pos + block_bytes) {
+      // The requested offset is at or beyond the end of the file.
+      *bytes_transferred = total_bytes_transferred;
+      return errors::OutOfRange("EOF at offset ", offset, " in file ", filename,
+                                " at position ", pos, "with data size ",
+                                block_bytes);
+    }
+    if (begin < std::min(end, block_bytes)) {
+      total_bytes_transferred += std::min(end, block_bytes) - begin;
+    }
+    if (block_bytes < block_size_) {
+      // The block was a partial block and thus signals EOF at its upper bound.
+      break;
+    }
+  }
+  *bytes_transferred = total_bytes_transferred;
+  return OkStatus();
+}
+
+Status TieredFileBlockCache::ReadBlock(const string& filename, size_t offset,
+                                       size_t begin, size_t end, char* buffer,
+                                       size_t* block_bytes) {
+  const string block_name = BlockFileName(filename, offset);
+  if (ReadBlockFile(block_name, begin, end, buffer, block_bytes)) {
+    if (cache_stats_ != nullptr) {
+      cache_stats_->RecordCacheHitBlockSize(*block_bytes);
+    }
+    return OkStatus();
+  }
+  std::vector<char> data(block_size_, 0);
+  size_t bytes_transferred = 0;
+  TF_RETURN_IF_ERROR(block_fetcher_(filename, offset, block_size_, data.data(),
+                                    &bytes_transferred));
+  if (cache_stats_ != nullptr) {
+    cache_stats_->RecordCacheMissBlockSize(bytes_transferred);
+  }
+  data.resize(bytes_transferred);
+  WriteBlockFile(block_name, data);
+  *block_bytes = data.size();
+  end = std::min(end, data.size());
+  if (begin < end) {
+    memcpy(buffer, &data[begin], end - begin);
+  }
+  return OkStatus();
+}
+
+bool TieredFileBlockCache::ReadBlockFile(const string& block_name,
+                                         size_t begin, size_t end,
+                                         char* buffer, size_t* block_bytes) {
+  const string path = io::JoinPath(cache_dir_, block_name);
+  FileStatistics stat;
+  if (!env_->Stat(path, &stat).ok()) {
+    return false;
+  }
+  if (max_staleness_ > 0 &&
+      env_->NowSeconds() > stat.mtime_nsec / 1000000000 + max_staleness_) {
+    return false;
+  }
+  // Only the requested range is read, so that small reads of large blocks,
+  // e.g. without an in-memory tier, do not read the whole block file.
+  end = std::min(end, static_cast<size_t>(stat.length));
+  if (begin < end) {
+    std::unique_ptr<RandomAccessFile> file;
+    StringPiece result;
+    Status status = env_->NewRandomAccessFile(path, &file);
+    if (status.ok()) {
+      status = file->Read(begin, end - begin, &result, buffer);
+    }
+    if (status.ok() && result.size() != end - begin) {
+      status = errors::DataLoss("Read ", result.size(), " bytes instead of ",
+                                end - begin);
+    }
+    if (!status.ok()) {
+      // The block may have been evicted by another process since Stat.
+      VLOG(1) << "Failed to read GCS cache block " << path << ": " << status;
+      return false;
+    }
+    if (result.data() != buffer) {
+      memmove(buffer, result.data(), result.size());
+    }
+  }
+  *block_bytes = stat.length;
+  // Records the hit in the file, so that a cache created later on the
+  // directory, e.g. after a restart, evicts the block as recently used.
+  TouchAccessTime(path);
+  mutex_lock lock(mu_);
+  AddOrTouch_Locked(block_name, stat.length);
+  return true;
+}
+
+void TieredFileBlockCache::WriteBlockFile(const string& block_name,
+                                          const std::vector<char>& data) {
+  if (data.size() > max_disk_bytes_) {
+    return;
+  }
+  const string path = io::JoinPath(cache_dir_, block_name);
+  string temp_path = path;
+  if (!env_->CreateUniqueFileName(&temp_path, kTempFileSuffix)) {
+    return;
+  }
+  Status status = WriteStringToFile(env_, temp_path,
+                                    StringPiece(data.data(), data.size()));
+  if (status.ok()) {
+    status = env_->RenameFile(temp_path, path);
+  }
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to write GCS cache block " << path << ": "
+                 << status;
+    env_->DeleteFile(temp_path).IgnoreError();
+    return;
+  }
+  std::vector<string> evicted;
+  {
+    mutex_lock lock(mu_);
+    AddOrTouch_Locked(block_name, data.size());
+    evicted = Trim_Locked();
+  }
+  DeleteBlockFiles(evicted);
+}
+
+string TieredFileBlockCache::BlockFileName(const string& filename,
+                                           size_t offset) {
+  int64_t file_signature = 0;
+  {
+    mutex_lock lock(mu_);
+    auto it = file_signature_map_.find(filename);
+    if (it != file_signature_map_.end()) {
+      file_signature = it->second;
+    }
+  }
+  return strings::StrCat(BlockFilePrefix(filename), file_signature, "_",
+                         offset, kBlockFileSuffix);
+}
+
+void TieredFileBlockCache::AddOrTouch_Locked(const string& block_name,
+                                             size_t size) {
+  auto it = disk_blocks_.find(block_name);
+  if (it != disk_blocks_.end()) {
+    lru_list_.erase(it->second.lru_iterator);
+    disk_cache_size_ -= it->second.size;
+  } else {
+    it = disk_blocks_.emplace(block_name, DiskBlock()).first;
+  }
+  lru_list_.push_front(block_name);
+  it->second.lru_iterator = lru_list_.begin();
+  it->second.size = size;
+  disk_cache_size_ += size;
+}
+
+std::vector<string> TieredFileBlockCache::Trim_Locked() {
+  std::vector<string> evicted;
+  while (!lru_list_.empty() && disk_cache_size_ > max_disk_bytes_) {
+    auto it = disk_blocks_.find(lru_list_.back());
+    disk_cache_size_ -= it->second.size;
+    evicted.push_back(it->first);
+    lru_list_.pop_back();
+    disk_blocks_.erase(it);
+  }
+  return evicted;
+}
+
+std::vector<string> TieredFileBlockCache::RemoveBlocks_Locked(
+    const string& prefix) {
+  std::vector<string> removed;
+  auto it = disk_blocks_.lower_bound(prefix);
+  while (it != disk_blocks_.end() && absl::StartsWith(it->first, prefix)) {
+    disk_cache_size_ -= it->second.size;
+    lru_list_.erase(it->second.lru_iterator);
+    removed.push_back(it->first);
+    it = disk_blocks_.erase(it);
+  }
+  return removed;
+}
+
+void TieredFileBlockCache::DeleteBlockFiles(
+    const std::vector<string>& block_names) {
+  for (const string& block_name : block_names) {
+    // Another process sharing the directory may have deleted it already.
+    env_->DeleteFile(io::JoinPath(cache_dir_, block_name)).IgnoreError();
+  }
+}
+
+bool TieredFileBlockCache::ValidateAndUpdateFileSignature(
+    const string& filename, int64_t file_signature) {
+  bool unchanged =
+      ram_cache_.ValidateAndUpdateFileSignature(filename, file_signature);
+  mutex_lock lock(mu_);
+  auto it = file_signature_map_.find(filename);
+  if (it != file_signature_map_.end()) {
+    // The blocks of other signatures are not removed, since other processes
+    // may still read them, but are not read anymore and age out of the cache.
+    unchanged = unchanged && it->second == file_signature;
+    it->second = file_signature;
+    return unchanged;
+  }
+  file_signature_map_[filename] = file_signature;
+  return unchanged;
+}
+
+size_t TieredFileBlockCache::DiskCacheSize() const {
+  mutex_lock lock(mu_);
+  return disk_cache_size_;
+}
+
+void TieredFileBlockCache::RemoveFile(const string& filename) {
+  ram_cache_.RemoveFile(filename);
+  std::vector<string> removed;
+  {
+    mutex_lock lock(mu_);
+    removed = RemoveBlocks_Locked(BlockFilePrefix(filename));
+  }
+  DeleteBlockFiles(removed);
+}
+
+void TieredFileBlockCache::Flush() {
+  ram_cache_.Flush();
+  std::vector<string> removed;
+  {
+    mutex_lock lock(mu_);
+    removed = RemoveBlocks_Locked("");
+  }
+  DeleteBlockFiles(removed);
+}
+
+}  // namespace tsl
@@ -0,0 +1,207 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_PLATFORM_CLOUD_TIERED_FILE_BLOCK_CACHE_H_
+#define TENSORFLOW_TSL_PLATFORM_CLOUD_TIERED_FILE_BLOCK_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/tsl/platform/cloud/file_block_cache.h"
+#include "tensorflow/tsl/platform/cloud/ram_file_block_cache.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/status.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+#include "tensorflow/tsl/platform/types.h"
+
+namespace tsl {
+
+/// \brief A two-tier block cache of file contents, keyed by {filename, offset}.
+///
+/// The first tier is a RamFileBlockCache of `max_bytes`. Blocks that miss it
+/// are read from the second tier, a directory on local disk holding up to
+/// `max_disk_bytes` of blocks, and only fetched from the backing filesystem if
+/// they miss it too. Blocks fetched from the backing filesystem are written to
+/// the directory.
+///
+/// The directory outlives the cache: a cache created on a directory populated
+/// by an earlier cache, e.g. before a process restart, reads its blocks. It
+/// can also be shared by the caches of several processes on a host. Blocks
+/// are written to a temporary file and renamed, so that a cache never reads a
+/// partially written block. Temporary files left behind by processes that
+/// stopped while writing a block are deleted when a cache is created.
+///
+/// `max_disk_bytes` is the budget of each cache, not of the directory. Each
+/// cache evicts the least recently used of the blocks it knows of, i.e. those
+/// in the directory when it was created and those it read or wrote since, so
+/// the directory can exceed `max_disk_bytes` by the blocks other processes
+/// write after it was created. Likewise, RemoveFile and Flush delete the block
+/// files this cache knows of, including those written by other processes,
+/// which then fetch them again.
+///
+/// The name of a block file depends on the signature of the file last passed
+/// to ValidateAndUpdateFileSignature, so that blocks of a modified file are
+/// not read, and age out of the cache instead.
+///
+/// Blocks read ahead by the in-memory tier, see RamFileBlockCache, are read
+/// through the disk tier too.
+class TieredFileBlockCache : public FileBlockCache {
+ public:
+  TieredFileBlockCache(size_t block_size, size_t max_bytes,
+                       uint64 max_staleness, const string& cache_dir,
+                       size_t max_disk_bytes, BlockFetcher block_fetcher,
+                       Env* env = Env::Default(),
+                       size_t max_readahead_blocks = 0,
+                       RamFileBlockCache::ReadaheadAllowed readahead_allowed =
+                           nullptr);
+
+  /// Read `n` bytes from `filename` starting at `offset` into `out`. Returns
+  /// the same errors as RamFileBlockCache::Read.
+  Status Read(const string& filename, size_t offset, size_t n, char* buffer,
+              size_t* bytes_transferred) override;
+
+  // Validate the given file signature with the existing file signature in the
+  // cache. Returns true if the signature doesn't change or the file doesn't
+  // exist before. If the signature changes, update the existing signature with
+  // the new one and remove the file from cache.
+  bool ValidateAndUpdateFileSignature(const string& filename,
+                                      int64_t file_signature) override
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Remove all cached blocks for `filename`, in memory and on disk.
+  void RemoveFile(const string& filename) override TF_LOCKS_EXCLUDED(mu_);
+
+  /// Remove all cached data, in memory and on disk. On disk, this deletes the
+  /// block files this cache knows of, even if other processes sharing the
+  /// directory still read them, but not those it does not know of.
+  void Flush() override TF_LOCKS_EXCLUDED(mu_);
+
+  /// Accessors for cache parameters.
+  size_t block_size() const override { return block_size_; }
+  size_t max_bytes() const override { return ram_cache_.max_bytes(); }
+  uint64 max_staleness() const override { return max_staleness_; }
+  size_t max_disk_bytes() const { return max_disk_bytes_; }
+  const string& cache_dir() const { return cache_dir_; }
+
+  /// The current size (in bytes) of the in-memory tier of the cache.
+  size_t CacheSize() const override { return ram_cache_.CacheSize(); }
+
+  /// The current size (in bytes) of the blocks known to be on disk.
+  size_t DiskCacheSize() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns true if the cache is enabled. If false, the BlockFetcher callback
+  // is always executed during Read.
+  bool IsCacheEnabled() const override {
+    return block_size_ > 0 && (max_bytes() > 0 || max_disk_bytes_ > 0);
+  }
+
+ private:
+  /// \brief A block file in the cache directory.
+  struct DiskBlock {
+    /// The size of the block, in bytes.
+    size_t size;
+    /// A list iterator pointing to the block's position in the LRU list.
+    std::list<string>::iterator lru_iterator;
+  };
+
+  /// Reads `n` bytes from `filename` starting at `offset` through the disk
+  /// tier, block by block.
+  Status ReadFromDisk(const string& filename, size_t offset, size_t n,
+                      char* buffer, size_t* bytes_transferred);
+
+  /// Reads the bytes [`begin`, `end`) of the block of `filename` at `offset`
+  /// into `buffer`, or fewer if the block is shorter, and sets `block_bytes`
+  /// to the size of the block. Reads them from the cache directory if the
+  /// block is there and not stale, and fetches the whole block from the
+  /// backing filesystem otherwise.
+  Status ReadBlock(const string& filename, size_t offset, size_t begin,
+                   size_t end, char* buffer, size_t* block_bytes)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Reads the bytes [`begin`, `end`) of the block file `block_name` into
+  /// `buffer`, as ReadBlock. Returns false if there is no such file, or if it
+  /// is stale.
+  bool ReadBlockFile(const string& block_name, size_t begin, size_t end,
+                     char* buffer, size_t* block_bytes) TF_LOCKS_EXCLUDED(mu_);
+
+  /// Writes `data` to the block file `block_name`, and evicts blocks to stay
+  /// within `max_disk_bytes_`.
+  void WriteBlockFile(const string& block_name, const std::vector<char>& data)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Returns the name of the block file of `filename` at `offset`.
+  string BlockFileName(const string& filename, size_t offset)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  /// Adds the block file `block_name` of `size` bytes to the front of the LRU
+  /// list, or moves it there if already known.
+  void AddOrTouch_Locked(const string& block_name, size_t size)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Removes the blocks of the LRU list from the back until the blocks fit in
+  /// `max_disk_bytes_`, and returns their names.
+  std::vector<string> Trim_Locked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Removes the blocks whose names start with `prefix`, or all blocks if
+  /// `prefix` is empty, and returns their names.
+  std::vector<string> RemoveBlocks_Locked(const string& prefix)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  /// Deletes the block files `block_names` from the cache directory.
+  void DeleteBlockFiles(const std::vector<string>& block_names);
+
+  /// Indexes the block files already in the cache directory, least recently
+  /// used first, and deletes stale temporary files. A block file was last used
+  /// when it was written or, as disk hits set its access time, last read.
+  void LoadIndex() TF_LOCKS_EXCLUDED(mu_);
+
+  const size_t block_size_;
+  const uint64 max_staleness_;
+  const string cache_dir_;
+  const size_t max_disk_bytes_;
+  /// The callback to read a block from the underlying filesystem.
+  const BlockFetcher block_fetcher_;
+  /// The Env of the cache directory, and from which we read timestamps.
+  Env* const env_;  // not owned
+
+  /// Guards access to the block index, LRU list, cached byte count and file
+  /// signatures.
+  mutable mutex mu_;
+
+  /// The block files known to be in the cache directory, by name.
+  std::map<string, DiskBlock> disk_blocks_ TF_GUARDED_BY(mu_);
+
+  /// The LRU list of block file names. The front of the list identifies the
+  /// most recently used block.
+  std::list<string> lru_list_ TF_GUARDED_BY(mu_);
+
+  /// The combined number of bytes in all of the known block files.
+  size_t disk_cache_size_ TF_GUARDED_BY(mu_) = 0;
+
+  // A filename->file_signature map.
+  std::map<string, int64_t> file_signature_map_ TF_GUARDED_BY(mu_);
+
+  /// The in-memory tier, which reads its blocks with ReadFromDisk. Declared
+  /// last, so that it is destroyed, and stops reading blocks ahead, first.
+  RamFileBlockCache ram_cache_;
+};
+
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_PLATFORM_CLOUD_TIERED_FILE_BLOCK_CACHE_H_
@@ -0,0 +1,301 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/platform/cloud/tiered_file_block_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstring>
+
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/cloud/now_seconds_env.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/path.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace tsl {
+namespace {
+
+Status ReadCache(TieredFileBlockCache* cache, const string& filename,
+                 size_t offset, size_t n, std::vector<char>* out) {
+  out->clear();
+  out->resize(n, 0);
+  size_t bytes_transferred = 0;
+  Status status =
+      cache->Read(filename, offset, n, out->data(), &bytes_transferred);
+  EXPECT_LE(bytes_transferred, n);
+  out->resize(bytes_transferred, n);
+  return status;
+}
+
+// Returns an empty directory for the cache of the test `name`.
+string CacheDir(const string& name) {
+  const string dir = io::JoinPath(testing::TmpDir(), "tiered_cache", name);
+  int64_t undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  return dir;
+}
+
+// Returns the number of block files in `dir`.
+int NumBlockFiles(const string& dir) {
+  std::vector<string> children;
+  TF_EXPECT_OK(Env::Default()->GetChildren(dir, &children));
+  return children.size();
+}
+
+// A fetcher of files of `file_size` bytes, whose byte at offset i is 'a' + i %
+// 26, that counts its calls.
+TieredFileBlockCache::BlockFetcher CountingFetcher(int* calls,
+                                                   size_t file_size = 1024) {
+  return [calls, file_size](const string& filename, size_t offset, size_t n,
+                            char* buffer, size_t* bytes_transferred) {
+    ++*calls;
+    *bytes_transferred = 0;
+    for (size_t i = offset; i < offset + n && i < file_size; ++i) {
+      buffer[(*bytes_transferred)++] = 'a' + i % 26;
+    }
+    return OkStatus();
+  };
+}
+
+TEST(TieredFileBlockCacheTest, IsCacheEnabled) {
+  int calls = 0;
+  const string dir = CacheDir("IsCacheEnabled");
+  EXPECT_FALSE(
+      TieredFileBlockCache(0, 32, 0, dir, 32, CountingFetcher(&calls))
+          .IsCacheEnabled());
+  EXPECT_FALSE(TieredFileBlockCache(16, 0, 0, dir, 0, CountingFetcher(&calls))
+                   .IsCacheEnabled());
+  EXPECT_TRUE(TieredFileBlockCache(16, 32, 0, dir, 0, CountingFetcher(&calls))
+                  .IsCacheEnabled());
+  EXPECT_TRUE(TieredFileBlockCache(16, 0, 0, dir, 32, CountingFetcher(&calls))
+                  .IsCacheEnabled());
+}
+
+TEST(TieredFileBlockCacheTest, ReadsAcrossBlocks) {
+  int calls = 0;
+  TieredFileBlockCache cache(16, 0, 0, CacheDir("ReadsAcrossBlocks"), 1024,
+                             CountingFetcher(&calls));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "file", 10, 20, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "klmnopqrstuvwxyzabcd");
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(cache.DiskCacheSize(), 32);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 32, &out));
+  EXPECT_EQ(calls, 2);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 20, 4, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "uvwx");
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(TieredFileBlockCacheTest, RamTierInFrontOfDiskTier) {
+  int calls = 0;
+  const string dir = CacheDir("RamTierInFrontOfDiskTier");
+  TieredFileBlockCache cache(16, 32, 0, dir, 1024, CountingFetcher(&calls));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(cache.CacheSize(), 16);
+  EXPECT_EQ(NumBlockFiles(dir), 1);
+
+  // Hits the RAM tier, even without the block file.
+  int64_t undeleted_files, undeleted_dirs;
+  TF_ASSERT_OK(Env::Default()->DeleteRecursively(dir, &undeleted_files,
+                                                 &undeleted_dirs));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(TieredFileBlockCacheTest, BlocksSurviveTheCache) {
+  int calls = 0;
+  const string dir = CacheDir("BlocksSurviveTheCache");
+  std::vector<char> out;
+  {
+    TieredFileBlockCache cache(16, 32, 0, dir, 1024, CountingFetcher(&calls));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 0, 48, &out));
+    EXPECT_EQ(calls, 3);
+  }
+  // A new cache, e.g. of a restarted or other process, reads the blocks from
+  // the directory.
+  TieredFileBlockCache cache(16, 32, 0, dir, 1024, CountingFetcher(&calls));
+  EXPECT_EQ(cache.DiskCacheSize(), 48);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 8, 32, &out));
+  EXPECT_EQ(string(out.begin(), out.end()), "ijklmnopqrstuvwxyzabcdefghijklmn");
+  EXPECT_EQ(calls, 3);
+}
+
+TEST(TieredFileBlockCacheTest, DeletesStaleTempFiles) {
+  int calls = 0;
+  const string dir = CacheDir("DeletesStaleTempFiles");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(dir));
+  const string temp_file = io::JoinPath(dir, "block.blk_1.tmp");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), temp_file, "partial"));
+  NowSecondsEnv env;
+  env.SetNowSeconds(Env::Default()->NowSeconds());
+  {
+    // The file may still be written by another process.
+    TieredFileBlockCache cache(16, 0, 0, dir, 1024, CountingFetcher(&calls),
+                               &env);
+    TF_EXPECT_OK(Env::Default()->FileExists(temp_file));
+  }
+  env.SetNowSeconds(env.NowSeconds() + 3600);
+  TieredFileBlockCache cache(16, 0, 0, dir, 1024, CountingFetcher(&calls),
+                             &env);
+  EXPECT_EQ(NumBlockFiles(dir), 0);
+  EXPECT_EQ(cache.DiskCacheSize(), 0);
+}
+
+TEST(TieredFileBlockCacheTest, EvictsLeastRecentlyUsedBlocks) {
+  int calls = 0;
+  const string dir = CacheDir("EvictsLeastRecentlyUsedBlocks");
+  TieredFileBlockCache cache(16, 0, 0, dir, 32, CountingFetcher(&calls));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 16, 16, &out));
+  // Uses the first block, so that the second one is evicted.
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 2);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 32, 16, &out));
+  EXPECT_EQ(calls, 3);
+  EXPECT_EQ(cache.DiskCacheSize(), 32);
+  EXPECT_EQ(NumBlockFiles(dir), 2);
+
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 3);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 16, 16, &out));
+  EXPECT_EQ(calls, 4);
+}
+
+// Sets the access and modification times of the files in `dir` to
+// `access_age` and `modification_age` seconds ago.
+void AgeFiles(const string& dir, int access_age, int modification_age) {
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(dir, &children));
+  const time_t now = Env::Default()->NowSeconds();
+  const struct timespec times[2] = {{now - access_age, 0},
+                                    {now - modification_age, 0}};
+  for (const string& child : children) {
+    ASSERT_EQ(
+        utimensat(AT_FDCWD, io::JoinPath(dir, child).c_str(), times, 0), 0);
+  }
+}
+
+TEST(TieredFileBlockCacheTest, EvictsLeastRecentlyUsedBlocksAfterRestart) {
+  int calls = 0;
+  const string dir = CacheDir("EvictsLeastRecentlyUsedBlocksAfterRestart");
+  std::vector<char> out;
+  {
+    TieredFileBlockCache cache(16, 0, 0, dir, 1024, CountingFetcher(&calls));
+    TF_EXPECT_OK(ReadCache(&cache, "file", 0, 32, &out));
+    // Read after written, so that reads do not update the access time by
+    // themselves.
+    AgeFiles(dir, 100, 200);
+    TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+    EXPECT_EQ(calls, 2);
+  }
+  // A new cache with room for one block keeps the most recently used one.
+  TieredFileBlockCache cache(16, 0, 0, dir, 16, CountingFetcher(&calls));
+  EXPECT_EQ(NumBlockFiles(dir), 1);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(TieredFileBlockCacheTest, PartialBlockAtEndOfFile) {
+  int calls = 0;
+  TieredFileBlockCache cache(16, 0, 0, CacheDir("PartialBlockAtEndOfFile"),
+                             1024, CountingFetcher(&calls, 20));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "file", 10, 32, &out));
+  EXPECT_EQ(out.size(), 10);
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(cache.DiskCacheSize(), 20);
+  EXPECT_EQ(ReadCache(&cache, "file", 24, 8, &out).code(),
+            error::OUT_OF_RANGE);
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(TieredFileBlockCacheTest, ValidateAndUpdateFileSignature) {
+  int calls = 0;
+  const string dir = CacheDir("ValidateAndUpdateFileSignature");
+  TieredFileBlockCache cache(16, 32, 0, dir, 1024, CountingFetcher(&calls));
+  std::vector<char> out;
+  EXPECT_TRUE(cache.ValidateAndUpdateFileSignature("file", 123));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_TRUE(cache.ValidateAndUpdateFileSignature("file", 123));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 1);
+
+  // The blocks of the old signature are not read anymore.
+  EXPECT_FALSE(cache.ValidateAndUpdateFileSignature("file", 456));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(NumBlockFiles(dir), 2);
+
+  // Nor by another cache.
+  TieredFileBlockCache other_cache(16, 32, 0, dir, 1024,
+                                   CountingFetcher(&calls));
+  EXPECT_TRUE(other_cache.ValidateAndUpdateFileSignature("file", 456));
+  TF_EXPECT_OK(ReadCache(&other_cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 2);
+  EXPECT_TRUE(other_cache.ValidateAndUpdateFileSignature("other_file", 456));
+  TF_EXPECT_OK(ReadCache(&other_cache, "other_file", 0, 16, &out));
+  EXPECT_EQ(calls, 3);
+}
+
+TEST(TieredFileBlockCacheTest, MaxStaleness) {
+  int calls = 0;
+  const string dir = CacheDir("MaxStaleness");
+  NowSecondsEnv env;
+  env.SetNowSeconds(Env::Default()->NowSeconds());
+  std::vector<char> out;
+  TieredFileBlockCache cache(16, 0, 10, dir, 1024, CountingFetcher(&calls),
+                             &env);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 1);
+  env.SetNowSeconds(env.NowSeconds() + 100);
+  TF_EXPECT_OK(ReadCache(&cache, "file", 0, 16, &out));
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(TieredFileBlockCacheTest, RemoveFileAndFlush) {
+  int calls = 0;
+  const string dir = CacheDir("RemoveFileAndFlush");
+  TieredFileBlockCache cache(16, 32, 0, dir, 1024, CountingFetcher(&calls));
+  std::vector<char> out;
+  TF_EXPECT_OK(ReadCache(&cache, "a", 0, 32, &out));
+  TF_EXPECT_OK(ReadCache(&cache, "b", 0, 16, &out));
+  EXPECT_EQ(calls, 3);
+  EXPECT_EQ(NumBlockFiles(dir), 3);
+
+  cache.RemoveFile("a");
+  EXPECT_EQ(NumBlockFiles(dir), 1);
+  EXPECT_EQ(cache.DiskCacheSize(), 16);
+  TF_EXPECT_OK(ReadCache(&cache, "a", 0, 16, &out));
+  EXPECT_EQ(calls, 4);
+
+  cache.Flush();
+  EXPECT_EQ(NumBlockFiles(dir), 0);
+  EXPECT_EQ(cache.CacheSize(), 0);
+  EXPECT_EQ(cache.DiskCacheSize(), 0);
+  TF_EXPECT_OK(ReadCache(&cache, "b", 0, 16, &out));
+  EXPECT_EQ(calls, 5);
+}
+
+}  // namespace
+}  // namespace tsl
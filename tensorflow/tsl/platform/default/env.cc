@@ -35,6 +35,7 @@ limitations under the License.
 #include <thread>
 #include <vector>
 
+#include "tensorflow/tsl/platform/default/io_uring_file_system.h"
 #include "tensorflow/tsl/platform/default/posix_file_system.h"
 #include "tensorflow/tsl/platform/env.h"
 #include "tensorflow/tsl/platform/load_library.h"
@@ -247,7 +248,7 @@ class PosixEnv : public Env {
 }  // namespace
 
 #if defined(PLATFORM_POSIX) || defined(__APPLE__) || defined(__ANDROID__)
-REGISTER_FILE_SYSTEM("", PosixFileSystem);
+REGISTER_FILE_SYSTEM("", IoUringFileSystem);
 REGISTER_FILE_SYSTEM("file", LocalPosixFileSystem);
 REGISTER_FILE_SYSTEM("ram", RamFileSystem);
 
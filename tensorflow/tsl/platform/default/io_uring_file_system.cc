@@ -0,0 +1,665 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/platform/default/io_uring_file_system.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define TSL_IO_URING_AVAILABLE 1
+#endif
+#endif
+
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/logging.h"
+
+namespace tsl {
+namespace {
+
+// A file descriptor and the name of its file. Shared by a random access file
+// and its reads in flight, so that the descriptor is only closed, and cannot
+// be reused by another file, once they have all completed.
+struct OpenFile {
+  OpenFile(const string& filename, int fd) : filename(filename), fd(fd) {}
+
+  ~OpenFile() {
+    if (close(fd) < 0) {
+      LOG(ERROR) << "close() failed: " << strerror(errno);
+    }
+  }
+
+  const string filename;
+  const int fd;
+};
+
+}  // namespace
+
+#if defined(TSL_IO_URING_AVAILABLE)
+
+// A submission and completion ring pair shared by all files of an
+// `IoUringFileSystem`.
+//
+// Reads are queued by `Read()` and moved to the submission ring by whichever
+// thread is not already flushing it; reads queued while that thread is in
+// `io_uring_enter()` are submitted by its next call, so concurrent reads are
+// batched. A background thread reaps completions, resubmits short reads and
+// runs the callbacks.
+//
+// If `io_uring_enter()` fails with an error other than a transient one, the
+// reads that were not submitted fail with that error, and the ring is not
+// used anymore.
+class IoUring {
+ public:
+  // Returns nullptr if the kernel does not support io_uring.
+  static std::unique_ptr<IoUring> Create(unsigned entries);
+
+  ~IoUring();
+
+  // Reads `n` bytes at `offset` of `file` into `buf` and calls `done` from
+  // the completion thread. `file` is kept open until then.
+  void Read(std::shared_ptr<const OpenFile> file, uint64 offset, size_t n,
+            char* buf, RandomAccessFile::ReadCallback done);
+
+  // Returns false once submitting to the ring has failed.
+  bool ok();
+
+ private:
+  struct Request {
+    std::shared_ptr<const OpenFile> file;
+    uint64 offset;
+    char* buf;
+    size_t n;
+    size_t bytes_read = 0;
+    struct iovec iov;
+    RandomAccessFile::ReadCallback done;
+  };
+
+  IoUring(int ring_fd, const io_uring_params& params);
+
+  // Maps the rings into memory. Returns false on failure.
+  bool Map();
+
+  // Queues `request` and flushes the queue unless another thread is flushing
+  // it. Fails `request` if the ring is not usable anymore.
+  void Submit(Request* request);
+
+  // Submits queued requests until the queue is empty or the rings are full.
+  void Flush();
+
+  // Moves as many queued requests as fit onto the submission ring.
+  void FillSubmissionQueueLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if there are requests queued or on the submission ring.
+  bool HasUnsubmittedLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Takes back the requests that have not been submitted yet, and fails them
+  // and all later ones with `status`.
+  void FailUnsubmitted(const Status& status);
+
+  // Submits a no-op, so that the completion thread wakes up if it is waiting
+  // for completions.
+  void WakeCompletionThread();
+
+  void CompletionLoop();
+
+  // Handles the completion of `request` with the given `cqe->res`.
+  void Complete(Request* request, int result);
+
+  // Calls the callback of `request` with `status`, and deletes it.
+  static void Done(Request* request, const Status& status);
+
+  const int ring_fd_;
+  const io_uring_params params_;
+
+  void* sq_ring_ = MAP_FAILED;
+  void* cq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+  unsigned cq_mask_ = 0;
+
+  mutex mu_;
+  std::deque<Request*> queued_ TF_GUARDED_BY(mu_);
+  bool flushing_ TF_GUARDED_BY(mu_) = false;
+  // The number of entries, requests or no-ops, on the submission ring or
+  // submitted whose completion has not been reaped. Kept below the completion
+  // ring size so that completions never overflow.
+  unsigned in_flight_ TF_GUARDED_BY(mu_) = 0;
+  // The number of entries handed, or being handed, to the kernel whose
+  // completion has not been reaped. The completion thread only waits for
+  // completions while this is positive.
+  unsigned submitted_ TF_GUARDED_BY(mu_) = 0;
+  // Set once submitting has failed.
+  Status status_ TF_GUARDED_BY(mu_);
+  bool stopping_ TF_GUARDED_BY(mu_) = false;
+  condition_variable submitted_cv_;
+
+  std::unique_ptr<Thread> completion_thread_;
+};
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd < 0) {
+    VLOG(1) << "io_uring_setup() failed: " << strerror(errno);
+    return nullptr;
+  }
+  std::unique_ptr<IoUring> ring(new IoUring(ring_fd, params));
+  if (!ring->Map()) {
+    return nullptr;
+  }
+  IoUring* ring_ptr = ring.get();
+  ring->completion_thread_.reset(Env::Default()->StartThread(
+      ThreadOptions(), "io_uring_completions",
+      [ring_ptr]() { ring_ptr->CompletionLoop(); }));
+  return ring;
+}
+
+IoUring::IoUring(int ring_fd, const io_uring_params& params)
+    : ring_fd_(ring_fd), params_(params) {}
+
+IoUring::~IoUring() {
+  if (completion_thread_) {
+    {
+      mutex_lock l(mu_);
+      stopping_ = true;
+    }
+    submitted_cv_.notify_all();
+    WakeCompletionThread();
+    completion_thread_.reset();
+  }
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, params_.sq_entries * sizeof(io_uring_sqe));
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  close(ring_fd_);
+}
+
+bool IoUring::Map() {
+  sq_ring_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map the io_uring submission ring: "
+               << strerror(errno);
+    return false;
+  }
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  if (cq_ring_ == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map the io_uring completion ring: "
+               << strerror(errno);
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(mmap(
+      nullptr, params_.sq_entries * sizeof(io_uring_sqe),
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+      IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED) {
+    LOG(ERROR) << "Failed to map the io_uring submission entries: "
+               << strerror(errno);
+    return false;
+  }
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+  return true;
+}
+
+void IoUring::Read(std::shared_ptr<const OpenFile> file, uint64 offset,
+                   size_t n, char* buf, RandomAccessFile::ReadCallback done) {
+  Request* request = new Request;
+  request->file = std::move(file);
+  request->offset = offset;
+  request->buf = buf;
+  request->n = n;
+  request->done = std::move(done);
+  Submit(request);
+}
+
+bool IoUring::ok() {
+  mutex_lock l(mu_);
+  return status_.ok();
+}
+
+void IoUring::Submit(Request* request) {
+  {
+    mutex_lock l(mu_);
+    if (status_.ok()) {
+      queued_.push_back(request);
+      if (flushing_) return;
+      flushing_ = true;
+      request = nullptr;
+    }
+  }
+  if (request != nullptr) {
+    Done(request, errors::Unavailable("io_uring is not usable anymore"));
+    return;
+  }
+  Flush();
+}
+
+void IoUring::Flush() {
+  // The initial and max backoff, in microseconds, while the kernel is out of
+  // resources and there are no completions to wait for instead.
+  constexpr int64_t kMinBackoffMicros = 50;
+  constexpr int64_t kMaxBackoffMicros = 10 * 1000;
+  int64_t backoff_micros = kMinBackoffMicros;
+  while (true) {
+    unsigned to_submit;
+    {
+      mutex_lock l(mu_);
+      FillSubmissionQueueLocked();
+      to_submit = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+      if (to_submit == 0) {
+        flushing_ = false;
+        return;
+      }
+      // Counted before they are submitted, since they may complete before
+      // `io_uring_enter()` returns.
+      submitted_ += to_submit;
+    }
+    submitted_cv_.notify_all();
+    const int submitted =
+        syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, 0, nullptr, 0);
+    const int error = errno;
+    {
+      mutex_lock l(mu_);
+      submitted_ -= to_submit - std::max(submitted, 0);
+    }
+    if (submitted >= 0) {
+      backoff_micros = kMinBackoffMicros;
+      continue;
+    }
+    if (error == EINTR) continue;
+    if (error == EAGAIN || error == EBUSY) {
+      {
+        mutex_lock l(mu_);
+        if (submitted_ > 0) {
+          // The completion thread flushes again once it has reaped
+          // completions, which frees the kernel resources.
+          flushing_ = false;
+          return;
+        }
+      }
+      Env::Default()->SleepForMicroseconds(backoff_micros);
+      backoff_micros = std::min(2 * backoff_micros, kMaxBackoffMicros);
+      continue;
+    }
+    const Status status = errors::IOError("io_uring_enter()", error);
+    LOG(ERROR) << "Failed to submit reads, no longer using io_uring: "
+               << status;
+    FailUnsubmitted(status);
+    return;
+  }
+}
+
+void IoUring::FillSubmissionQueueLocked() {
+  unsigned tail = *sq_tail_;
+  const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  while (!queued_.empty() && tail - head < params_.sq_entries &&
+         in_flight_ < params_.cq_entries) {
+    Request* request = queued_.front();
+    queued_.pop_front();
+    const unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    request->iov.iov_base = request->buf + request->bytes_read;
+    request->iov.iov_len = request->n - request->bytes_read;
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = request->file->fd;
+    sqe->off = request->offset + request->bytes_read;
+    sqe->addr = reinterpret_cast<uintptr_t>(&request->iov);
+    sqe->len = 1;
+    sqe->user_data = reinterpret_cast<uintptr_t>(request);
+    sq_array_[index] = index;
+    ++tail;
+    ++in_flight_;
+  }
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+}
+
+bool IoUring::HasUnsubmittedLocked() {
+  return !queued_.empty() ||
+         *sq_tail_ != __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+}
+
+void IoUring::FailUnsubmitted(const Status& status) {
+  std::vector<Request*> failed;
+  {
+    mutex_lock l(mu_);
+    status_ = status;
+    flushing_ = false;
+    // Without SQPOLL, the kernel only consumes submission entries in
+    // `io_uring_enter()`, which nobody else calls with entries to submit, so
+    // the entries past the head can be taken back.
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    const unsigned tail = *sq_tail_;
+    for (unsigned i = head; i != tail; ++i) {
+      Request* request =
+          reinterpret_cast<Request*>(sqes_[sq_array_[i & sq_mask_]].user_data);
+      // The no-ops of `WakeCompletionThread()` have no request.
+      if (request != nullptr) {
+        failed.push_back(request);
+      }
+    }
+    __atomic_store_n(sq_tail_, head, __ATOMIC_RELEASE);
+    in_flight_ -= tail - head;
+    failed.insert(failed.end(), queued_.begin(), queued_.end());
+    queued_.clear();
+  }
+  for (Request* request : failed) {
+    Done(request, status);
+  }
+}
+
+void IoUring::WakeCompletionThread() {
+  mutex_lock l(mu_);
+  const unsigned tail = *sq_tail_;
+  // If either ring is full, completions are pending and wake it up anyway.
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >=
+          params_.sq_entries ||
+      in_flight_ >= params_.cq_entries) {
+    return;
+  }
+  const unsigned index = tail & sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_NOP;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  // Its completion is reaped like those of the requests.
+  ++in_flight_;
+  const int submitted =
+      syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+  if (submitted > 0) {
+    submitted_ += submitted;
+  }
+}
+
+void IoUring::CompletionLoop() {
+  // The initial and max backoff, in microseconds, after a failure to wait for
+  // completions.
+  constexpr int64_t kMinBackoffMicros = 50;
+  constexpr int64_t kMaxBackoffMicros = 100 * 1000;
+  int64_t backoff_micros = kMinBackoffMicros;
+  std::vector<std::pair<Request*, int>> completions;
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      while (submitted_ == 0 && !stopping_) {
+        submitted_cv_.wait(l);
+      }
+      if (submitted_ == 0) return;
+    }
+    if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS,
+                nullptr, 0) < 0 &&
+        errno != EINTR) {
+      LOG(ERROR) << "io_uring_enter() failed: " << strerror(errno);
+      {
+        mutex_lock l(mu_);
+        if (stopping_) return;
+      }
+      Env::Default()->SleepForMicroseconds(backoff_micros);
+      backoff_micros = std::min(2 * backoff_micros, kMaxBackoffMicros);
+    } else {
+      backoff_micros = kMinBackoffMicros;
+    }
+    completions.clear();
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      completions.emplace_back(reinterpret_cast<Request*>(cqe.user_data),
+                               cqe.res);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    bool flush = false;
+    {
+      mutex_lock l(mu_);
+      in_flight_ -= completions.size();
+      submitted_ -= completions.size();
+      // Submissions may have stopped because the rings were full.
+      if (status_.ok() && HasUnsubmittedLocked() && !flushing_) {
+        flushing_ = flush = true;
+      }
+    }
+    if (flush) Flush();
+
+    for (const auto& completion : completions) {
+      // The no-ops of `WakeCompletionThread()` have no request.
+      if (completion.first != nullptr) {
+        Complete(completion.first, completion.second);
+      }
+    }
+  }
+}
+
+void IoUring::Complete(Request* request, int result) {
+  if (result == -EINTR || result == -EAGAIN) {
+    Submit(request);
+    return;
+  }
+  Status s;
+  if (result < 0) {
+    s = errors::IOError(request->file->filename, -result);
+  } else {
+    request->bytes_read += result;
+    if (request->bytes_read < request->n) {
+      if (result > 0) {
+        // Short read: read the rest.
+        Submit(request);
+        return;
+      }
+      s = errors::OutOfRange("Read less bytes than requested");
+    }
+  }
+  Done(request, s);
+}
+
+void IoUring::Done(Request* request, const Status& status) {
+  std::unique_ptr<Request> done_request(request);
+  done_request->done(
+      status, StringPiece(done_request->buf, done_request->bytes_read));
+}
+
+#else  // defined(TSL_IO_URING_AVAILABLE)
+
+class IoUring {
+ public:
+  static std::unique_ptr<IoUring> Create(unsigned entries) { return nullptr; }
+
+  void Read(std::shared_ptr<const OpenFile> file, uint64 offset, size_t n,
+            char* buf, RandomAccessFile::ReadCallback done) {}
+
+  bool ok() { return false; }
+};
+
+#endif  // defined(TSL_IO_URING_AVAILABLE)
+
+namespace {
+
+// The number of entries of the submission ring.
+constexpr unsigned kRingEntries = 256;
+
+bool IoUringEnabledByEnv() {
+  const char* value = getenv("TF_FILESYSTEM_USE_IO_URING");
+  return value != nullptr &&
+         (strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0);
+}
+
+// Reads synchronously with `pread()`, like `PosixRandomAccessFile`, and
+// asynchronously through the ring.
+class IoUringRandomAccessFile : public RandomAccessFile {
+ public:
+  IoUringRandomAccessFile(const string& filename, int fd,
+                          std::shared_ptr<IoUring> ring)
+      : file_(std::make_shared<OpenFile>(filename, fd)),
+        ring_(std::move(ring)) {}
+
+  Status Name(StringPiece* result) const override {
+    *result = file_->filename;
+    return OkStatus();
+  }
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    Status s;
+    char* dst = scratch;
+    while (n > 0 && s.ok()) {
+      const size_t requested_read_length = std::min<size_t>(n, INT32_MAX);
+      const ssize_t r = pread(file_->fd, dst, requested_read_length,
+                              static_cast<off_t>(offset));
+      if (r > 0) {
+        dst += r;
+        n -= r;
+        offset += r;
+      } else if (r == 0) {
+        s = errors::OutOfRange("Read less bytes than requested");
+      } else if (errno != EINTR && errno != EAGAIN) {
+        s = errors::IOError(file_->filename, errno);
+      }
+    }
+    *result = StringPiece(scratch, dst - scratch);
+    return s;
+  }
+
+  void ReadAsync(uint64 offset, size_t n, char* scratch,
+                 ReadCallback done) const override {
+    if (n == 0) {
+      done(OkStatus(), StringPiece());
+      return;
+    }
+    if (!ring_->ok()) {
+      RandomAccessFile::ReadAsync(offset, n, scratch, std::move(done));
+      return;
+    }
+    ring_->Read(file_, offset, n, scratch, std::move(done));
+  }
+
+#if defined(TF_CORD_SUPPORT)
+  Status Read(uint64 offset, size_t n, absl::Cord* cord) const override {
+    if (n == 0) {
+      return OkStatus();
+    }
+    char* scratch = new char[n];
+    StringPiece tmp;
+    Status s = Read(offset, n, &tmp, scratch);
+    cord->Append(absl::MakeCordFromExternal(
+        absl::string_view(scratch, tmp.size()),
+        [scratch](absl::string_view) { delete[] scratch; }));
+    return s;
+  }
+#endif
+
+ private:
+  // Shared with the reads in flight, which may outlive this file.
+  const std::shared_ptr<const OpenFile> file_;
+  const std::shared_ptr<IoUring> ring_;
+};
+
+}  // namespace
+
+IoUringFileSystem::IoUringFileSystem()
+    : IoUringFileSystem(IoUringEnabledByEnv()) {}
+
+IoUringFileSystem::IoUringFileSystem(bool use_io_uring)
+    : use_io_uring_(use_io_uring) {}
+
+IoUringFileSystem::~IoUringFileSystem() {}
+
+Status IoUringFileSystem::NewRandomAccessFile(
+    const string& filename, TransactionToken* token,
+    std::unique_ptr<RandomAccessFile>* result) {
+  std::shared_ptr<IoUring> ring = GetRing();
+  if (ring == nullptr) {
+    return PosixFileSystem::NewRandomAccessFile(filename, token, result);
+  }
+  const string translated_fname = TranslateName(filename);
+  const int fd = open(translated_fname.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return errors::IOError(filename, errno);
+  }
+  *result = std::make_unique<IoUringRandomAccessFile>(translated_fname, fd,
+                                                      std::move(ring));
+  return OkStatus();
+}
+
+bool IoUringFileSystem::UsesIoUring() { return GetRing() != nullptr; }
+
+std::shared_ptr<IoUring> IoUringFileSystem::GetRing() {
+  mutex_lock l(mu_);
+  if (!ring_initialized_) {
+    ring_initialized_ = true;
+    if (use_io_uring_) {
+      ring_ = IoUring::Create(kRingEntries);
+      if (ring_ == nullptr) {
+        LOG(WARNING) << "io_uring is not supported by this kernel; reading "
+                        "files with pread() instead.";
+      }
+    }
+  }
+  return ring_;
+}
+
+}  // namespace tsl
@@ -0,0 +1,73 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_PLATFORM_DEFAULT_IO_URING_FILE_SYSTEM_H_
+#define TENSORFLOW_TSL_PLATFORM_DEFAULT_IO_URING_FILE_SYSTEM_H_
+
+#include <memory>
+
+#include "tensorflow/tsl/platform/default/posix_file_system.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/thread_annotations.h"
+
+namespace tsl {
+
+class IoUring;
+
+// A PosixFileSystem whose random access files implement
+// `RandomAccessFile::ReadAsync()` with Linux io_uring.
+//
+// All files share a single ring. Reads started concurrently are queued and
+// handed to the kernel with a single `io_uring_enter()` call, and their
+// completions are dispatched by a background thread, so readers can keep
+// many reads in flight without a thread (or a syscall) per read. `Read()`
+// still uses `pread()`, as a blocking read gains nothing from the ring.
+//
+// io_uring is only used on Linux kernels that support it, and if enabled by
+// the `TF_FILESYSTEM_USE_IO_URING` environment variable (or the constructor
+// argument). Otherwise this behaves exactly like `PosixFileSystem`.
+class IoUringFileSystem : public PosixFileSystem {
+ public:
+  // Uses io_uring if `TF_FILESYSTEM_USE_IO_URING` is set to "1" or "true".
+  IoUringFileSystem();
+  explicit IoUringFileSystem(bool use_io_uring);
+
+  ~IoUringFileSystem() override;
+
+  TF_USE_FILESYSTEM_METHODS_WITH_NO_TRANSACTION_SUPPORT;
+
+  Status NewRandomAccessFile(
+      const string& filename, TransactionToken* token,
+      std::unique_ptr<RandomAccessFile>* result) override;
+
+  // Returns true if random access files of this filesystem read through
+  // io_uring, i.e. if it is enabled and supported by the kernel.
+  bool UsesIoUring();
+
+ private:
+  // Returns the ring, creating it on first use. Returns nullptr if io_uring
+  // is disabled or not supported.
+  std::shared_ptr<IoUring> GetRing() TF_LOCKS_EXCLUDED(mu_);
+
+  const bool use_io_uring_;
+
+  mutex mu_;
+  bool ring_initialized_ TF_GUARDED_BY(mu_) = false;
+  std::shared_ptr<IoUring> ring_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_PLATFORM_DEFAULT_IO_URING_FILE_SYSTEM_H_
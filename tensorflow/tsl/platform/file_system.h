@@ -765,6 +765,29 @@ class RandomAccessFile {
   virtual tsl::Status Read(uint64 offset, size_t n, StringPiece* result,
                            char* scratch) const = 0;
 
+  /// \brief Called when a `ReadAsync()` completes, with the status and the
+  /// data that was read. Both have the same semantics as the return value and
+  /// `*result` of `Read()`.
+  using ReadCallback = std::function<void(const tsl::Status&, StringPiece)>;
+
+  /// \brief Starts reading up to `n` bytes from the file starting at
+  /// `offset`, and calls `done` once the read completes.
+  ///
+  /// `scratch[0..n-1]` may be written by this routine and must stay live until
+  /// `done` returns. `done` may be called on any thread, including the calling
+  /// thread before `ReadAsync()` returns.
+  ///
+  /// The default implementation calls `Read()` synchronously. Filesystems that
+  /// can overlap reads without a thread per read should override it.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual void ReadAsync(uint64 offset, size_t n, char* scratch,
+                         ReadCallback done) const {
+    StringPiece result;
+    tsl::Status s = Read(offset, n, &result, scratch);
+    done(s, result);
+  }
+
 #if defined(TF_CORD_SUPPORT)
   /// \brief Read up to `n` bytes from the file starting at `offset`.
   virtual tsl::Status Read(uint64 offset, size_t n, absl::Cord* cord) const {
@@ -0,0 +1,185 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/tsl/platform/default/io_uring_file_system.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/tsl/lib/core/status_test_util.h"
+#include "tensorflow/tsl/platform/env.h"
+#include "tensorflow/tsl/platform/errors.h"
+#include "tensorflow/tsl/platform/mutex.h"
+#include "tensorflow/tsl/platform/test.h"
+
+namespace tsl {
+namespace {
+
+constexpr int kFileSize = 100000;
+
+class IoUringFileSystemTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!fs_.UsesIoUring()) {
+      GTEST_SKIP() << "io_uring is not supported";
+    }
+    contents_.resize(kFileSize);
+    for (int i = 0; i < kFileSize; ++i) {
+      contents_[i] = static_cast<char>(i % 251);
+    }
+    ASSERT_TRUE(Env::Default()->LocalTempFilename(&fname_));
+    TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname_, contents_));
+  }
+
+  // Reads `n` bytes at `offset` with `ReadAsync()` and waits for the result.
+  Status ReadAsync(RandomAccessFile* file, uint64 offset, size_t n,
+                   char* scratch, StringPiece* result) {
+    mutex mu;
+    condition_variable cv;
+    bool done = false;
+    Status status;
+    file->ReadAsync(offset, n, scratch,
+                    [&](const Status& s, StringPiece data) {
+                      mutex_lock l(mu);
+                      status = s;
+                      *result = data;
+                      done = true;
+                      cv.notify_all();
+                    });
+    mutex_lock l(mu);
+    while (!done) cv.wait(l);
+    return status;
+  }
+
+  IoUringFileSystem fs_{/*use_io_uring=*/true};
+  std::string fname_;
+  std::string contents_;
+};
+
+TEST_F(IoUringFileSystemTest, ReadAsync) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(fs_.NewRandomAccessFile(fname_, nullptr, &file));
+  std::vector<char> scratch(1000);
+  StringPiece result;
+  for (uint64 offset : {0, 1, 5000, 99000}) {
+    TF_ASSERT_OK(
+        ReadAsync(file.get(), offset, scratch.size(), scratch.data(), &result));
+    EXPECT_EQ(result, StringPiece(contents_).substr(offset, scratch.size()));
+  }
+  TF_ASSERT_OK(ReadAsync(file.get(), 0, 0, scratch.data(), &result));
+  EXPECT_TRUE(result.empty());
+}
+
+TEST_F(IoUringFileSystemTest, ReadAsyncPastEndOfFile) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(fs_.NewRandomAccessFile(fname_, nullptr, &file));
+  std::vector<char> scratch(1000);
+  StringPiece result;
+  EXPECT_TRUE(errors::IsOutOfRange(ReadAsync(
+      file.get(), kFileSize - 300, scratch.size(), scratch.data(), &result)));
+  EXPECT_EQ(result, StringPiece(contents_).substr(kFileSize - 300));
+  EXPECT_TRUE(errors::IsOutOfRange(ReadAsync(
+      file.get(), kFileSize + 10, scratch.size(), scratch.data(), &result)));
+  EXPECT_TRUE(result.empty());
+}
+
+TEST_F(IoUringFileSystemTest, ConcurrentReadAsync) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(fs_.NewRandomAccessFile(fname_, nullptr, &file));
+  // More reads than ring entries, so that some of them are queued.
+  constexpr int kNumReads = 1000;
+  constexpr int kReadSize = 100;
+  std::vector<char> scratch(kNumReads * kReadSize);
+  mutex mu;
+  condition_variable cv;
+  int num_done = 0;
+  std::vector<Status> statuses(kNumReads);
+  std::vector<StringPiece> results(kNumReads);
+  for (int i = 0; i < kNumReads; ++i) {
+    file->ReadAsync(i * kReadSize, kReadSize, &scratch[i * kReadSize],
+                    [&, i](const Status& s, StringPiece data) {
+                      mutex_lock l(mu);
+                      statuses[i] = s;
+                      results[i] = data;
+                      ++num_done;
+                      cv.notify_all();
+                    });
+  }
+  {
+    mutex_lock l(mu);
+    while (num_done < kNumReads) cv.wait(l);
+  }
+  for (int i = 0; i < kNumReads; ++i) {
+    TF_EXPECT_OK(statuses[i]);
+    EXPECT_EQ(results[i],
+              StringPiece(contents_).substr(i * kReadSize, kReadSize));
+  }
+}
+
+TEST_F(IoUringFileSystemTest, FileDestroyedWithReadsInFlight) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(fs_.NewRandomAccessFile(fname_, nullptr, &file));
+  constexpr int kNumReads = 1000;
+  constexpr int kReadSize = 100;
+  std::vector<char> scratch(kNumReads * kReadSize);
+  mutex mu;
+  condition_variable cv;
+  int num_done = 0;
+  std::vector<Status> statuses(kNumReads);
+  for (int i = 0; i < kNumReads; ++i) {
+    file->ReadAsync(i * kReadSize, kReadSize, &scratch[i * kReadSize],
+                    [&, i](const Status& s, StringPiece data) {
+                      mutex_lock l(mu);
+                      statuses[i] = s;
+                      ++num_done;
+                      cv.notify_all();
+                    });
+  }
+  file.reset();
+  // Would reuse the file descriptor of `file` if it was closed already.
+  std::string other_fname;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&other_fname));
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), other_fname,
+                                 std::string(kFileSize, 'x')));
+  std::unique_ptr<RandomAccessFile> other_file;
+  TF_ASSERT_OK(fs_.NewRandomAccessFile(other_fname, nullptr, &other_file));
+  {
+    mutex_lock l(mu);
+    while (num_done < kNumReads) cv.wait(l);
+  }
+  for (int i = 0; i < kNumReads; ++i) {
+    TF_EXPECT_OK(statuses[i]);
+  }
+  EXPECT_EQ(StringPiece(scratch.data(), scratch.size()),
+            StringPiece(contents_).substr(0, scratch.size()));
+}
+
+TEST_F(IoUringFileSystemTest, Read) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(fs_.NewRandomAccessFile(fname_, nullptr, &file));
+  std::vector<char> scratch(1000);
+  StringPiece result;
+  TF_ASSERT_OK(file->Read(4000, scratch.size(), &result, scratch.data()));
+  EXPECT_EQ(result, StringPiece(contents_).substr(4000, scratch.size()));
+}
+
+TEST(IoUringFileSystemDisabledTest, FallsBackToPosix) {
+  IoUringFileSystem fs(/*use_io_uring=*/false);
+  EXPECT_FALSE(fs.UsesIoUring());
+}
+
+}  // namespace
+}  // namespace tsl